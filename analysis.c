@@ -0,0 +1,166 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "string.h"
+#include "position.h"
+#include "search.h"
+#include "triple_buffer.h"
+#include "analysis.h"
+
+static void
+begin(struct Analysis *analysis, const struct Position *pos) {
+  struct Search *search = analysis->search;
+  struct SearchLimits limits = {.depth = SEARCH_MAX_PLY - 1};
+  search_stop(search);
+  search_set_position(search, pos);
+  search_start(search, &limits);
+}
+
+static void
+publish(struct Analysis *analysis, uint64_t hash) {
+  const struct Search *search = analysis->search;
+  struct AnalysisReport *report = triple_buffer_back(&analysis->reports);
+  report->hash = hash;
+  report->depth = search->depth;
+  report->nodes = search->nodes;
+  report->line_count = search->line_count;
+  for (int i = 0; i < search->line_count; i++) {
+    const struct SearchLine *line = &search->best_lines[i];
+    struct AnalysisLine *out = &report->lines[i];
+    out->score = line->score;
+    out->length = MIN(line->length, ANALYSIS_LINE_MOVES);
+    memcpy(out->moves, line->moves, out->length * sizeof (Move));
+  }
+  triple_buffer_publish(&analysis->reports);
+}
+
+static void
+init(struct Analysis *analysis, struct Search *search, int lines) {
+  memset(analysis->slots, 0, sizeof analysis->slots);
+  triple_buffer_init(&analysis->reports, &analysis->slots[0], &analysis->slots[1], &analysis->slots[2]);
+  analysis->search = search;
+  search->multi_pv = MAX(1, MIN(lines, SEARCH_MAX_LINES));
+  analysis->generation = 0;
+  analysis->searched = 0;
+  analysis->running = 1;
+}
+
+const struct AnalysisReport *
+analysis_read(struct Analysis *analysis) {
+  return triple_buffer_read(&analysis->reports);
+}
+
+#ifdef NO_THREADS
+
+int
+analysis_start(struct Analysis *analysis, struct Search *search, int lines) {
+  init(analysis, search, lines);
+  return 0;
+}
+
+void
+analysis_stop(struct Analysis *analysis) {
+  search_stop(analysis->search);
+  analysis->running = 0;
+}
+
+void
+analysis_set_position(struct Analysis *analysis, const struct Position *pos) {
+  if (analysis->generation == 0 || pos->hash != analysis->requested.hash) {
+    analysis->requested = *pos;
+    analysis->generation++;
+  }
+}
+
+void
+analysis_frame(struct Analysis *analysis, int64_t budget_us) {
+  if (analysis->generation != analysis->searched) {
+    analysis->searched = analysis->generation;
+    begin(analysis, &analysis->requested);
+  }
+  if (analysis->search->running) {
+    search_slice(analysis->search, budget_us);
+    publish(analysis, analysis->requested.hash);
+  }
+}
+
+#else
+
+static void *
+analysis_thread_main(void *arg) {
+  struct Analysis *analysis = arg;
+  struct Position pos;
+
+  for (;;) {
+    // Sleeps once the search has run out of depth, until there's something new
+    pthread_mutex_lock(&analysis->lock);
+    while (analysis->running && analysis->generation == analysis->searched && !analysis->search->running) {
+      pthread_cond_wait(&analysis->changed, &analysis->lock);
+    }
+    if (!analysis->running) {
+      pthread_mutex_unlock(&analysis->lock);
+      break;
+    }
+    int fresh = analysis->generation != analysis->searched;
+    if (fresh) {
+      pos = analysis->requested;
+      analysis->searched = analysis->generation;
+    }
+    pthread_mutex_unlock(&analysis->lock);
+
+    if (fresh) {
+      begin(analysis, &pos);
+    }
+    search_slice(analysis->search, ANALYSIS_SLICE_US);
+    publish(analysis, pos.hash);
+  }
+
+  search_stop(analysis->search);
+  return NULL;
+}
+
+int
+analysis_start(struct Analysis *analysis, struct Search *search, int lines) {
+  init(analysis, search, lines);
+  pthread_mutex_init(&analysis->lock, NULL);
+  pthread_cond_init(&analysis->changed, NULL);
+  if (pthread_create(&analysis->thread, NULL, analysis_thread_main, analysis) != 0) {
+    printf("could not start the analysis thread\n");
+    analysis->running = 0;
+    pthread_mutex_destroy(&analysis->lock);
+    pthread_cond_destroy(&analysis->changed);
+    return -1;
+  }
+  return 0;
+}
+
+void
+analysis_stop(struct Analysis *analysis) {
+  pthread_mutex_lock(&analysis->lock);
+  analysis->running = 0;
+  pthread_cond_signal(&analysis->changed);
+  pthread_mutex_unlock(&analysis->lock);
+
+  pthread_join(analysis->thread, NULL);
+  pthread_mutex_destroy(&analysis->lock);
+  pthread_cond_destroy(&analysis->changed);
+}
+
+void
+analysis_set_position(struct Analysis *analysis, const struct Position *pos) {
+  pthread_mutex_lock(&analysis->lock);
+  if (analysis->generation == 0 || pos->hash != analysis->requested.hash) {
+    analysis->requested = *pos;
+    analysis->generation++;
+    pthread_cond_signal(&analysis->changed);
+  }
+  pthread_mutex_unlock(&analysis->lock);
+}
+
+void
+analysis_frame(struct Analysis *analysis, int64_t budget_us) {
+  // The thread has it
+  (void)analysis;
+  (void)budget_us;
+}
+
+#endif
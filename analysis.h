@@ -0,0 +1,71 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "stdint.h"
+#include "position.h"
+#include "search.h"
+#include "triple_buffer.h"
+
+#ifndef NO_THREADS
+#include "pthread.h"
+#endif
+
+// Analysis mode: keeps searching whatever position it was given last for its best few lines,
+// on an engine thread of its own, and hands the newest results to the render thread through
+// a triple buffer so drawing never waits on it. A new position just stops the search and
+// starts another with the same table and history, so after a move the lines that were
+// already searched come straight back out of the table and depth builds on what was there.
+//
+// Built with -DNO_THREADS there's no thread, analysis_frame runs a slice of the search on
+// the caller instead.
+
+#define ANALYSIS_LINE_MOVES 8 // of each line that get handed over
+#define ANALYSIS_SLICE_US 20000 // the thread looks for a new position this often
+
+struct AnalysisLine {
+  int score; // centipawns for the side to move
+  int length;
+  Move moves[ANALYSIS_LINE_MOVES];
+};
+
+struct AnalysisReport {
+  uint64_t hash; // of the position the lines are for, 0 before there's any
+  int depth;
+  uint64_t nodes; // on this position so far
+  int line_count;
+  struct AnalysisLine lines[SEARCH_MAX_LINES]; // best first
+};
+
+struct Analysis {
+  struct Search *search; // only the engine thread touches it once started
+  struct TripleBuffer reports;
+  struct AnalysisReport slots[3];
+
+  // From the render thread, under lock when there's a thread
+  struct Position requested;
+  uint64_t generation; // bumped for every new position
+  uint64_t searched; // the generation the search has
+  int running;
+#ifndef NO_THREADS
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+#endif
+};
+
+// search needs a table to carry anything over from one position to the next, lines is 1
+// to SEARCH_MAX_LINES. Nothing gets searched until there's a position. Returns -1 if the
+// thread couldn't be started, then there's nothing to stop.
+int analysis_start(struct Analysis *analysis, struct Search *search, int lines);
+// Waits for the slice in progress
+void analysis_stop(struct Analysis *analysis);
+
+// Cheap when it's the position already being analysed, so it can be called every frame
+void analysis_set_position(struct Analysis *analysis, const struct Position *pos);
+// From the render thread every frame, only does anything without threads
+void analysis_frame(struct Analysis *analysis, int64_t budget_us);
+
+// The newest report, valid until the next call
+const struct AnalysisReport *analysis_read(struct Analysis *analysis);
+
+#endif
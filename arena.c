@@ -0,0 +1,41 @@
+#include "stddef.h"
+#include "stdint.h"
+#include "string.h"
+#include "assert.h"
+#include "arena.h"
+
+void
+arena_init(struct Arena *arena, void *memory, size_t size) {
+  arena->base = memory;
+  arena->size = size;
+  arena->used = 0;
+  arena->high_water = 0;
+}
+
+void *
+arena_alloc(struct Arena *arena, size_t size, size_t align) {
+  assert(align != 0 && (align & (align - 1)) == 0); // has to be a power of two
+
+  uintptr_t current = (uintptr_t)(arena->base + arena->used);
+  size_t padding = (align - (current & (align - 1))) & (align - 1);
+
+  if (arena->used + padding + size > arena->size) {
+    return NULL;
+  }
+
+  void *result = arena->base + arena->used + padding;
+  arena->used += padding + size;
+  if (arena->used > arena->high_water) {
+    arena->high_water = arena->used;
+  }
+  return result;
+}
+
+void *
+arena_alloc_zero(struct Arena *arena, size_t size, size_t align) {
+  void *result = arena_alloc(arena, size, align);
+  if (result != NULL) {
+    memset(result, 0, size);
+  }
+  return result;
+}
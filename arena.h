@@ -0,0 +1,44 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "stddef.h"
+#include "stdint.h"
+
+// Linear allocator over one block of memory that somebody else owns.
+// Allocating bumps an offset, freeing is resetting the whole thing (or rewinding to a mark),
+// so a game or a frame can throw away everything it allocated in O(1)
+struct Arena {
+  uint8_t *base;
+  size_t size;
+  size_t used;
+  size_t high_water; // most that has ever been used, to size the block
+};
+
+void arena_init(struct Arena *arena, void *memory, size_t size);
+
+// Returns NULL when the block is full, callers decide if that's fatal
+void *arena_alloc(struct Arena *arena, size_t size, size_t align);
+void *arena_alloc_zero(struct Arena *arena, size_t size, size_t align);
+
+static inline void
+arena_reset(struct Arena *arena) {
+  arena->used = 0;
+}
+
+static inline size_t
+arena_mark(const struct Arena *arena) {
+  return arena->used;
+}
+
+static inline void
+arena_rewind(struct Arena *arena, size_t mark) {
+  arena->used = mark;
+}
+
+#define ARENA_ALLOC_ARRAY(arena, type, count) \
+  ((type *)arena_alloc((arena), sizeof (type) * (size_t)(count), __alignof__(type)))
+
+#define ARENA_ALLOC_ZERO_ARRAY(arena, type, count) \
+  ((type *)arena_alloc_zero((arena), sizeof (type) * (size_t)(count), __alignof__(type)))
+
+#endif
@@ -0,0 +1,207 @@
+#include "stdint.h"
+#include "string.h"
+#include "chess.h"
+#include "piece_defs.h"
+#include "game.h"
+#include "attacks.h"
+
+// Walks the piece's targets like game_piece_moves, but keeps every square it could capture on
+// whoever is standing there, and skips offsets it can only move along
+static SquareSet
+walk_attacks(const struct Game *game, int piece) {
+  const struct ChessPieces *pieces = &game->pieces;
+  if (pieces->is_dead[piece]) {
+    return 0;
+  }
+
+  int index = piece_table_index(&piece_tables, pieces->owners[piece], pieces->chess_type[piece], pieces->squares[piece]);
+  const struct PieceTarget *target = &piece_tables.targets[piece_tables.starts[index]];
+  const struct PieceTarget *end = target + piece_tables.counts[index];
+  const uint8_t *occupied = game->cells.occupied_states;
+  SquareSet attacks = 0;
+
+  while (target < end) {
+    if (target->flags & PIECE_MOVE_ONLY) {
+      target += target->skip;
+      continue;
+    }
+    attacks |= SQUARE_BIT(target->square);
+    target += occupied[target->square] ? target->skip : 1;
+  }
+  return attacks;
+}
+
+static void
+set_attacks(struct AttackMap *map, int piece, SquareSet attacks) {
+  PieceSet bit = PIECE_BIT(piece);
+  SquareSet removed = map->piece_attacks[piece] & ~attacks;
+  SquareSet added = attacks & ~map->piece_attacks[piece];
+
+  map->changed |= removed | added;
+  while (removed) {
+    map->attackers[__builtin_ctzll(removed)] &= ~bit;
+    removed &= removed - 1;
+  }
+  while (added) {
+    map->attackers[__builtin_ctzll(added)] |= bit;
+    added &= added - 1;
+  }
+  map->piece_attacks[piece] = attacks;
+}
+
+void
+attack_map_build(struct AttackMap *map, const struct Game *game) {
+  memset(map, 0, sizeof *map);
+  for (int piece = 0; piece < game->num_pieces; piece++) {
+    set_attacks(map, piece, walk_attacks(game, piece));
+  }
+  map->changed = ~0ull >> (64 - N_CELLS);
+}
+
+void
+attack_map_move(struct AttackMap *map, const struct Game *game, int piece, Square from, Square to, int captured) {
+  // Lines through from can now go further, lines into to stop earlier (or at somebody else)
+  PieceSet stale = map->attackers[from] | map->attackers[to] | PIECE_BIT(piece);
+  map->changed |= SQUARE_BIT(from) | SQUARE_BIT(to);
+  if (captured >= 0) {
+    stale |= PIECE_BIT(captured);
+  }
+
+  while (stale) {
+    int id = __builtin_ctzll(stale);
+    set_attacks(map, id, walk_attacks(game, id));
+    stale &= stale - 1;
+  }
+}
+
+SquareSet
+threats_update(struct Threats *threats, struct AttackMap *map, const struct Game *game) {
+  // A square's overlay only depends on who attacks it and who stands on it
+  SquareSet redo = map->changed;
+  map->changed = 0;
+
+  SquareSet remaining = redo;
+  while (remaining) {
+    int square = __builtin_ctzll(remaining);
+    remaining &= remaining - 1;
+
+    PieceSet attackers = map->attackers[square];
+    uint8_t attacked_by = 0;
+    for (int player = 0; player < game->num_players; player++) {
+      attacked_by |= (uint8_t)((attackers & player_pieces(player)) != 0) << player;
+    }
+    threats->attacked_by[square] = attacked_by;
+
+    threats->hanging &= ~SQUARE_BIT(square);
+    if (game->cells.occupied_states[square]) {
+      int owner = game->cells.cell_player_states[square];
+      if ((attacked_by & ~(1u << owner)) && !(attacked_by & (1u << owner))) {
+        threats->hanging |= SQUARE_BIT(square);
+      }
+    }
+  }
+  return redo;
+}
+
+static int
+find_king(const struct Game *game, int player) {
+  const int *live_pieces = &game->players.live_pieces[player * N_PIECES];
+  for (int i = 0; i < game->players.live_piece_counts[player]; i++) {
+    if (game->pieces.chess_type[live_pieces[i]] == KING) {
+      return live_pieces[i];
+    }
+  }
+  return -1;
+}
+
+// Follows every offset of an enemy piece that passes over the king, counting what's in between.
+// Nothing in between is a check, one of the player's own pieces in between is pinned.
+static void
+find_lines(struct Checks *checks, const struct Game *game, int enemy, Square king_square) {
+  const struct ChessPieces *pieces = &game->pieces;
+  const struct Cells *cells = &game->cells;
+  int index = piece_table_index(&piece_tables, pieces->owners[enemy], pieces->chess_type[enemy], pieces->squares[enemy]);
+  if (!(piece_tables.reach[index] & SQUARE_BIT(king_square))) {
+    return; // can't get there even on an empty board, most pieces stop here
+  }
+
+  const struct PieceTarget *target = &piece_tables.targets[piece_tables.starts[index]];
+  const struct PieceTarget *end = target + piece_tables.counts[index];
+
+  while (target < end) {
+    const struct PieceTarget *line_end = target + target->skip;
+    if (target->flags & PIECE_MOVE_ONLY) {
+      target = line_end;
+      continue;
+    }
+
+    SquareSet line = SQUARE_BIT(pieces->squares[enemy]);
+    int blockers = 0;
+    int blocker = -1;
+
+    for (; target < line_end; target++) {
+      int square = target->square;
+      if (square == king_square) {
+        if (blockers == 0) {
+          // Blocking anywhere on the line or taking the checker both stop it, and stepping
+          // back along it doesn't get the king out of the way
+          checks->evasions |= line;
+          for (target++; target < line_end; target++) {
+            checks->king_danger |= SQUARE_BIT(target->square);
+            if (cells->occupied_states[target->square]) {
+              break;
+            }
+          }
+        }
+        else if (blockers == 1 && pieces->owners[blocker] == checks->player) {
+          checks->pinned |= PIECE_BIT(blocker);
+          checks->pin_lines[blocker - (checks->player * N_PIECES)] = line;
+        }
+        break;
+      }
+
+      if (cells->occupied_states[square]) {
+        blocker = cells->cell_piece_indices[square];
+        if (++blockers > 1) {
+          break;
+        }
+      }
+      line |= SQUARE_BIT(square);
+    }
+    target = line_end;
+  }
+}
+
+void
+checks_compute(struct Checks *checks, const struct AttackMap *map, const struct Game *game, int player) {
+  checks->player = player;
+  checks->king = find_king(game, player);
+  checks->checkers = 0;
+  checks->evasions = ~0ull;
+  checks->king_danger = 0;
+  checks->pinned = 0;
+  if (checks->king < 0) {
+    return;
+  }
+
+  Square king_square = game->pieces.squares[checks->king];
+  PieceSet everybody = game->num_pieces == 64 ? ~0ull : PIECE_BIT(game->num_pieces) - 1;
+  PieceSet enemies = everybody & ~player_pieces(player);
+
+  checks->checkers = map->attackers[king_square] & enemies;
+  if (checks->checkers) {
+    checks->evasions = 0; // find_lines adds each checker and its line
+  }
+
+  // Only enemies whose offsets pass over the king get their lines walked
+  PieceSet remaining = enemies;
+  while (remaining) {
+    int enemy = __builtin_ctzll(remaining);
+    remaining &= remaining - 1;
+    if (game->pieces.is_dead[enemy]) {
+      continue;
+    }
+    checks->king_danger |= map->piece_attacks[enemy];
+    find_lines(checks, game, enemy, king_square);
+  }
+}
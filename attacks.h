@@ -0,0 +1,73 @@
+#ifndef ATTACKS_H
+#define ATTACKS_H
+
+#include "stdint.h"
+#include "chess.h"
+
+// What every piece attacks and who attacks every square, as 64 bit sets. A move only changes
+// what stands on two squares, so after one only the pieces attacking either of them (plus the
+// mover and whatever it took) get their attacks walked again.
+//
+// From those, checks_compute works out once per position what legal moves need for one player:
+// who is checking their king, which of their pieces are pinned and along what line, and where
+// the king can't step. game_piece_moves then keeps a move or drops it with one mask test,
+// nothing is ever played out to see if it leaves the king in check.
+//
+// The king is the player's first live piece of the KING type. Players without one (levels
+// can leave it out) can't be checked, every move they have is legal.
+//
+// The map also remembers which squares' attackers or occupants changed, so threats_update
+// only looks at those when it refreshes the threat overlay after a move.
+
+#if N_CELLS > 64 || (MAX_PLAYERS * N_PIECES) > 64
+#error "attack maps keep squares and piece ids in 64 bit sets"
+#endif
+
+typedef uint64_t SquareSet;
+typedef uint64_t PieceSet;
+
+#define SQUARE_BIT(square) (1ull << (square))
+#define PIECE_BIT(piece) (1ull << (piece))
+
+struct AttackMap {
+  SquareSet piece_attacks[MAX_PLAYERS * N_PIECES]; // where each piece could capture, its own side's pieces included
+  PieceSet attackers[N_CELLS];
+  SquareSet changed; // attackers or occupant changed since threats_update last took them
+};
+
+// What the threat overlay shows for one board
+struct Threats {
+  uint8_t attacked_by[N_CELLS]; // bit per player attacking the square
+  SquareSet hanging; // pieces an enemy attacks and none of their own defends
+};
+
+struct Checks {
+  int player; // whose king this is about, -1 once a move has made it stale
+  int king; // piece id, -1 if the player has no king
+  PieceSet checkers;
+  SquareSet evasions; // what a piece other than the king can move to: everywhere unless in check
+  SquareSet king_danger; // attacked, or behind the king on a line it's being checked along
+  PieceSet pinned;
+  SquareSet pin_lines[N_PIECES]; // by id - player * N_PIECES, the pinner and the squares up to the king
+};
+
+// Ids player owns, N_PIECES each
+static inline PieceSet
+player_pieces(int player) {
+  return ((PIECE_BIT(N_PIECES) - 1)) << (player * N_PIECES);
+}
+
+struct Game;
+
+void attack_map_build(struct AttackMap *map, const struct Game *game);
+
+// Call after the game has made the move, captured is the piece taken or -1
+void attack_map_move(struct AttackMap *map, const struct Game *game, int piece, Square from, Square to, int captured);
+
+// Brings threats up to date with the squares that changed since the last call (all of them
+// after a build), returns which squares it redid
+SquareSet threats_update(struct Threats *threats, struct AttackMap *map, const struct Game *game);
+
+void checks_compute(struct Checks *checks, const struct AttackMap *map, const struct Game *game, int player);
+
+#endif
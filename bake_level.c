@@ -0,0 +1,46 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "chess.h"
+#include "piece_defs.h"
+#include "level.h"
+
+// Bakes text levels into the binary main() maps with --level, `make levels` runs it
+// over everything in resources/levels
+
+static void
+usage(const char *program) {
+  printf("usage: %s PIECES_FILE LEVEL.txt LEVEL.lvl\n", program);
+}
+
+int
+main(int argc, char **argv) {
+  if (argc != 4) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  // Piece types are stored by index, so bake against the same file the game loads
+  static struct PieceDefs defs;
+  if (piece_defs_load(&defs, argv[1]) < 0) {
+    return 1;
+  }
+  if (level_bake(argv[2], argv[3], &defs) != 0) {
+    return 1;
+  }
+
+  // Map it straight back so a bad bake fails here and not in the game
+  struct Level level;
+  if (level_map(&level, argv[3]) != 0) {
+    return 1;
+  }
+  printf("%s: %dx%d, %d players, %d piece slots, %d quads, %zu bytes\n",
+         argv[3],
+         level.rows,
+         level.cols,
+         level.num_players,
+         level.num_pieces,
+         level.qtree.size,
+         level.size);
+  level_unmap(&level);
+  return 0;
+}
@@ -0,0 +1,248 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "../piece_defs.h"
+#include "bench.h"
+
+#define BENCH_REPS 21
+#define BENCH_WARMUP_NS 20000000ull // 20ms
+#define BENCH_TARGET_REP_NS 2000000ull // 2ms per repetition
+#define BENCH_MAX_RESULTS 256
+#define BENCH_TOLERANCE 0.10 // how much slower than baseline before we call it a regression
+#define BENCH_PIECES_PATH "resources/pieces/chess.txt"
+
+volatile uint64_t bench_sink = 0;
+
+struct BaselineEntry {
+  char name[64];
+  double median_ns;
+  double mad_ns;
+};
+
+static struct BaselineEntry baseline[BENCH_MAX_RESULTS];
+static int baseline_count = 0;
+
+static struct BenchResult results[BENCH_MAX_RESULTS];
+static int result_count = 0;
+static int regression_count = 0;
+
+static const char *filter = NULL;
+
+uint64_t
+bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+static int
+compare_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double
+median(double *values, int n) {
+  qsort(values, n, sizeof values[0], compare_double);
+  if (n % 2 == 1) {
+    return values[n / 2];
+  }
+  return (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+static struct BaselineEntry *
+find_baseline(const char *name) {
+  for (int i = 0; i < baseline_count; i++) {
+    if (strcmp(baseline[i].name, name) == 0) {
+      return &baseline[i];
+    }
+  }
+  return NULL;
+}
+
+static void
+load_baseline(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    printf("no baseline at %s, run `make bench-baseline` to save one\n", path);
+    return;
+  }
+
+  char line[256];
+  while (fgets(line, sizeof line, file) && baseline_count < BENCH_MAX_RESULTS) {
+    struct BaselineEntry *entry = &baseline[baseline_count];
+    if (line[0] == '#') {
+      continue;
+    }
+    if (sscanf(line, "%63s %lf %lf", entry->name, &entry->median_ns, &entry->mad_ns) == 3) {
+      baseline_count++;
+    }
+  }
+  fclose(file);
+}
+
+static int
+save_baseline(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return -1;
+  }
+
+  fprintf(file, "# name median_ns mad_ns\n");
+  for (int i = 0; i < result_count; i++) {
+    fprintf(file, "%s %.4f %.4f\n", results[i].name, results[i].median_ns, results[i].mad_ns);
+  }
+  fclose(file);
+  return 0;
+}
+
+static void
+report(struct BenchResult result) {
+  struct BaselineEntry *base = find_baseline(result.name);
+  char status[64] = "";
+
+  if (base != NULL && base->median_ns > 0) {
+    double change = (result.median_ns - base->median_ns) / base->median_ns;
+    double noise = 3.0 * (result.mad_ns > base->mad_ns ? result.mad_ns : base->mad_ns);
+
+    // Only flag it when it's both a real percentage and outside the noise
+    if (change > BENCH_TOLERANCE && (result.median_ns - base->median_ns) > noise) {
+      snprintf(status, sizeof status, "REGRESSED %+.1f%%", change * 100.0);
+      regression_count++;
+    }
+    else {
+      snprintf(status, sizeof status, "%+.1f%%", change * 100.0);
+    }
+  }
+
+  printf("%-40s %10.2f ns/op  mad %8.2f  min %10.2f  (%ld x %d)  %s\n",
+         result.name,
+         result.median_ns,
+         result.mad_ns,
+         result.min_ns,
+         result.iters,
+         result.reps,
+         status);
+}
+
+struct BenchResult
+bench_run(const char *name, BenchFn fn, void *ctx) {
+  return bench_run_ops(name, fn, ctx, 1);
+}
+
+struct BenchResult
+bench_run_ops(const char *name, BenchFn fn, void *ctx, long ops_per_iter) {
+  struct BenchResult result = {.name = name};
+
+  if (filter != NULL && strstr(name, filter) == NULL) {
+    return result;
+  }
+
+  // Warm up caches and branch predictors, and find how many iterations fill a repetition
+  long iters = 1;
+  uint64_t warmup_start = bench_now();
+  for (;;) {
+    uint64_t start = bench_now();
+    fn(ctx, iters);
+    uint64_t elapsed = bench_now() - start;
+
+    if (elapsed >= BENCH_TARGET_REP_NS && (bench_now() - warmup_start) >= BENCH_WARMUP_NS) {
+      break;
+    }
+    if (elapsed < BENCH_TARGET_REP_NS) {
+      iters *= 2;
+    }
+  }
+
+  double per_op[BENCH_REPS];
+  double deviations[BENCH_REPS];
+
+  for (int rep = 0; rep < BENCH_REPS; rep++) {
+    uint64_t start = bench_now();
+    fn(ctx, iters);
+    uint64_t elapsed = bench_now() - start;
+    per_op[rep] = (double)elapsed / ((double)iters * (double)ops_per_iter);
+  }
+
+  result.median_ns = median(per_op, BENCH_REPS);
+  result.min_ns = per_op[0]; // sorted by median()
+  for (int rep = 0; rep < BENCH_REPS; rep++) {
+    double d = per_op[rep] - result.median_ns;
+    deviations[rep] = d < 0 ? -d : d;
+  }
+  result.mad_ns = median(deviations, BENCH_REPS);
+  result.iters = iters;
+  result.reps = BENCH_REPS;
+
+  if (result_count < BENCH_MAX_RESULTS) {
+    results[result_count++] = result;
+  }
+  report(result);
+  return result;
+}
+
+static void
+usage(const char *program) {
+  printf("usage: %s [--baseline FILE] [--save-baseline FILE] [--filter SUBSTRING]\n", program);
+}
+
+int
+main(int argc, char **argv) {
+  const char *baseline_path = NULL;
+  const char *save_path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+      baseline_path = argv[++i];
+    }
+    else if (strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc) {
+      save_path = argv[++i];
+    }
+    else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    }
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (baseline_path != NULL) {
+    load_baseline(baseline_path);
+  }
+
+  // Everything below plays by the standard rules unless a suite swaps them
+  if (piece_rules_load(BENCH_PIECES_PATH) != 0) {
+    return 2;
+  }
+
+  bench_board_suite();
+  bench_position_suite();
+  bench_game_suite();
+  bench_pieces_suite();
+  bench_level_suite();
+  bench_game_log_suite();
+  bench_triple_buffer_suite();
+  bench_tween_suite();
+  bench_nnue_suite();
+  bench_search_suite();
+
+  if (save_path != NULL) {
+    if (save_baseline(save_path) != 0) {
+      printf("could not write baseline to %s\n", save_path);
+      return 2;
+    }
+    printf("saved %d results to %s\n", result_count, save_path);
+  }
+
+  if (regression_count > 0) {
+    printf("%d benchmark(s) regressed against the baseline\n", regression_count);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "stdint.h"
+
+// A benchmark body runs the operation `iters` times.
+// Anything it computes should end up in bench_sink so the compiler can't drop the work.
+typedef void (*BenchFn)(void *ctx, long iters);
+
+struct BenchResult {
+  const char *name;
+  double median_ns; // ns per op, median over repetitions
+  double mad_ns; // median absolute deviation of the ns per op
+  double min_ns;
+  long iters; // ops per repetition
+  int reps;
+};
+
+extern volatile uint64_t bench_sink;
+
+uint64_t bench_now(void);
+
+// Warms up, picks an iteration count so one repetition takes a few ms,
+// then times BENCH_REPS repetitions and reports/compares the result
+struct BenchResult bench_run(const char *name, BenchFn fn, void *ctx);
+
+// Same, but one call of the body does ops_per_iter operations (nodes, cells, ...)
+// and the reported times are per operation
+struct BenchResult bench_run_ops(const char *name, BenchFn fn, void *ctx, long ops_per_iter);
+
+// Each suite lives in its own bench_*.c file and is listed in bench.c
+void bench_board_suite(void);
+void bench_position_suite(void);
+void bench_game_suite(void);
+void bench_pieces_suite(void);
+void bench_level_suite(void);
+void bench_game_log_suite(void);
+void bench_triple_buffer_suite(void);
+void bench_tween_suite(void);
+void bench_nnue_suite(void);
+void bench_search_suite(void);
+
+#endif
@@ -0,0 +1,193 @@
+#include "stdint.h"
+#include "string.h"
+#include "raylib.h"
+#include "../chess.h"
+#include "../board.h"
+#include "../arena.h"
+#include "../game.h"
+#include "bench.h"
+
+// Starting board, set up the same way main() does it
+static uint8_t game_memory[GAME_ARENA_SIZE];
+static Vector3 square_positions[N_CELLS];
+
+struct BoardFixture {
+  struct Game *game;
+  struct Cells cells;
+  struct Players players;
+  struct ChessPieces pieces;
+};
+
+static void
+knock_out(struct Game *game, int piece) {
+  // Capture a piece in place by moving an enemy onto it
+  int enemy = (game->pieces.owners[piece] == WHITE_PLAYER ? BLACK_PLAYER : WHITE_PLAYER) * N_PIECES;
+  Square square_from = game->pieces.squares[enemy];
+  game_move_piece(game, enemy, game->pieces.squares[piece]);
+  game_move_piece(game, enemy, square_from);
+}
+
+static struct BoardFixture
+make_fixture(void) {
+  struct Arena arena;
+  arena_init(&arena, &game_memory[0], sizeof game_memory);
+
+  struct BoardFixture fixture;
+  fixture.game = game_create(&arena, NUM_PLAYERS);
+  build_square_positions(&square_positions[0], PIECE_SIZE);
+
+  // Knock out a few pieces so find_next_piece has gaps to skip over
+  knock_out(fixture.game, WHITE_PLAYER * N_PIECES + 3);
+  knock_out(fixture.game, WHITE_PLAYER * N_PIECES + 4);
+  knock_out(fixture.game, BLACK_PLAYER * N_PIECES + 10);
+
+  fixture.cells = fixture.game->cells;
+  fixture.players = fixture.game->players;
+  fixture.pieces = fixture.game->pieces;
+  return fixture;
+}
+
+static void
+bench_convert_coord(void *ctx, long iters) {
+  uint64_t sum = 0;
+  for (long i = 0; i < iters; i++) {
+    sum += convert_coord((int)(i & 7) - 3, N_ROWS);
+  }
+  bench_sink += sum;
+}
+
+static void
+bench_calculate_position(void *ctx, long iters) {
+  float sum = 0;
+  for (long i = 0; i < iters; i++) {
+    Vector3 position = calculate_position((int)(i & 7) - 3, (int)((i >> 3) & 7) - 3, PIECE_SIZE);
+    sum += position.x + position.z;
+  }
+  bench_sink += (uint64_t)sum;
+}
+
+static void
+bench_calculate_position_sweep(void *ctx, long iters) {
+  float sum = 0;
+  int x_half = (N_ROWS / 2) - 1;
+  int y_half = N_COLS / 2;
+  for (long i = 0; i < iters; i++) {
+    for (int col = -x_half; col <= y_half; col++) {
+      for (int row = -x_half; row <= y_half; row++) {
+        Vector3 position = calculate_position(col, row, PIECE_SIZE);
+        sum += position.x + position.z;
+      }
+    }
+  }
+  bench_sink += (uint64_t)sum;
+}
+
+static void
+bench_square_positions_sweep(void *ctx, long iters) {
+  // What drawing pays now, one table load per piece instead of calculate_position
+  struct BoardFixture *fixture = ctx;
+  float sum = 0;
+  for (long i = 0; i < iters; i++) {
+    for (int piece = 0; piece < fixture->game->num_pieces; piece++) {
+      Square square = fixture->pieces.squares[piece];
+      if (square == SQUARE_NONE) {
+        continue;
+      }
+      Vector3 position = square_positions[square];
+      sum += position.x + position.z;
+    }
+  }
+  bench_sink += (uint64_t)sum;
+}
+
+static void
+bench_should_skip_cell(void *ctx, long iters) {
+  struct BoardFixture *fixture = ctx;
+  uint64_t sum = 0;
+  for (long i = 0; i < iters; i++) {
+    int cell = (int)(i % N_CELLS);
+    sum += should_skip_cell(cell / N_COLS, cell % N_COLS, 1, WHITE_PLAYER, fixture->cells);
+  }
+  bench_sink += sum;
+}
+
+static void
+bench_should_skip_cell_sweep(void *ctx, long iters) {
+  // Every cell (plus the ring just off the board) for both players
+  struct BoardFixture *fixture = ctx;
+  uint64_t sum = 0;
+  for (long i = 0; i < iters; i++) {
+    for (int player = 0; player < NUM_PLAYERS; player++) {
+      int player_sign = player == BLACK_PLAYER ? -1 : 1;
+      for (int x = -1; x <= N_ROWS; x++) {
+        for (int y = -1; y <= N_COLS; y++) {
+          sum += should_skip_cell(x, y, player_sign, player, fixture->cells);
+        }
+      }
+    }
+  }
+  bench_sink += sum;
+}
+
+static void
+bench_find_next_piece(void *ctx, long iters) {
+  struct BoardFixture *fixture = ctx;
+  uint64_t sum = 0;
+  for (long i = 0; i < iters; i++) {
+    int direction = (i & 1) ? 1 : -1;
+    sum += find_next_piece((int)((i >> 1) % N_PIECES), WHITE_PLAYER, direction, fixture->players);
+  }
+  bench_sink += sum;
+}
+
+static void
+bench_find_next_piece_sweep(void *ctx, long iters) {
+  struct BoardFixture *fixture = ctx;
+  uint64_t sum = 0;
+  for (long i = 0; i < iters; i++) {
+    for (int player = 0; player < NUM_PLAYERS; player++) {
+      for (int piece = player * N_PIECES; piece < (player + 1) * N_PIECES; piece++) {
+        sum += find_next_piece(piece, player, 1, fixture->players);
+        sum += find_next_piece(piece, player, -1, fixture->players);
+      }
+    }
+  }
+  bench_sink += sum;
+}
+
+static void
+bench_calculate_row_move(void *ctx, long iters) {
+  uint64_t sum = 0;
+  for (long i = 0; i < iters; i++) {
+    int cell = (int)(i & 31);
+    int move_count = (int)((i >> 5) & 31);
+    sum += calculate_row_move_forward(cell, 1, move_count, 1);
+    sum += calculate_row_move_backward(cell, -1, move_count, 1);
+  }
+  bench_sink += sum;
+}
+
+static void
+bench_next_pow2(void *ctx, long iters) {
+  uint64_t sum = 0;
+  for (long i = 0; i < iters; i++) {
+    sum += next_pow2((int)(i & 1023) + 1);
+  }
+  bench_sink += sum;
+}
+
+void
+bench_board_suite(void) {
+  struct BoardFixture fixture = make_fixture();
+
+  bench_run("board/convert_coord", bench_convert_coord, NULL);
+  bench_run("board/calculate_position", bench_calculate_position, NULL);
+  bench_run("board/calculate_position/sweep", bench_calculate_position_sweep, NULL);
+  bench_run("board/square_positions/sweep", bench_square_positions_sweep, &fixture);
+  bench_run("board/should_skip_cell", bench_should_skip_cell, &fixture);
+  bench_run("board/should_skip_cell/sweep", bench_should_skip_cell_sweep, &fixture);
+  bench_run("board/find_next_piece", bench_find_next_piece, &fixture);
+  bench_run("board/find_next_piece/sweep", bench_find_next_piece_sweep, &fixture);
+  bench_run("board/calculate_row_move", bench_calculate_row_move, NULL);
+  bench_run("board/next_pow2", bench_next_pow2, NULL);
+}
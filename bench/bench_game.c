@@ -0,0 +1,298 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+#include "../chess.h"
+#include "../arena.h"
+#include "../game.h"
+#include "../position.h"
+#include "../board_pool.h"
+#include "bench.h"
+
+#define BENCH_GAMES 1024
+#define BENCH_POOL_BOARDS 256
+#define BENCH_LEGAL_GAMES 200
+
+struct GameFixture {
+  struct Arena arena;
+};
+
+static uint8_t game_memory[GAME_ARENA_SIZE * 4];
+static uint8_t games_memory[(size_t)GAME_ARENA_SIZE * BENCH_GAMES];
+
+static void
+bench_game_create_reset(void *ctx, long iters) {
+  // Spin a game up and throw it away, this never touches malloc
+  struct GameFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    struct Game *game = game_create(&fixture->arena, NUM_PLAYERS);
+    bench_sink += game->cells.occupied_states[i % N_CELLS];
+    arena_reset(&fixture->arena);
+  }
+}
+
+static void
+bench_game_create_many(void *ctx, long iters) {
+  // BENCH_GAMES live side by side in one block, torn down together with one reset
+  struct GameFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    for (int g = 0; g < BENCH_GAMES; g++) {
+      struct Game *game = game_create(&fixture->arena, NUM_PLAYERS);
+      bench_sink += game->num_players;
+    }
+    arena_reset(&fixture->arena);
+  }
+}
+
+static void
+bench_game_update_auto(void *ctx, long iters) {
+  struct Game *game = ctx;
+  uint64_t rng = 1;
+  for (long i = 0; i < iters; i++) {
+    if (!game_update_auto(game, &rng) || game->ply >= BOARD_POOL_MAX_PLIES) {
+      game_reset(game);
+    }
+  }
+  bench_sink += game->ply;
+}
+
+static int
+position_king_attacked(const struct Position *pos, int player) {
+  // The side to move can take player's king, there's only one king a player in Position games
+  int king = -1;
+  for (int piece_id = player * N_PIECES; piece_id < (player + 1) * N_PIECES; piece_id++) {
+    if (pos->piece_squares[piece_id] != POSITION_SQUARE_NONE && position_piece_type(pos, piece_id) == KING) {
+      king = piece_id;
+      break;
+    }
+  }
+  if (king < 0) {
+    return 0;
+  }
+
+  Move moves[POSITION_MAX_MOVES];
+  int count = position_generate_moves(pos, moves);
+  for (int i = 0; i < count; i++) {
+    if (MOVE_TO(moves[i]) == pos->piece_squares[king]) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Every legal move of the side to move the slow way, making each pseudo-legal move and
+// seeing if the other side can take the king. Returns 1 if there is at least one.
+static int
+legal_by_make(const struct Game *game, uint64_t *targets) {
+  struct Position pos;
+  int player = game->active_player;
+  position_from_game(&pos, &game->pieces, game->num_pieces, player);
+
+  Move moves[POSITION_MAX_MOVES];
+  int count = position_generate_moves(&pos, moves);
+  int any = 0;
+  for (int i = 0; i < count; i++) {
+    struct PositionUndo undo;
+    position_make_move(&pos, moves[i], &undo);
+    if (!position_king_attacked(&pos, player)) {
+      targets[MOVE_FROM(moves[i])] |= 1ull << MOVE_TO(moves[i]);
+      any = 1;
+    }
+    position_unmake_move(&pos, moves[i], &undo);
+  }
+  return any;
+}
+
+// Plays random games and checks the attack maps give exactly the moves make-and-test does,
+// and that check, mate and stalemate agree with it
+static void
+check_legal_moves(struct Game *game) {
+  uint64_t rng = 7;
+  int mates = 0;
+  int stalemates = 0;
+
+  for (int played = 0; played < BENCH_LEGAL_GAMES; played++) {
+    game_reset(game);
+    for (;;) {
+      int player = game->active_player;
+      uint64_t expected[N_CELLS] = {0};
+      uint64_t found[N_CELLS] = {0};
+      int any = legal_by_make(game, expected);
+
+      const int *live_pieces = &game->players.live_pieces[player * N_PIECES];
+      for (int i = 0; i < game->players.live_piece_counts[player]; i++) {
+        Square move_squares[N_CELLS];
+        int piece = live_pieces[i];
+        int count = game_piece_moves(game, piece, move_squares);
+        for (int m = 0; m < count; m++) {
+          found[game->pieces.squares[piece]] |= 1ull << move_squares[m];
+        }
+      }
+      for (int square = 0; square < N_CELLS; square++) {
+        assert(found[square] == expected[square]);
+      }
+
+      struct Position pos;
+      position_from_game(&pos, &game->pieces, game->num_pieces, (player + 1) % game->num_players);
+      int in_check = position_king_attacked(&pos, player);
+      int status = game_player_status(game, player);
+      assert(status == (any ? (in_check ? GAME_CHECK : GAME_PLAYING) : (in_check ? GAME_CHECKMATE : GAME_STALEMATE)));
+
+      if (!game_update_auto(game, &rng) || game->ply >= BOARD_POOL_MAX_PLIES) {
+        mates += game->status == GAME_CHECKMATE;
+        stalemates += game->status == GAME_STALEMATE;
+        break;
+      }
+    }
+  }
+  printf("game: legal moves agree with make and test over %d games (%d mates, %d stalemates)\n",
+         BENCH_LEGAL_GAMES,
+         mates,
+         stalemates);
+}
+
+// Increments and the next time control's time get added as turns pass, and running out of
+// time ends the game until it's reset
+static void
+check_clock(struct Game *game) {
+  uint64_t rng = 11;
+  game_clock_set(game, 1000000, 100000, 2);
+  game_reset(game);
+  for (int move = 0; move < 4; move++) {
+    int player = game->active_player;
+    int64_t before = game->clock.remaining_us[player];
+    game_clock_tick(game, 50000);
+    assert(game_update_auto(game, &rng));
+    int new_control = game->clock.moves_made[player] % 2 == 0;
+    assert(game->clock.remaining_us[player] == before - 50000 + 100000 + (new_control ? 1000000 : 0));
+  }
+  assert(game_clock_moves_to_go(&game->clock, game->active_player) == 2);
+
+  int flagged = game->active_player;
+  game_clock_tick(game, game->clock.remaining_us[flagged]);
+  assert(game_over(game) && game->clock.flagged == flagged);
+  game_next_player(game);
+  assert(game->status == GAME_FLAGGED && !game_update_auto(game, &rng));
+
+  game_reset(game);
+  assert(!game_over(game) && game->clock.remaining_us[flagged] == 1000000);
+  game->clock.running = 0;
+  printf("game: clock increments, time controls and flag fall check out\n");
+}
+
+// The maps kept up move by move, and the threats taken from their changes, have to match
+// building both from scratch
+static void
+check_threats(struct Game *game) {
+  static struct AttackMap fresh;
+  struct Threats threats = {{0}, 0};
+  struct Threats expected = {{0}, 0};
+  uint64_t rng = 11;
+  long redone = 0;
+  long moves = 0;
+
+  game_reset(game);
+  threats_update(&threats, game->attacks, game);
+  for (int played = 0; played < BENCH_LEGAL_GAMES / 4; played++) {
+    while (game_update_auto(game, &rng) && game->ply < BOARD_POOL_MAX_PLIES) {
+      redone += __builtin_popcountll(threats_update(&threats, game->attacks, game));
+      moves++;
+
+      attack_map_build(&fresh, game);
+      assert(memcmp(fresh.piece_attacks, game->attacks->piece_attacks, sizeof fresh.piece_attacks) == 0);
+      assert(memcmp(fresh.attackers, game->attacks->attackers, sizeof fresh.attackers) == 0);
+      threats_update(&expected, &fresh, game);
+      assert(memcmp(&threats, &expected, sizeof threats) == 0);
+    }
+    game_reset(game);
+    threats_update(&threats, game->attacks, game);
+  }
+  printf("game: threats agree with a rebuild over %ld moves, %.1f squares redone a move\n",
+         moves,
+         (double)redone / (double)moves);
+}
+
+static void
+bench_game_threats(void *ctx, long iters) {
+  // update_auto plus keeping the overlay up to date, the difference is what the overlay costs
+  struct Game *game = ctx;
+  static struct Threats threats;
+  uint64_t rng = 1;
+  for (long i = 0; i < iters; i++) {
+    if (!game_update_auto(game, &rng) || game->ply >= BOARD_POOL_MAX_PLIES) {
+      game_reset(game);
+    }
+    bench_sink += threats_update(&threats, game->attacks, game);
+  }
+}
+
+static void
+bench_game_checks(void *ctx, long iters) {
+  struct Game *game = ctx;
+  for (long i = 0; i < iters; i++) {
+    game->checks->player = -1;
+    bench_sink += game_checks(game, (int)(i & 1))->king_danger;
+  }
+}
+
+static void
+bench_game_status(void *ctx, long iters) {
+  struct Game *game = ctx;
+  for (long i = 0; i < iters; i++) {
+    bench_sink += game_player_status(game, (int)(i & 1));
+  }
+}
+
+static void
+bench_board_pool_update(void *ctx, long iters) {
+  struct BoardPool *pool = ctx;
+  for (long i = 0; i < iters; i++) {
+    struct BoardPoolStats stats = board_pool_update(pool);
+    bench_sink += stats.max_ns;
+  }
+}
+
+void
+bench_game_suite(void) {
+  static struct GameFixture single;
+  static struct GameFixture many;
+  arena_init(&single.arena, &game_memory[0], sizeof game_memory);
+  arena_init(&many.arena, &games_memory[0], sizeof games_memory);
+
+  struct Game *game = game_create(&single.arena, NUM_PLAYERS);
+  assert(game != NULL);
+  assert(single.arena.high_water <= GAME_ARENA_SIZE);
+  printf("game: %zu bytes per game (%zu including build scratch, bound %d)\n",
+         game->memory_used,
+         single.arena.high_water,
+         GAME_ARENA_SIZE);
+  arena_reset(&single.arena);
+
+  bench_run("game/create_reset", bench_game_create_reset, &single);
+  bench_run_ops("game/create_many", bench_game_create_many, &many, BENCH_GAMES);
+
+  game = game_create(&single.arena, NUM_PLAYERS);
+  check_legal_moves(game);
+  check_clock(game);
+  game_reset(game);
+  bench_run("game/checks", bench_game_checks, game);
+  bench_run("game/status", bench_game_status, game);
+  bench_run("game/update_auto", bench_game_update_auto, game);
+  check_threats(game);
+  game_reset(game);
+  bench_run("game/update_auto/threats", bench_game_threats, game);
+  arena_reset(&single.arena);
+
+  // Per board, so the single and threaded pools compare against game/update_auto
+  static struct BoardPool serial_pool;
+  static struct BoardPool threaded_pool;
+  if (board_pool_init(&serial_pool, BENCH_POOL_BOARDS, NUM_PLAYERS, NULL, 1) == 0) {
+    bench_run_ops("board_pool/update/1_thread", bench_board_pool_update, &serial_pool, BENCH_POOL_BOARDS - 1);
+    board_pool_destroy(&serial_pool);
+  }
+  if (board_pool_init(&threaded_pool, BENCH_POOL_BOARDS, NUM_PLAYERS, NULL, 0) == 0) {
+    printf("board_pool: %d boards on %d threads\n", BENCH_POOL_BOARDS, threaded_pool.threads.num_threads);
+    bench_run_ops("board_pool/update/all_threads", bench_board_pool_update, &threaded_pool, BENCH_POOL_BOARDS - 1);
+    board_pool_destroy(&threaded_pool);
+  }
+}
@@ -0,0 +1,224 @@
+#include "stddef.h"
+#include "stdint.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+#include "../chess.h"
+#include "../arena.h"
+#include "../game.h"
+#include "../game_log.h"
+#include "bench.h"
+
+#define BENCH_LOG_PATH "bench/games.log"
+#define BENCH_LOG_PLIES 1000 // long games so a seek has plenty to skip
+#define BENCH_LOG_MIN_PLIES (8 * GAME_LOG_CHECKPOINT_INTERVAL) // the seek benchmarks' game is at least this long
+#define BENCH_LOG_SEEKS 64
+
+struct GameLogFixture {
+  struct Arena arena;
+  struct Game *game;
+  struct Game *replay;
+  struct GameRecord *record; // read back from the file
+  struct GameRecord start_only; // the same with only the first checkpoint
+  struct GameRecord *damaged; // read back after breaking the file on purpose
+  uint64_t rng;
+};
+
+static uint8_t log_memory[(GAME_ARENA_SIZE * 4) + (GAME_RECORD_ARENA_SIZE * 3)];
+
+// Where every piece is at each ply of the game being checked
+static uint8_t expected_squares[BENCH_LOG_PLIES + 1][GAME_LOG_MAX_PIECES];
+
+static void
+snapshot(const struct Game *game, uint8_t *squares) {
+  for (int piece = 0; piece < game->num_pieces; piece++) {
+    squares[piece] = game->pieces.is_dead[piece] ? POSITION_SQUARE_NONE : (uint8_t)game->pieces.squares[piece];
+  }
+}
+
+static void
+bench_record_update_auto(void *ctx, long iters) {
+  // The same loop as game/update_auto, with every move going into the log
+  struct GameLogFixture *fixture = ctx;
+  struct Game *game = fixture->game;
+  for (long i = 0; i < iters; i++) {
+    if (!game_update_auto(game, &fixture->rng) || game->ply >= BENCH_LOG_PLIES) {
+      game_reset(game);
+    }
+  }
+  bench_sink += game->ply;
+}
+
+static void
+bench_seek(void *ctx, long iters) {
+  struct GameLogFixture *fixture = ctx;
+  int plies = fixture->record->header.ply_count;
+  for (long i = 0; i < iters; i++) {
+    int ply = (int)((i * 7919) % (plies + 1));
+    game_record_seek(fixture->record, fixture->replay, ply);
+    bench_sink += fixture->replay->ply;
+  }
+}
+
+static void
+bench_replay_from_start(void *ctx, long iters) {
+  // What seeking costs without checkpoints: the same seek, but the start is all it has, so
+  // every move gets replayed with exactly the work a seek does for it
+  struct GameLogFixture *fixture = ctx;
+  int plies = fixture->start_only.header.ply_count;
+  for (long i = 0; i < iters; i++) {
+    int ply = (int)((i * 7919) % (plies + 1));
+    game_record_seek(&fixture->start_only, fixture->replay, ply);
+    bench_sink += fixture->replay->ply;
+  }
+}
+
+// Writes a log holding only the one record
+static void
+write_record(const char *path, const struct GameRecord *record) {
+  struct GameLogFileHeader file_header = {
+    .magic = GAME_LOG_MAGIC,
+    .version = GAME_LOG_VERSION,
+    .checkpoint_interval = GAME_LOG_CHECKPOINT_INTERVAL
+  };
+  const struct GameLogHeader *header = &record->header;
+  FILE *file = fopen(path, "wb");
+  assert(file != NULL);
+  assert(fwrite(&file_header, sizeof file_header, 1, file) == 1 &&
+         fwrite(header, sizeof *header, 1, file) == 1 &&
+         fwrite(record->moves, sizeof (Move), header->ply_count, file) == header->ply_count &&
+         fwrite(record->checkpoints, sizeof (struct GameLogCheckpoint), header->num_checkpoints, file) == header->num_checkpoints);
+  fclose(file);
+}
+
+// Reads the record back after one change to its second checkpoint
+static int
+read_damaged(struct GameLogFixture *fixture, int offset, uint8_t value) {
+  static struct GameLogCheckpoint checkpoints[GAME_LOG_MAX_CHECKPOINTS];
+  struct GameRecord damaged = *fixture->record;
+  memcpy(checkpoints, damaged.checkpoints, damaged.header.num_checkpoints * sizeof checkpoints[0]);
+  ((uint8_t *)&checkpoints[1])[offset] = value;
+  damaged.checkpoints = checkpoints;
+  write_record(BENCH_LOG_PATH, &damaged);
+
+  struct GameLogReader reader;
+  assert(game_log_reader_open(&reader, BENCH_LOG_PATH) == 0);
+  int result = game_log_read(&reader, fixture->damaged);
+  game_log_reader_close(&reader);
+  return result;
+}
+
+// Checkpoints pointing off the board or at types and players that don't exist are refused
+// when read, a move by anybody but the side to move when it's replayed
+static void
+check_damaged_records(struct GameLogFixture *fixture) {
+  const struct GameLogHeader *header = &fixture->record->header;
+  assert(header->num_checkpoints > 1);
+  assert(read_damaged(fixture, offsetof(struct GameLogCheckpoint, squares), N_CELLS) == -1);
+  // The first piece moved onto the square of the next live one
+  const struct GameLogCheckpoint *checkpoint = &fixture->record->checkpoints[1];
+  int piece = 1;
+  while (checkpoint->squares[piece] == POSITION_SQUARE_NONE) {
+    piece++;
+  }
+  assert(read_damaged(fixture, offsetof(struct GameLogCheckpoint, squares), checkpoint->squares[piece]) == -1);
+  assert(read_damaged(fixture, offsetof(struct GameLogCheckpoint, types), 0xFF) == -1);
+  assert(read_damaged(fixture, offsetof(struct GameLogCheckpoint, active_player), header->num_players) == -1);
+  assert(read_damaged(fixture, offsetof(struct GameLogCheckpoint, reserved), 1) == 1);
+
+  static Move moves[GAME_LOG_MAX_PLIES];
+  struct GameRecord damaged = *fixture->record;
+  const struct GameLogCheckpoint *start = &damaged.checkpoints[0];
+  int other = (start->active_player + 1) % header->num_players;
+  memcpy(moves, damaged.moves, header->ply_count * sizeof (Move));
+  moves[0] = MAKE_MOVE(start->squares[other * N_PIECES], MOVE_TO(moves[0]), 0);
+  damaged.moves = moves;
+  assert(game_record_seek(&damaged, fixture->replay, 0) == 0);
+  assert(game_record_seek(&damaged, fixture->replay, 1) == -1);
+  printf("game_log: damaged checkpoints and moves are refused\n");
+}
+
+// A seed whose random game goes on for at least BENCH_LOG_MIN_PLIES, so seeks have several
+// checkpoints to pick from
+static uint64_t
+long_game_seed(struct Game *game) {
+  for (uint64_t seed = 1;; seed++) {
+    uint64_t rng = seed;
+    game_reset(game);
+    while (game->ply < BENCH_LOG_MIN_PLIES && game_update_auto(game, &rng)) {
+    }
+    if (game->ply >= BENCH_LOG_MIN_PLIES) {
+      return seed;
+    }
+  }
+}
+
+void
+bench_game_log_suite(void) {
+  static struct GameLogFixture fixture;
+  static struct GameLogWriter writer;
+  arena_init(&fixture.arena, &log_memory[0], sizeof log_memory);
+  remove(BENCH_LOG_PATH);
+  if (game_log_writer_open(&writer, BENCH_LOG_PATH) != 0) {
+    return;
+  }
+
+  fixture.game = game_create(&fixture.arena, NUM_PLAYERS);
+  fixture.replay = game_create(&fixture.arena, NUM_PLAYERS);
+  fixture.game->record = game_record_create(&fixture.arena, &writer, 0);
+  fixture.record = game_record_create(&fixture.arena, NULL, 0);
+  fixture.damaged = game_record_create(&fixture.arena, NULL, 0);
+  assert(fixture.record != NULL && fixture.damaged != NULL);
+  fixture.rng = long_game_seed(fixture.replay);
+
+  // Play one game to the end and remember every ply of it
+  game_record_begin(fixture.game->record, fixture.game);
+  snapshot(fixture.game, expected_squares[0]);
+  int plies = 0;
+  while (plies < BENCH_LOG_PLIES && game_update_auto(fixture.game, &fixture.rng)) {
+    snapshot(fixture.game, expected_squares[++plies]);
+  }
+  game_reset(fixture.game);
+
+  bench_run("game_log/update_auto", bench_record_update_auto, &fixture);
+  game_record_finish(fixture.game->record, GAME_LOG_END_RESET);
+  assert(game_log_writer_close(&writer) == 0);
+  printf("game_log: %llu games, %llu bytes\n",
+         (unsigned long long)writer.records,
+         (unsigned long long)writer.bytes);
+
+  // The first record is the checked game, every ply of it has to come back the same
+  struct GameLogReader reader;
+  assert(game_log_reader_open(&reader, BENCH_LOG_PATH) == 0);
+  assert(game_log_read(&reader, fixture.record) == 1);
+  assert(fixture.record->header.ply_count == plies);
+  for (int ply = 0; ply <= plies; ply++) {
+    uint8_t squares[GAME_LOG_MAX_PIECES];
+    assert(game_record_seek(fixture.record, fixture.replay, ply) == 0);
+    snapshot(fixture.replay, squares);
+    assert(memcmp(squares, expected_squares[ply], fixture.replay->num_pieces) == 0);
+  }
+
+  struct GameLogHeader header;
+  int games = 1;
+  while (game_log_skip(&reader, &header) == 1) {
+    games++;
+  }
+  assert(games == (int)writer.records);
+  game_log_reader_close(&reader);
+
+  // Per seek, a random ply of a game of up to BENCH_LOG_PLIES moves
+  fixture.start_only = *fixture.record;
+  fixture.start_only.header.num_checkpoints = 1;
+  for (int ply = 0; ply <= plies; ply += 7) {
+    uint8_t squares[GAME_LOG_MAX_PIECES];
+    assert(game_record_seek(&fixture.start_only, fixture.replay, ply) == 0);
+    snapshot(fixture.replay, squares);
+    assert(memcmp(squares, expected_squares[ply], fixture.replay->num_pieces) == 0);
+  }
+  check_damaged_records(&fixture);
+  printf("game_log: seeking in a %d ply game, a checkpoint every %d\n", plies, GAME_LOG_CHECKPOINT_INTERVAL);
+  bench_run("game_log/seek/checkpoints", bench_seek, &fixture);
+  bench_run("game_log/seek/from_start", bench_replay_from_start, &fixture);
+  remove(BENCH_LOG_PATH);
+}
@@ -0,0 +1,195 @@
+#include "stddef.h"
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "assert.h"
+#include "../chess.h"
+#include "../arena.h"
+#include "../game.h"
+#include "../piece_defs.h"
+#include "../level.h"
+#include "bench.h"
+
+#define BIG_LEVEL_SIZE 64
+#define BIG_LEVEL_SLOTS 900 // per player, a little over what the generator places
+#define BIG_LEVEL_TEXT "bench/big_level.txt"
+#define BIG_LEVEL_BAKED "bench/big_level.lvl"
+#define CLASSIC_LEVEL_TEXT "resources/levels/classic.txt"
+#define CLASSIC_LEVEL_BAKED "bench/classic.lvl"
+#define LEVEL_PIECES_PATH "resources/pieces/chess.txt"
+#define BROKEN_LEVEL_TEXT "bench/broken_level.txt"
+#define BROKEN_LEVEL_BAKED "bench/broken.lvl"
+
+struct LevelFixture {
+  struct PieceDefs defs;
+  struct Level classic;
+  struct Arena arena;
+  int big_pieces;
+};
+
+static uint8_t level_game_memory[GAME_ARENA_SIZE];
+
+// Four players on a 64x64 board, pieces on a bit over four in five cells of each one's quarter
+static int
+write_big_level(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return -1;
+  }
+
+  const char *symbols = "PNBRQKpnbrqkACDEFGacdefg";
+  const char *names[6] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+  fprintf(file, "size %d %d\nplayers 4\nslots %d\n", BIG_LEVEL_SIZE, BIG_LEVEL_SIZE, BIG_LEVEL_SLOTS);
+  for (int i = 0; i < 24; i++) {
+    fprintf(file, "piece %c %d %s\n", symbols[i], i / 6, names[i % 6]);
+  }
+
+  int placed = 0;
+  uint32_t state = 12345;
+  fprintf(file, "board\n");
+  for (int row = 0; row < BIG_LEVEL_SIZE; row++) {
+    for (int col = 0; col < BIG_LEVEL_SIZE; col++) {
+      state = (state * 1103515245u) + 12345u;
+      int player = ((row >= BIG_LEVEL_SIZE / 2) * 2) + (col >= BIG_LEVEL_SIZE / 2);
+      int filled = ((state >> 16) % 100) < 80;
+      fputc(filled ? symbols[(player * 6) + ((state >> 8) % 6)] : '.', file);
+      placed += filled;
+    }
+    fputc('\n', file);
+  }
+  fprintf(file, "end\n");
+  fclose(file);
+  return placed;
+}
+
+static void
+bench_level_bake(void *ctx, long iters) {
+  struct LevelFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    bench_sink += level_bake(BIG_LEVEL_TEXT, BIG_LEVEL_BAKED, &fixture->defs) == 0;
+  }
+}
+
+static void
+bench_level_map(void *ctx, long iters) {
+  (void)ctx;
+  for (long i = 0; i < iters; i++) {
+    struct Level level;
+    if (level_map(&level, BIG_LEVEL_BAKED) == 0) {
+      bench_sink += (uint64_t)level_piece_at(&level, BIG_LEVEL_SIZE / 2, BIG_LEVEL_SIZE / 2);
+      level_unmap(&level);
+    }
+  }
+}
+
+static void
+bench_game_from_level(void *ctx, long iters) {
+  struct LevelFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    arena_reset(&fixture->arena);
+    struct Game *game = game_create_from_level(&fixture->arena, &fixture->classic);
+    bench_sink += game->players.live_piece_counts[0];
+  }
+}
+
+// Writes a copy of a baked level with one int32_t changed
+static void
+write_changed_level(const char *from, const char *to, uint32_t offset, int32_t value) {
+  FILE *file = fopen(from, "rb");
+  assert(file != NULL);
+  static uint8_t bytes[64 * 1024];
+  size_t size = fread(bytes, 1, sizeof bytes, file);
+  fclose(file);
+  assert(size < sizeof bytes && offset + sizeof value <= size);
+  memcpy(&bytes[offset], &value, sizeof value);
+  file = fopen(to, "wb");
+  assert(file != NULL && fwrite(bytes, 1, size, file) == size);
+  fclose(file);
+}
+
+// Levels that would have the game read outside the mapping, or face a seat some way the
+// piece tables weren't compiled for, don't get through
+static void
+check_broken_levels(struct LevelFixture *fixture) {
+  struct Level level;
+  assert(level_map(&level, CLASSIC_LEVEL_BAKED) == 0);
+  const struct LevelHeader *header = level.mapping;
+  uint32_t children_offset = header->quad_children_offset;
+  uint32_t forwards_offset = header->forwards_offset;
+  uint32_t squares_offset = header->piece_squares_offset;
+  Square squares[2] = {level.piece_squares[0], level.piece_squares[2]};
+  level_unmap(&level);
+
+  // No top left child under the whole board, level_piece_at would index with -1
+  write_changed_level(CLASSIC_LEVEL_BAKED, BROKEN_LEVEL_BAKED, children_offset, -1);
+  assert(level_map(&level, BROKEN_LEVEL_BAKED) != 0);
+
+  // Player 0 turned to face across the board
+  write_changed_level(CLASSIC_LEVEL_BAKED, BROKEN_LEVEL_BAKED, forwards_offset, 0);
+  assert(level_map(&level, BROKEN_LEVEL_BAKED) != 0);
+
+  // 256 rows of 2^24 + 1 columns, which wraps to 256 cells in 32 bits
+  write_changed_level(CLASSIC_LEVEL_BAKED, BROKEN_LEVEL_BAKED, offsetof(struct LevelHeader, rows), 256);
+  write_changed_level(BROKEN_LEVEL_BAKED, BROKEN_LEVEL_BAKED, offsetof(struct LevelHeader, cols), 16777217);
+  assert(level_map(&level, BROKEN_LEVEL_BAKED) != 0);
+
+  // Piece 1 stood on piece 0's square, so it would be missing from the cells
+  int32_t shared;
+  memcpy(&shared, squares, sizeof shared);
+  write_changed_level(CLASSIC_LEVEL_BAKED, BROKEN_LEVEL_BAKED, squares_offset + sizeof (Square), shared);
+  assert(level_map(&level, BROKEN_LEVEL_BAKED) != 0);
+
+  FILE *file = fopen(BROKEN_LEVEL_TEXT, "w");
+  assert(file != NULL);
+  fprintf(file, "size 2 2\nplayers 2\nslots 1\nforward 0 0 1\npiece K 0 king\npiece k 1 king\nboard\nK.\n.k\nend\n");
+  fclose(file);
+  assert(level_bake(BROKEN_LEVEL_TEXT, BROKEN_LEVEL_BAKED, &fixture->defs) != 0);
+
+  // A bigger size after the board would have the baker count past what it read
+  file = fopen(BROKEN_LEVEL_TEXT, "w");
+  assert(file != NULL);
+  fprintf(file, "size 2 2\nplayers 2\npiece K 0 king\npiece k 1 king\nboard\nK.\n.k\nend\nsize 200 200\n");
+  fclose(file);
+  assert(level_bake(BROKEN_LEVEL_TEXT, BROKEN_LEVEL_BAKED, &fixture->defs) != 0);
+  printf("level: broken headers, quads, squares and turned seats are turned away\n");
+}
+
+void
+bench_level_suite(void) {
+  static struct LevelFixture fixture;
+  if (piece_defs_load(&fixture.defs, LEVEL_PIECES_PATH) < 0) {
+    return;
+  }
+
+  fixture.big_pieces = write_big_level(BIG_LEVEL_TEXT);
+  assert(fixture.big_pieces > 0);
+  assert(level_bake(BIG_LEVEL_TEXT, BIG_LEVEL_BAKED, &fixture.defs) == 0);
+
+  // The quadtree has to land on the same piece as the flat cell table everywhere
+  struct Level big;
+  assert(level_map(&big, BIG_LEVEL_BAKED) == 0);
+  for (int x = 0; x < big.rows; x++) {
+    for (int y = 0; y < big.cols; y++) {
+      assert(level_piece_at(&big, x, y) == big.cell_pieces[(x * big.cols) + y]);
+    }
+  }
+  printf("level: %dx%d, %d pieces, %d quads, %zu bytes baked\n",
+         big.rows,
+         big.cols,
+         fixture.big_pieces,
+         big.qtree.size,
+         big.size);
+  level_unmap(&big);
+
+  bench_run("level/bake/64x64", bench_level_bake, &fixture);
+  bench_run("level/map/64x64", bench_level_map, &fixture);
+
+  // Against game/create_reset, which lays the pieces out and builds the quadtree itself
+  assert(level_bake(CLASSIC_LEVEL_TEXT, CLASSIC_LEVEL_BAKED, &fixture.defs) == 0);
+  assert(level_map(&fixture.classic, CLASSIC_LEVEL_BAKED) == 0);
+  check_broken_levels(&fixture);
+  arena_init(&fixture.arena, &level_game_memory[0], sizeof level_game_memory);
+  bench_run("game/create_from_level", bench_game_from_level, &fixture);
+  level_unmap(&fixture.classic);
+}
@@ -0,0 +1,180 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+#include "../chess.h"
+#include "../position.h"
+#include "../nnue.h"
+#include "bench.h"
+
+#define BENCH_NNUE_PATH "bench/bench.nnue"
+#define BENCH_NNUE_POSITIONS 64
+#define BENCH_NNUE_LINE 96 // plies each random line plays
+
+// The results keep the name, so these can't be built on the stack
+static const char *const evaluate_names[NNUE_KERNEL_COUNT] = {
+  "nnue/evaluate/scalar",
+  "nnue/evaluate/sse4.1",
+  "nnue/evaluate/avx2"
+};
+
+struct NnueFixture {
+  struct Nnue net;
+  struct NnueStack stack;
+  struct Position positions[BENCH_NNUE_POSITIONS];
+  struct NnueAccumulator accumulators[BENCH_NNUE_POSITIONS];
+  struct Position start;
+  Move moves[POSITION_MAX_MOVES];
+  int move_count;
+};
+
+static uint64_t
+next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+// Plays random lines keeping a stack of accumulators, every push has to match a refresh and
+// every pop has to land back on the parent's
+static void
+check_incremental(struct NnueFixture *fixture) {
+  static struct NnueStack stack;
+  struct NnueAccumulator fresh;
+  struct Position line[BENCH_NNUE_LINE + 1];
+  Move played[BENCH_NNUE_LINE];
+  struct PositionUndo undo[BENCH_NNUE_LINE];
+  uint64_t rng = 5;
+  int stored = 0;
+
+  for (int game = 0; game < 8; game++) {
+    struct Position pos = fixture->start;
+    nnue_stack_reset(&stack, &fixture->net, &pos);
+    int plies = 0;
+    for (; plies < BENCH_NNUE_LINE; plies++) {
+      Move moves[POSITION_MAX_MOVES];
+      int count = position_generate_moves(&pos, moves);
+      if (count == 0) {
+        break;
+      }
+      line[plies] = pos;
+      played[plies] = moves[next_random(&rng) % count];
+      nnue_push_move(&stack, &pos, played[plies]);
+      position_make_move(&pos, played[plies], &undo[plies]);
+
+      nnue_refresh(&fixture->net, &pos, &fresh);
+      assert(memcmp(&fresh, &stack.accumulators[stack.depth], sizeof fresh) == 0);
+      if (stored < BENCH_NNUE_POSITIONS && (plies % 12) == 11) {
+        fixture->positions[stored] = pos;
+        fixture->accumulators[stored++] = fresh;
+      }
+    }
+
+    while (plies-- > 0) {
+      nnue_pop(&stack);
+      position_unmake_move(&pos, played[plies], &undo[plies]);
+      assert(memcmp(&pos, &line[plies], sizeof pos) == 0);
+      nnue_refresh(&fixture->net, &pos, &fresh);
+      assert(memcmp(&fresh, &stack.accumulators[stack.depth], sizeof fresh) == 0);
+    }
+  }
+
+  // Fill whatever the lines didn't reach so every slot is a real position
+  for (; stored < BENCH_NNUE_POSITIONS; stored++) {
+    fixture->positions[stored] = fixture->start;
+    nnue_refresh(&fixture->net, &fixture->start, &fixture->accumulators[stored]);
+  }
+}
+
+static void
+check_kernels_agree(struct NnueFixture *fixture, int best) {
+  for (int i = 0; i < BENCH_NNUE_POSITIONS; i++) {
+    const struct Position *pos = &fixture->positions[i];
+    assert(nnue_select_kernel(NNUE_SCALAR) == 0);
+    int expected = nnue_evaluate(&fixture->net, &fixture->accumulators[i], pos->side_to_move);
+    for (int kernel = NNUE_SCALAR + 1; kernel <= best; kernel++) {
+      if (nnue_select_kernel(kernel) == 0) {
+        assert(nnue_evaluate(&fixture->net, &fixture->accumulators[i], pos->side_to_move) == expected);
+      }
+    }
+  }
+}
+
+static void
+bench_nnue_evaluate(void *ctx, long iters) {
+  struct NnueFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    int index = (int)(i % BENCH_NNUE_POSITIONS);
+    bench_sink += nnue_evaluate(&fixture->net, &fixture->accumulators[index], fixture->positions[index].side_to_move);
+  }
+}
+
+static void
+bench_nnue_push_pop(void *ctx, long iters) {
+  // Every move from the start, pushed and popped
+  struct NnueFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    nnue_push_move(&fixture->stack, &fixture->start, fixture->moves[i % fixture->move_count]);
+    bench_sink += fixture->stack.accumulators[fixture->stack.depth].values[0][i & (NNUE_HIDDEN - 1)];
+    nnue_pop(&fixture->stack);
+  }
+}
+
+static void
+bench_nnue_refresh(void *ctx, long iters) {
+  struct NnueFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    nnue_refresh(&fixture->net, &fixture->positions[i % BENCH_NNUE_POSITIONS], &fixture->stack.accumulators[1]);
+    bench_sink += fixture->stack.accumulators[1].values[1][0];
+  }
+}
+
+static void
+bench_hand_evaluate(void *ctx, long iters) {
+  // The tables eval.h keeps up, for comparison
+  struct NnueFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    bench_sink += position_evaluate(&fixture->positions[i % BENCH_NNUE_POSITIONS]);
+  }
+}
+
+void
+bench_nnue_suite(void) {
+  static struct NnueFixture fixture;
+  static struct Nnue loaded;
+  position_set_start(&fixture.start, WHITE_PLAYER);
+  nnue_init_random(&fixture.net, 0x4E4E5545ull);
+
+  // Whatever gets saved has to come back the same
+  assert(nnue_save(&fixture.net, BENCH_NNUE_PATH) == 0);
+  assert(nnue_load(&loaded, BENCH_NNUE_PATH) == 0);
+  assert(memcmp(&loaded, &fixture.net, sizeof loaded) == 0);
+  remove(BENCH_NNUE_PATH);
+
+  check_incremental(&fixture);
+  int best = nnue_best_kernel();
+  check_kernels_agree(&fixture, best);
+  printf("nnue: %zu bytes of weights, incremental accumulators and %d kernel(s) agree, best is %s\n",
+         sizeof (struct Nnue),
+         best + 1,
+         nnue_kernel_names[best]);
+
+  // Each kernel the cpu has on the same positions, per evaluation
+  for (int kernel = NNUE_SCALAR; kernel <= best; kernel++) {
+    if (nnue_select_kernel(kernel) != 0) {
+      continue;
+    }
+    struct BenchResult result = bench_run(evaluate_names[kernel], bench_nnue_evaluate, &fixture);
+    if (result.median_ns > 0) {
+      printf("nnue: %s %.1fM evaluations/s\n", nnue_kernel_names[kernel], 1000.0 / result.median_ns);
+    }
+  }
+  nnue_select_kernel(best);
+
+  nnue_stack_reset(&fixture.stack, &fixture.net, &fixture.start);
+  fixture.move_count = position_generate_moves(&fixture.start, fixture.moves);
+  bench_run("nnue/push_pop", bench_nnue_push_pop, &fixture);
+  bench_run("nnue/refresh", bench_nnue_refresh, &fixture);
+  bench_run("nnue/hand_evaluate", bench_hand_evaluate, &fixture);
+}
@@ -0,0 +1,246 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "assert.h"
+#include "../chess.h"
+#include "../board.h"
+#include "../arena.h"
+#include "../piece_defs.h"
+#include "../position.h"
+#include "bench.h"
+
+#define BENCH_POSITIONS 64
+#define FAIRY_PIECES_PATH "resources/pieces/fairy.txt"
+
+// Standard chess written out by hand, the way movegen looked before piece definitions,
+// to check the compiled tables give the same moves and cost no more
+static const int8_t pawn_moves[][3] = {{1, 0, PIECE_MOVE_ONLY}, {1, -1, PIECE_CAPTURE_ONLY}, {1, 1, PIECE_CAPTURE_ONLY}};
+static const int8_t knight_moves[][3] = {{1, -2, 0}, {-1, -2, 0}, {2, -1, 0}, {-2, -1, 0}, {2, 1, 0}, {-2, 1, 0}, {1, 2, 0}, {-1, 2, 0}};
+static const int8_t bishop_moves[][3] = {{1, -1, 0}, {-1, -1, 0}, {1, 1, 0}, {-1, 1, 0}};
+static const int8_t rook_moves[][3] = {{1, 0, 0}, {-1, 0, 0}, {0, -1, 0}, {0, 1, 0}};
+static const int8_t queen_moves[][3] = {{0, -1, 0}, {-1, -1, 0}, {1, -1, 0}, {-1, 0, 0}, {1, 0, 0}, {-1, 1, 0}, {1, 1, 0}, {0, 1, 0}};
+
+static const int8_t (*hardcoded_moves[6])[3] = {pawn_moves, knight_moves, bishop_moves, rook_moves, queen_moves, queen_moves};
+static const int hardcoded_counts[6] = {3, 8, 4, 4, 8, 8};
+static const int hardcoded_ranges[6] = {1, 1, N_ROWS, N_ROWS, N_ROWS, 1};
+
+struct PiecesFixture {
+  struct Position positions[BENCH_POSITIONS];
+  long total_moves;
+};
+
+static int
+hardcoded_generate_moves(const struct Position *pos, Move *moves) {
+  int count = 0;
+  int side = pos->side_to_move;
+  int player_sign = side == BLACK_PLAYER ? -1 : 1;
+  int first = side * N_PIECES;
+
+  for (int piece_id = first; piece_id < first + N_PIECES; piece_id++) {
+    int from = pos->piece_squares[piece_id];
+    if (from == POSITION_SQUARE_NONE) {
+      continue;
+    }
+
+    int type = position_piece_type(pos, piece_id);
+    int from_x = square_row(from);
+    int from_y = square_col(from);
+
+    for (int i = 0; i < hardcoded_counts[type]; i++) {
+      int offset_x = hardcoded_moves[type][i][0] * player_sign;
+      int offset_y = hardcoded_moves[type][i][1] * player_sign;
+      int flags = hardcoded_moves[type][i][2];
+      int x = from_x + offset_x;
+      int y = from_y + offset_y;
+
+      for (int step = 0; step < hardcoded_ranges[type]; step++) {
+        if (x < 0 || y < 0 || x >= N_ROWS || y >= N_COLS) {
+          break;
+        }
+
+        int to = square_of(x, y);
+        int promote = (type == PAWN && (x + offset_x < 0 || x + offset_x >= N_ROWS)) ? MOVE_PROMOTE : 0;
+        int occupant = pos->board[to];
+        if (occupant == 0) {
+          if (!(flags & PIECE_CAPTURE_ONLY)) {
+            moves[count++] = MAKE_MOVE(from, to, promote);
+          }
+        }
+        else {
+          if (piece_owner(occupant - 1) != side && !(flags & PIECE_MOVE_ONLY)) {
+            moves[count++] = MAKE_MOVE(from, to, promote | MOVE_CAPTURE);
+          }
+          break;
+        }
+
+        x += offset_x;
+        y += offset_y;
+      }
+    }
+  }
+  return count;
+}
+
+static int
+compare_moves(const void *a, const void *b) {
+  return (int)*(const Move *)a - (int)*(const Move *)b;
+}
+
+static void
+make_positions(struct PiecesFixture *fixture) {
+  // A spread of middlegame-ish positions from random playouts of different lengths
+  uint64_t rng = 0x2545F4914F6CDD1Dull;
+  fixture->total_moves = 0;
+
+  for (int i = 0; i < BENCH_POSITIONS; i++) {
+    struct Position *pos = &fixture->positions[i];
+    position_set_start(pos, i % NUM_PLAYERS);
+
+    for (int ply = 0; ply < (i % 40); ply++) {
+      Move moves[POSITION_MAX_MOVES];
+      int count = position_generate_moves(pos, moves);
+      if (count == 0) {
+        break;
+      }
+      rng = (rng * 6364136223846793005ull) + 1442695040888963407ull;
+      position_make_move(pos, moves[(rng >> 33) % count], NULL);
+    }
+    Move moves[POSITION_MAX_MOVES];
+    fixture->total_moves += position_generate_moves(pos, moves);
+  }
+}
+
+static void
+check_tables_match_hardcoded(struct PiecesFixture *fixture) {
+  for (int i = 0; i < BENCH_POSITIONS; i++) {
+    Move table_moves[POSITION_MAX_MOVES];
+    Move specialized[POSITION_MAX_MOVES];
+    Move hardcoded[POSITION_MAX_MOVES];
+    int table_count = position_generate_moves_generic(&fixture->positions[i], table_moves);
+    int specialized_count = position_generate_moves_chess(&fixture->positions[i], specialized);
+    int hardcoded_count = hardcoded_generate_moves(&fixture->positions[i], hardcoded);
+
+    assert(table_count == hardcoded_count && specialized_count == hardcoded_count);
+    qsort(table_moves, table_count, sizeof (Move), compare_moves);
+    qsort(specialized, specialized_count, sizeof (Move), compare_moves);
+    qsort(hardcoded, hardcoded_count, sizeof (Move), compare_moves);
+    assert(memcmp(table_moves, hardcoded, table_count * sizeof (Move)) == 0);
+    assert(memcmp(specialized, hardcoded, table_count * sizeof (Move)) == 0);
+  }
+}
+
+static void
+bench_movegen_hardcoded(void *ctx, long iters) {
+  struct PiecesFixture *fixture = ctx;
+  Move moves[POSITION_MAX_MOVES];
+  for (long i = 0; i < iters; i++) {
+    for (int p = 0; p < BENCH_POSITIONS; p++) {
+      bench_sink += hardcoded_generate_moves(&fixture->positions[p], moves);
+    }
+  }
+}
+
+static void
+bench_movegen_tables(void *ctx, long iters) {
+  struct PiecesFixture *fixture = ctx;
+  Move moves[POSITION_MAX_MOVES];
+  for (long i = 0; i < iters; i++) {
+    for (int p = 0; p < BENCH_POSITIONS; p++) {
+      bench_sink += position_generate_moves_generic(&fixture->positions[p], moves);
+    }
+  }
+}
+
+static void
+bench_movegen_specialized(void *ctx, long iters) {
+  struct PiecesFixture *fixture = ctx;
+  Move moves[POSITION_MAX_MOVES];
+  for (long i = 0; i < iters; i++) {
+    for (int p = 0; p < BENCH_POSITIONS; p++) {
+      bench_sink += position_generate_moves_chess(&fixture->positions[p], moves);
+    }
+  }
+}
+
+// Chess with one more type on top, an alfil that only promotion could make. That isn't chess
+// any more, so every generator has to give what the table walk does with alfils on the board.
+static void
+check_extra_type(struct PiecesFixture *fixture) {
+  static uint8_t memory[PIECE_TABLES_ARENA_SIZE];
+  static const int8_t alfil[4][2] = {{2, 2}, {2, -2}, {-2, 2}, {-2, -2}};
+  struct PieceDefs defs;
+  struct PieceTables tables;
+  struct Arena arena;
+  arena_init(&arena, &memory[0], sizeof memory);
+  assert(piece_defs_load(&defs, "resources/pieces/chess.txt") == 6);
+
+  int type = defs.count++;
+  snprintf(defs.names[type], PIECE_NAME_SIZE, "alfil");
+  defs.models[type] = BISHOP;
+  defs.promotes_to[type] = -1;
+  defs.offset_counts[type] = 4;
+  for (int i = 0; i < 4; i++) {
+    defs.offset_x[type][i] = alfil[i][0];
+    defs.offset_y[type][i] = alfil[i][1];
+    defs.offset_ranges[type][i] = 1;
+    defs.offset_flags[type][i] = 0;
+  }
+  assert(piece_tables_compile(&tables, &defs, &arena) == 0);
+
+  struct PieceTables standard_tables = piece_tables;
+  piece_tables = tables;
+  assert(!piece_tables.standard_chess);
+  for (int i = 0; i < BENCH_POSITIONS; i++) {
+    // Knights turned into alfils
+    struct Position pos = fixture->positions[i];
+    for (int piece_id = 0; piece_id < POSITION_PIECES; piece_id++) {
+      if (position_piece_type(&pos, piece_id) == KNIGHT) {
+        position_set_piece_type(&pos, piece_id, type);
+      }
+    }
+    Move table_moves[POSITION_MAX_MOVES];
+    Move moves[POSITION_MAX_MOVES];
+    int table_count = position_generate_moves_generic(&pos, table_moves);
+    int count = position_generate_moves(&pos, moves);
+    assert(count == table_count);
+    qsort(table_moves, table_count, sizeof (Move), compare_moves);
+    qsort(moves, count, sizeof (Move), compare_moves);
+    assert(memcmp(table_moves, moves, count * sizeof (Move)) == 0);
+  }
+  piece_tables = standard_tables;
+  printf("pieces: chess with an extra type isn't taken for chess, %d positions agree\n", BENCH_POSITIONS);
+}
+
+void
+bench_pieces_suite(void) {
+  static struct PiecesFixture chess;
+  static struct PiecesFixture fairy;
+  static uint8_t fairy_memory[PIECE_TABLES_ARENA_SIZE];
+
+  assert(piece_tables.standard_chess);
+  make_positions(&chess);
+  check_tables_match_hardcoded(&chess);
+  check_extra_type(&chess);
+
+  // Times are per generated move since the fairy pieces have more of them
+  bench_run_ops("pieces/movegen/hardcoded", bench_movegen_hardcoded, &chess, chess.total_moves);
+  bench_run_ops("pieces/movegen/tables/chess", bench_movegen_tables, &chess, chess.total_moves);
+  bench_run_ops("pieces/movegen/specialized", bench_movegen_specialized, &chess, chess.total_moves);
+
+  struct PieceDefs defs;
+  struct PieceTables fairy_tables;
+  struct Arena arena;
+  arena_init(&arena, &fairy_memory[0], sizeof fairy_memory);
+  if (piece_defs_load(&defs, FAIRY_PIECES_PATH) < 0 || piece_tables_compile(&fairy_tables, &defs, &arena) != 0) {
+    return;
+  }
+
+  struct PieceTables standard_tables = piece_tables;
+  piece_tables = fairy_tables;
+  assert(!piece_tables.standard_chess);
+  make_positions(&fairy);
+  printf("pieces: %d chess targets, %d fairy targets\n", standard_tables.num_targets, fairy_tables.num_targets);
+  bench_run_ops("pieces/movegen/tables/fairy", bench_movegen_tables, &fairy, fairy.total_moves);
+  piece_tables = standard_tables;
+}
@@ -0,0 +1,231 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+#include "../chess.h"
+#include "../position.h"
+#include "bench.h"
+
+#define PERFT_DEPTH 3
+#define PERFT_GENERATOR_DEPTH 4
+
+typedef int (*MoveGenerator)(const struct Position *pos, Move *moves);
+
+struct PositionFixture {
+  struct Position start;
+  uint64_t perft_nodes;
+  uint64_t generator_nodes; // at PERFT_GENERATOR_DEPTH
+  struct Position line[16]; // a game's first few positions, to evaluate
+};
+
+static uint64_t
+perft_make_unmake(struct Position *pos, int depth) {
+  if (depth == 0) {
+    return 1;
+  }
+
+  Move moves[POSITION_MAX_MOVES];
+  int count = position_generate_moves(pos, moves);
+  uint64_t nodes = 0;
+
+  for (int i = 0; i < count; i++) {
+    struct PositionUndo undo;
+    position_make_move(pos, moves[i], &undo);
+    nodes += perft_make_unmake(pos, depth - 1);
+    position_unmake_move(pos, moves[i], &undo);
+  }
+  return nodes;
+}
+
+static uint64_t
+perft_copy_make(const struct Position *pos, int depth) {
+  if (depth == 0) {
+    return 1;
+  }
+
+  Move moves[POSITION_MAX_MOVES];
+  int count = position_generate_moves(pos, moves);
+  uint64_t nodes = 0;
+
+  for (int i = 0; i < count; i++) {
+    struct Position child;
+    position_copy_make(&child, pos, moves[i]);
+    nodes += perft_copy_make(&child, depth - 1);
+  }
+  return nodes;
+}
+
+static uint64_t
+perft_with(struct Position *pos, int depth, MoveGenerator generate) {
+  if (depth == 0) {
+    return 1;
+  }
+
+  Move moves[POSITION_MAX_MOVES];
+  int count = generate(pos, moves);
+  if (depth == 1) {
+    return (uint64_t)count;
+  }
+
+  uint64_t nodes = 0;
+  for (int i = 0; i < count; i++) {
+    struct PositionUndo undo;
+    position_make_move(pos, moves[i], &undo);
+    nodes += perft_with(pos, depth - 1, generate);
+    position_unmake_move(pos, moves[i], &undo);
+  }
+  return nodes;
+}
+
+// The sums make and unmake keep have to match adding every piece up again
+static void
+check_eval(const struct Position *pos) {
+  int mg, eg, phase;
+  position_compute_eval(pos, &mg, &eg, &phase);
+  assert(pos->eval_mg == mg && pos->eval_eg == eg && pos->phase == phase);
+}
+
+static int
+evaluate_rescan(const struct Position *pos) {
+  int mg, eg, phase;
+  position_compute_eval(pos, &mg, &eg, &phase);
+  int score = eval_taper(mg, eg, phase);
+  return pos->side_to_move == 0 ? score : -score;
+}
+
+// Walks a line of first moves and checks both strategies land on the same position
+static void
+check_strategies_agree(const struct Position *start) {
+  struct Position in_place = *start;
+  struct Position copied = *start;
+  struct PositionUndo undo[16];
+  Move line[16];
+  int plies = 0;
+
+  for (; plies < 16; plies++) {
+    Move moves[POSITION_MAX_MOVES];
+    int count = position_generate_moves(&in_place, moves);
+    if (count == 0) {
+      break;
+    }
+    line[plies] = moves[(plies * 7) % count];
+    position_make_move(&in_place, line[plies], &undo[plies]);
+
+    struct Position next;
+    position_copy_make(&next, &copied, line[plies]);
+    copied = next;
+
+    assert(memcmp(&in_place, &copied, sizeof in_place) == 0);
+    assert(in_place.hash == position_compute_hash(&in_place));
+    check_eval(&in_place);
+  }
+
+  while (plies-- > 0) {
+    position_unmake_move(&in_place, line[plies], &undo[plies]);
+  }
+  assert(memcmp(&in_place, start, sizeof in_place) == 0);
+}
+
+static void
+bench_position_evaluate(void *ctx, long iters) {
+  struct PositionFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    fixture->line[i & 15].side_to_move ^= 1;
+    bench_sink += position_evaluate(&fixture->line[i & 15]);
+  }
+}
+
+static void
+bench_position_evaluate_rescan(void *ctx, long iters) {
+  struct PositionFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    fixture->line[i & 15].side_to_move ^= 1;
+    bench_sink += evaluate_rescan(&fixture->line[i & 15]);
+  }
+}
+
+static void
+bench_perft_make_unmake(void *ctx, long iters) {
+  struct PositionFixture *fixture = ctx;
+  struct Position pos = fixture->start;
+  for (long i = 0; i < iters; i++) {
+    bench_sink += perft_make_unmake(&pos, PERFT_DEPTH);
+  }
+}
+
+static void
+bench_perft_copy_make(void *ctx, long iters) {
+  struct PositionFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    bench_sink += perft_copy_make(&fixture->start, PERFT_DEPTH);
+  }
+}
+
+static void
+bench_perft_generic(void *ctx, long iters) {
+  struct PositionFixture *fixture = ctx;
+  struct Position pos = fixture->start;
+  for (long i = 0; i < iters; i++) {
+    bench_sink += perft_with(&pos, PERFT_GENERATOR_DEPTH, position_generate_moves_generic);
+  }
+}
+
+static void
+bench_perft_specialized(void *ctx, long iters) {
+  struct PositionFixture *fixture = ctx;
+  struct Position pos = fixture->start;
+  for (long i = 0; i < iters; i++) {
+    bench_sink += perft_with(&pos, PERFT_GENERATOR_DEPTH, position_generate_moves_chess);
+  }
+}
+
+static void
+bench_position_copy(void *ctx, long iters) {
+  struct PositionFixture *fixture = ctx;
+  struct Position copies[2];
+  for (long i = 0; i < iters; i++) {
+    copies[i & 1] = fixture->start;
+    copies[i & 1].ply = (uint16_t)i;
+    bench_sink += copies[(i + 1) & 1].ply;
+  }
+}
+
+void
+bench_position_suite(void) {
+  static struct PositionFixture fixture;
+  position_init();
+  position_set_start(&fixture.start, WHITE_PLAYER);
+  check_strategies_agree(&fixture.start);
+
+  fixture.perft_nodes = perft_make_unmake(&fixture.start, PERFT_DEPTH);
+  assert(fixture.perft_nodes == perft_copy_make(&fixture.start, PERFT_DEPTH));
+  printf("position: %zu bytes, perft(%d) = %llu nodes\n",
+         sizeof (struct Position),
+         PERFT_DEPTH,
+         (unsigned long long)fixture.perft_nodes);
+
+  // Times are per perft node so the two strategies compare directly
+  bench_run_ops("position/perft/make_unmake", bench_perft_make_unmake, &fixture, (long)fixture.perft_nodes);
+  bench_run_ops("position/perft/copy_make", bench_perft_copy_make, &fixture, (long)fixture.perft_nodes);
+  bench_run("position/copy", bench_position_copy, &fixture);
+
+  // Leaf evaluation from the running sums against adding the board up again
+  fixture.line[0] = fixture.start;
+  for (int ply = 1; ply < 16; ply++) {
+    Move moves[POSITION_MAX_MOVES];
+    int count = position_generate_moves(&fixture.line[ply - 1], moves);
+    position_copy_make(&fixture.line[ply], &fixture.line[ply - 1], moves[(ply * 5) % count]);
+    assert(position_evaluate(&fixture.line[ply]) == evaluate_rescan(&fixture.line[ply]));
+  }
+  bench_run("position/evaluate", bench_position_evaluate, &fixture);
+  bench_run("position/evaluate/rescan", bench_position_evaluate_rescan, &fixture);
+
+  // The generic table walk against the compile time chess generators, they have to agree
+  fixture.generator_nodes = perft_with(&fixture.start, PERFT_GENERATOR_DEPTH, position_generate_moves_generic);
+  assert(fixture.generator_nodes == perft_with(&fixture.start, PERFT_GENERATOR_DEPTH, position_generate_moves_chess));
+  printf("position: perft(%d) = %llu nodes with both generators\n",
+         PERFT_GENERATOR_DEPTH,
+         (unsigned long long)fixture.generator_nodes);
+  bench_run_ops("position/perft/generic", bench_perft_generic, &fixture, (long)fixture.generator_nodes);
+  bench_run_ops("position/perft/specialized", bench_perft_specialized, &fixture, (long)fixture.generator_nodes);
+}
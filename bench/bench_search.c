@@ -0,0 +1,907 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "assert.h"
+#include "../chess.h"
+#include "../board.h"
+#include "../arena.h"
+#include "../position.h"
+#include "../tt.h"
+#include "../nnue.h"
+#include "../move_picker.h"
+#include "../see.h"
+#include "../search.h"
+#include "../time_manager.h"
+#include "../analysis.h"
+#include "bench.h"
+
+#define BENCH_SEARCH_POSITIONS 12
+#define BENCH_SEARCH_DEPTH 5 // for the node counts
+#define BENCH_SEARCH_EXACT_DEPTH 3 // without a table, every ordering has to get the same score
+#define BENCH_SEARCH_TIMED_DEPTH 4
+#define BENCH_SEARCH_TT_BYTES (1024 * 1024)
+#define BENCH_SEARCH_SLICE_US 200 // what search_slice gets each time when searching a slice at a time
+#define BENCH_PONDER_DEPTH 6
+#define BENCH_PONDER_US 20000 // the other side takes this long to reply
+#define BENCH_PONDER_MISSES 2 // replies other than the expected one tried from each position
+#define BENCH_MULTI_PV 3
+#define BENCH_ANALYSIS_DEPTH 5
+#define BENCH_ANALYSIS_WAIT_NS 2000000000ull // for the engine thread to get somewhere
+#define BENCH_TACTICS_DEPTH 8
+#define BENCH_TACTICS_NODES 400000 // given up on after this many
+#define BENCH_CLOCK_GAMES 2 // of each time control
+#define BENCH_CLOCK_PLIES 40
+#define BENCH_CLOCK_OVERHEAD_US 2000 // nothing but the bench between a search and the clock here
+#define BENCH_CLOCK_READS 1000000 // timed for what one costs
+#define BENCH_MAX_OVERHEAD_PERCENT 0.5 // of the time per node that polling the clock can take
+
+// Bullet, down to a fifth of a second with a small increment, and moves in a time control
+static const struct TimeControl clock_controls[] = {
+  {1000000, 0, 0},
+  {200000, 20000, 0},
+  {300000, 0, 10}
+};
+#define BENCH_CLOCK_CONTROLS (int)(sizeof clock_controls / sizeof clock_controls[0])
+
+static const char *const ordering_names[] = {"none", "tt move", "mvv-lva", "see", "killers", "history"};
+
+// Win At Chess, the first ten. The best moves are written as from and to squares rather than
+// SAN, there's no castling, en passant or double pawn step here so the FENs' other fields
+// don't matter.
+struct Tactic {
+  const char *fen;
+  const char *best;
+};
+
+static const struct Tactic tactics[] = {
+  {"2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w", "g3g6"},
+  {"8/7p/5k2/5p2/p1p2P2/Pr1pPK2/1P1R3P/8 b", "b3b2"},
+  {"5rk1/1ppb3p/p1pb4/6q1/3P1p1r/2P1R2P/PP1BQ1P1/5RKN w", "e3g3"},
+  {"r1bq2rk/pp3pbp/2p1p1pQ/7P/3P4/2PB1N2/PP3PPR/2KR4 w", "h6h7"},
+  {"5k2/6pp/p1qN4/1p1p4/3P4/2PKP2Q/PP3r2/3R4 b", "c6c4"},
+  {"7k/p7/1R5K/6r1/6p1/6P1/8/8 w", "b6b7"},
+  {"rnbqkb1r/pppp1ppp/8/4P3/6n1/7P/PPPNPPP1/R1BQKBNR b", "g4e3"},
+  {"r4q1k/p2bR1rp/2p2Q1N/5p2/5p2/2P5/PP3PPP/R5K1 w", "e7f7"},
+  {"3q1rk1/p4pp1/2pb3p/3p4/6Pr/1PNQ4/P1PB1PP1/4RRK1 b", "d6h2"},
+  {"2br2k1/2q3rn/p2NppQ1/2p1P3/Pp5R/4P3/1P3PPP/3R2K1 w", "h4h7"}
+};
+
+#define BENCH_TACTICS (int)(sizeof tactics / sizeof tactics[0])
+
+// When the best move showed up and stayed, over the iterations of one search
+struct SolveTracker {
+  Move expected;
+  uint64_t solved_at; // nodes by the end of the iteration that settled on it, 0 while it hasn't
+};
+
+struct SearchFixture {
+  struct Search search;
+  struct Search nnue_search; // the same, evaluating with a network
+  struct Search opponent; // replies while search ponders, without a table of its own
+  struct Nnue net;
+  struct Tt tt;
+  struct Position positions[BENCH_SEARCH_POSITIONS];
+  struct Search *timed; // which of the two the timing runs
+  int clocked; // the timing runs on a clock that never gets low
+  struct TimeManager time;
+  uint64_t clock_reads;
+};
+
+static uint64_t
+next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+static int
+compare_moves(const void *a, const void *b) {
+  return (int)*(const Move *)a - (int)*(const Move *)b;
+}
+
+// Captures and quiets have to add up to every move, from both generators, and the
+// pseudo legal test has to say yes to exactly the moves they give
+static void
+check_generators(const struct Position *pos) {
+  Move all[POSITION_MAX_MOVES];
+  Move split[POSITION_MAX_MOVES];
+  int count = position_generate_moves_generic(pos, all);
+  int captures = position_generate_captures_generic(pos, split);
+  int quiets = position_generate_quiets_generic(pos, &split[captures]);
+  assert(captures + quiets == count);
+  qsort(all, count, sizeof (Move), compare_moves);
+  qsort(split, count, sizeof (Move), compare_moves);
+  assert(memcmp(all, split, count * sizeof (Move)) == 0);
+
+  captures = position_generate_captures_chess(pos, split);
+  quiets = position_generate_quiets_chess(pos, &split[captures]);
+  assert(captures + quiets == count);
+  for (int i = 0; i < count; i++) {
+    assert(move_is_quiet(split[i]) == (i >= captures));
+  }
+  qsort(split, count, sizeof (Move), compare_moves);
+  assert(memcmp(all, split, count * sizeof (Move)) == 0);
+
+  for (int flags = 0; flags < 4; flags++) {
+    for (int from = 0; from < N_CELLS; from++) {
+      for (int to = 0; to < N_CELLS; to++) {
+        Move move = MAKE_MOVE(from, to, flags);
+        int generated = bsearch(&move, all, count, sizeof (Move), compare_moves) != NULL;
+        assert(position_move_is_pseudo_legal(pos, move) == generated);
+      }
+    }
+  }
+
+  // In check is the other side having a capture that lands on the king
+  for (int seat = 0; seat < NUM_PLAYERS; seat++) {
+    struct Position other = *pos;
+    other.side_to_move = (uint8_t)((seat + 1) % NUM_PLAYERS);
+    int moves = position_generate_captures(&other, split);
+    int king_taken = 0;
+    for (int i = 0; i < moves; i++) {
+      int victim = other.board[MOVE_TO(split[i])] - 1;
+      king_taken |= (MOVE_FLAGS(split[i]) & MOVE_CAPTURE) && position_piece_type(&other, victim) == KING;
+    }
+    assert(position_in_check(pos, seat) == king_taken);
+  }
+}
+
+// Takes on square with the cheapest piece there is or stops, whichever is better, by really
+// making the captures. Promotions are left out, static exchange doesn't promote either.
+static int
+exchange_by_making(struct Position *pos, int square) {
+  Move captures[POSITION_MAX_MOVES];
+  int count = position_generate_captures(pos, captures);
+  Move cheapest = MOVE_NONE;
+  int cheapest_value = 0;
+  for (int i = 0; i < count; i++) {
+    Move move = captures[i];
+    int value = see_value(position_piece_type(pos, pos->board[MOVE_FROM(move)] - 1));
+    if (MOVE_TO(move) == square && (MOVE_FLAGS(move) & MOVE_CAPTURE) && (cheapest == MOVE_NONE || value < cheapest_value)) {
+      cheapest = move;
+      cheapest_value = value;
+    }
+  }
+  if (cheapest == MOVE_NONE) {
+    return 0;
+  }
+
+  struct PositionUndo undo;
+  int taken = see_value(position_piece_type(pos, pos->board[square] - 1));
+  position_make_move(pos, cheapest & ~(MOVE_PROMOTE << 12), &undo);
+  int score = taken - exchange_by_making(pos, square);
+  position_unmake_move(pos, cheapest & ~(MOVE_PROMOTE << 12), &undo);
+  return MAX(score, 0);
+}
+
+static void
+check_see(const struct Position *start) {
+  struct Position pos = *start;
+  Move captures[POSITION_MAX_MOVES];
+  int count = position_generate_captures(&pos, captures);
+  for (int i = 0; i < count; i++) {
+    Move move = captures[i];
+    int to = MOVE_TO(move);
+    if (!(MOVE_FLAGS(move) & MOVE_CAPTURE) || square_row(to) == 0 || square_row(to) == N_ROWS - 1) {
+      continue;
+    }
+    struct PositionUndo undo;
+    int taken = see_value(position_piece_type(&pos, pos.board[to] - 1));
+    position_make_move(&pos, move, &undo);
+    int expected = taken - exchange_by_making(&pos, to);
+    position_unmake_move(&pos, move, &undo);
+    assert(position_see(&pos, move) == expected);
+    assert(position_see_losing(&pos, move) == (expected < 0));
+  }
+}
+
+// Whatever the table move, killers and counter are, every move comes out once
+static void
+check_picker(const struct Position *pos, struct MoveHistory *history, uint64_t *rng) {
+  Move all[POSITION_MAX_MOVES];
+  Move picked[POSITION_MAX_MOVES];
+  int count = position_generate_moves(pos, all);
+  qsort(all, count, sizeof (Move), compare_moves);
+
+  for (int trial = 0; trial < 16; trial++) {
+    // Half the time real moves, otherwise anything at all
+    Move specials[4];
+    for (int i = 0; i < 4; i++) {
+      specials[i] = (next_random(rng) & 1) && count > 0 ? all[next_random(rng) % count] : (Move)next_random(rng);
+    }
+    for (int ordering = MOVE_ORDER_NONE; ordering <= MOVE_ORDER_HISTORY; ordering++) {
+      struct MovePicker picker;
+      move_picker_init(&picker, pos, history, specials[0], &specials[1], specials[3], ordering);
+      int picked_count = 0;
+      Move move;
+      while ((move = move_picker_next(&picker)) != MOVE_NONE) {
+        assert(picked_count < count);
+        picked[picked_count++] = move;
+      }
+      assert(picked_count == count);
+      qsort(picked, count, sizeof (Move), compare_moves);
+      assert(memcmp(all, picked, count * sizeof (Move)) == 0);
+    }
+  }
+}
+
+static void
+make_positions(struct SearchFixture *fixture) {
+  // Random openings played on by a shallow search, so they look like games rather than noise
+  struct Search *search = &fixture->search;
+  struct MoveHistory history;
+  struct SearchLimits limits = {.depth = 2};
+  uint64_t rng = 0x5EA2C4ull;
+  int stored = 0;
+  move_history_clear(&history);
+
+  while (stored < BENCH_SEARCH_POSITIONS) {
+    struct Position pos;
+    position_set_start(&pos, WHITE_PLAYER);
+    for (int ply = 0; ply < 40 && stored < BENCH_SEARCH_POSITIONS; ply++) {
+      Move moves[POSITION_MAX_MOVES];
+      int count = position_generate_moves(&pos, moves);
+      check_generators(&pos);
+      check_picker(&pos, &history, &rng);
+      check_see(&pos);
+
+      Move move = MOVE_NONE;
+      if (ply < 6) {
+        for (int tries = 0; tries < count && move == MOVE_NONE; tries++) {
+          struct Position child;
+          Move candidate = moves[next_random(&rng) % count];
+          position_copy_make(&child, &pos, candidate);
+          move = position_in_check(&child, pos.side_to_move) ? MOVE_NONE : candidate;
+        }
+      }
+      else {
+        search_set_position(search, &pos);
+        move = search_run(search, &limits);
+      }
+      if (move == MOVE_NONE) {
+        break;
+      }
+
+      struct Position child;
+      position_copy_make(&child, &pos, move);
+      pos = child;
+      if (ply >= 10 && (ply % 7) == 3 && !position_in_check(&pos, pos.side_to_move)) {
+        fixture->positions[stored++] = pos;
+      }
+    }
+  }
+}
+
+// Plain alpha-beta's score doesn't depend on the order moves are tried in. Quiescence's
+// pruning does, so it stays off.
+static void
+check_orderings_agree(struct SearchFixture *fixture) {
+  struct Search *search = &fixture->search;
+  struct SearchLimits limits = {.depth = BENCH_SEARCH_EXACT_DEPTH};
+  search->tt = NULL;
+  search->quiescence = 0;
+  for (int i = 0; i < BENCH_SEARCH_POSITIONS; i += 3) {
+    int expected = 0;
+    for (int ordering = MOVE_ORDER_NONE; ordering <= MOVE_ORDER_HISTORY; ordering++) {
+      search->ordering = ordering;
+      search_clear(search);
+      search_set_position(search, &fixture->positions[i]);
+      search_run(search, &limits);
+      if (ordering == MOVE_ORDER_NONE) {
+        expected = search->score;
+      }
+      assert(search->score == expected);
+    }
+  }
+  search->tt = &fixture->tt;
+  search->ordering = MOVE_ORDER_HISTORY;
+  search->quiescence = 1;
+}
+
+// A slice at a time has to search exactly the nodes search_run does in one go, and stopping
+// partway has to leave the root as it was
+static void
+check_slices(struct SearchFixture *fixture) {
+  struct Search *search = &fixture->search;
+  struct SearchLimits limits = {.depth = BENCH_SEARCH_DEPTH};
+  int slices = 0;
+  uint64_t longest = 0;
+  for (int i = 0; i < BENCH_SEARCH_POSITIONS; i += 4) {
+    const struct Position *root = &fixture->positions[i];
+    search_clear(search);
+    search_set_position(search, root);
+    Move expected = search_run(search, &limits);
+    int score = search->score;
+    uint64_t nodes = search->nodes;
+
+    search_clear(search);
+    search_set_position(search, root);
+    search_start(search, &limits);
+    int running = 1;
+    while (running) {
+      uint64_t start = bench_now();
+      running = search_slice(search, BENCH_SEARCH_SLICE_US);
+      longest = MAX(longest, bench_now() - start);
+      slices++;
+    }
+    assert(search->best_move == expected && search->score == score && search->nodes == nodes);
+
+    search_start(search, &limits);
+    search_slice(search, BENCH_SEARCH_SLICE_US);
+    search_stop(search);
+    assert(!search->running && search->height == 0);
+    assert(memcmp(&search->pos, root, sizeof *root) == 0);
+  }
+  printf("search: sliced searches match, %d slices of %dus, longest %.0fus\n",
+         slices,
+         BENCH_SEARCH_SLICE_US,
+         longest / 1000.0);
+}
+
+// Each of the best lines has to score what searching its first move on its own does, and
+// between them they have to be the best scoring moves there are. Without a table or
+// quiescence those scores are exact.
+static void
+check_multi_pv(struct SearchFixture *fixture) {
+  struct Search *search = &fixture->search;
+  struct Search *child = &fixture->opponent;
+  struct SearchLimits limits = {.depth = BENCH_SEARCH_EXACT_DEPTH};
+  struct SearchLimits child_limits = {.depth = BENCH_SEARCH_EXACT_DEPTH - 1};
+  search_init(child, NULL, NULL);
+  child->quiescence = 0;
+  search->tt = NULL;
+  search->quiescence = 0;
+  search->multi_pv = BENCH_MULTI_PV;
+
+  for (int i = 0; i < BENCH_SEARCH_POSITIONS; i += 3) {
+    const struct Position *pos = &fixture->positions[i];
+    search_clear(search);
+    search_set_position(search, pos);
+    search_run(search, &limits);
+
+    // Every legal move's score, best first
+    Move moves[POSITION_MAX_MOVES];
+    int scores[POSITION_MAX_MOVES];
+    int count = position_generate_moves(pos, moves);
+    int legal = 0;
+    for (int m = 0; m < count; m++) {
+      struct Position after;
+      position_copy_make(&after, pos, moves[m]);
+      if (position_in_check(&after, pos->side_to_move)) {
+        continue;
+      }
+      search_clear(child);
+      search_set_position(child, &after);
+      search_run(child, &child_limits);
+      int score = -child->score;
+      int slot = legal++;
+      while (slot > 0 && scores[slot - 1] < score) {
+        scores[slot] = scores[slot - 1];
+        slot--;
+      }
+      scores[slot] = score;
+    }
+
+    assert(search->line_count == MIN(BENCH_MULTI_PV, legal));
+    assert(search->best_move == search->best_lines[0].moves[0] && search->score == search->best_lines[0].score);
+    for (int line = 0; line < search->line_count; line++) {
+      // Mates are a ply further from the child's root, those aren't compared
+      if (!search_is_mate_score(scores[line])) {
+        assert(search->best_lines[line].score == scores[line]);
+      }
+    }
+  }
+
+  search->tt = &fixture->tt;
+  search->quiescence = 1;
+  search->multi_pv = 1;
+}
+
+// Analysis a move later, with the table from before it kept and from empty. The lines it
+// had searched come out of the table so depth builds on them rather than from nothing.
+static void
+run_analysis_reuse(struct SearchFixture *fixture) {
+  struct Search *search = &fixture->search;
+  struct SearchLimits limits = {.depth = BENCH_ANALYSIS_DEPTH};
+  uint64_t nodes[2] = {0, 0}; // cleared, kept
+  search->multi_pv = BENCH_MULTI_PV;
+
+  for (int i = 0; i < BENCH_SEARCH_POSITIONS; i += 2) {
+    for (int keep = 0; keep < 2; keep++) {
+      search_clear(search);
+      search_set_position(search, &fixture->positions[i]);
+      search_run(search, &limits);
+      if (search->pv_length < 2) {
+        break;
+      }
+
+      struct Position after;
+      struct Position replied;
+      position_copy_make(&after, &fixture->positions[i], search->pv[0]);
+      position_copy_make(&replied, &after, search->pv[1]);
+      if (!keep) {
+        search_clear(search);
+      }
+      search_set_position(search, &replied);
+      search_run(search, &limits);
+      nodes[keep] += search->nodes;
+    }
+  }
+  search->multi_pv = 1;
+
+  printf("search: %d lines to depth %d a move later, %llu nodes with the table kept, %llu from empty\n",
+         BENCH_MULTI_PV,
+         BENCH_ANALYSIS_DEPTH,
+         (unsigned long long)nodes[1],
+         (unsigned long long)nodes[0]);
+}
+
+// When the engine thread's search first gets to a depth on one position, taken in the
+// report callback so it isn't rounded up to the end of a slice
+struct DepthTimer {
+  uint64_t hash;
+  int depth;
+  uint64_t reached_ns; // 0 until it has
+};
+
+static void
+time_depth(void *ctx, const struct Search *search) {
+  struct DepthTimer *timer = ctx;
+  if (search->pos.hash == timer->hash && search->depth >= timer->depth && __atomic_load_n(&timer->reached_ns, __ATOMIC_ACQUIRE) == 0) {
+    __atomic_store_n(&timer->reached_ns, bench_now(), __ATOMIC_RELEASE);
+  }
+}
+
+// Gives the thread pos and waits for lines to depth, returns how long they took
+static uint64_t
+analyse_to_depth(struct Analysis *analysis, struct DepthTimer *timer, const struct Position *pos, int depth) {
+  timer->hash = pos->hash;
+  timer->depth = depth;
+  __atomic_store_n(&timer->reached_ns, 0, __ATOMIC_RELEASE);
+  uint64_t start = bench_now();
+  analysis_set_position(analysis, pos);
+  const struct AnalysisReport *report;
+  do {
+    analysis_frame(analysis, BENCH_SEARCH_SLICE_US);
+    report = analysis_read(analysis);
+  } while ((report->hash != pos->hash || report->depth < depth) && bench_now() - start < BENCH_ANALYSIS_WAIT_NS);
+  assert(report->hash == pos->hash && report->depth >= depth);
+  assert(report->line_count == BENCH_MULTI_PV && report->lines[0].length > 0);
+  assert(position_move_is_pseudo_legal(pos, report->lines[0].moves[0]));
+  return __atomic_load_n(&timer->reached_ns, __ATOMIC_ACQUIRE) - start;
+}
+
+// The engine thread has to come back with lines for whatever position it was given last, and
+// once it's given the position two moves down its own best line, get there sooner with the
+// table it filled than with a cleared one
+static void
+check_analysis_thread(struct SearchFixture *fixture) {
+  static struct Analysis analysis;
+  struct Search *search = &fixture->search;
+  struct DepthTimer timer;
+  uint64_t waited_ns[2] = {0, 0}; // cleared, kept
+  int moves = 0;
+  search->report = time_depth;
+  search->report_ctx = &timer;
+
+  for (int i = 0; i < BENCH_SEARCH_POSITIONS; i += 2) {
+    const struct Position *pos = &fixture->positions[i];
+    for (int keep = 0; keep < 2; keep++) {
+      search_clear(search);
+      assert(analysis_start(&analysis, search, BENCH_MULTI_PV) == 0);
+      analyse_to_depth(&analysis, &timer, pos, BENCH_ANALYSIS_DEPTH);
+      const struct AnalysisReport *report = analysis_read(&analysis);
+      if (report->lines[0].length < 2) {
+        analysis_stop(&analysis);
+        break;
+      }
+      struct Position after;
+      struct Position replied;
+      position_copy_make(&after, pos, report->lines[0].moves[0]);
+      position_copy_make(&replied, &after, report->lines[0].moves[1]);
+
+      // Restarted either way, so the only difference is the table
+      analysis_stop(&analysis);
+      if (!keep) {
+        search_clear(search);
+      }
+      assert(analysis_start(&analysis, search, BENCH_MULTI_PV) == 0);
+      waited_ns[keep] += analyse_to_depth(&analysis, &timer, &replied, BENCH_ANALYSIS_DEPTH);
+      // and it has to switch back while it's still searching
+      analyse_to_depth(&analysis, &timer, pos, BENCH_ANALYSIS_DEPTH);
+      analysis_stop(&analysis);
+      moves += keep;
+    }
+  }
+
+  search->report = NULL;
+  search->multi_pv = 1;
+  assert(moves > 0 && waited_ns[1] < waited_ns[0]);
+  printf("search: analysis had %d lines to depth %d two moves down its line in %.1fms with the table kept, %.1fms cleared (%d positions)\n",
+         BENCH_MULTI_PV,
+         BENCH_ANALYSIS_DEPTH,
+         waited_ns[1] / (moves * 1e6),
+         waited_ns[0] / (moves * 1e6),
+         moves);
+}
+
+enum PonderMode {
+  PONDER_NONE,
+  PONDER,
+  PONDER_HISTORY_BACK // pondered, but the history goes back to how it was before on a miss
+};
+
+// Searches the position it's to move in after the reply, returns how long that took
+static uint64_t
+answer_reply(struct Search *search, const struct Position *pos, Move move, Move reply, int mode, uint64_t *nodes) {
+  static struct MoveHistory before_pondering;
+  struct SearchLimits limits = {.depth = BENCH_PONDER_DEPTH};
+  struct Position after;
+  struct Position replied;
+  position_copy_make(&after, pos, move);
+  position_copy_make(&replied, &after, reply);
+
+  // The same search as the one that moved first, so the table starts out the same each time
+  search_clear(search);
+  search_set_position(search, pos);
+  search_run(search, &limits);
+
+  if (mode != PONDER_NONE) {
+    struct Position expected;
+    before_pondering = search->history;
+    position_copy_make(&expected, &after, search_ponder_move(search));
+    search_set_position(search, &expected);
+    search_start(search, &limits);
+    search_slice(search, BENCH_PONDER_US);
+  }
+
+  uint64_t start = bench_now();
+  if (mode != PONDER_NONE && search->pos.hash == replied.hash) {
+    while (search_slice(search, 0)) {
+    }
+  }
+  else {
+    search_stop(search);
+    if (mode == PONDER_HISTORY_BACK) {
+      search->history = before_pondering;
+    }
+    search_set_position(search, &replied);
+    search_run(search, &limits);
+  }
+  *nodes = search->nodes;
+  return bench_now() - start;
+}
+
+// How much sooner the answer comes when search has pondered through the other side's turn.
+// Every position gives a hit, the reply search expected, and a few misses, other legal
+// replies, so a miss's cost can be told from the noise. Nodes don't depend on timing apart
+// from how far the 20ms of pondering got, and on a miss the history it left behind is the
+// only part of that that changes the answering search much.
+static void
+run_ponder(struct SearchFixture *fixture) {
+  struct Search *search = &fixture->search;
+  struct Search *opponent = &fixture->opponent;
+  struct SearchLimits limits = {.depth = BENCH_PONDER_DEPTH};
+  struct SearchLimits opponent_limits = {.depth = BENCH_PONDER_DEPTH - 1};
+  uint64_t latency[2][3] = {{0, 0, 0}, {0, 0, 0}}; // by hit, by PonderMode
+  uint64_t nodes[2][3] = {{0, 0, 0}, {0, 0, 0}};
+  int counts[2] = {0, 0};
+  int opponent_hits = 0;
+  search_init(opponent, NULL, NULL);
+
+  for (int i = 0; i < BENCH_SEARCH_POSITIONS; i++) {
+    const struct Position *pos = &fixture->positions[i];
+    search_clear(search);
+    search_set_position(search, pos);
+    Move move = search_run(search, &limits);
+    Move expected = search_ponder_move(search);
+    if (move == MOVE_NONE || expected == MOVE_NONE) {
+      continue;
+    }
+
+    // A shallower search stands in for whoever is replying, for how often the guess is right
+    struct Position after;
+    position_copy_make(&after, pos, move);
+    search_set_position(opponent, &after);
+    opponent_hits += search_run(opponent, &opponent_limits) == expected;
+
+    Move replies[POSITION_MAX_MOVES];
+    int count = position_generate_moves(&after, replies);
+    int misses = 0;
+    for (int r = -1; r < count && misses < BENCH_PONDER_MISSES; r++) {
+      Move reply = r < 0 ? expected : replies[r];
+      struct Position replied;
+      position_copy_make(&replied, &after, reply);
+      if ((r >= 0 && reply == expected) || position_in_check(&replied, after.side_to_move)) {
+        continue;
+      }
+      int hit = reply == expected;
+      misses += !hit;
+      counts[hit]++;
+      for (int mode = PONDER_NONE; mode <= (hit ? PONDER : PONDER_HISTORY_BACK); mode++) {
+        uint64_t answer_nodes;
+        latency[hit][mode] += answer_reply(search, pos, move, reply, mode, &answer_nodes);
+        nodes[hit][mode] += answer_nodes;
+      }
+    }
+  }
+
+  printf("search: the stand-in opponent played the expected reply %d times out of %d\n", opponent_hits, counts[1]);
+  for (int hit = 1; hit >= 0; hit--) {
+    printf("search: %d ponder%s, answered in %.1fms (%llu nodes) after pondering %dms, %.1fms (%llu nodes) without\n",
+           counts[hit],
+           hit ? " hits" : " misses",
+           latency[hit][PONDER] / (counts[hit] * 1e6),
+           (unsigned long long)nodes[hit][PONDER],
+           BENCH_PONDER_US / 1000,
+           latency[hit][PONDER_NONE] / (counts[hit] * 1e6),
+           (unsigned long long)nodes[hit][PONDER_NONE]);
+  }
+  printf("search: misses with the history from before pondering put back, %.1fms (%llu nodes)\n",
+         latency[0][PONDER_HISTORY_BACK] / (counts[0] * 1e6),
+         (unsigned long long)nodes[0][PONDER_HISTORY_BACK]);
+}
+
+static uint64_t
+count_nodes(struct SearchFixture *fixture, int ordering, int depth) {
+  struct Search *search = &fixture->search;
+  struct SearchLimits limits = {.depth = depth};
+  uint64_t nodes = 0;
+  search->ordering = ordering;
+  for (int i = 0; i < BENCH_SEARCH_POSITIONS; i++) {
+    search_clear(search);
+    search_set_position(search, &fixture->positions[i]);
+    search_run(search, &limits);
+    nodes += search->nodes;
+  }
+  search->ordering = MOVE_ORDER_HISTORY;
+  return nodes;
+}
+
+static uint64_t
+search_timed_positions(struct SearchFixture *fixture) {
+  // Same positions from an empty table every time, so each run searches the same nodes
+  struct Search *search = fixture->timed;
+  struct SearchLimits limits = {.depth = BENCH_SEARCH_TIMED_DEPTH};
+  struct TimeControl forever = {1000000000000ll, 0, 0}; // a couple of weeks
+  uint64_t nodes = 0;
+  fixture->clock_reads = 0;
+  for (int p = 0; p < BENCH_SEARCH_POSITIONS; p += 4) {
+    if (fixture->clocked) {
+      time_manager_start(&fixture->time, &forever, 0);
+      limits.time = &fixture->time;
+    }
+    search_clear(search);
+    search_set_position(search, &fixture->positions[p]);
+    bench_sink += search_run(search, &limits);
+    nodes += search->nodes;
+    fixture->clock_reads += search->clock_reads;
+  }
+  return nodes;
+}
+
+static void
+bench_search_depth(void *ctx, long iters) {
+  for (long i = 0; i < iters; i++) {
+    search_timed_positions(ctx);
+  }
+}
+
+static void
+bench_clock_read(void *ctx, long iters) {
+  (void)ctx;
+  for (long i = 0; i < iters; i++) {
+    bench_sink += bench_now();
+  }
+}
+
+// Self play on a clock from a few of the positions, charging each side what its searches
+// really took. Nobody's flag may fall, at any of the time controls.
+static void
+run_clock_games(struct SearchFixture *fixture) {
+  struct Search *search = &fixture->search;
+  struct TimeManager *tm = &fixture->time;
+
+  for (int c = 0; c < BENCH_CLOCK_CONTROLS; c++) {
+    const struct TimeControl *control = &clock_controls[c];
+    int moves = 0;
+    int64_t longest_us = 0;
+    int64_t closest_us = control->remaining_us;
+    int64_t past_hard_us = 0;
+    double optimums = 0.0; // of the time used, summed over the moves
+
+    for (int game = 0; game < BENCH_CLOCK_GAMES; game++) {
+      struct Position pos = fixture->positions[game * 3];
+      int64_t remaining[NUM_PLAYERS] = {control->remaining_us, control->remaining_us};
+      search_clear(search);
+      for (int ply = 0; ply < BENCH_CLOCK_PLIES; ply++) {
+        int side = pos.side_to_move;
+        int move_number = ply / 2;
+        struct TimeControl clock = {
+          .remaining_us = remaining[side],
+          .increment_us = control->increment_us,
+          .moves_to_go = control->moves_to_go > 0 ? control->moves_to_go - (move_number % control->moves_to_go) : 0
+        };
+        time_manager_start(tm, &clock, BENCH_CLOCK_OVERHEAD_US);
+        struct SearchLimits limits = {.depth = SEARCH_MAX_PLY - 1, .time = tm};
+        search_set_position(search, &pos);
+        uint64_t start = bench_now();
+        Move move = search_run(search, &limits);
+        int64_t elapsed_us = (int64_t)((bench_now() - start) / 1000);
+        assert(search->pos.hash == pos.hash);
+        if (move == MOVE_NONE) {
+          break;
+        }
+
+        remaining[side] -= elapsed_us;
+        assert(remaining[side] > 0);
+        closest_us = MIN(closest_us, remaining[side]);
+        remaining[side] += control->increment_us;
+        if (control->moves_to_go > 0 && (move_number + 1) % control->moves_to_go == 0) {
+          remaining[side] += control->remaining_us;
+        }
+
+        moves++;
+        longest_us = MAX(longest_us, elapsed_us);
+        past_hard_us = MAX(past_hard_us, elapsed_us - tm->hard_us);
+        optimums += tm->optimum_us > 0 ? (double)elapsed_us / tm->optimum_us : 0.0;
+
+        struct Position next;
+        position_copy_make(&next, &pos, move);
+        pos = next;
+      }
+    }
+
+    printf("search: clock %d/%.2fs+%.2fs, %d moves in %.2f optimums each, longest %.1fms, %.1fms left at the closest, hard limit passed by %.2fms at most\n",
+           control->moves_to_go,
+           control->remaining_us / 1e6,
+           control->increment_us / 1e6,
+           moves,
+           optimums / MAX(moves, 1),
+           longest_us / 1000.0,
+           closest_us / 1000.0,
+           past_hard_us / 1000.0);
+  }
+}
+
+static Move
+move_from_text(const struct Position *pos, const char *text) {
+  Move moves[POSITION_MAX_MOVES];
+  // The a file is the last column, like position_from_fen has it
+  int from = ((text[1] - '1') * N_COLS) + ('h' - text[0]);
+  int to = ((text[3] - '1') * N_COLS) + ('h' - text[2]);
+  int count = position_generate_moves(pos, moves);
+  for (int i = 0; i < count; i++) {
+    if (MOVE_FROM(moves[i]) == from && MOVE_TO(moves[i]) == to) {
+      return moves[i];
+    }
+  }
+  return MOVE_NONE;
+}
+
+static void
+track_solve(void *ctx, const struct Search *search) {
+  struct SolveTracker *tracker = ctx;
+  if (search->best_move != tracker->expected) {
+    tracker->solved_at = 0;
+  }
+  else if (tracker->solved_at == 0) {
+    tracker->solved_at = search->nodes;
+  }
+}
+
+// Nodes until each position's best move is found for good, with and without quiescence
+static void
+run_tactics(struct SearchFixture *fixture) {
+  struct Search *search = &fixture->search;
+  struct SearchLimits limits = {.depth = BENCH_TACTICS_DEPTH, .nodes = BENCH_TACTICS_NODES};
+  struct SolveTracker tracker;
+  uint64_t totals[2] = {0, 0};
+  int solved[2] = {0, 0};
+
+  search->report = track_solve;
+  search->report_ctx = &tracker;
+  for (int i = 0; i < BENCH_TACTICS; i++) {
+    struct Position pos;
+    assert(position_from_fen(&pos, tactics[i].fen) == 0);
+    tracker.expected = move_from_text(&pos, tactics[i].best);
+    assert(tracker.expected != MOVE_NONE);
+
+    for (int quiescence = 0; quiescence < 2; quiescence++) {
+      search->quiescence = quiescence;
+      tracker.solved_at = 0;
+      search_clear(search);
+      search_set_position(search, &pos);
+      search_run(search, &limits);
+      solved[quiescence] += tracker.solved_at != 0;
+      totals[quiescence] += tracker.solved_at;
+    }
+  }
+  search->report = NULL;
+  search->quiescence = 1;
+
+  for (int quiescence = 0; quiescence < 2; quiescence++) {
+    printf("search: tactics %s quiescence, %d/%d solved, %llu nodes to solve those\n",
+           quiescence ? "with" : "without",
+           solved[quiescence],
+           BENCH_TACTICS,
+           (unsigned long long)totals[quiescence]);
+  }
+}
+
+void
+bench_search_suite(void) {
+  static struct SearchFixture fixture;
+  static uint8_t tt_memory[BENCH_SEARCH_TT_BYTES];
+  struct Arena arena;
+  arena_init(&arena, tt_memory, sizeof tt_memory);
+  assert(tt_init(&fixture.tt, &arena, sizeof tt_memory) == 0);
+  search_init(&fixture.search, &fixture.tt, NULL);
+
+  // The usual start written out has to be the same position main() plays from
+  struct Position from_fen;
+  struct Position start;
+  assert(position_from_fen(&from_fen, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w") == 0);
+  position_set_start(&start, WHITE_PLAYER);
+  assert(from_fen.hash == start.hash);
+
+  make_positions(&fixture);
+  check_orderings_agree(&fixture);
+  printf("search: generators, picker and every ordering agree on %d positions\n", BENCH_SEARCH_POSITIONS);
+  check_slices(&fixture);
+  check_multi_pv(&fixture);
+  printf("search: %d best lines score what their moves do searched one by one\n", BENCH_MULTI_PV);
+
+  // Each heuristic on top of the ones before it, nodes to the same depth
+  uint64_t unordered = 0;
+  for (int ordering = MOVE_ORDER_NONE; ordering <= MOVE_ORDER_HISTORY; ordering++) {
+    uint64_t nodes = count_nodes(&fixture, ordering, BENCH_SEARCH_DEPTH);
+    if (ordering == MOVE_ORDER_NONE) {
+      unordered = nodes;
+    }
+    printf("search: depth %d ordering %-8s %10llu nodes (%.1f%% of unordered)\n",
+           BENCH_SEARCH_DEPTH,
+           ordering_names[ordering],
+           (unsigned long long)nodes,
+           (100.0 * nodes) / unordered);
+  }
+
+  run_tactics(&fixture);
+  run_ponder(&fixture);
+  run_analysis_reuse(&fixture);
+  check_analysis_thread(&fixture);
+  run_clock_games(&fixture);
+
+  fixture.timed = &fixture.search;
+  uint64_t nodes = search_timed_positions(&fixture);
+  bench_run_ops("search/node", bench_search_depth, &fixture, (long)nodes);
+
+  // A clock that never runs low can't change the search, it only costs the polling. Timed
+  // here too so the check doesn't depend on the benchmarks being filtered in.
+  fixture.clocked = 1;
+  uint64_t started = bench_now();
+  assert(search_timed_positions(&fixture) == nodes);
+  double node_ns = (double)(bench_now() - started) / nodes;
+  uint64_t clock_reads = fixture.clock_reads;
+  bench_run_ops("search/node/clocked", bench_search_depth, &fixture, (long)nodes);
+  fixture.clocked = 0;
+  started = bench_now();
+  bench_clock_read(NULL, BENCH_CLOCK_READS);
+  double read_ns = (double)(bench_now() - started) / BENCH_CLOCK_READS;
+  double overhead = (100.0 * clock_reads * read_ns) / (nodes * node_ns);
+  printf("search: on a clock, %.4f clock reads a node at %.0fns each, %.4f%% of the time per node\n",
+         (double)clock_reads / nodes,
+         read_ns,
+         overhead);
+  assert(overhead < BENCH_MAX_OVERHEAD_PERCENT);
+
+  // The network's accumulators have to be back at the root after every search
+  nnue_init_random(&fixture.net, 0x4E4E5545ull);
+  search_init(&fixture.nnue_search, &fixture.tt, &fixture.net);
+  fixture.timed = &fixture.nnue_search;
+  uint64_t nnue_nodes = search_timed_positions(&fixture);
+  assert(fixture.nnue_search.nnue.depth == 0);
+  bench_run_ops("search/node/nnue", bench_search_depth, &fixture, (long)nnue_nodes);
+}
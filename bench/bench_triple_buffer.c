@@ -0,0 +1,112 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+#include "../triple_buffer.h"
+#include "bench.h"
+
+#ifndef NO_THREADS
+#include "pthread.h"
+#endif
+
+// About what main() publishes for one board, every word is the sequence number
+// so a reader can tell if it ever got a slot the writer was still filling
+#define SNAPSHOT_WORDS 256
+
+struct BenchSnapshot {
+  uint64_t sequence;
+  uint32_t words[SNAPSHOT_WORDS];
+};
+
+struct TripleBufferFixture {
+  struct TripleBuffer buffer;
+  struct BenchSnapshot slots[3];
+  uint64_t sequence;
+  int stop;
+};
+
+static void
+fill(struct BenchSnapshot *snapshot, uint64_t sequence) {
+  snapshot->sequence = sequence;
+  for (int i = 0; i < SNAPSHOT_WORDS; i++) {
+    snapshot->words[i] = (uint32_t)sequence;
+  }
+}
+
+static void
+bench_publish_read(void *ctx, long iters) {
+  // One simulation step and one frame on the same thread, the cost of the handoff itself
+  struct TripleBufferFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    fill(triple_buffer_back(&fixture->buffer), ++fixture->sequence);
+    triple_buffer_publish(&fixture->buffer);
+    const struct BenchSnapshot *snapshot = triple_buffer_read(&fixture->buffer);
+    bench_sink += snapshot->sequence;
+  }
+}
+
+#ifndef NO_THREADS
+// Checks the slot is whole and no older than the last one read
+static uint64_t
+check(const struct BenchSnapshot *snapshot, uint64_t last) {
+  uint64_t sequence = snapshot->sequence;
+  assert(sequence >= last);
+  for (int i = 0; i < SNAPSHOT_WORDS; i++) {
+    assert(snapshot->words[i] == (uint32_t)sequence);
+  }
+  return sequence;
+}
+
+static void *
+writer_main(void *arg) {
+  struct TripleBufferFixture *fixture = arg;
+  uint64_t sequence = fixture->sequence;
+  while (!__atomic_load_n(&fixture->stop, __ATOMIC_RELAXED)) {
+    fill(triple_buffer_back(&fixture->buffer), ++sequence);
+    triple_buffer_publish(&fixture->buffer);
+  }
+  return NULL;
+}
+
+static void
+bench_read_contended(void *ctx, long iters) {
+  // The render side while another thread publishes as fast as it can
+  struct TripleBufferFixture *fixture = ctx;
+  uint64_t last = 0;
+  for (long i = 0; i < iters; i++) {
+    last = check(triple_buffer_read(&fixture->buffer), last);
+  }
+  bench_sink += last;
+}
+#endif
+
+void
+bench_triple_buffer_suite(void) {
+  static struct TripleBufferFixture fixture;
+  triple_buffer_init(&fixture.buffer, &fixture.slots[0], &fixture.slots[1], &fixture.slots[2]);
+
+  // Nothing published yet, the reader keeps the slot it started with
+  fill(&fixture.slots[2], 0);
+  assert(triple_buffer_read(&fixture.buffer) == &fixture.slots[2]);
+
+  // Every publish is seen by the next read, and a read with nothing new keeps the same slot
+  for (uint64_t i = 1; i <= 8; i++) {
+    fill(triple_buffer_back(&fixture.buffer), i);
+    triple_buffer_publish(&fixture.buffer);
+    const struct BenchSnapshot *latest = triple_buffer_read(&fixture.buffer);
+    assert(latest->sequence == i);
+    assert(triple_buffer_read(&fixture.buffer) == latest);
+  }
+  fixture.sequence = 8;
+
+  bench_run("triple_buffer/publish_read", bench_publish_read, &fixture);
+
+#ifndef NO_THREADS
+  fixture.stop = 0;
+  pthread_t writer;
+  pthread_create(&writer, NULL, writer_main, &fixture);
+  bench_run("triple_buffer/read_contended", bench_read_contended, &fixture);
+  __atomic_store_n(&fixture.stop, 1, __ATOMIC_RELAXED);
+  pthread_join(writer, NULL);
+#endif
+}
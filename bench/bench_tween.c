@@ -0,0 +1,117 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "math.h"
+#include "assert.h"
+#include "../arena.h"
+#include "../tween.h"
+#include "bench.h"
+
+#define TWEEN_BENCH_KEYS (16 * 1024)
+#define TWEEN_BENCH_DT (1.0f / 60.0f)
+
+struct TweenFixture {
+  struct Tweens *tweens;
+};
+
+static Vector3
+key_position(int key, int end) {
+  return (Vector3){(float)(key % 8) * 5.0f, end ? 2.0f : 0.0f, (float)((key / 8) % 8) * 5.0f};
+}
+
+// Every key slides somewhere and every fourth one fades out, none of them ever finish
+static void
+start_all(struct Tweens *tweens, int count) {
+  tweens_clear(tweens);
+  for (int key = 0; key < count; key++) {
+    if (key % 4 == 3) {
+      tween_fade_out(tweens, key, key_position(key, 0), 1e9f, 0.0f);
+    }
+    else {
+      tween_move(tweens, key, key_position(key, 0), key_position(key, 1), 1e9f, key % TWEEN_EASING_COUNT, 0.0f);
+    }
+  }
+}
+
+static void
+check_slots(const struct Tweens *tweens) {
+  for (int row = 0; row < tweens->count; row++) {
+    assert(tween_of(tweens, tweens->keys[row]) == row);
+  }
+}
+
+// Runs real length tweens through to the end and checks where they are on the way
+static void
+check_tweens(struct Tweens *tweens) {
+  tweens_clear(tweens);
+  for (int key = 0; key < 64; key++) {
+    if (key % 4 == 3) {
+      tween_fade_out(tweens, key, key_position(key, 0), TWEEN_FADE_SECONDS, 0.0f);
+    }
+    else {
+      tween_move(tweens, key, key_position(key, 0), key_position(key, 1), TWEEN_MOVE_SECONDS, key % TWEEN_EASING_COUNT, 0.0f);
+    }
+  }
+  assert(tweens->count == 64);
+
+  // Starting over on a key reuses its row, stopping one hands its row to the last
+  tween_move(tweens, 5, key_position(5, 0), key_position(5, 1), TWEEN_MOVE_SECONDS, TWEEN_SMOOTH, 0.0f);
+  tween_stop(tweens, 0);
+  assert(tweens->count == 63 && tween_of(tweens, 0) == -1);
+  check_slots(tweens);
+
+  // Half way through, moves are between their ends and fades are part way out
+  tweens_update(tweens, TWEEN_MOVE_SECONDS * 0.5f);
+  assert(tweens->count == 63);
+  for (int key = 1; key < 64; key++) {
+    int row = tween_of(tweens, key);
+    assert(row >= 0);
+    if (key % 4 == 3) {
+      assert(tweens->fade[row] > 0.0f && tweens->fade[row] < 1.0f);
+    }
+    else {
+      assert(tweens->y[row] > 0.0f && tweens->y[row] < 2.0f && tweens->fade[row] == 1.0f);
+      if (key % TWEEN_EASING_COUNT == TWEEN_LINEAR) {
+        assert(fabsf(tweens->y[row] - 1.0f) < 1e-4f);
+      }
+    }
+  }
+  check_slots(tweens);
+
+  // The moves finish first, then the fades, and they all go away
+  tweens_update(tweens, TWEEN_MOVE_SECONDS * 0.5f);
+  assert(tweens->count == 16);
+  check_slots(tweens);
+  tweens_update(tweens, TWEEN_FADE_SECONDS);
+  assert(tweens->count == 0);
+}
+
+static void
+bench_update(void *ctx, long iters) {
+  struct TweenFixture *fixture = ctx;
+  for (long i = 0; i < iters; i++) {
+    tweens_update(fixture->tweens, TWEEN_BENCH_DT);
+  }
+  bench_sink += (uint64_t)fixture->tweens->x[0];
+}
+
+void
+bench_tween_suite(void) {
+  static struct TweenFixture fixture;
+  size_t size = TWEENS_ARENA_SIZE(TWEEN_BENCH_KEYS);
+  void *memory = malloc(size);
+  struct Arena arena;
+  arena_init(&arena, memory, size);
+  fixture.tweens = tweens_create(&arena, TWEEN_BENCH_KEYS);
+  assert(fixture.tweens != NULL);
+
+  check_tweens(fixture.tweens);
+
+  // Reported per 1k animations, so the two sizes compare directly
+  start_all(fixture.tweens, 1024);
+  bench_run_ops("tween/update/1k", bench_update, &fixture, 1);
+  start_all(fixture.tweens, TWEEN_BENCH_KEYS);
+  bench_run_ops("tween/update/16k", bench_update, &fixture, TWEEN_BENCH_KEYS / 1024);
+
+  free(memory);
+}
@@ -0,0 +1,189 @@
+#include "stdint.h"
+#include "assert.h"
+#include "raylib.h"
+#include "math.h"
+#include "board.h"
+
+// Starting layout by slot, what moves each slot makes comes from the piece definitions
+ChessPiece white_starting_pieces[N_PIECES] = {
+    PAWN, PAWN, PAWN, PAWN, PAWN, PAWN, PAWN, PAWN,           // First row
+    ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK // Second row
+};
+
+// Listed in black's own frame (see set_pieces) so the king and queen swap places
+// compared to white, they still end up facing each other
+ChessPiece black_starting_pieces[N_PIECES] = {
+    PAWN, PAWN, PAWN, PAWN, PAWN, PAWN, PAWN, PAWN,           // First row
+    ROOK, KNIGHT, BISHOP, KING, QUEEN, BISHOP, KNIGHT, ROOK // Second row
+};
+
+// Seats beyond the first two sit on the left and right edges
+Vector2 player_forwards[MAX_PLAYERS] = {
+    {1, 0},  // white, up the rows
+    {-1, 0}, // black, down the rows
+    {0, 1},  // along the columns
+    {0, -1}
+};
+
+ChessPiece *player_starting_pieces[MAX_PLAYERS] = {
+    &white_starting_pieces[0],
+    &black_starting_pieces[0],
+    &white_starting_pieces[0],
+    &black_starting_pieces[0]
+};
+
+int
+convert_coord(int input, int n) {
+  // n = number of cells in a row or column
+  // Translate coordinates
+  assert (n > 0);
+  int half = n / 2;
+  return half - input;
+}
+
+Vector3
+calculate_position(int col, int row, int size) {
+  // Given a column and row, and a tile size
+  // calculate a board position
+  assert (size != 0);
+  Vector3 position = { (size*row) - (size/2.0),
+                       0.0f,
+                       (size*col) - (size/2.0)}; // 4 = half the grid from center
+  assert (fpclassify(position.x) == FP_NORMAL || fpclassify(position.x) == FP_ZERO);
+  assert (fpclassify(position.y) == FP_NORMAL || fpclassify(position.y) == FP_ZERO);
+  assert (fpclassify(position.z) == FP_NORMAL || fpclassify(position.z) == FP_ZERO);
+
+  return position;
+}
+
+void
+build_square_positions(Vector3 *square_positions, int size) {
+  // The chess coordinates used by calculate_position are centered around 0,0
+  // and run opposite to the cell indices, so flip them back here once
+  for (int square = 0; square < N_CELLS; square++) {
+    int x = square_row(square);
+    int y = square_col(square);
+    square_positions[square] = calculate_position(convert_coord(x, N_ROWS), convert_coord(y, N_COLS), size);
+  }
+}
+
+int
+set_pieces(struct ChessPieces pieces,
+           struct Cells cells,
+           struct Players players,
+           int player_id) {
+  // Lays a player's N_PIECES out on the two rows along the edge behind them, in their own frame:
+  // pieces 0..7 on the row in front, 8..15 on the back row, counting from their right.
+  // With white and black that's the normal board. Anything that lands on a square
+  // somebody already has (the corners with more than two players) starts out captured.
+  Vector2 forward = players.forwards[player_id];
+  Vector2 right = rotate_offset((Vector2){0, 1}, forward);
+
+  // The corner of the board the player's frame starts from
+  int origin_x = (forward.x < 0 || right.x < 0) ? N_ROWS - 1 : 0;
+  int origin_y = (forward.y < 0 || right.y < 0) ? N_COLS - 1 : 0;
+
+  int first_piece = player_id * N_PIECES;
+  int *live_pieces = &players.live_pieces[first_piece];
+  int live_count = 0;
+
+  for (int i = 0; i < N_PIECES; i++) {
+    int piece = first_piece + i;
+    int row = 1 - (i / N_COLS);
+    int file = (N_COLS - 1) - (i % N_COLS);
+    int x = origin_x + (row * forward.x) + (file * right.x);
+    int y = origin_y + (row * forward.y) + (file * right.y);
+    Square square = square_of(x, y);
+
+    pieces.owners[piece] = (uint8_t)player_id;
+
+    if (cells.occupied_states[square]) {
+      pieces.squares[piece] = SQUARE_NONE;
+      pieces.is_dead[piece] = 1;
+      continue;
+    }
+
+    pieces.squares[piece] = square; // points to the cell that piece is on
+    pieces.is_dead[piece] = 0;
+    live_pieces[live_count++] = piece;
+
+    cells.occupied_states[square] = 1;
+    cells.cell_player_states[square] = player_id;
+    cells.cell_piece_indices[square] = piece; // ends up pointing back to the piece occupied by that cell
+  }
+
+  players.live_piece_counts[player_id] = live_count;
+  players.select_to_move_pieces[player_id] = live_count > 0 ? live_pieces[0] : first_piece;
+  return live_count;
+}
+
+int
+should_skip_cell(int x,
+                 int y,
+                 int player_sign,
+                 int active_player,
+                 struct Cells cells) {
+  // Filter out moves off the end of the board
+  int position = y + (x * N_COLS);
+  if (x < 0 || y < 0 || x >= N_ROWS || y >= N_COLS) {
+    return BOARD_EDGE;
+  }
+
+  // If it's occupied but not by us then we can move to it (and take the piece on it in chess)
+
+  if (cells.cell_player_states[position] == active_player) {
+    return OWN_PIECE;
+  }
+
+  if (cells.cell_player_states[position] != active_player && cells.occupied_states[position] != 0) {
+    return OTHER_PIECE;
+  }
+
+  return NO_COLLISION;
+}
+
+int
+clamp(int d, int min, int max) {
+  const int t = d < min ? min : d;
+  return t > max ? max : t;
+}
+
+
+int
+calculate_row_move_forward(int active_cell_to_move_to, int player_sign, int move_count, int n_rows) {
+  if (move_count <= 0) {
+    return 0;
+  }
+  return clamp(active_cell_to_move_to + (player_sign * n_rows) % move_count, 0, move_count - 1);
+}
+
+int
+calculate_row_move_backward(int active_cell_to_move_to, int player_sign, int move_count, int n_rows) {
+  if (move_count <= 0) {
+    return 0;
+  }
+  return clamp(active_cell_to_move_to - (player_sign * n_rows) % move_count, 0, move_count - 1);
+}
+
+int
+find_next_piece(int active_piece_to_move,
+                int active_player,
+                int direction,
+                struct Players players) {
+  // Cycles through your live pieces, only ever looks at the active player's list
+  // TODO: use a quadtree to do this as well for the mouse
+  const int *live_pieces = &players.live_pieces[active_player * N_PIECES];
+  int live_count = players.live_piece_counts[active_player];
+
+  for (int i = 0; i < live_count; i++) {
+    if (live_pieces[i] != active_piece_to_move) {
+      continue;
+    }
+    int next = i + direction;
+    if (next >= 0 && next < live_count) {
+      return live_pieces[next];
+    }
+    break;
+  }
+  return active_piece_to_move; // If we didn't find anything return the original cell, can't return 0 because it could be invalid!
+}
@@ -0,0 +1,65 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "raylib.h"
+#include "chess.h"
+
+// Starting layout, indexed by piece
+extern ChessPiece white_starting_pieces[N_PIECES];
+extern ChessPiece black_starting_pieces[N_PIECES];
+
+// Per seat, indexed by player
+extern Vector2 player_forwards[MAX_PLAYERS];
+extern ChessPiece *player_starting_pieces[MAX_PLAYERS];
+
+static inline Square
+square_of(int x, int y) {
+  return (Square)(y + (x * N_COLS));
+}
+
+static inline int
+square_row(Square square) {
+  return square / N_COLS;
+}
+
+static inline int
+square_col(Square square) {
+  return square % N_COLS;
+}
+
+// Turns an offset written for a player moving up the rows (+x) into one for a player
+// facing `forward`, for black that's the same as flipping both signs
+static inline Vector2
+rotate_offset(Vector2 offset, Vector2 forward) {
+  return (Vector2){(offset.x * forward.x) - (offset.y * forward.y),
+                   (offset.x * forward.y) + (offset.y * forward.x)};
+}
+
+int convert_coord(int input, int n);
+Vector3 calculate_position(int col, int row, int size);
+
+// Fills in the world position of every square, done once so drawing is a table lookup
+void build_square_positions(Vector3 *square_positions, int size);
+
+// Places player_id's pieces and fills in their live list, returns how many made it onto the board
+int set_pieces(struct ChessPieces pieces,
+               struct Cells cells,
+               struct Players players,
+               int player_id);
+
+int should_skip_cell(int x,
+                     int y,
+                     int player_sign,
+                     int active_player,
+                     struct Cells cells);
+
+int clamp(int d, int min, int max);
+int calculate_row_move_forward(int active_cell_to_move_to, int player_sign, int move_count, int n_rows);
+int calculate_row_move_backward(int active_cell_to_move_to, int player_sign, int move_count, int n_rows);
+
+int find_next_piece(int active_piece_to_move,
+                    int active_player,
+                    int direction,
+                    struct Players players);
+
+#endif
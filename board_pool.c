@@ -0,0 +1,116 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "stdint.h"
+#include "stdlib.h"
+#include "time.h"
+#include "board_pool.h"
+
+static uint64_t
+now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+int
+board_pool_init(struct BoardPool *pool, int count, int num_players, const struct Level *level, int num_threads) {
+  // Every game_create wants GAME_ARENA_SIZE free even though it keeps less than that,
+  // so size for the worst case, with room for a game record in case it gets logged.
+  // One malloc at startup, nothing after that.
+  size_t per_board = sizeof (struct Game *) + (2 * sizeof (uint64_t)) + GAME_RECORD_ARENA_SIZE + 64;
+  size_t size = (size_t)count * (GAME_ARENA_SIZE + per_board);
+
+  pool->memory = malloc(size);
+  if (pool->memory == NULL) {
+    return -1;
+  }
+  arena_init(&pool->arena, pool->memory, size);
+
+  pool->count = count;
+  pool->focused = 0;
+  pool->games = ARENA_ALLOC_ARRAY(&pool->arena, struct Game *, count);
+  pool->rng_states = ARENA_ALLOC_ARRAY(&pool->arena, uint64_t, count);
+  pool->update_ns = ARENA_ALLOC_ZERO_ARRAY(&pool->arena, uint64_t, count);
+
+  for (int i = 0; i < count; i++) {
+    pool->games[i] = level != NULL ? game_create_from_level(&pool->arena, level) : game_create(&pool->arena, num_players);
+    if (pool->games[i] == NULL) {
+      free(pool->memory);
+      return -1;
+    }
+    // Any odd-ish nonzero seed works for xorshift, keep them different per board
+    pool->rng_states[i] = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1);
+  }
+
+  thread_pool_init(&pool->threads, num_threads);
+  return 0;
+}
+
+int
+board_pool_attach_log(struct BoardPool *pool, struct GameLogWriter *writer) {
+  for (int i = 0; i < pool->count; i++) {
+    struct Game *game = pool->games[i];
+    game->record = game_record_create(&pool->arena, writer, i);
+    if (game->record == NULL) {
+      return -1;
+    }
+    game_record_begin(game->record, game);
+  }
+  return 0;
+}
+
+void
+board_pool_destroy(struct BoardPool *pool) {
+  thread_pool_destroy(&pool->threads);
+  for (int i = 0; i < pool->count; i++) {
+    if (pool->games[i]->record != NULL) {
+      game_record_finish(pool->games[i]->record, GAME_LOG_END_RESET);
+    }
+  }
+  free(pool->memory);
+  pool->memory = NULL;
+  pool->count = 0;
+}
+
+static void
+update_board(void *ctx, int index) {
+  struct BoardPool *pool = ctx;
+  if (index == pool->focused) {
+    return;
+  }
+
+  uint64_t start = now_ns();
+  struct Game *game = pool->games[index];
+
+  if (!game_update_auto(game, &pool->rng_states[index]) || game->ply >= BOARD_POOL_MAX_PLIES) {
+    game_reset(game);
+  }
+
+  pool->update_ns[index] = now_ns() - start;
+}
+
+struct BoardPoolStats
+board_pool_update(struct BoardPool *pool) {
+  struct BoardPoolStats stats = {.max_board = -1};
+
+  uint64_t start = now_ns();
+  thread_pool_parallel_for(&pool->threads, pool->count, update_board, pool);
+  stats.wall_ns = now_ns() - start;
+
+  for (int i = 0; i < pool->count; i++) {
+    if (i == pool->focused) {
+      continue;
+    }
+    stats.total_ns += pool->update_ns[i];
+    stats.updated++;
+    if (pool->update_ns[i] >= stats.max_ns) {
+      stats.max_ns = pool->update_ns[i];
+      stats.max_board = i;
+    }
+  }
+
+  if (stats.updated > 0) {
+    stats.avg_ns = stats.total_ns / (uint64_t)stats.updated;
+  }
+  return stats;
+}
@@ -0,0 +1,52 @@
+#ifndef BOARD_POOL_H
+#define BOARD_POOL_H
+
+#include "stddef.h"
+#include "stdint.h"
+#include "arena.h"
+#include "game.h"
+#include "level.h"
+#include "game_log.h"
+#include "thread_pool.h"
+
+// Boards that don't have a player on them get reset after this many moves
+#define BOARD_POOL_MAX_PLIES 200
+
+// Many independent games in one process. Every game comes out of one arena,
+// the focused board is the one main() takes input for, the rest play themselves
+// and are updated across the thread pool.
+struct BoardPool {
+  struct Arena arena;
+  void *memory;
+  struct ThreadPool threads;
+  int count;
+  int focused;
+
+  // Per board, indexed the same as games
+  struct Game **games;
+  uint64_t *rng_states;
+  uint64_t *update_ns; // how long the last update of each board took
+};
+
+struct BoardPoolStats {
+  uint64_t wall_ns; // the whole parallel update
+  uint64_t total_ns; // sum of every board, compare with wall_ns for the speedup
+  uint64_t avg_ns;
+  uint64_t max_ns;
+  int max_board;
+  int updated; // boards that got an update, everything but the focused one
+};
+
+// Every board gets num_players seats, or starts from level instead when it isn't NULL
+// (the level has to outlive the pool). Returns -1 if the memory couldn't be allocated
+// or the level doesn't fit a game. num_threads <= 0 uses every cpu.
+int board_pool_init(struct BoardPool *pool, int count, int num_players, const struct Level *level, int num_threads);
+// Records every game from now on into the log, the writer has to stay open until after
+// board_pool_destroy (which hands over the games still being played)
+int board_pool_attach_log(struct BoardPool *pool, struct GameLogWriter *writer);
+void board_pool_destroy(struct BoardPool *pool);
+
+// One move on every board except the focused one
+struct BoardPoolStats board_pool_update(struct BoardPool *pool);
+
+#endif
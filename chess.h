@@ -1,5 +1,10 @@
-static Vector3 calculate_position(int, int, int);
-static int clamp(int, int, int);
+#ifndef CHESS_H
+#define CHESS_H
+
+#include "stdint.h"
+#include "stdio.h"
+#include "math.h"
+#include "raylib.h"
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
@@ -11,7 +16,12 @@ static int clamp(int, int, int);
 #define N_PIECES 16
 #define GRID_SIZE (N_CELLS  * 5.0f) // TODO would be stored in a table later, and the tile size 5.0 would be dynamic
 
-int
+// Canonical board coordinate, a cell index in 0..N_CELLS-1 (row * N_COLS + col)
+// world positions are only looked up from it when drawing
+typedef uint16_t Square;
+#define SQUARE_NONE ((Square)0xFFFF)
+
+static inline int
 next_pow2(int n) {
   int k = 1;
   while (k < n) {
@@ -20,11 +30,6 @@ next_pow2(int n) {
   return k;
 }
 
-enum SIDES {
-  TOP_SIDE = 0,
-  BOTTOM_SIDE = 1
-};
-
 typedef enum CollisionStates {
   NO_COLLISION = 0,
   OWN_PIECE = 1,
@@ -38,13 +43,18 @@ typedef enum PlayerState {
   CHECKMATE = 2
 } PlayerState;
 
-// FIXME allow for a variable number of players (for not chess)
+// How many players a game has is runtime data (struct Game num_players), up to MAX_PLAYERS.
+// These name the first two seats, NUM_PLAYERS is classic chess which is what
+// struct Position and the engine work with.
 typedef enum PlayerType {
   WHITE_PLAYER = 0,
   BLACK_PLAYER = 1,
   NUM_PLAYERS
 } PlayerType;
 
+#define MAX_PLAYERS 4
+
+// The six slots the starting layout uses, piece types past KING come from the piece definitions
 typedef enum ChessPiece {
     PAWN = 0,
     KNIGHT = 1,
@@ -83,34 +93,33 @@ struct Quads {
   int *bottom_right;
 };
 
+// Every player's pieces in one table, player p owns ids p*N_PIECES .. (p+1)*N_PIECES-1
 struct ChessPieces {
   ChessPiece *chess_type;
-  Vector3 *grid_positions; // where they are in 3D space
-  Vector2 *chess_positions; // where they are in 2D chess space (centered around 0,0)
+  uint8_t *owners; // player that owns each piece
+  Square *squares; // which cell each piece is on, foreign key for Cells
   uint8_t *is_dead;
   Color *colors;
-  int *action_points_per_turn;
-  int *piece_cell_indices; // foreign key for Cells
   int *quad_indices; // refers to the node in the quadtree this piece is located
 };
 
 struct ChessTypes {
   float *scaling_factors;
   Texture2D *textures;
-  Model *models;
-  Vector2 **offsets; // "actions" a piece type can take
-  int *offset_sizes;
+  Model *models; // indexed by the model a piece definition asks for
 };
 
 struct Players {
-  int *score;
+  int *score; // material left, midgame centipawns (eval.h)
   int *select_to_move_pieces; // tracks which cell you / a piece is actually on
   int *select_to_move_to_cells; // tracks which cell you're thinking of moving to
-  int *live_piece_counts; // how many pieces are currently alive
-  Vector2 *select_to_move_to_chess_positions; // tracks the chess position of the cell you're thinking of moving to
+  int *select_counts; // how many things (pieces or moves) you're cycling through
+  Square *select_to_move_to_squares; // tracks the square of the cell you're thinking of moving to
   PlayerType *player_type;
   PlayerState *player_states;
-  int *piece_indices;
+  Vector2 *forwards; // which way is forward for each player, piece offsets are rotated by it
+  int *live_pieces; // N_PIECES slots per player, ids of their live pieces in id order
+  int *live_piece_counts; // how many pieces are currently alive
 };
 
 struct Cells {
@@ -119,55 +128,11 @@ struct Cells {
   int *cell_piece_indices; // foreign key for ChessPieces
 };
 
-// TODO have multiple boards
-
-// Pawn move offsets (including the initial two-square move)
-Vector2 pawnOffsets[] = {
-    {1, 0},  // Single square forward
-             // FIXME, need a rule that it can take other pieces diagonally only
-};
-
-// Knight move offsets
-Vector2 knightOffsets[] = {
-    {1, -2}, {-1, -2}, // Leftmost columns
-    {2, -1}, {-2, -1}, // Next from left
-    {2, 1}, {-2, 1},   // Next from left
-    {1, 2}, {-1, 2}    // Rightmost columns
-};
-
-// Bishop move offsets (unbounded)
-Vector2 bishopOffsets[] = {
-    {1, -1}, {-1, -1}, // Leftmost columns
-    {1, 1}, {-1, 1}    // Rightmost columns
-};
-
-// Rook move offsets (unbounded)
-Vector2 rookOffsets[] = {
-    {1, 0}, {-1, 0}, // Horizontal moves (rows)
-    {0, -1}, {0, 1}  // Vertical moves (columns)
-};
-
-// Unbounded
-Vector2 queenOffsets[] = {
-    {0, -1},
-    {-1, -1}, {1, -1},
-    {-1, 0}, {1, 0},
-    {-1, 1}, {1, 1},
-    {0, 1}
-};
-
-Vector2 kingOffsets[] = {
-    {0, -1},
-    {-1, -1}, {1, -1},
-    {-1, 0}, {1, 0},
-    {-1, 1}, {1, 1},
-    {0, 1}
-};
-
 // Debugging stuff
 
 // Convert HSV to RGB
-Color HSVtoRGB(float h, float s, float v) {
+static inline Color
+HSVtoRGB(float h, float s, float v) {
     float c = v * s;
     float x = c * (1.0f - fabsf(fmodf(h / 60.0f, 2.0f) - 1.0f));
     float m = v - c;
@@ -198,23 +163,24 @@ Color HSVtoRGB(float h, float s, float v) {
 }
 
 // Function to map integer `i` to a distinct color
-Color next_color(int i) {
+static inline Color
+next_color(int i) {
     const float golden_ratio_conjugate = 0.618033988749895f; // Golden ratio conjugate
     float hue = fmodf((i * golden_ratio_conjugate) * 360.0f, 360.0f); // Spread hues evenly
     return HSVtoRGB(hue, 1.0f, 1.0f); // Full saturation and brightness
 }
 
-static void
+static inline void
 print_vec2(Vector2 vec) {
   printf("x = %f, y = %f\n", vec.x, vec.y);
 }
 
-static void
+static inline void
 print_vec3(Vector3 vec) {
   printf("x = %f, y = %f, z = %f\n", vec.x, vec.y, vec.z);
 }
 
-static void
+static inline void
 print_cell_player_states(int *states) {
   printf("cell states = ");
   for (int i = 0; i < N_CELLS; i++) {
@@ -224,7 +190,7 @@ print_cell_player_states(int *states) {
 }
 
 
-static void
+static inline void
 print_board_state(uint8_t *board) {
   printf("board states = ");
   for (int i = 0; i < N_CELLS; i++) {
@@ -242,7 +208,7 @@ static int q_head = 0; // Index of the first element in the queue
 static int q_tail = 0; // Index of the next insertion point
 static int q_count = 0; // Number of elements in the queue
 
-static int
+static inline int
 q_push(struct QItem vec,
        struct QItem *queue,
        int q_size) {
@@ -256,7 +222,7 @@ q_push(struct QItem vec,
     return index;
 }
 
-static int
+static inline int
 q_get(int q_size) {
     if (q_count == 0) {
         return -1; // Queue is empty
@@ -266,3 +232,5 @@ q_get(int q_size) {
     q_count--;
     return index;
 }
+
+#endif
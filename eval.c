@@ -0,0 +1,137 @@
+#include "stdint.h"
+#include "chess.h"
+#include "board.h"
+#include "eval.h"
+
+struct EvalTerm eval_terms[NUM_PLAYERS][EVAL_MODELS][N_CELLS];
+
+const uint8_t eval_phase_weights[EVAL_MODELS] = {0, 1, 1, 2, 4, 0};
+const int16_t eval_material[EVAL_MODELS] = {82, 337, 365, 477, 1025, 0};
+static const int16_t eval_material_eg[EVAL_MODELS] = {94, 281, 297, 512, 936, 0};
+
+// Square bonuses seen from the side that owns the piece, its back rank first
+static const int8_t pawn_mg[8][8] = {
+  {  0,   0,   0,   0,   0,   0,   0,   0},
+  {  5,  10,  10, -20, -20,  10,  10,   5},
+  {  5,  -5, -10,   0,   0, -10,  -5,   5},
+  {  0,   0,   0,  20,  20,   0,   0,   0},
+  {  5,   5,  10,  25,  25,  10,   5,   5},
+  { 10,  10,  20,  30,  30,  20,  10,  10},
+  { 50,  50,  50,  50,  50,  50,  50,  50},
+  {  0,   0,   0,   0,   0,   0,   0,   0}
+};
+
+// Late on a pawn is worth more the closer it is to promoting
+static const int8_t pawn_eg[8][8] = {
+  {  0,   0,   0,   0,   0,   0,   0,   0},
+  {  0,   0,   0,   0,   0,   0,   0,   0},
+  { 10,  10,  10,  10,  10,  10,  10,  10},
+  { 20,  20,  20,  20,  20,  20,  20,  20},
+  { 35,  35,  35,  35,  35,  35,  35,  35},
+  { 60,  60,  60,  60,  60,  60,  60,  60},
+  {100, 100, 100, 100, 100, 100, 100, 100},
+  {  0,   0,   0,   0,   0,   0,   0,   0}
+};
+
+static const int8_t knight_table[8][8] = {
+  {-50, -40, -30, -30, -30, -30, -40, -50},
+  {-40, -20,   0,   5,   5,   0, -20, -40},
+  {-30,   5,  10,  15,  15,  10,   5, -30},
+  {-30,   0,  15,  20,  20,  15,   0, -30},
+  {-30,   5,  15,  20,  20,  15,   5, -30},
+  {-30,   0,  10,  15,  15,  10,   0, -30},
+  {-40, -20,   0,   0,   0,   0, -20, -40},
+  {-50, -40, -30, -30, -30, -30, -40, -50}
+};
+
+static const int8_t bishop_table[8][8] = {
+  {-20, -10, -10, -10, -10, -10, -10, -20},
+  {-10,   5,   0,   0,   0,   0,   5, -10},
+  {-10,  10,  10,  10,  10,  10,  10, -10},
+  {-10,   0,  10,  10,  10,  10,   0, -10},
+  {-10,   5,   5,  10,  10,   5,   5, -10},
+  {-10,   0,   5,  10,  10,   5,   0, -10},
+  {-10,   0,   0,   0,   0,   0,   0, -10},
+  {-20, -10, -10, -10, -10, -10, -10, -20}
+};
+
+static const int8_t rook_table[8][8] = {
+  {  0,   0,   0,   5,   5,   0,   0,   0},
+  { -5,   0,   0,   0,   0,   0,   0,  -5},
+  { -5,   0,   0,   0,   0,   0,   0,  -5},
+  { -5,   0,   0,   0,   0,   0,   0,  -5},
+  { -5,   0,   0,   0,   0,   0,   0,  -5},
+  { -5,   0,   0,   0,   0,   0,   0,  -5},
+  {  5,  10,  10,  10,  10,  10,  10,   5},
+  {  0,   0,   0,   0,   0,   0,   0,   0}
+};
+
+static const int8_t queen_table[8][8] = {
+  {-20, -10, -10,  -5,  -5, -10, -10, -20},
+  {-10,   0,   5,   0,   0,   0,   0, -10},
+  {-10,   5,   5,   5,   5,   5,   0, -10},
+  {  0,   0,   5,   5,   5,   5,   0,  -5},
+  { -5,   0,   5,   5,   5,   5,   0,  -5},
+  {-10,   0,   5,   5,   5,   5,   0, -10},
+  {-10,   0,   0,   0,   0,   0,   0, -10},
+  {-20, -10, -10,  -5,  -5, -10, -10, -20}
+};
+
+// Tucked away behind its pawns while there's material about
+static const int8_t king_mg[8][8] = {
+  { 20,  30,  10,   0,   0,  10,  30,  20},
+  { 20,  20,   0,   0,   0,   0,  20,  20},
+  {-10, -20, -20, -20, -20, -20, -20, -10},
+  {-20, -30, -30, -40, -40, -30, -30, -20},
+  {-30, -40, -40, -50, -50, -40, -40, -30},
+  {-30, -40, -40, -50, -50, -40, -40, -30},
+  {-30, -40, -40, -50, -50, -40, -40, -30},
+  {-30, -40, -40, -50, -50, -40, -40, -30}
+};
+
+// and out in the middle once there isn't
+static const int8_t king_eg[8][8] = {
+  {-50, -30, -30, -30, -30, -30, -30, -50},
+  {-30, -30,   0,   0,   0,   0, -30, -30},
+  {-30, -10,  20,  30,  30,  20, -10, -30},
+  {-30, -10,  30,  40,  40,  30, -10, -30},
+  {-30, -10,  30,  40,  40,  30, -10, -30},
+  {-30, -10,  20,  30,  30,  20, -10, -30},
+  {-30, -20, -10,   0,   0, -10, -20, -30},
+  {-50, -40, -30, -20, -20, -30, -40, -50}
+};
+
+// Indexed by model
+static const int8_t (*const mg_tables[EVAL_MODELS])[8] = {pawn_mg, knight_table, bishop_table, rook_table, queen_table, king_mg};
+static const int8_t (*const eg_tables[EVAL_MODELS])[8] = {pawn_eg, knight_table, bishop_table, rook_table, queen_table, king_eg};
+
+void
+eval_init(void) {
+  // Ranks count up the way the seat moves, the tables are stretched over boards that aren't 8x8
+  for (int seat = 0; seat < NUM_PLAYERS; seat++) {
+    int forward_x = (int)player_forwards[seat].x;
+    int forward_y = (int)player_forwards[seat].y;
+    int sign = seat == 0 ? 1 : -1;
+
+    for (int square = 0; square < N_CELLS; square++) {
+      int row = square_row(square);
+      int col = square_col(square);
+      int rank = 0;
+      int file = 0;
+      if (forward_x != 0) {
+        rank = (forward_x > 0 ? row : N_ROWS - 1 - row) * 8 / N_ROWS;
+        file = col * 8 / N_COLS;
+      }
+      else {
+        rank = (forward_y > 0 ? col : N_COLS - 1 - col) * 8 / N_COLS;
+        file = row * 8 / N_ROWS;
+      }
+
+      for (int model = 0; model < EVAL_MODELS; model++) {
+        struct EvalTerm *term = &eval_terms[seat][model][square];
+        term->mg = (int16_t)(sign * (eval_material[model] + mg_tables[model][rank][file]));
+        term->eg = (int16_t)(sign * (eval_material_eg[model] + eg_tables[model][rank][file]));
+      }
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "stdint.h"
+#include "chess.h"
+#include "piece_defs.h"
+
+// Static evaluation: material plus piece-square tables, with a midgame and an endgame score
+// blended by how much material is left on the board (a tapered eval). What every piece is
+// worth on every square is worked out once, so struct Position keeps running sums through
+// make and unmake and scoring a leaf only reads them.
+//
+// Piece types come from the definition files, so they're valued by the model they're
+// drawn with (pawn to king). Scores are centipawns for seat 0, seat 1 counts against it.
+
+#define EVAL_MODELS 6
+#define EVAL_PHASE_MAX 24 // all the knights, bishops, rooks and queens of a chess game
+
+struct EvalTerm {
+  int16_t mg;
+  int16_t eg;
+};
+
+// Material and square bonus together, already negated for seat 1
+extern struct EvalTerm eval_terms[NUM_PLAYERS][EVAL_MODELS][N_CELLS];
+extern const uint8_t eval_phase_weights[EVAL_MODELS];
+// Midgame material by model, what struct Players keeps as a score
+extern const int16_t eval_material[EVAL_MODELS];
+
+// Fills eval_terms in, it only depends on the board size and seat directions
+void eval_init(void);
+
+static inline const struct EvalTerm *
+eval_term(int seat, int type, int square) {
+  return &eval_terms[seat][piece_tables.models[type]][square];
+}
+
+static inline int
+eval_phase_weight(int type) {
+  return eval_phase_weights[piece_tables.models[type]];
+}
+
+static inline int
+eval_piece_material(int type) {
+  return eval_material[piece_tables.models[type]];
+}
+
+// Promotions can put more on the board than a game starts with, that's still a full midgame
+static inline int
+eval_taper(int mg, int eg, int phase) {
+  if (phase > EVAL_PHASE_MAX) {
+    phase = EVAL_PHASE_MAX;
+  }
+  return ((mg * phase) + (eg * (EVAL_PHASE_MAX - phase))) / EVAL_PHASE_MAX;
+}
+
+#endif
@@ -0,0 +1,628 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+#include "raylib.h"
+#include "chess.h"
+#include "board.h"
+#include "arena.h"
+#include "piece_defs.h"
+#include "level.h"
+#include "position.h"
+#include "game_log.h"
+#include "attacks.h"
+#include "eval.h"
+#include "game.h"
+
+// The quadtree build is chatty, only print it when asked to
+#ifdef QTREE_DEBUG
+#define QTREE_LOG(...) printf(__VA_ARGS__)
+#else
+#define QTREE_LOG(...) do { if (0) printf(__VA_ARGS__); } while (0)
+#endif
+
+void
+initialize_qtree(struct Quads qtree, struct QItem *queue, int q_size) {
+  qtree.size = q_size;
+
+  QTREE_LOG("qtree.size = %d\n", qtree.size);
+
+  Vector2 current_quad_size;
+  current_quad_size.x = N_ROWS * PIECE_SIZE;
+  current_quad_size.y = N_COLS * PIECE_SIZE;
+
+  Vector3 current_quad_position;
+  current_quad_position.x = 0.0f;
+  current_quad_position.y = 0.0f;
+  current_quad_position.z = 0.0f;
+
+  struct QItem root = {.position = current_quad_position, .dimensions=current_quad_size};
+
+  q_push(root, queue, q_size);
+
+  while (q_count > 0) { // FIXME level calculation
+    int next_q_count = q_count;
+    QTREE_LOG("q_count = %d\n", q_count);
+    if (next_q_count >= (q_size/16.0)) {
+      break;
+    }
+    for (int i = 0; i < next_q_count; i++) {
+      struct QItem current_node = queue[q_get(q_size)];
+      struct Vector2 root_dimensions = current_node.dimensions;
+      struct Vector3 root_position = current_node.position;
+
+      int root_num_cells_x = (root_dimensions.x / PIECE_SIZE);
+      int root_num_cells_y = (root_dimensions.y / PIECE_SIZE);
+
+      float root_x_numerator_left = root_dimensions.x;
+      float root_x_numerator_right = root_dimensions.x;
+      float root_y_numerator = root_dimensions.y;
+
+      QTREE_LOG("i = %d, root_x_cells = %d, root_y_cells = %d\n", i, root_num_cells_x, root_num_cells_y);
+
+      // Calculate root dimension number of cells
+      // Split into quads based on number of *cells*, and allow an uneven split, e.g. 3 -> 1, 2
+      // do that for rows and columns
+      // convert back to normal coordinates for each quad
+
+      Vector3 bottom_right_pos = {
+          .x = root_position.x + (root_x_numerator_right / 4.0),
+          .y = 0.0f,
+          .z = root_position.z + (root_y_numerator / 4.0)
+      };
+      Vector3 bottom_left_pos = {
+          .x = root_position.x - (root_x_numerator_left / 4.0),
+          .y = 0.0f,
+          .z = root_position.z + (root_y_numerator / 4.0)
+      };
+      Vector3 top_left_pos = {
+          .x = root_position.x - (root_x_numerator_left / 4.0),
+          .y = 0.0f,
+          .z = root_position.z - (root_y_numerator / 4.0)
+      };
+      Vector3 top_right_pos = {
+          .x = root_position.x + (root_x_numerator_right / 4.0),
+          .y = 0.0f,
+          .z = root_position.z - (root_y_numerator / 4.0)
+      };
+
+      Vector2 bottom_right_size = {.x=root_dimensions.x / 2.0, .y=root_dimensions.y / 2.0};
+      Vector2 bottom_left_size = {.x=root_dimensions.x / 2.0, .y=root_dimensions.y / 2.0};
+      Vector2 top_left_size = {.x=root_dimensions.x / 2.0, .y=root_dimensions.y / 2.0};
+      Vector2 top_right_size = {.x=root_dimensions.x / 2.0, .y=root_dimensions.y / 2.0};
+
+      //DrawCube(top_left_pos, top_left_size.x, 0.1f, top_left_size.y, next_color(i));
+      //DrawCube(top_right_pos, top_right_size.x, 0.1f, top_right_size.y, next_color(i+10));
+      //DrawCube(bottom_left_pos, bottom_left_size.x, 0.1f, bottom_left_size.y, next_color(i+20));
+      //DrawCube(bottom_right_pos, bottom_right_size.x, 0.1f, bottom_right_size.y, next_color(i+30));
+
+      assert(q_push((struct QItem){.position=top_left_pos, .dimensions=top_left_size}, queue, q_size) != -1);
+      assert(q_push((struct QItem){.position=top_right_pos, .dimensions=top_right_size}, queue, q_size) != -1);
+      assert(q_push((struct QItem){.position=bottom_right_pos, .dimensions=bottom_right_size}, queue, q_size) != -1);
+      assert(q_push((struct QItem){.position=bottom_left_pos, .dimensions=bottom_left_size}, queue, q_size) != -1);
+
+      /*
+      printf("===============\n");
+      printf("root_pos = "); print_vec3(root_position);
+      printf("bottom_right_pos = "); print_vec3(bottom_right_pos);
+      printf("top_right_pos = "); print_vec3(top_right_pos);
+      printf("bottom_left_pos = "); print_vec3(bottom_left_pos);
+      printf("top_left_pos = "); print_vec3(top_left_pos);
+      printf("===============\n");
+      */
+    }
+  }
+
+  q_count = 0;
+  q_tail = 0;
+  q_head = 0;
+
+}
+
+static struct ChessPieces
+alloc_pieces(struct Arena *arena, int count) {
+  struct ChessPieces pieces = {
+    .chess_type = ARENA_ALLOC_ARRAY(arena, ChessPiece, count),
+    .owners = ARENA_ALLOC_ARRAY(arena, uint8_t, count),
+    .squares = ARENA_ALLOC_ARRAY(arena, Square, count),
+    .is_dead = ARENA_ALLOC_ZERO_ARRAY(arena, uint8_t, count),
+    .colors = ARENA_ALLOC_ARRAY(arena, Color, count) // later on, a player could have differently colored pieces
+  };
+
+  memset(pieces.squares, 0xFF, count * sizeof (Square));
+  return pieces;
+}
+
+int
+game_piece_moves(const struct Game *game, int piece, Square *move_squares) {
+  struct ChessPieces pieces = game->pieces;
+
+  if (pieces.is_dead[piece] == 1) {
+    return 0;
+  }
+
+  // Every square the piece could reach from here is precomputed, offset by offset,
+  // all that's left is checking what's standing on them and that the king is safe after
+  int player = pieces.owners[piece];
+  const struct Checks *checks = game_checks(game, player);
+  SquareSet allowed = ~0ull;
+  if (piece == checks->king) {
+    allowed = ~checks->king_danger;
+  }
+  else if (checks->king >= 0) {
+    if (checks->checkers & (checks->checkers - 1)) {
+      return 0; // double check, only the king can move
+    }
+    allowed = checks->evasions;
+    if (checks->pinned & PIECE_BIT(piece)) {
+      allowed &= checks->pin_lines[piece - (player * N_PIECES)];
+    }
+  }
+
+  int index = piece_table_index(&piece_tables, player, pieces.chess_type[piece], pieces.squares[piece]);
+  const struct PieceTarget *target = &piece_tables.targets[piece_tables.starts[index]];
+  const struct PieceTarget *end = target + piece_tables.counts[index];
+
+  struct Cells cells = game->cells;
+  int move_to_count = 0;
+
+  while (target < end) {
+    int square = target->square;
+
+    if (cells.occupied_states[square] == 0) {
+      if (!(target->flags & PIECE_CAPTURE_ONLY) && (allowed & SQUARE_BIT(square))) {
+        move_squares[move_to_count++] = square;
+      }
+      target++;
+      continue;
+    }
+
+    // Something is in the way, take it if it's not ours then go on to the next offset
+    if (cells.cell_player_states[square] != player && !(target->flags & PIECE_MOVE_ONLY) && (allowed & SQUARE_BIT(square))) {
+      move_squares[move_to_count++] = square;
+    }
+    target += target->skip;
+  }
+
+  return move_to_count;
+}
+
+static void
+remove_live_piece(struct Players players, int player, int piece) {
+  // Keeps the list in id order so cycling through pieces doesn't jump around after a capture
+  int *live_pieces = &players.live_pieces[player * N_PIECES];
+  int live_count = players.live_piece_counts[player];
+
+  for (int i = 0; i < live_count; i++) {
+    if (live_pieces[i] == piece) {
+      memmove(&live_pieces[i], &live_pieces[i + 1], (live_count - i - 1) * sizeof live_pieces[0]);
+      players.live_piece_counts[player]--; // reduce number of live pieces for enemy
+      return;
+    }
+  }
+}
+
+void
+game_move_piece(struct Game *game, int piece, Square square_to) {
+  struct Cells cells = game->cells;
+  struct ChessPieces pieces = game->pieces;
+  int player = pieces.owners[piece];
+  Square square_from = pieces.squares[piece];
+  int promotes_to = piece_tables.promotes_to[pieces.chess_type[piece]];
+  int promotes = promotes_to >= 0 && piece_tables.promotion_squares[(player * N_CELLS) + square_to];
+
+  // Recorded before anything changes so a checkpoint taken here is the board the move is played on
+  if (game->record != NULL) {
+    int move_flags = (cells.occupied_states[square_to] == 1 ? MOVE_CAPTURE : 0) | (promotes ? MOVE_PROMOTE : 0);
+    game_record_move(game->record, game, MAKE_MOVE(square_from, square_to, move_flags));
+  }
+
+  int captured = -1;
+  if (cells.occupied_states[square_to] == 1) {
+    int kill_cell_piece_index = cells.cell_piece_indices[square_to];
+    captured = kill_cell_piece_index;
+    // Set that piece to be dead and take it out of its owner's live list
+    pieces.is_dead[kill_cell_piece_index] = 1;
+    pieces.squares[kill_cell_piece_index] = SQUARE_NONE;
+    remove_live_piece(game->players, pieces.owners[kill_cell_piece_index], kill_cell_piece_index);
+    game->players.score[pieces.owners[kill_cell_piece_index]] -= eval_piece_material(pieces.chess_type[kill_cell_piece_index]);
+  }
+
+  // Moving around all the state tracking stuff
+  // This tracks whether a cell is occupied or not
+  cells.occupied_states[square_to] = 1;
+  cells.occupied_states[square_from] = 0;
+
+  // This tracks which piece is currently occupying a cell
+  cells.cell_piece_indices[square_to] = cells.cell_piece_indices[square_from];
+  cells.cell_piece_indices[square_from] = 0;
+
+  // This tracks which player is currently occupying a cell
+  cells.cell_player_states[square_to] = player;
+  cells.cell_player_states[square_from] = -1;
+
+  // The piece just points at its new cell, where it gets drawn is looked up from that
+  pieces.squares[piece] = square_to;
+
+  if (promotes) {
+    game->players.score[player] += eval_piece_material(promotes_to) - eval_piece_material(pieces.chess_type[piece]);
+    pieces.chess_type[piece] = promotes_to;
+  }
+
+  attack_map_move(game->attacks, game, piece, square_from, square_to, captured);
+  game->checks->player = -1;
+  game->ply++;
+}
+
+const struct Checks *
+game_checks(const struct Game *game, int player) {
+  if (game->checks->player != player) {
+    checks_compute(game->checks, game->attacks, game, player);
+  }
+  return game->checks;
+}
+
+int
+game_player_status(const struct Game *game, int player) {
+  // Stops at the first piece with a legal move, so this is only slow when it's mate
+  Square move_squares[N_CELLS];
+  int in_check = game_checks(game, player)->checkers != 0;
+  const int *live_pieces = &game->players.live_pieces[player * N_PIECES];
+
+  for (int i = 0; i < game->players.live_piece_counts[player]; i++) {
+    if (game_piece_moves(game, live_pieces[i], move_squares) > 0) {
+      return in_check ? GAME_CHECK : GAME_PLAYING;
+    }
+  }
+  return in_check ? GAME_CHECKMATE : GAME_STALEMATE;
+}
+
+static void
+count_scores(struct Game *game) {
+  // Every player's score is the material they have left, moves keep it up to date from here
+  for (int player = 0; player < game->num_players; player++) {
+    const int *live_pieces = &game->players.live_pieces[player * N_PIECES];
+    int score = 0;
+    for (int i = 0; i < game->players.live_piece_counts[player]; i++) {
+      score += eval_piece_material(game->pieces.chess_type[live_pieces[i]]);
+    }
+    game->players.score[player] = score;
+  }
+}
+
+static int
+in_game(const struct Game *game, int player) {
+  return game->players.live_piece_counts[player] > 0 && game->players.player_states[player] != CHECKMATE;
+}
+
+static void
+clock_turn_over(struct GameClock *clock, int player) {
+  // The increment comes after every move, the next control's time after its last one
+  if (!clock->running || clock->flagged >= 0) {
+    return;
+  }
+  clock->remaining_us[player] += clock->increment_us;
+  clock->moves_made[player]++;
+  if (clock->moves_per_control != 0 && clock->moves_made[player] % clock->moves_per_control == 0) {
+    clock->remaining_us[player] += clock->initial_us;
+  }
+}
+
+int
+game_next_player(struct Game *game) {
+  // Turns go round the table, skipping anybody who has nothing left or has been mated
+  clock_turn_over(&game->clock, game->active_player);
+  int player = game->active_player;
+  for (int i = 0; i < game->num_players; i++) {
+    player = (player + 1) % game->num_players;
+    if (!in_game(game, player)) {
+      continue;
+    }
+    game->status = game_player_status(game, player);
+    if (game->status != GAME_CHECKMATE) {
+      break;
+    }
+    game->players.player_states[player] = CHECKMATE;
+  }
+  game->active_player = player;
+
+  // The last one standing has won
+  int left = 0;
+  for (int other = 0; other < game->num_players; other++) {
+    left += in_game(game, other);
+  }
+  if (left < 2) {
+    game->status = GAME_CHECKMATE;
+  }
+  if (game->clock.flagged >= 0) {
+    game->status = GAME_FLAGGED;
+  }
+  return player;
+}
+
+static void
+clock_reset(struct GameClock *clock) {
+  for (int player = 0; player < MAX_PLAYERS; player++) {
+    clock->remaining_us[player] = clock->initial_us;
+    clock->moves_made[player] = 0;
+  }
+  clock->flagged = -1;
+}
+
+void
+game_clock_set(struct Game *game, int64_t initial_us, int64_t increment_us, int moves_per_control) {
+  struct GameClock *clock = &game->clock;
+  clock->running = 1;
+  clock->initial_us = initial_us;
+  clock->increment_us = increment_us;
+  clock->moves_per_control = moves_per_control;
+  clock_reset(clock);
+}
+
+void
+game_clock_tick(struct Game *game, int64_t elapsed_us) {
+  struct GameClock *clock = &game->clock;
+  if (!clock->running || game_over(game)) {
+    return;
+  }
+  int player = game->active_player;
+  clock->remaining_us[player] -= elapsed_us;
+  if (clock->remaining_us[player] <= 0) {
+    clock->remaining_us[player] = 0;
+    clock->flagged = player;
+    game->status = GAME_FLAGGED;
+  }
+}
+
+static uint32_t
+next_random(uint64_t *state) {
+  // xorshift64*, each board keeps its own state so boards can update on any thread
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return (uint32_t)((x * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+int
+game_update_auto(struct Game *game, uint64_t *rng) {
+  // Plays one random move for whoever's turn it is, starting from a random piece
+  // so every live piece gets a go. Returns 0 when the side to move is stuck.
+  Square move_squares[N_CELLS];
+  int player = game->active_player;
+  const int *live_pieces = &game->players.live_pieces[player * N_PIECES];
+  int live_count = game->players.live_piece_counts[player];
+
+  if (live_count == 0 || game_over(game)) {
+    return 0;
+  }
+
+  int first = next_random(rng) % live_count;
+  for (int i = 0; i < live_count; i++) {
+    int piece = live_pieces[(first + i) % live_count];
+    int move_count = game_piece_moves(game, piece, move_squares);
+    if (move_count == 0) {
+      continue;
+    }
+
+    game_move_piece(game, piece, move_squares[next_random(rng) % move_count]);
+    game_next_player(game);
+    return 1;
+  }
+  return 0;
+}
+
+static void
+place_pieces(struct Game *game, int player, const Square *squares) {
+  // Same bookkeeping as set_pieces for pieces that already know their squares (a level
+  // or a saved game), their ids are laid out exactly like ours so they copy across one for one
+  struct ChessPieces pieces = game->pieces;
+  struct Cells cells = game->cells;
+  int first_piece = player * N_PIECES;
+  int *live_pieces = &game->players.live_pieces[first_piece];
+  int live_count = 0;
+
+  for (int piece = first_piece; piece < first_piece + N_PIECES; piece++) {
+    Square square = squares[piece];
+    pieces.owners[piece] = (uint8_t)player;
+    pieces.squares[piece] = square;
+    pieces.is_dead[piece] = square == SQUARE_NONE;
+    if (square == SQUARE_NONE) {
+      continue;
+    }
+
+    live_pieces[live_count++] = piece;
+    cells.occupied_states[square] = 1;
+    cells.cell_player_states[square] = player;
+    cells.cell_piece_indices[square] = piece;
+  }
+
+  game->players.live_piece_counts[player] = live_count;
+  game->players.select_to_move_pieces[player] = live_count > 0 ? live_pieces[0] : first_piece;
+}
+
+void
+game_restore(struct Game *game, const uint8_t *squares, const uint8_t *types, int active_player, int ply) {
+  Square piece_squares[MAX_PLAYERS * N_PIECES];
+  for (int piece = 0; piece < game->num_pieces; piece++) {
+    piece_squares[piece] = squares[piece] == POSITION_SQUARE_NONE ? SQUARE_NONE : squares[piece];
+    game->pieces.chess_type[piece] = types[piece];
+  }
+
+  memset(game->cells.occupied_states, 0, N_CELLS * sizeof (uint8_t));
+  memset(game->cells.cell_player_states, -1, N_CELLS * sizeof (int));
+  memset(game->cells.cell_piece_indices, 0, N_CELLS * sizeof (int));
+  for (int player = 0; player < game->num_players; player++) {
+    place_pieces(game, player, piece_squares);
+    // Checkpoints don't say who was mated, game_next_player finds them again on their turn
+    if (game->players.player_states[player] == CHECKMATE) {
+      game->players.player_states[player] = PIECE_SELECTION;
+    }
+  }
+
+  game->active_player = active_player;
+  game->ply = ply;
+  count_scores(game);
+  attack_map_build(game->attacks, game);
+  game->checks->player = -1;
+  game->status = game_player_status(game, active_player);
+}
+
+void
+game_reset(struct Game *game) {
+  // Puts the pieces back where they started, reusing the memory the game already has
+  if (game->record != NULL) {
+    game_record_finish(game->record, GAME_LOG_END_RESET);
+  }
+
+  Color seat_colors[MAX_PLAYERS] = {WHITE, BLACK, RED, BLUE};
+  struct ChessPieces pieces = game->pieces;
+
+  for (int player = 0; player < game->num_players; player++) {
+    int first_piece = player * N_PIECES;
+    const ChessPiece *starting_pieces = game->level != NULL ? &game->level->piece_types[first_piece] : player_starting_pieces[player];
+    memcpy(&pieces.chess_type[first_piece], starting_pieces, N_PIECES * sizeof (ChessPiece));
+    for (int i = first_piece; i < first_piece + N_PIECES; i++) {
+      pieces.colors[i] = seat_colors[player];
+    }
+  }
+
+  struct Players *players = &game->players;
+  for (int player = 0; player < game->num_players; player++) {
+    players->select_to_move_to_cells[player] = -1;
+    players->select_counts[player] = N_PIECES; // start out being able to select any piece
+    players->select_to_move_to_squares[player] = SQUARE_NONE;
+    players->player_type[player] = player;
+    players->player_states[player] = PIECE_SELECTION; // Tracks the state a player is currently in
+    players->forwards[player] = game->level != NULL ? game->level->forwards[player] : player_forwards[player];
+  }
+
+  memset(game->cells.occupied_states, 0, N_CELLS * sizeof (uint8_t));
+  memset(game->cells.cell_player_states, -1, N_CELLS * sizeof (int));
+  memset(game->cells.cell_piece_indices, 0, N_CELLS * sizeof (int));
+
+  for (int player = 0; player < game->num_players; player++) {
+    if (game->level != NULL) {
+      place_pieces(game, player, game->level->piece_squares);
+    }
+    else {
+      set_pieces(pieces, game->cells, game->players, player);
+    }
+  }
+
+  game->active_player = BLACK_PLAYER;
+  game->ply = 0;
+  clock_reset(&game->clock);
+  count_scores(game);
+  attack_map_build(game->attacks, game);
+  game->checks->player = -1;
+  game->status = game_player_status(game, game->active_player);
+
+  if (game->record != NULL) {
+    game_record_begin(game->record, game);
+  }
+}
+
+static struct Game *
+create_game(struct Arena *arena, int num_players, const struct Level *level) {
+  assert(num_players >= 2 && num_players <= MAX_PLAYERS);
+  assert(piece_tables.num_types > 0); // piece_rules_load has to come first
+
+  // Check the bound once up front, then none of the allocations below can fail
+  if (arena->size - arena->used < GAME_ARENA_SIZE) {
+    return NULL;
+  }
+
+  size_t start = arena_mark(arena);
+  struct Game *game = ARENA_ALLOC_ZERO_ARRAY(arena, struct Game, 1);
+
+  game->level = level;
+  game->num_players = num_players;
+  game->num_pieces = num_players * N_PIECES;
+
+  // Gameplay piece stuff, one table for everybody with an owner column
+  game->pieces = alloc_pieces(arena, game->num_pieces);
+
+  // Player type stuff
+  game->players = (struct Players){
+    .score = ARENA_ALLOC_ARRAY(arena, int, num_players),
+    .select_to_move_pieces = ARENA_ALLOC_ARRAY(arena, int, num_players),
+    .select_to_move_to_cells = ARENA_ALLOC_ARRAY(arena, int, num_players),
+    .select_counts = ARENA_ALLOC_ARRAY(arena, int, num_players),
+    .select_to_move_to_squares = ARENA_ALLOC_ARRAY(arena, Square, num_players),
+    .player_type = ARENA_ALLOC_ARRAY(arena, PlayerType, num_players),
+    .player_states = ARENA_ALLOC_ARRAY(arena, PlayerState, num_players),
+    .forwards = ARENA_ALLOC_ARRAY(arena, Vector2, num_players),
+    .live_pieces = ARENA_ALLOC_ARRAY(arena, int, game->num_pieces),
+    .live_piece_counts = ARENA_ALLOC_ARRAY(arena, int, num_players)
+  };
+
+  // Cell stuff
+  game->cells = (struct Cells){
+    .occupied_states = ARENA_ALLOC_ARRAY(arena, uint8_t, N_CELLS),
+    .cell_player_states = ARENA_ALLOC_ARRAY(arena, int, N_CELLS),
+    .cell_piece_indices = ARENA_ALLOC_ARRAY(arena, int, N_CELLS)
+  };
+
+  game->attacks = ARENA_ALLOC_ARRAY(arena, struct AttackMap, 1);
+  game->checks = ARENA_ALLOC_ARRAY(arena, struct Checks, 1);
+
+  // A baked level already has its quadtree, use it where it's mapped
+  if (level != NULL) {
+    game->qtree = level->qtree;
+    game_reset(game);
+    game->memory_used = arena_mark(arena) - start;
+    return game;
+  }
+
+  // Quad-Tree stuff
+  int q_size = next_pow2(next_pow2(N_CELLS*2+1) + 1); // add 1 for the root node
+  game->qtree = (struct Quads){
+    .size = q_size,
+    .quad_sizes = ARENA_ALLOC_ARRAY(arena, Vector2, q_size),
+    .quad_positions = ARENA_ALLOC_ARRAY(arena, Vector3, q_size),
+    .piece_indices = ARENA_ALLOC_ARRAY(arena, int, q_size),
+    .top_left = ARENA_ALLOC_ARRAY(arena, int, q_size),
+    .top_right = ARENA_ALLOC_ARRAY(arena, int, q_size),
+    .bottom_left = ARENA_ALLOC_ARRAY(arena, int, q_size),
+    .bottom_right = ARENA_ALLOC_ARRAY(arena, int, q_size)
+  };
+
+  game_reset(game);
+
+  // The queue is only needed while building the tree, give it back straight after
+  size_t queue_mark = arena_mark(arena);
+  struct QItem *queue = ARENA_ALLOC_ARRAY(arena, struct QItem, q_size);
+  assert(arena->used - start <= GAME_ARENA_SIZE);
+  initialize_qtree(game->qtree, queue, q_size);
+  arena_rewind(arena, queue_mark);
+
+  game->memory_used = arena_mark(arena) - start;
+  return game;
+}
+
+struct Game *
+game_create(struct Arena *arena, int num_players) {
+  return create_game(arena, num_players, NULL);
+}
+
+struct Game *
+game_create_from_level(struct Arena *arena, const struct Level *level) {
+  // The rest of the game is still fixed to one board size and N_PIECES a player
+  if (level->rows != N_ROWS || level->cols != N_COLS || level->slots_per_player != N_PIECES) {
+    printf("level is %dx%d with %d pieces a player, this build plays %dx%d with %d\n",
+           level->rows,
+           level->cols,
+           level->slots_per_player,
+           N_ROWS,
+           N_COLS,
+           N_PIECES);
+    return NULL;
+  }
+  if (level->num_types != piece_tables.num_types) {
+    printf("level was baked against %d piece types but %d are loaded\n", level->num_types, piece_tables.num_types);
+    return NULL;
+  }
+  return create_game(arena, level->num_players, level);
+}
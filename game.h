@@ -0,0 +1,111 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "stddef.h"
+#include "stdint.h"
+#include "chess.h"
+#include "arena.h"
+#include "level.h"
+#include "attacks.h"
+
+// Upper bound on what game_create takes out of an arena (including the quadtree build queue),
+// the game bench checks the real number against it
+#define GAME_ARENA_SIZE (64 * 1024)
+
+struct GameRecord;
+
+// Where the game stands for the player to move
+enum GameStatus {
+  GAME_PLAYING,
+  GAME_CHECK,
+  GAME_CHECKMATE, // everybody but one player has been mated, the game is over
+  GAME_STALEMATE, // the player to move isn't in check and can't move, a draw
+  GAME_FLAGGED // somebody's clock ran out, the game is over
+};
+
+// A chess clock, only running when game_clock_set has been called. Times are in
+// microseconds of game time, which is however many ticks have gone by.
+struct GameClock {
+  int running;
+  int64_t initial_us; // for each time control
+  int64_t increment_us; // added after every move
+  int moves_per_control; // 0 when the whole game is one time control
+  int64_t remaining_us[MAX_PLAYERS];
+  int moves_made[MAX_PLAYERS];
+  int flagged; // whose time ran out, -1 while nobody's has
+};
+
+// Everything one game needs, all of it allocated from a single arena
+// so the whole game goes away with one arena_reset
+struct Game {
+  struct Cells cells;
+  struct ChessPieces pieces; // num_pieces long, N_PIECES per player
+  struct Players players; // num_players long
+  struct Quads qtree; // points into the level's mapping when there is one
+  const struct Level *level; // where game_reset puts the pieces back to, NULL for the usual start
+  struct GameRecord *record; // every move goes into it when set, see game_log.h
+  struct AttackMap *attacks; // kept up to date by every move
+  struct Checks *checks; // for whichever player asked last, worked out again after a move
+  int num_players;
+  int num_pieces;
+  int active_player;
+  int status; // GameStatus, set by game_next_player
+  int ply; // moves played since the last reset
+  struct GameClock clock;
+  size_t memory_used; // bytes this game took from its arena
+};
+
+// num_players is 2 to MAX_PLAYERS, piece_rules_load has to have been called.
+// Returns NULL if the arena has less than GAME_ARENA_SIZE free
+struct Game *game_create(struct Arena *arena, int num_players);
+
+// Starts from a baked level instead, it has to be N_ROWS x N_COLS with N_PIECES slots a player
+// and stay mapped for as long as the game is around. Returns NULL if it doesn't fit.
+struct Game *game_create_from_level(struct Arena *arena, const struct Level *level);
+void game_reset(struct Game *game);
+
+// Puts every piece where squares says (indexed by piece id, POSITION_SQUARE_NONE for captured)
+// with the given types, used to restore game log checkpoints
+void game_restore(struct Game *game, const uint8_t *squares, const uint8_t *types, int active_player, int ply);
+
+// Every square the piece can legally move to, in offset order, returns how many.
+// Moves that would leave its owner's king in check aren't in it.
+int game_piece_moves(const struct Game *game, int piece, Square *move_squares);
+void game_move_piece(struct Game *game, int piece, Square square_to);
+
+// The checks, pins and king danger for player in the current position, worked out on first use
+const struct Checks *game_checks(const struct Game *game, int player);
+
+// Whether player is in check and whether they have a legal move, GAME_CHECKMATE and
+// GAME_STALEMATE here are about that player only
+int game_player_status(const struct Game *game, int player);
+
+// Hands the turn to the next player that still has pieces and hasn't been mated, marking
+// players CHECKMATE as it finds them mated, and sets status for whoever that is
+int game_next_player(struct Game *game);
+
+static inline int
+game_over(const struct Game *game) {
+  return game->status == GAME_CHECKMATE || game->status == GAME_STALEMATE || game->status == GAME_FLAGGED;
+}
+
+// Puts every player's clock at initial_us and starts it, game_reset puts them back there
+void game_clock_set(struct Game *game, int64_t initial_us, int64_t increment_us, int moves_per_control);
+// The player to move's clock runs down, their flag falls when it gets to 0
+void game_clock_tick(struct Game *game, int64_t elapsed_us);
+
+// Moves player has to make before the next time control, 0 when there isn't one
+static inline int
+game_clock_moves_to_go(const struct GameClock *clock, int player) {
+  if (clock->moves_per_control == 0) {
+    return 0;
+  }
+  return clock->moves_per_control - (clock->moves_made[player] % clock->moves_per_control);
+}
+
+// Plays a random legal move for the side to move, returns 0 if it has none or the game is over
+int game_update_auto(struct Game *game, uint64_t *rng);
+
+void initialize_qtree(struct Quads qtree, struct QItem *queue, int q_size);
+
+#endif
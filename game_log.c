@@ -0,0 +1,388 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "chess.h"
+#include "arena.h"
+#include "position.h"
+#include "game.h"
+#include "piece_defs.h"
+#include "game_log.h"
+
+static size_t
+record_size(const struct GameLogHeader *header) {
+  return sizeof *header +
+         (header->ply_count * sizeof (Move)) +
+         (header->num_checkpoints * sizeof (struct GameLogCheckpoint));
+}
+
+// Hands the filled buffer over to be written and starts filling the other one.
+// Called with the lock held.
+static void
+swap_buffers(struct GameLogWriter *writer) {
+#ifdef NO_THREADS
+  if (!writer->failed && fwrite(writer->filling, 1, writer->filled, writer->file) != writer->filled) {
+    writer->failed = 1;
+  }
+  writer->bytes += writer->filled;
+#else
+  // Only two buffers, so if the last one is still going out the game threads have to wait
+  while (writer->writing != NULL) {
+    pthread_cond_wait(&writer->work_done, &writer->lock);
+  }
+  writer->writing = writer->filling;
+  writer->to_write = writer->filled;
+  writer->filling = writer->filling == writer->buffers[0] ? writer->buffers[1] : writer->buffers[0];
+  pthread_cond_signal(&writer->work_ready);
+#endif
+  writer->filled = 0;
+}
+
+#ifndef NO_THREADS
+static void *
+writer_main(void *arg) {
+  struct GameLogWriter *writer = arg;
+
+  pthread_mutex_lock(&writer->lock);
+  for (;;) {
+    while (writer->writing == NULL && !writer->shutdown) {
+      pthread_cond_wait(&writer->work_ready, &writer->lock);
+    }
+    if (writer->writing == NULL) {
+      break; // shut down with nothing left to write
+    }
+
+    uint8_t *buffer = writer->writing;
+    size_t size = writer->to_write;
+    int failed = writer->failed;
+    pthread_mutex_unlock(&writer->lock);
+
+    if (!failed && fwrite(buffer, 1, size, writer->file) != size) {
+      failed = 1;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->failed = failed;
+    writer->bytes += size;
+    writer->writing = NULL;
+    pthread_cond_broadcast(&writer->work_done);
+  }
+  pthread_mutex_unlock(&writer->lock);
+  return NULL;
+}
+#endif
+
+int
+game_log_writer_open(struct GameLogWriter *writer, const char *path) {
+  memset(writer, 0, sizeof *writer);
+  writer->file = fopen(path, "ab");
+  if (writer->file == NULL) {
+    printf("could not open game log %s\n", path);
+    return -1;
+  }
+
+  // Start a new file off with its header, otherwise keep appending games to it
+  fseek(writer->file, 0, SEEK_END);
+  if (ftell(writer->file) == 0) {
+    struct GameLogFileHeader header = {
+      .magic = GAME_LOG_MAGIC,
+      .version = GAME_LOG_VERSION,
+      .checkpoint_interval = GAME_LOG_CHECKPOINT_INTERVAL
+    };
+    fwrite(&header, sizeof header, 1, writer->file);
+  }
+
+  writer->buffers[0] = malloc(2 * GAME_LOG_BUFFER_SIZE);
+  if (writer->buffers[0] == NULL) {
+    fclose(writer->file);
+    return -1;
+  }
+  writer->buffers[1] = writer->buffers[0] + GAME_LOG_BUFFER_SIZE;
+  writer->filling = writer->buffers[0];
+
+#ifndef NO_THREADS
+  pthread_mutex_init(&writer->lock, NULL);
+  pthread_cond_init(&writer->work_ready, NULL);
+  pthread_cond_init(&writer->work_done, NULL);
+  if (pthread_create(&writer->thread, NULL, writer_main, writer) != 0) {
+    printf("could not start the game log writer\n");
+    pthread_cond_destroy(&writer->work_done);
+    pthread_cond_destroy(&writer->work_ready);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer->buffers[0]);
+    fclose(writer->file);
+    return -1;
+  }
+#endif
+  return 0;
+}
+
+int
+game_log_writer_close(struct GameLogWriter *writer) {
+#ifdef NO_THREADS
+  if (writer->filled > 0) {
+    swap_buffers(writer);
+  }
+#else
+  pthread_mutex_lock(&writer->lock);
+  if (writer->filled > 0) {
+    swap_buffers(writer);
+  }
+  writer->shutdown = 1;
+  pthread_cond_signal(&writer->work_ready);
+  pthread_mutex_unlock(&writer->lock);
+
+  // The thread drains whatever it was handed before it sees the shutdown
+  pthread_join(writer->thread, NULL);
+  pthread_cond_destroy(&writer->work_done);
+  pthread_cond_destroy(&writer->work_ready);
+  pthread_mutex_destroy(&writer->lock);
+#endif
+
+  int failed = writer->failed;
+  if (fclose(writer->file) != 0) {
+    failed = 1;
+  }
+  free(writer->buffers[0]);
+  writer->file = NULL;
+  return failed ? -1 : 0;
+}
+
+void
+game_log_writer_append(struct GameLogWriter *writer, const struct GameRecord *record) {
+  const struct GameLogHeader *header = &record->header;
+  size_t moves_size = header->ply_count * sizeof (Move);
+  size_t checkpoints_size = header->num_checkpoints * sizeof (struct GameLogCheckpoint);
+
+#ifndef NO_THREADS
+  pthread_mutex_lock(&writer->lock);
+#endif
+  if (writer->filled + record_size(header) > GAME_LOG_BUFFER_SIZE) {
+    swap_buffers(writer);
+  }
+
+  uint8_t *out = writer->filling + writer->filled;
+  memcpy(out, header, sizeof *header);
+  memcpy(out + sizeof *header, record->moves, moves_size);
+  memcpy(out + sizeof *header + moves_size, record->checkpoints, checkpoints_size);
+  writer->filled += record_size(header);
+  writer->records++;
+#ifndef NO_THREADS
+  pthread_mutex_unlock(&writer->lock);
+#endif
+}
+
+struct GameRecord *
+game_record_create(struct Arena *arena, struct GameLogWriter *writer, int board) {
+  struct GameRecord *record = ARENA_ALLOC_ZERO_ARRAY(arena, struct GameRecord, 1);
+  if (record == NULL) {
+    return NULL;
+  }
+
+  record->moves = ARENA_ALLOC_ARRAY(arena, Move, GAME_LOG_MAX_PLIES);
+  record->checkpoints = ARENA_ALLOC_ARRAY(arena, struct GameLogCheckpoint, GAME_LOG_MAX_CHECKPOINTS);
+  if (record->moves == NULL || record->checkpoints == NULL) {
+    return NULL;
+  }
+  record->writer = writer;
+  record->header.board = (uint32_t)board;
+  return record;
+}
+
+static void
+take_checkpoint(struct GameRecord *record, const struct Game *game) {
+  struct GameLogCheckpoint *checkpoint = &record->checkpoints[record->header.num_checkpoints++];
+  const struct ChessPieces *pieces = &game->pieces;
+
+  memset(checkpoint, 0, sizeof *checkpoint);
+  checkpoint->ply = (uint16_t)game->ply;
+  checkpoint->active_player = (uint8_t)game->active_player;
+  for (int piece = 0; piece < game->num_pieces; piece++) {
+    checkpoint->squares[piece] = pieces->is_dead[piece] ? POSITION_SQUARE_NONE : (uint8_t)pieces->squares[piece];
+    checkpoint->types[piece] = (uint8_t)pieces->chess_type[piece];
+  }
+}
+
+void
+game_record_begin(struct GameRecord *record, const struct Game *game) {
+  struct GameLogHeader *header = &record->header;
+  header->magic = GAME_LOG_GAME_MAGIC;
+  header->start_ply = (uint16_t)game->ply;
+  header->ply_count = 0;
+  header->num_players = (uint8_t)game->num_players;
+  header->num_pieces = (uint8_t)game->num_pieces;
+  header->num_checkpoints = 0;
+  header->end_reason = GAME_LOG_END_RESET;
+  take_checkpoint(record, game);
+}
+
+void
+game_record_move(struct GameRecord *record, const struct Game *game, Move move) {
+  // Called before the game applies the move, so checkpoints are the board with move n still to play
+  struct GameLogHeader *header = &record->header;
+  if (header->ply_count == GAME_LOG_MAX_PLIES) {
+    game_record_finish(record, GAME_LOG_END_CONTINUED);
+    game_record_begin(record, game);
+  }
+  else if (header->ply_count > 0 && header->ply_count % GAME_LOG_CHECKPOINT_INTERVAL == 0) {
+    take_checkpoint(record, game);
+  }
+  record->moves[header->ply_count++] = move;
+}
+
+void
+game_record_finish(struct GameRecord *record, int end_reason) {
+  struct GameLogHeader *header = &record->header;
+  if (header->ply_count == 0) {
+    return;
+  }
+
+  header->end_reason = (uint8_t)end_reason;
+  if (record->writer != NULL) {
+    game_log_writer_append(record->writer, record);
+  }
+  if (end_reason != GAME_LOG_END_CONTINUED) {
+    header->game++;
+  }
+  header->ply_count = 0;
+}
+
+int
+game_log_reader_open(struct GameLogReader *reader, const char *path) {
+  reader->file = fopen(path, "rb");
+  if (reader->file == NULL) {
+    printf("could not open game log %s\n", path);
+    return -1;
+  }
+
+  if (fread(&reader->header, sizeof reader->header, 1, reader->file) != 1 ||
+      reader->header.magic != GAME_LOG_MAGIC ||
+      reader->header.version != GAME_LOG_VERSION ||
+      reader->header.checkpoint_interval != GAME_LOG_CHECKPOINT_INTERVAL) {
+    printf("%s isn't a game log this build can read\n", path);
+    fclose(reader->file);
+    reader->file = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+void
+game_log_reader_close(struct GameLogReader *reader) {
+  if (reader->file != NULL) {
+    fclose(reader->file);
+  }
+  reader->file = NULL;
+}
+
+static int
+read_header(struct GameLogReader *reader, struct GameLogHeader *header) {
+  size_t read = fread(header, 1, sizeof *header, reader->file);
+  if (read == 0 && feof(reader->file)) {
+    return 0;
+  }
+
+  int valid = read == sizeof *header &&
+              header->magic == GAME_LOG_GAME_MAGIC &&
+              header->ply_count <= GAME_LOG_MAX_PLIES &&
+              header->num_checkpoints > 0 &&
+              header->num_checkpoints <= GAME_LOG_MAX_CHECKPOINTS &&
+              header->num_checkpoints == ((header->ply_count + GAME_LOG_CHECKPOINT_INTERVAL - 1) / GAME_LOG_CHECKPOINT_INTERVAL) &&
+              header->num_players >= 2 && header->num_players <= MAX_PLAYERS &&
+              header->num_pieces == header->num_players * N_PIECES;
+  return valid ? 1 : -1;
+}
+
+// game_restore takes a checkpoint as it is, so everything in it has to index inside the board,
+// the piece tables and the players, with no two pieces on one square
+static int
+checkpoint_valid(const struct GameLogHeader *header, const struct GameLogCheckpoint *checkpoint, int index) {
+  if (checkpoint->ply != header->start_ply + (index * GAME_LOG_CHECKPOINT_INTERVAL) ||
+      checkpoint->active_player >= header->num_players) {
+    return 0;
+  }
+
+  uint64_t taken = 0;
+  for (int piece = 0; piece < header->num_pieces; piece++) {
+    uint8_t square = checkpoint->squares[piece];
+    if (checkpoint->types[piece] >= piece_tables.num_types) {
+      return 0;
+    }
+    if (square == POSITION_SQUARE_NONE) {
+      continue;
+    }
+    if (square >= N_CELLS || (taken & (1ull << square)) != 0) {
+      return 0;
+    }
+    taken |= 1ull << square;
+  }
+  return 1;
+}
+
+int
+game_log_read(struct GameLogReader *reader, struct GameRecord *record) {
+  struct GameLogHeader *header = &record->header;
+  int result = read_header(reader, header);
+  if (result != 1) {
+    return result;
+  }
+
+  if (fread(record->moves, sizeof (Move), header->ply_count, reader->file) != header->ply_count ||
+      fread(record->checkpoints, sizeof (struct GameLogCheckpoint), header->num_checkpoints, reader->file) != header->num_checkpoints) {
+    return -1;
+  }
+  for (int i = 0; i < header->num_checkpoints; i++) {
+    if (!checkpoint_valid(header, &record->checkpoints[i], i)) {
+      return -1;
+    }
+  }
+  return 1;
+}
+
+int
+game_log_skip(struct GameLogReader *reader, struct GameLogHeader *header) {
+  int result = read_header(reader, header);
+  if (result != 1) {
+    return result;
+  }
+  long rest = (long)(record_size(header) - sizeof *header);
+  return fseek(reader->file, rest, SEEK_CUR) == 0 ? 1 : -1;
+}
+
+int
+game_record_seek(const struct GameRecord *record, struct Game *game, int ply) {
+  const struct GameLogHeader *header = &record->header;
+  int start = header->start_ply;
+  if (ply < start || ply > start + header->ply_count || game->num_players != header->num_players) {
+    return -1;
+  }
+
+  int index = (ply - start) / GAME_LOG_CHECKPOINT_INTERVAL;
+  if (index >= header->num_checkpoints) {
+    index = header->num_checkpoints - 1; // the last ply of a record that ends on an interval
+  }
+  const struct GameLogCheckpoint *checkpoint = &record->checkpoints[index];
+  game_restore(game, checkpoint->squares, checkpoint->types, checkpoint->active_player, checkpoint->ply);
+
+  // Replaying shouldn't go into whatever the game is recording itself
+  struct GameRecord *recording = game->record;
+  game->record = NULL;
+  int result = 0;
+  for (int i = index * GAME_LOG_CHECKPOINT_INTERVAL; i < ply - start; i++) {
+    Move move = record->moves[i];
+    Square from = MOVE_FROM(move);
+    Square to = MOVE_TO(move);
+    // Moves are only read, never checked, so one that isn't the side to move's own piece
+    // going somewhere on the board means the record is damaged
+    if (from >= N_CELLS || to >= N_CELLS ||
+        game->cells.cell_player_states[from] != game->active_player ||
+        game->cells.cell_player_states[to] == game->active_player) {
+      result = -1;
+      break;
+    }
+    game_move_piece(game, game->cells.cell_piece_indices[from], to);
+    game_next_player(game);
+  }
+  game->record = recording;
+  return result;
+}
@@ -0,0 +1,136 @@
+#ifndef GAME_LOG_H
+#define GAME_LOG_H
+
+#include "stdio.h"
+#include "stdint.h"
+#include "chess.h"
+#include "arena.h"
+#include "position.h"
+
+#ifndef NO_THREADS
+#include "pthread.h"
+#endif
+
+// Append-only binary record of every game played. A file is a GameLogFileHeader followed
+// by one record per game: a GameLogHeader, ply_count 16-bit moves, then a checkpoint of the
+// whole board every GAME_LOG_CHECKPOINT_INTERVAL plies (the first one is the start), so any
+// ply can be restored by copying the checkpoint before it and replaying at most that many moves.
+//
+// Finished records are copied into a buffer and written out by a background thread,
+// the game threads only ever take a lock and memcpy. Built with -DNO_THREADS
+// the buffer is written out by whoever fills it.
+
+#define GAME_LOG_MAGIC 0x4C474352u // "RCGL"
+#define GAME_LOG_GAME_MAGIC 0x454D4147u // "GAME", starts every record so a reader can resync
+#define GAME_LOG_VERSION 1
+#define GAME_LOG_CHECKPOINT_INTERVAL 32
+#define GAME_LOG_MAX_PLIES 1024 // longer games carry on in a new record that starts from a checkpoint
+#define GAME_LOG_MAX_CHECKPOINTS (GAME_LOG_MAX_PLIES / GAME_LOG_CHECKPOINT_INTERVAL)
+#define GAME_LOG_MAX_PIECES (MAX_PLAYERS * N_PIECES)
+#define GAME_LOG_BUFFER_SIZE (1 << 20) // per buffer, there are two
+
+// Why a record stopped
+#define GAME_LOG_END_RESET 0 // the game was reset or the program closed
+#define GAME_LOG_END_CONTINUED 1 // ran out of room, the next record from this board carries on
+
+struct GameLogFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t checkpoint_interval;
+  uint32_t reserved;
+};
+
+struct GameLogHeader {
+  uint32_t magic;
+  uint32_t board; // which board of the pool played it
+  uint32_t game; // counts up per board, continued records keep the number
+  uint16_t start_ply; // ply of the first checkpoint
+  uint16_t ply_count; // moves in this record
+  uint8_t num_players;
+  uint8_t num_pieces;
+  uint8_t num_checkpoints;
+  uint8_t end_reason;
+  uint32_t reserved;
+};
+
+// The whole board at one ply, squares are POSITION_SQUARE_NONE once a piece is captured
+struct GameLogCheckpoint {
+  uint16_t ply;
+  uint8_t active_player;
+  uint8_t reserved;
+  uint8_t squares[GAME_LOG_MAX_PIECES];
+  uint8_t types[GAME_LOG_MAX_PIECES];
+};
+
+// What game_record_create takes out of an arena, alignment padding included
+#define GAME_RECORD_ARENA_SIZE (sizeof (struct GameRecord) + \
+                                (GAME_LOG_MAX_PLIES * sizeof (Move)) + \
+                                (GAME_LOG_MAX_CHECKPOINTS * sizeof (struct GameLogCheckpoint)) + 64)
+
+// One game being recorded, or read back
+struct GameRecord {
+  struct GameLogHeader header;
+  Move *moves; // GAME_LOG_MAX_PLIES
+  struct GameLogCheckpoint *checkpoints; // GAME_LOG_MAX_CHECKPOINTS
+  struct GameLogWriter *writer; // NULL when reading
+};
+
+struct GameLogWriter {
+  FILE *file;
+  uint8_t *buffers[2];
+  uint8_t *filling; // the buffer records are copied into
+  size_t filled;
+  uint8_t *writing; // the buffer the writer thread has, NULL when it's idle
+  size_t to_write;
+  uint64_t records; // written so far
+  uint64_t bytes;
+  int failed; // a write went wrong, everything after it is dropped
+#ifndef NO_THREADS
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t work_ready;
+  pthread_cond_t work_done;
+  int shutdown;
+#endif
+};
+
+struct GameLogReader {
+  FILE *file;
+  struct GameLogFileHeader header;
+};
+
+// Appends to path, writing the file header if it's new. Returns -1 if it can't be opened
+// or the writer thread can't be started.
+int game_log_writer_open(struct GameLogWriter *writer, const char *path);
+// Writes out whatever is buffered and stops the thread, returns -1 if any write failed
+int game_log_writer_close(struct GameLogWriter *writer);
+
+// From any thread, copies the record into the write buffer
+void game_log_writer_append(struct GameLogWriter *writer, const struct GameRecord *record);
+
+struct GameRecord *game_record_create(struct Arena *arena, struct GameLogWriter *writer, int board);
+
+struct Game;
+
+// Starts a record from where the game is now
+void game_record_begin(struct GameRecord *record, const struct Game *game);
+// Called before the game applies the move, checkpoints and starts a new record when full
+void game_record_move(struct GameRecord *record, const struct Game *game, Move move);
+// Hands the record to the writer if it has any moves, the next game gets the next number
+void game_record_finish(struct GameRecord *record, int end_reason);
+
+int game_log_reader_open(struct GameLogReader *reader, const char *path);
+void game_log_reader_close(struct GameLogReader *reader);
+
+// Reads the next record into one from game_record_create, returns 0 at the end of the file
+// and -1 if the file is damaged. Checkpoints are checked here, moves only when seeking.
+int game_log_read(struct GameLogReader *reader, struct GameRecord *record);
+// Only reads the header and seeks over the rest
+int game_log_skip(struct GameLogReader *reader, struct GameLogHeader *header);
+
+// Puts the game at any ply the record covers, from the nearest checkpoint at or before it.
+// The game has to have the record's player count. Returns -1 if the ply isn't in the record,
+// or if a move on the way there isn't one the side to move could have played.
+int game_record_seek(const struct GameRecord *record, struct Game *game, int ply);
+
+#endif
@@ -0,0 +1,279 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "raylib.h"
+#include "input.h"
+
+static const int NINTENDO_CONTROLLER = 1;
+
+static int
+left_x_right_control() {
+  int gamepad_x = GetGamepadAxisMovement(NINTENDO_CONTROLLER, GAMEPAD_AXIS_LEFT_X) > 0.95f;
+  int key_x = IsKeyDown(KEY_D);
+  return gamepad_x || key_x;
+}
+
+static int
+left_x_left_control() {
+  int gamepad_x = GetGamepadAxisMovement(NINTENDO_CONTROLLER, GAMEPAD_AXIS_LEFT_X) < 0;
+  int key_x = IsKeyDown(KEY_A);
+  return gamepad_x || key_x;
+}
+
+static int
+left_y_down_control() {
+  int gamepad_x = GetGamepadAxisMovement(NINTENDO_CONTROLLER, GAMEPAD_AXIS_LEFT_Y) > 0.95f;
+  int key_x = IsKeyDown(KEY_S);
+  return gamepad_x || key_x;
+}
+
+static int
+left_y_up_control() {
+  int gamepad_x = GetGamepadAxisMovement(NINTENDO_CONTROLLER, GAMEPAD_AXIS_LEFT_Y) < 0;
+  int key_x = IsKeyDown(KEY_W);
+  return gamepad_x || key_x;
+}
+
+static int
+trigger_control() {
+  int gamepad_trigger = IsGamepadButtonDown(NINTENDO_CONTROLLER, GAMEPAD_BUTTON_LEFT_TRIGGER_2);
+  int key_trigger = IsKeyDown(KEY_X);
+  return gamepad_trigger || key_trigger;
+}
+
+static int
+select_control() {
+  int gamepad_control = IsGamepadButtonDown(NINTENDO_CONTROLLER, GAMEPAD_BUTTON_RIGHT_FACE_UP);
+  int key_control = IsKeyDown(KEY_M);
+  return gamepad_control || key_control;
+}
+
+static int
+switch_players_control() {
+  int gamepad_control = IsGamepadButtonDown(NINTENDO_CONTROLLER, GAMEPAD_BUTTON_LEFT_FACE_UP);
+  int key_control = IsKeyDown(KEY_P);
+  return gamepad_control || key_control;
+}
+
+// Indexed by InputAction
+static int (*const controls[INPUT_ACTION_COUNT])() = {
+  left_x_left_control,
+  left_x_right_control,
+  left_y_up_control,
+  left_y_down_control,
+  trigger_control,
+  select_control,
+  switch_players_control
+};
+
+static int
+load_replay(struct Input *input, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    printf("could not open input replay %s\n", path);
+    return -1;
+  }
+
+  struct InputFileHeader header;
+  int valid = fread(&header, sizeof header, 1, file) == 1 &&
+              header.magic == INPUT_MAGIC &&
+              header.version == INPUT_VERSION &&
+              header.timestep_us == (uint32_t)(INPUT_TIMESTEP * 1e6f) &&
+              header.num_ticks <= INPUT_MAX_TICKS &&
+              header.num_events <= INPUT_MAX_EVENTS;
+  if (valid) {
+    input->events = malloc(((size_t)header.num_events + 1) * sizeof (struct InputEvent));
+    input->frame_times = malloc(((size_t)header.num_ticks + 1) * sizeof (float));
+    valid = input->events != NULL && input->frame_times != NULL &&
+            fread(input->events, sizeof (struct InputEvent), header.num_events, file) == header.num_events;
+  }
+  fclose(file);
+
+  // The replay takes events in tick order and indexes with their actions, so anything out of
+  // order or past the end would be skipped or written outside the controls
+  for (uint32_t i = 0; valid && i < header.num_events; i++) {
+    struct InputEvent event = input->events[i];
+    valid = event.action < INPUT_ACTION_COUNT &&
+            event.down <= 1 &&
+            event.tick < header.num_ticks &&
+            (i == 0 || event.tick >= input->events[i - 1].tick);
+  }
+
+  if (!valid) {
+    printf("%s isn't an input recording this build can replay\n", path);
+    free(input->events);
+    free(input->frame_times);
+    input->events = NULL;
+    input->frame_times = NULL;
+    return -1;
+  }
+  input->num_events = header.num_events;
+  input->num_ticks = header.num_ticks;
+  return 0;
+}
+
+int
+input_open(struct Input *input, int mode, const char *path) {
+  memset(input, 0, sizeof *input);
+  input->mode = mode;
+  input->path = path;
+
+  if (mode == INPUT_REPLAY) {
+    return load_replay(input, path);
+  }
+  return 0;
+}
+
+static int
+compare_float(const void *a, const void *b) {
+  float x = *(const float *)a;
+  float y = *(const float *)b;
+  return (x > y) - (x < y);
+}
+
+static void
+report_frame_times(const struct Input *input) {
+  // The first frame's time is whatever startup took, leave it out
+  int count = (int)input->tick - 1;
+  if (count <= 0) {
+    return;
+  }
+
+  float *times = &input->frame_times[1];
+  double total = 0;
+  for (int i = 0; i < count; i++) {
+    total += times[i];
+  }
+  qsort(times, count, sizeof times[0], compare_float);
+  printf("replay %s: %d frames, mean %.3fms  p50 %.3fms  p99 %.3fms  max %.3fms\n",
+         input->path,
+         count,
+         (total / count) * 1000.0,
+         times[count / 2] * 1000.0,
+         times[(count * 99) / 100] * 1000.0,
+         times[count - 1] * 1000.0);
+}
+
+int
+input_close(struct Input *input) {
+  int result = 0;
+
+  if (input->mode == INPUT_RECORD) {
+    FILE *file = fopen(input->path, "wb");
+    struct InputFileHeader header = {
+      .magic = INPUT_MAGIC,
+      .version = INPUT_VERSION,
+      .timestep_us = (uint32_t)(INPUT_TIMESTEP * 1e6f),
+      .num_ticks = input->tick,
+      .num_events = (uint32_t)input->num_events
+    };
+    result = -1;
+    if (file != NULL) {
+      if (fwrite(&header, sizeof header, 1, file) == 1 &&
+          fwrite(input->events, sizeof (struct InputEvent), input->num_events, file) == input->num_events) {
+        result = 0;
+      }
+      if (fclose(file) != 0) {
+        result = -1;
+      }
+    }
+    if (result == 0) {
+      printf("recorded %u ticks and %zu input events to %s\n", input->tick, input->num_events, input->path);
+    }
+  }
+  else if (input->mode == INPUT_REPLAY) {
+    report_frame_times(input);
+  }
+
+  free(input->events);
+  free(input->frame_times);
+  input->events = NULL;
+  input->frame_times = NULL;
+  return result;
+}
+
+static void
+push_event(struct Input *input, int action, int down) {
+  if (input->queue_count == INPUT_QUEUE_SIZE) {
+    return; // every action changing more than once in a tick, can't happen from polling
+  }
+  input->queue[input->queue_count++] = (struct InputEvent){
+    .tick = input->tick,
+    .action = (uint8_t)action,
+    .down = (uint8_t)down
+  };
+}
+
+static int
+record_event(struct Input *input, struct InputEvent event) {
+  if (input->num_events == input->capacity) {
+    size_t capacity = input->capacity > 0 ? input->capacity * 2 : 1024;
+    struct InputEvent *events = realloc(input->events, capacity * sizeof *events);
+    if (events == NULL) {
+      return -1;
+    }
+    input->events = events;
+    input->capacity = capacity;
+  }
+  input->events[input->num_events++] = event;
+  return 0;
+}
+
+uint32_t
+input_poll_controls(void) {
+  uint32_t down = 0;
+  for (int action = 0; action < INPUT_ACTION_COUNT; action++) {
+    if (controls[action]()) {
+      down |= 1u << action;
+    }
+  }
+  return down;
+}
+
+void
+input_begin_tick(struct Input *input, uint32_t controls_down, float frame_time) {
+  if (input->tick > 0) {
+    input->time_since_action += INPUT_TIMESTEP;
+    if (input->mode == INPUT_REPLAY) {
+      input->frame_times[input->tick - 1] = frame_time;
+    }
+  }
+  input->queue_count = 0;
+
+  if (input->mode == INPUT_REPLAY) {
+    while (input->next_event < input->num_events && input->events[input->next_event].tick == input->tick) {
+      struct InputEvent event = input->events[input->next_event++];
+      push_event(input, event.action, event.down);
+    }
+  }
+  else {
+    // Only changes become events, a held key is one press until it's let go
+    for (int action = 0; action < INPUT_ACTION_COUNT; action++) {
+      int down = (controls_down >> action) & 1;
+      if (down != input->down[action]) {
+        push_event(input, action, down);
+      }
+    }
+  }
+
+  for (int i = 0; i < input->queue_count; i++) {
+    struct InputEvent event = input->queue[i];
+    input->down[event.action] = event.down;
+    if (input->mode == INPUT_RECORD && record_event(input, event) != 0) {
+      printf("out of memory recording input, the rest of the session won't be saved\n");
+      input->mode = INPUT_LIVE;
+    }
+  }
+
+  input->tick++;
+}
+
+int
+input_take(struct Input *input, int action) {
+  if (!input->down[action] || input->time_since_action < INPUT_REPEAT_DELAY) {
+    return 0;
+  }
+  input->time_since_action = 0.0f;
+  return 1;
+}
@@ -0,0 +1,102 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "stddef.h"
+#include "stdint.h"
+#include "sim.h"
+
+// The controls as a stream of events. Every simulation tick the keys and gamepad are turned
+// into press/release events stamped with the tick number, and the game only ever looks at
+// what those events say. A session can be recorded to a file and replayed later without
+// touching the keyboard. Ticks are a fixed length (sim.h), so the replay makes exactly the
+// same moves however fast it runs. Replays run one tick per frame with the frame cap off
+// and report their frame times at the end.
+//
+// raylib's key state belongs to the thread with the window, so that thread polls the controls
+// into a bitmask and the simulation thread turns the mask into events.
+
+#define INPUT_TIMESTEP ((float)SIM_TIMESTEP)
+#define INPUT_REPEAT_DELAY 0.2f // how long a held control waits before it acts again
+#define INPUT_QUEUE_SIZE 32
+#define INPUT_MAGIC 0x4E494352u // "RCIN"
+#define INPUT_VERSION 1
+#define INPUT_MAX_TICKS (24u * 60 * 60 * SIM_TICK_RATE) // a day, longer replays are refused
+#define INPUT_MAX_EVENTS (INPUT_MAX_TICKS * 4) // plenty for a day of mashing
+
+enum InputAction {
+  INPUT_LEFT,
+  INPUT_RIGHT,
+  INPUT_UP,
+  INPUT_DOWN,
+  INPUT_TRIGGER, // switch between picking a piece and picking where it goes
+  INPUT_SELECT, // move the piece
+  INPUT_SWITCH_PLAYERS,
+  INPUT_ACTION_COUNT
+};
+
+enum InputMode {
+  INPUT_LIVE,
+  INPUT_RECORD,
+  INPUT_REPLAY
+};
+
+struct InputEvent {
+  uint32_t tick;
+  uint8_t action;
+  uint8_t down;
+  uint16_t reserved;
+};
+
+struct InputFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t timestep_us;
+  uint32_t num_ticks;
+  uint32_t num_events;
+  uint32_t reserved;
+};
+
+struct Input {
+  int mode;
+  uint32_t tick;
+  float time_since_action; // shared by every control, like one key repeat timer
+  uint8_t down[INPUT_ACTION_COUNT];
+
+  // This tick's events, in the order they happened
+  struct InputEvent queue[INPUT_QUEUE_SIZE];
+  int queue_count;
+
+  // The whole session when recording or replaying
+  const char *path;
+  struct InputEvent *events;
+  size_t num_events;
+  size_t capacity;
+  size_t next_event; // replay position
+  uint32_t num_ticks; // replay length
+
+  float *frame_times; // wall clock seconds of every replayed frame, one tick each
+};
+
+// Replaying loads the whole file up front, returns -1 if it can't be read
+int input_open(struct Input *input, int mode, const char *path);
+// Saves a recording, prints the frame times of a replay. Returns -1 if the save failed.
+int input_close(struct Input *input);
+
+// Bit (1 << action) set for every control held down right now, call it from the window's thread
+uint32_t input_poll_controls(void);
+
+// Call at the start of every tick with the latest input_poll_controls (replays ignore it),
+// frame_time is what the frame before took (only replays use it)
+void input_begin_tick(struct Input *input, uint32_t controls_down, float frame_time);
+
+// A replay has run out of ticks
+static inline int
+input_finished(const struct Input *input) {
+  return input->mode == INPUT_REPLAY && input->tick >= input->num_ticks;
+}
+
+// 1 if the control is held and the repeat delay is up. It then takes the delay,
+// so only one control acts per INPUT_REPEAT_DELAY.
+int input_take(struct Input *input, int action);
+
+#endif
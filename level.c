@@ -0,0 +1,633 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "chess.h"
+#include "board.h"
+#include "arena.h"
+#include "piece_defs.h"
+#include "level.h"
+
+#define LEVEL_MAX_LEGEND 64
+
+// A region of the board being split into quads, in cells
+struct QuadRegion {
+  int x;
+  int y;
+  int rows;
+  int cols;
+};
+
+static uint32_t
+align_offset(uint32_t offset) {
+  return (offset + (LEVEL_ALIGN - 1)) & ~(uint32_t)(LEVEL_ALIGN - 1);
+}
+
+static char *
+read_text_file(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    printf("could not open %s\n", path);
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char *text = malloc((size_t)size + 1);
+  if (text != NULL) {
+    size_t read = fread(text, 1, (size_t)size, file);
+    text[read] = '\0';
+  }
+  fclose(file);
+  return text;
+}
+
+static int
+find_piece_type(const struct PieceDefs *defs, const char *name) {
+  for (int type = 0; type < defs->count; type++) {
+    if (strcmp(defs->names[type], name) == 0) {
+      return type;
+    }
+  }
+  return -1;
+}
+
+// Splits a region in half each way, the first half gets the smaller share of an odd split.
+// A child with no cells is left out.
+static int
+split_region(struct QuadRegion region, struct QuadRegion children[4]) {
+  int top_rows = region.rows / 2;
+  int left_cols = region.cols / 2;
+  children[0] = (struct QuadRegion){region.x, region.y, top_rows, left_cols};
+  children[1] = (struct QuadRegion){region.x, region.y + left_cols, top_rows, region.cols - left_cols};
+  children[2] = (struct QuadRegion){region.x + top_rows, region.y, region.rows - top_rows, left_cols};
+  children[3] = (struct QuadRegion){region.x + top_rows, region.y + left_cols, region.rows - top_rows, region.cols - left_cols};
+  return 4;
+}
+
+static int
+count_quads(struct QuadRegion region) {
+  if (region.rows <= 0 || region.cols <= 0) {
+    return 0;
+  }
+  if (region.rows == 1 && region.cols == 1) {
+    return 1;
+  }
+  struct QuadRegion children[4];
+  int total = 1;
+  for (int i = 0; i < split_region(region, children); i++) {
+    total += count_quads(children[i]);
+  }
+  return total;
+}
+
+static void
+build_quads(struct Quads qtree, int rows, int cols, const int32_t *cell_pieces, struct QuadRegion *queue) {
+  // Breadth first like initialize_qtree, so the top of the tree sits together at the front
+  int head = 0;
+  int tail = 0;
+  queue[tail++] = (struct QuadRegion){0, 0, rows, cols};
+
+  while (head < tail) {
+    int index = head;
+    struct QuadRegion region = queue[head++];
+
+    // Same world layout as build_square_positions, rows run along z and columns along x
+    float centre_x = region.y + ((region.cols - 1) / 2.0f);
+    float centre_z = region.x + ((region.rows - 1) / 2.0f);
+    qtree.quad_positions[index] = (Vector3){
+      (PIECE_SIZE * ((cols / 2) - centre_x)) - (PIECE_SIZE / 2.0f),
+      0.0f,
+      (PIECE_SIZE * ((rows / 2) - centre_z)) - (PIECE_SIZE / 2.0f)
+    };
+    qtree.quad_sizes[index] = (Vector2){region.cols * PIECE_SIZE, region.rows * PIECE_SIZE};
+
+    int *children[4] = {qtree.top_left, qtree.top_right, qtree.bottom_left, qtree.bottom_right};
+
+    if (region.rows == 1 && region.cols == 1) {
+      qtree.piece_indices[index] = cell_pieces[(region.x * cols) + region.y];
+      for (int i = 0; i < 4; i++) {
+        children[i][index] = -1;
+      }
+      continue;
+    }
+
+    qtree.piece_indices[index] = -1;
+    struct QuadRegion child_regions[4];
+    split_region(region, child_regions);
+    for (int i = 0; i < 4; i++) {
+      if (child_regions[i].rows <= 0 || child_regions[i].cols <= 0) {
+        children[i][index] = -1;
+        continue;
+      }
+      children[i][index] = tail;
+      queue[tail++] = child_regions[i];
+    }
+  }
+}
+
+int
+level_bake(const char *source_path, const char *baked_path, const struct PieceDefs *defs) {
+  char *text = read_text_file(source_path);
+  if (text == NULL) {
+    return -1;
+  }
+
+  int rows = 0;
+  int cols = 0;
+  int num_players = 0;
+  int slots_per_player = 0; // defaults to the most pieces any player has
+  Vector2 forwards[MAX_PLAYERS];
+  memcpy(forwards, player_forwards, sizeof forwards);
+
+  // What each character on the board stands for
+  char legend_chars[LEVEL_MAX_LEGEND];
+  int legend_players[LEVEL_MAX_LEGEND];
+  int legend_types[LEVEL_MAX_LEGEND];
+  int legend_count = 0;
+
+  int32_t *cell_pieces = NULL;
+  int board_row = -1; // row the next board line fills, counting down from the top
+  int num_pieces = 0;
+  int result = -1;
+  int line_number = 0;
+  char *cursor = text;
+
+  // Pieces are numbered by owner once the whole board is read, this is their order on the board
+  uint8_t *cell_owners = NULL;
+  ChessPiece *cell_types = NULL;
+
+  while (*cursor != '\0') {
+    char *line = cursor;
+    size_t length = strcspn(cursor, "\n");
+    cursor += length + (cursor[length] == '\n');
+    line[length] = '\0';
+    if (length > 0 && line[length - 1] == '\r') {
+      line[--length] = '\0';
+    }
+    line_number++;
+
+    if (board_row >= 0) {
+      if (strcmp(line, "end") == 0 || (int)length != cols) {
+        printf("%s:%d: expected a board row of %d cells\n", source_path, line_number, cols);
+        goto done;
+      }
+      for (int y = 0; y < cols; y++) {
+        int square = (board_row * cols) + y;
+        cell_pieces[square] = -1;
+        if (line[y] == '.') {
+          continue;
+        }
+        int entry = -1;
+        for (int i = 0; i < legend_count; i++) {
+          if (legend_chars[i] == line[y]) {
+            entry = i;
+          }
+        }
+        if (entry < 0) {
+          printf("%s:%d: %c isn't in the piece legend\n", source_path, line_number, line[y]);
+          goto done;
+        }
+        cell_pieces[square] = 0;
+        cell_owners[square] = (uint8_t)legend_players[entry];
+        cell_types[square] = legend_types[entry];
+      }
+      board_row--;
+      if (board_row < 0) {
+        board_row = -2; // finished, only `end` can follow
+      }
+      continue;
+    }
+
+    char word[16];
+    if (sscanf(line, " %15s", word) != 1 || word[0] == '#') {
+      continue;
+    }
+
+    if ((strcmp(word, "size") == 0 || strcmp(word, "players") == 0 || strcmp(word, "slots") == 0) && cell_pieces != NULL) {
+      // The board was allocated and read for the ones before it
+      printf("%s:%d: %s has to come before the board\n", source_path, line_number, word);
+      goto done;
+    }
+    else if (strcmp(word, "size") == 0) {
+      if (sscanf(line, " size %d %d", &rows, &cols) != 2 || rows <= 0 || cols <= 0 || (int64_t)rows * cols > LEVEL_MAX_CELLS) {
+        printf("%s:%d: bad size\n", source_path, line_number);
+        goto done;
+      }
+    }
+    else if (strcmp(word, "players") == 0) {
+      if (sscanf(line, " players %d", &num_players) != 1 || num_players < 2 || num_players > MAX_PLAYERS) {
+        printf("%s:%d: players has to be 2 to %d\n", source_path, line_number, MAX_PLAYERS);
+        goto done;
+      }
+    }
+    else if (strcmp(word, "slots") == 0) {
+      if (sscanf(line, " slots %d", &slots_per_player) != 1 || slots_per_player <= 0) {
+        printf("%s:%d: bad slots\n", source_path, line_number);
+        goto done;
+      }
+    }
+    else if (strcmp(word, "forward") == 0) {
+      int player;
+      int x;
+      int y;
+      if (sscanf(line, " forward %d %d %d", &player, &x, &y) != 3 || player < 0 || player >= MAX_PLAYERS || abs(x) + abs(y) != 1) {
+        printf("%s:%d: expected `forward <player> <x> <y>` along a row or column\n", source_path, line_number);
+        goto done;
+      }
+      // Piece tables, evaluation and the network are all built for the usual seats
+      if (x != (int)player_forwards[player].x || y != (int)player_forwards[player].y) {
+        printf("%s:%d: player %d can only face %d %d, moves are compiled for the usual seats\n",
+               source_path,
+               line_number,
+               player,
+               (int)player_forwards[player].x,
+               (int)player_forwards[player].y);
+        goto done;
+      }
+      forwards[player] = (Vector2){x, y};
+    }
+    else if (strcmp(word, "piece") == 0) {
+      char symbol;
+      int player;
+      char name[PIECE_NAME_SIZE];
+      if (legend_count == LEVEL_MAX_LEGEND ||
+          sscanf(line, " piece %c %d %15s", &symbol, &player, name) != 3 ||
+          player < 0 || player >= MAX_PLAYERS || symbol == '.') {
+        printf("%s:%d: expected `piece <char> <player> <type>`\n", source_path, line_number);
+        goto done;
+      }
+      legend_chars[legend_count] = symbol;
+      legend_players[legend_count] = player;
+      legend_types[legend_count] = find_piece_type(defs, name);
+      if (legend_types[legend_count] < 0) {
+        printf("%s:%d: no piece definition called %s\n", source_path, line_number, name);
+        goto done;
+      }
+      legend_count++;
+    }
+    else if (strcmp(word, "board") == 0) {
+      if (rows == 0 || num_players == 0 || cell_pieces != NULL) {
+        printf("%s:%d: size and players have to come before the board\n", source_path, line_number);
+        goto done;
+      }
+      cell_pieces = malloc((size_t)rows * cols * sizeof (int32_t));
+      cell_owners = malloc((size_t)rows * cols);
+      cell_types = malloc((size_t)rows * cols * sizeof (ChessPiece));
+      if (cell_pieces == NULL || cell_owners == NULL || cell_types == NULL) {
+        goto done;
+      }
+      board_row = rows - 1; // drawn the way you look at it, white at the bottom
+    }
+    else if (strcmp(word, "end") == 0 && board_row == -2) {
+      board_row = -3;
+    }
+    else {
+      printf("%s:%d: unexpected %s\n", source_path, line_number, word);
+      goto done;
+    }
+  }
+
+  if (board_row != -3) {
+    printf("%s: missing board or its end\n", source_path);
+    goto done;
+  }
+
+  for (int i = 0; i < legend_count; i++) {
+    if (legend_players[i] >= num_players) {
+      printf("%s: legend uses player %d but there are only %d\n", source_path, legend_players[i], num_players);
+      goto done;
+    }
+  }
+
+  int player_counts[MAX_PLAYERS] = {0};
+  int most_pieces = 0;
+  for (int square = 0; square < rows * cols; square++) {
+    if (cell_pieces[square] >= 0) {
+      int count = ++player_counts[cell_owners[square]];
+      most_pieces = count > most_pieces ? count : most_pieces;
+    }
+  }
+  if (slots_per_player == 0) {
+    slots_per_player = most_pieces;
+  }
+  if (most_pieces > slots_per_player || (int64_t)num_players * slots_per_player > rows * cols) {
+    printf("%s: a player has %d pieces, more than the %d slots\n", source_path, most_pieces, slots_per_player);
+    goto done;
+  }
+  num_pieces = num_players * slots_per_player;
+
+  // Lay the file out, then fill it in place in one block
+  int num_quads = count_quads((struct QuadRegion){0, 0, rows, cols});
+  int num_cells = rows * cols;
+  struct LevelHeader header = {
+    .magic = LEVEL_MAGIC,
+    .version = LEVEL_VERSION,
+    .byte_order = LEVEL_BYTE_ORDER,
+    .rows = (uint32_t)rows,
+    .cols = (uint32_t)cols,
+    .num_players = (uint32_t)num_players,
+    .slots_per_player = (uint32_t)slots_per_player,
+    .num_pieces = (uint32_t)num_pieces,
+    .num_types = (uint32_t)defs->count,
+    .num_quads = (uint32_t)num_quads
+  };
+
+  uint32_t offset = align_offset(sizeof header);
+  header.forwards_offset = offset;
+  offset = align_offset(offset + num_players * sizeof (Vector2));
+  header.piece_squares_offset = offset;
+  offset = align_offset(offset + num_pieces * sizeof (Square));
+  header.piece_owners_offset = offset;
+  offset = align_offset(offset + num_pieces * sizeof (uint8_t));
+  header.piece_types_offset = offset;
+  offset = align_offset(offset + num_pieces * sizeof (ChessPiece));
+  header.cell_pieces_offset = offset;
+  offset = align_offset(offset + num_cells * sizeof (int32_t));
+  header.quad_positions_offset = offset;
+  offset = align_offset(offset + num_quads * sizeof (Vector3));
+  header.quad_sizes_offset = offset;
+  offset = align_offset(offset + num_quads * sizeof (Vector2));
+  header.quad_pieces_offset = offset;
+  offset = align_offset(offset + num_quads * sizeof (int32_t));
+  header.quad_children_offset = offset;
+  offset = align_offset(offset + 4 * num_quads * sizeof (int32_t));
+  header.file_size = offset;
+
+  uint8_t *file = calloc(1, header.file_size);
+  struct QuadRegion *queue = malloc(num_quads * sizeof *queue);
+  if (file == NULL || queue == NULL) {
+    free(file);
+    free(queue);
+    goto done;
+  }
+
+  memcpy(file, &header, sizeof header);
+  memcpy(file + header.forwards_offset, forwards, num_players * sizeof (Vector2));
+
+  Square *piece_squares = (Square *)(file + header.piece_squares_offset);
+  uint8_t *piece_owners = file + header.piece_owners_offset;
+  ChessPiece *piece_types = (ChessPiece *)(file + header.piece_types_offset);
+  int32_t *baked_cells = (int32_t *)(file + header.cell_pieces_offset);
+
+  // Number the pieces player by player, in board order within a player, and leave
+  // the slots nobody uses off the board
+  for (int piece = 0; piece < num_pieces; piece++) {
+    piece_squares[piece] = SQUARE_NONE;
+    piece_owners[piece] = (uint8_t)(piece / slots_per_player);
+  }
+  int next_slot[MAX_PLAYERS] = {0};
+  for (int square = 0; square < num_cells; square++) {
+    if (cell_pieces[square] < 0) {
+      continue;
+    }
+    int player = cell_owners[square];
+    int piece = (player * slots_per_player) + next_slot[player]++;
+    piece_squares[piece] = (Square)square;
+    piece_types[piece] = cell_types[square];
+    cell_pieces[square] = piece;
+  }
+  memcpy(baked_cells, cell_pieces, num_cells * sizeof (int32_t));
+
+  int32_t *children = (int32_t *)(file + header.quad_children_offset);
+  struct Quads qtree = {
+    .size = num_quads,
+    .quad_positions = (Vector3 *)(file + header.quad_positions_offset),
+    .quad_sizes = (Vector2 *)(file + header.quad_sizes_offset),
+    .piece_indices = (int *)(file + header.quad_pieces_offset),
+    .top_left = &children[0],
+    .top_right = &children[num_quads],
+    .bottom_left = &children[2 * num_quads],
+    .bottom_right = &children[3 * num_quads]
+  };
+  build_quads(qtree, rows, cols, baked_cells, queue);
+  free(queue);
+
+  FILE *out = fopen(baked_path, "wb");
+  if (out == NULL) {
+    printf("could not write %s\n", baked_path);
+  }
+  else {
+    result = fwrite(file, 1, header.file_size, out) == header.file_size ? 0 : -1;
+    result |= fclose(out);
+  }
+  free(file);
+
+done:
+  free(cell_pieces);
+  free(cell_owners);
+  free(cell_types);
+  free(text);
+  return result;
+}
+
+static int
+array_fits(const struct LevelHeader *header, uint32_t offset, uint32_t count, size_t element_size) {
+  return offset % LEVEL_ALIGN == 0 &&
+         offset <= header->file_size &&
+         (uint64_t)count * element_size <= header->file_size - offset;
+}
+
+// The quads have to make the tree the baker makes for a board this size: a child for every
+// part of a split region that has cells, and -1 for the rest and under every single cell.
+// Children always come after their parent in the breadth first order, so walks can't loop.
+static int
+quads_valid(const int32_t *children, int64_t quads, int64_t quad, struct QuadRegion region) {
+  int leaf = region.rows == 1 && region.cols == 1;
+  struct QuadRegion child_regions[4];
+  split_region(region, child_regions);
+  for (int child = 0; child < 4; child++) {
+    int32_t next = children[(child * quads) + quad];
+    if (leaf || child_regions[child].rows <= 0 || child_regions[child].cols <= 0) {
+      if (next != -1) {
+        return 0;
+      }
+      continue;
+    }
+    if (next <= quad || next >= quads || !quads_valid(children, quads, next, child_regions[child])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Everything the game indexes with has to stay inside its array, one pass over each
+static int
+indices_valid(const struct LevelHeader *header, const uint8_t *base) {
+  int64_t cells = (int64_t)header->rows * header->cols;
+  int64_t quads = header->num_quads;
+  const Square *piece_squares = (const Square *)(base + header->piece_squares_offset);
+  const uint8_t *piece_owners = base + header->piece_owners_offset;
+  const ChessPiece *piece_types = (const ChessPiece *)(base + header->piece_types_offset);
+  const int32_t *cell_pieces = (const int32_t *)(base + header->cell_pieces_offset);
+  const int32_t *quad_pieces = (const int32_t *)(base + header->quad_pieces_offset);
+  const int32_t *children = (const int32_t *)(base + header->quad_children_offset);
+
+  for (uint32_t piece = 0; piece < header->num_pieces; piece++) {
+    if ((piece_squares[piece] != SQUARE_NONE && piece_squares[piece] >= cells) ||
+        piece_owners[piece] != piece / header->slots_per_player ||
+        (uint32_t)piece_types[piece] >= header->num_types) {
+      return 0;
+    }
+  }
+  for (int64_t cell = 0; cell < cells; cell++) {
+    if (cell_pieces[cell] < -1 || cell_pieces[cell] >= (int64_t)header->num_pieces) {
+      return 0;
+    }
+  }
+  // The game places pieces from their squares, so both sides have to agree, and no two
+  // live pieces can share a square
+  for (uint32_t piece = 0; piece < header->num_pieces; piece++) {
+    if (piece_squares[piece] != SQUARE_NONE && cell_pieces[piece_squares[piece]] != (int32_t)piece) {
+      return 0;
+    }
+  }
+  for (int64_t cell = 0; cell < cells; cell++) {
+    if (cell_pieces[cell] >= 0 && piece_squares[cell_pieces[cell]] != cell) {
+      return 0;
+    }
+  }
+  for (int64_t quad = 0; quad < quads; quad++) {
+    if (quad_pieces[quad] < -1 || quad_pieces[quad] >= (int64_t)header->num_pieces) {
+      return 0;
+    }
+  }
+  struct QuadRegion board = {0, 0, (int)header->rows, (int)header->cols};
+  return quads == count_quads(board) && quads_valid(children, quads, 0, board);
+}
+
+int
+level_map(struct Level *level, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("could not open level %s\n", path);
+    return -1;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof (struct LevelHeader)) {
+    printf("%s is too small to be a level\n", path);
+    close(fd);
+    return -1;
+  }
+
+  // Private and writable, so the game can use the arrays as its own and any changes
+  // stay in this process instead of going back to the file
+  void *mapping = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    printf("could not map level %s\n", path);
+    return -1;
+  }
+
+  const struct LevelHeader *header = mapping;
+  uint8_t *base = mapping;
+  uint64_t cells = (uint64_t)header->rows * header->cols;
+  uint32_t quads = header->num_quads;
+
+  int valid = header->magic == LEVEL_MAGIC &&
+              header->version == LEVEL_VERSION &&
+              header->byte_order == LEVEL_BYTE_ORDER &&
+              header->file_size == (uint64_t)info.st_size &&
+              header->rows > 0 && header->cols > 0 && header->rows <= LEVEL_MAX_CELLS && header->cols <= LEVEL_MAX_CELLS &&
+              cells <= LEVEL_MAX_CELLS &&
+              header->num_players >= 2 && header->num_players <= MAX_PLAYERS &&
+              header->slots_per_player > 0 &&
+              (uint64_t)header->num_players * header->slots_per_player == header->num_pieces &&
+              header->num_pieces <= cells &&
+              array_fits(header, header->forwards_offset, header->num_players, sizeof (Vector2)) &&
+              array_fits(header, header->piece_squares_offset, header->num_pieces, sizeof (Square)) &&
+              array_fits(header, header->piece_owners_offset, header->num_pieces, sizeof (uint8_t)) &&
+              array_fits(header, header->piece_types_offset, header->num_pieces, sizeof (ChessPiece)) &&
+              array_fits(header, header->cell_pieces_offset, (uint32_t)cells, sizeof (int32_t)) &&
+              array_fits(header, header->quad_positions_offset, quads, sizeof (Vector3)) &&
+              array_fits(header, header->quad_sizes_offset, quads, sizeof (Vector2)) &&
+              array_fits(header, header->quad_pieces_offset, quads, sizeof (int32_t)) &&
+              array_fits(header, header->quad_children_offset, quads, 4 * sizeof (int32_t));
+
+  if (!valid) {
+    printf("%s isn't a level this build can read, rebake it with `make levels`\n", path);
+    munmap(mapping, (size_t)info.st_size);
+    return -1;
+  }
+
+  int32_t *children = (int32_t *)(base + header->quad_children_offset);
+  if (!indices_valid(header, base)) {
+    printf("%s has pieces or quads pointing outside the level\n", path);
+    munmap(mapping, (size_t)info.st_size);
+    return -1;
+  }
+
+  const Vector2 *forwards = (const Vector2 *)(base + header->forwards_offset);
+  for (uint32_t player = 0; player < header->num_players; player++) {
+    if (forwards[player].x != player_forwards[player].x || forwards[player].y != player_forwards[player].y) {
+      printf("%s turns player %u away from the usual seat, moves are only compiled for those\n", path, player);
+      munmap(mapping, (size_t)info.st_size);
+      return -1;
+    }
+  }
+
+  *level = (struct Level){
+    .mapping = mapping,
+    .size = (size_t)info.st_size,
+    .rows = (int)header->rows,
+    .cols = (int)header->cols,
+    .num_players = (int)header->num_players,
+    .slots_per_player = (int)header->slots_per_player,
+    .num_pieces = (int)header->num_pieces,
+    .num_types = (int)header->num_types,
+    .forwards = (const Vector2 *)(base + header->forwards_offset),
+    .piece_squares = (const Square *)(base + header->piece_squares_offset),
+    .piece_owners = base + header->piece_owners_offset,
+    .piece_types = (const ChessPiece *)(base + header->piece_types_offset),
+    .cell_pieces = (const int32_t *)(base + header->cell_pieces_offset),
+    .qtree = {
+      .size = (int)quads,
+      .quad_positions = (Vector3 *)(base + header->quad_positions_offset),
+      .quad_sizes = (Vector2 *)(base + header->quad_sizes_offset),
+      .piece_indices = (int *)(base + header->quad_pieces_offset),
+      .top_left = &children[0],
+      .top_right = &children[quads],
+      .bottom_left = &children[2 * quads],
+      .bottom_right = &children[3 * quads]
+    }
+  };
+  return 0;
+}
+
+void
+level_unmap(struct Level *level) {
+  if (level->mapping != NULL) {
+    munmap(level->mapping, level->size);
+  }
+  level->mapping = NULL;
+}
+
+int
+level_piece_at(const struct Level *level, int x, int y) {
+  if (x < 0 || y < 0 || x >= level->rows || y >= level->cols) {
+    return -1;
+  }
+
+  struct QuadRegion region = {0, 0, level->rows, level->cols};
+  int quad = 0;
+  while (region.rows > 1 || region.cols > 1) {
+    struct QuadRegion children[4];
+    split_region(region, children);
+    int *child_quads[4] = {level->qtree.top_left, level->qtree.top_right, level->qtree.bottom_left, level->qtree.bottom_right};
+    int bottom = x >= children[3].x;
+    int right = y >= children[3].y;
+    int child = (bottom * 2) + right;
+    region = children[child];
+    quad = child_quads[child][quad];
+  }
+  return level->qtree.piece_indices[quad];
+}
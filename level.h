@@ -0,0 +1,76 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "stddef.h"
+#include "stdint.h"
+#include "chess.h"
+#include "piece_defs.h"
+
+// Levels are written as text (resources/levels/*.txt) and baked by `make levels`
+// into a binary that is mmap'd and used in place: every array the game needs,
+// including the quadtree, is already laid out the way struct Game and struct Quads
+// point at it, so loading is open + mmap + checking the header.
+
+#define LEVEL_MAGIC 0x564C4352u // "RCLV"
+#define LEVEL_VERSION 1
+#define LEVEL_BYTE_ORDER 0x01020304u // reads back differently on a machine with the other byte order
+#define LEVEL_ALIGN 64
+#define LEVEL_MAX_CELLS 0xFFFF // squares are 16 bit and SQUARE_NONE is taken
+
+// The mapped arrays are used as the in-memory types, make sure those are what was written
+typedef char level_piece_type_check[(sizeof (ChessPiece) == sizeof (int32_t)) ? 1 : -1];
+typedef char level_vector_check[(sizeof (Vector3) == 12 && sizeof (Vector2) == 8) ? 1 : -1];
+
+// Offsets are from the start of the file, every array starts on a LEVEL_ALIGN boundary
+struct LevelHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t file_size;
+  uint32_t rows;
+  uint32_t cols;
+  uint32_t num_players;
+  uint32_t slots_per_player; // piece ids are player * slots_per_player + slot, like struct ChessPieces
+  uint32_t num_pieces; // num_players * slots_per_player, unused slots sit on SQUARE_NONE
+  uint32_t num_types; // how many piece definitions it was baked against
+  uint32_t num_quads;
+  uint32_t forwards_offset; // Vector2 per player
+  uint32_t piece_squares_offset; // Square per piece
+  uint32_t piece_owners_offset; // uint8_t per piece
+  uint32_t piece_types_offset; // ChessPiece per piece
+  uint32_t cell_pieces_offset; // int32_t per cell, -1 when empty
+  uint32_t quad_positions_offset; // Vector3 per quad, world centre
+  uint32_t quad_sizes_offset; // Vector2 per quad, world size
+  uint32_t quad_pieces_offset; // int32_t per quad, the piece on a single cell quad, else -1
+  uint32_t quad_children_offset; // 4 int32_t arrays of num_quads: top_left, top_right, bottom_left, bottom_right
+};
+
+// A mapped level, the pointers all point into the mapping
+struct Level {
+  void *mapping;
+  size_t size;
+  int rows;
+  int cols;
+  int num_players;
+  int slots_per_player;
+  int num_pieces;
+  int num_types;
+  const Vector2 *forwards;
+  const Square *piece_squares;
+  const uint8_t *piece_owners;
+  const ChessPiece *piece_types;
+  const int32_t *cell_pieces;
+  struct Quads qtree; // root is quad 0, children are -1 past a single cell
+};
+
+// Bakes a text level against the piece definitions, returns -1 after printing what went wrong
+int level_bake(const char *source_path, const char *baked_path, const struct PieceDefs *defs);
+
+// Maps a baked level, returns -1 if it can't be opened or doesn't check out
+int level_map(struct Level *level, const char *path);
+void level_unmap(struct Level *level);
+
+// Walks the quadtree down to the cell, returns the piece on it or -1
+int level_piece_at(const struct Level *level, int x, int y);
+
+#endif
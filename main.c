@@ -1,130 +1,95 @@
 #include "stdint.h"
 #include "raylib.h"
+#include "raymath.h"
 #include "math.h"
 #include "stdio.h"
+#include "stdlib.h"
 #include "string.h"
 #include "assert.h"
 #include "chess.h"
+#include "board.h"
+#include "arena.h"
+#include "game.h"
+#include "board_pool.h"
+#include "piece_defs.h"
+#include "level.h"
+#include "game_log.h"
+#include "position.h"
+#include "see.h"
+#include "tt.h"
+#include "search.h"
+#include "time_manager.h"
+#include "analysis.h"
+#include "input.h"
+#include "sim.h"
+#include "triple_buffer.h"
+#include "tween.h"
+#include "profiler.h"
 #include "camera/rlTPCamera.h"
 
-const int NINTENDO_CONTROLLER = 1;
+#define TICK_ARENA_SIZE (16 * 1024)
 
-static int
-left_x_right_control() {
-  int gamepad_x = GetGamepadAxisMovement(NINTENDO_CONTROLLER, GAMEPAD_AXIS_LEFT_X) > 0.95f;
-  int key_x = IsKeyDown(KEY_D);
-  return gamepad_x || key_x;
-}
+#define TARGET_FPS 60
 
-static int
-left_x_left_control() {
-  int gamepad_x = GetGamepadAxisMovement(NINTENDO_CONTROLLER, GAMEPAD_AXIS_LEFT_X) < 0;
-  int key_x = IsKeyDown(KEY_A);
-  return gamepad_x || key_x;
-}
+// The other boards in the pool play a move this often
+#define BOARD_UPDATE_TICKS (SIM_TICK_RATE / 4)
+// Space between tiles when there is more than one board
+#define BOARD_TILE_GAP (2 * PIECE_SIZE)
+
+// The computer searches this long after every frame is drawn
+#define COMPUTER_SLICE_US 4000
+// and plays the best move it's found once it has gone this deep or this many nodes,
+// unless it's playing on a clock
+#define COMPUTER_DEPTH 12
+#define COMPUTER_NODES 2000000
+// On a clock its time manager keeps this back for the frames between its search finishing
+// and the move being played on the simulation thread
+#define COMPUTER_MOVE_OVERHEAD_US 50000
+#define COMPUTER_TT_BYTES (16 * 1024 * 1024)
 
+// L shows the best few lines of the focused board as arrows, searched on an engine thread
+#define ANALYSIS_LINES 3
+#define ANALYSIS_TT_BYTES (16 * 1024 * 1024)
+#define ANALYSIS_ARROW_HEIGHT 0.3f // over the threat overlay
+
+#ifdef PROFILER
 static int
-left_y_down_control() {
-  int gamepad_x = GetGamepadAxisMovement(NINTENDO_CONTROLLER, GAMEPAD_AXIS_LEFT_Y) > 0.95f;
-  int key_x = IsKeyDown(KEY_S);
-  return gamepad_x || key_x;
+profiler_overlay_control() {
+  return IsKeyPressed(KEY_F3);
 }
 
 static int
-left_y_up_control() {
-  int gamepad_x = GetGamepadAxisMovement(NINTENDO_CONTROLLER, GAMEPAD_AXIS_LEFT_Y) < 0;
-  int key_x = IsKeyDown(KEY_W);
-  return gamepad_x || key_x;
+profiler_export_control() {
+  return IsKeyPressed(KEY_F9);
 }
+#endif
 
 static int
-trigger_control() {
-  int gamepad_trigger = IsGamepadButtonDown(NINTENDO_CONTROLLER, GAMEPAD_BUTTON_LEFT_TRIGGER_2);
-  int key_trigger = IsKeyDown(KEY_X);
-  return gamepad_trigger || key_trigger;
+fast_forward_control() {
+  return IsKeyPressed(KEY_F);
 }
 
 static int
-select_control() {
-  int gamepad_control = IsGamepadButtonDown(NINTENDO_CONTROLLER, GAMEPAD_BUTTON_RIGHT_FACE_UP);
-  int key_control = IsKeyDown(KEY_M);
-  return gamepad_control || key_control;
+threat_overlay_control() {
+  return IsKeyPressed(KEY_T);
 }
 
 static int
-switch_players_control() {
-  int gamepad_control = IsGamepadButtonDown(NINTENDO_CONTROLLER, GAMEPAD_BUTTON_LEFT_FACE_UP);
-  int key_control = IsKeyDown(KEY_P);
-  return gamepad_control || key_control;
+analysis_control() {
+  return IsKeyPressed(KEY_L);
 }
 
 // Piece stuff
-static ChessPiece white_starting_pieces[N_PIECES] = {
-    PAWN, PAWN, PAWN, PAWN, PAWN, PAWN, PAWN, PAWN,           // First row
-    ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK // Second row
-};
-
-static ChessPiece black_starting_pieces[N_PIECES] = {
-    ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK, // Second row
-    PAWN, PAWN, PAWN, PAWN, PAWN, PAWN, PAWN, PAWN           // First row
-};
-
-static Color black_colors[N_PIECES] = {
-  BLACK, BLACK, BLACK, BLACK, BLACK, BLACK, BLACK, BLACK,
-  BLACK, BLACK, BLACK, BLACK, BLACK, BLACK, BLACK, BLACK
-};
-
-static Color white_colors[N_PIECES] = {
-  WHITE, WHITE, WHITE, WHITE, WHITE, WHITE, WHITE, WHITE,
-  WHITE, WHITE, WHITE, WHITE, WHITE, WHITE, WHITE, WHITE
-};
-
-static int white_starting_aps[N_PIECES] = {
-    1, 1, 1, 1, 1, 1, 1, 1,     // First row
-    N_COLS, 1, N_COLS, N_COLS, 1, N_COLS, 1, N_COLS, // Second row
-};
-
-static int black_starting_aps[N_PIECES] = {
-    N_COLS, 1, N_COLS, N_COLS, 1, N_COLS, 1, N_COLS, // Second row
-    1, 1, 1, 1, 1, 1, 1, 1     // First row
-};
-
-static int white_piece_cell_indices[N_PIECES];
-static int black_piece_cell_indices[N_PIECES];
-
 static Texture2D piece_textures[6];
 static Model piece_models[6];
 static float piece_scaling_factors[6] = {20.0f, 20.0f, 20.0f, 20.0f, 20.0f, 20.0f};
 
-static int offset_sizes[6] = {
-  (sizeof pawnOffsets)/sizeof(pawnOffsets[0]),
-  (sizeof knightOffsets)/sizeof(knightOffsets[0]),
-  (sizeof bishopOffsets)/sizeof(bishopOffsets[0]),
-  (sizeof rookOffsets)/sizeof(rookOffsets[0]),
-  (sizeof queenOffsets)/sizeof(queenOffsets[0]),
-  (sizeof kingOffsets)/sizeof(kingOffsets[0])
-};
-
-static Vector2 *offsets[6] = {
-  &pawnOffsets[0],
-  &knightOffsets[0],
-  &bishopOffsets[0],
-  &rookOffsets[0],
-  &queenOffsets[0],
-  &kingOffsets[0]
-};
-
-static Vector3 white_grid_positions[N_PIECES];
-static Vector3 black_grid_positions[N_PIECES];
-static Vector2 white_chess_positions[N_PIECES];
-static Vector2 black_chess_positions[N_PIECES];
-static uint8_t white_pieces_dead[N_PIECES];
-static uint8_t black_pieces_dead[N_PIECES];
+// World position of every square, only used for drawing
+static Vector3 square_positions[N_CELLS];
 
-// Cell stuff
-static uint8_t occupied_states[N_CELLS];
-static int cell_player_states[N_CELLS];
-static int cell_piece_indices[N_CELLS];
+// Backing memory for the tick arena, the games come out of the board pool's block
+// and nothing is malloc'd once the game is running
+static uint8_t tick_memory[TICK_ARENA_SIZE];
 
 static void
 load_assets() {
@@ -138,371 +103,842 @@ load_assets() {
 }
 
 static int
-convert_coord(int input, int n) {
-  // n = number of cells in a row or column
-  // Translate coordinates
-  assert (n > 0);
-  int half = n / 2;
-  return half - input;
+handle_moving_piece(int active_cell_to_move_to,
+                    int active_piece_to_move,
+                    int active_player,
+                    struct Game *game,
+                    struct Players active_players,
+                    Square *move_squares) {
+  // Fills move_squares with every cell the piece can move to, in offset order
+  // and remembers which one is selected so select_control can move there
+  int move_to_count = game_piece_moves(game, active_piece_to_move, move_squares);
+
+  if (active_cell_to_move_to >= 0 && active_cell_to_move_to < move_to_count) {
+    active_players.select_to_move_to_squares[active_player] = move_squares[active_cell_to_move_to];
+  }
+
+  return move_to_count;
 }
 
-void
-initialize_qtree(struct Quads qtree, struct QItem *queue, int q_size) {
-  qtree.size = q_size;
+static Vector3
+board_tile_offset(int board, int tiles_per_row) {
+  // Board 0 sits at the origin where the camera looks, the rest are laid out in rows after it
+  float tile_size = (N_ROWS * PIECE_SIZE) + BOARD_TILE_GAP;
+  return (Vector3){(board % tiles_per_row) * tile_size, 0.0f, (board / tiles_per_row) * tile_size};
+}
 
-  printf("qtree.size = %d\n", qtree.size);
+// Everything a frame draws. The simulation thread fills one in after its ticks and publishes
+// it, the render thread only ever reads the latest one and never touches a Game.
+struct Snapshot {
+  uint64_t tick;
+  double tick_time; // when the latest tick happened, see sim_alpha
+  int sim_mode;
+  int ticks_per_publish;
+  int finished; // the replay has run out
+  int status; // GameStatus of the player on the focused board
+  struct Threats threats; // of the focused board
+  struct BoardPoolStats board_stats;
+
+  // The selection on the focused board
+  Square selected_square; // SQUARE_NONE when the selected piece is dead
+  int move_count;
+  int active_move;
+  Square move_squares[N_CELLS];
+  SquareSet losing_moves; // captures static exchange says lose material, two player games only
+
+  // The focused board for search, with its player to move. Two player games only.
+  int has_position;
+  int ply;
+  struct Position position;
+  int computer_to_move; // and position is what it has to search
+  int game_over; // on the focused board, status alone can be a stalemate for the player shown
+
+  // The focused board's clock, running when clock.running is set
+  struct GameClock clock;
+  int clock_player; // whose time is going down
+
+  // Every board in the pool, the focused one too, pieces_per_board each.
+  // A piece's key is board * pieces_per_board + piece, captured pieces are on SQUARE_NONE.
+  int num_boards;
+  int pieces_per_board;
+  Square *squares;
+  ChessPiece *types;
+  Color *colors;
+};
 
-  Vector2 current_quad_size;
-  current_quad_size.x = N_ROWS * PIECE_SIZE;
-  current_quad_size.y = N_COLS * PIECE_SIZE;
+static int
+snapshot_init(struct Snapshot *snapshot, int num_boards, int pieces_per_board) {
+  memset(snapshot, 0, sizeof *snapshot);
+  size_t count = (size_t)num_boards * pieces_per_board;
+  snapshot->num_boards = num_boards;
+  snapshot->pieces_per_board = pieces_per_board;
+  snapshot->squares = malloc(count * sizeof (Square));
+  snapshot->types = malloc(count * sizeof (ChessPiece));
+  snapshot->colors = malloc(count * sizeof (Color));
+  if (snapshot->squares == NULL || snapshot->types == NULL || snapshot->colors == NULL) {
+    return -1;
+  }
+  return 0;
+}
 
-  Vector3 current_quad_position;
-  current_quad_position.x = 0.0f;
-  current_quad_position.y = 0.0f;
-  current_quad_position.z = 0.0f;
+static void
+snapshot_free(struct Snapshot *snapshot) {
+  free(snapshot->squares);
+  free(snapshot->types);
+  free(snapshot->colors);
+}
 
-  struct QItem root = {.position = current_quad_position, .dimensions=current_quad_size};
+static void
+copy_pieces(const struct Game *game, Square *squares, ChessPiece *types, Color *colors) {
+  const struct ChessPieces *pieces = &game->pieces;
+  for (int i = 0; i < game->num_pieces; i++) {
+    squares[i] = pieces->is_dead[i] ? SQUARE_NONE : pieces->squares[i];
+    types[i] = pieces->chess_type[i];
+    colors[i] = pieces->colors[i];
+  }
+}
 
-  q_push(root, queue, q_size);
+// Render thread only, what it has animated so far. shown_squares is where every key was in
+// the last snapshot it saw, a new snapshot starts a tween for each key that differs.
+struct Animations {
+  struct Tweens *tweens;
+  Square *shown_squares;
+  uint64_t tick;
+};
 
-  while (q_count > 0) { // FIXME level calculation
-    int next_q_count = q_count;
-    printf("q_count = %d\n", q_count);
-    if (next_q_count >= (q_size/16.0)) {
-      break;
+static void
+animate_snapshot(struct Animations *animations, const struct Snapshot *snapshot, float elapsed) {
+  struct Tweens *tweens = animations->tweens;
+  int num_keys = snapshot->num_boards * snapshot->pieces_per_board;
+
+  for (int key = 0; key < num_keys; key++) {
+    Square shown = animations->shown_squares[key];
+    Square square = snapshot->squares[key];
+    if (square == shown) {
+      continue;
     }
-    for (int i = 0; i < next_q_count; i++) {
-      struct QItem current_node = queue[q_get(q_size)];
-      struct Vector2 root_dimensions = current_node.dimensions;
-      struct Vector3 root_position = current_node.position;
-
-      int root_num_cells_x = (root_dimensions.x / PIECE_SIZE);
-      int root_num_cells_y = (root_dimensions.y / PIECE_SIZE);
-
-      float root_x_numerator_left = root_dimensions.x;
-      float root_x_numerator_right = root_dimensions.x;
-      float root_y_numerator = root_dimensions.y;
-
-      printf("i = %d, root_x_cells = %d, root_y_cells = %d\n", i, root_num_cells_x, root_num_cells_y);
-
-      // Calculate root dimension number of cells
-      // Split into quads based on number of *cells*, and allow an uneven split, e.g. 3 -> 1, 2
-      // do that for rows and columns
-      // convert back to normal coordinates for each quad
-
-      Vector3 bottom_right_pos = {
-          .x = root_position.x + (root_x_numerator_right / 4.0),
-          .y = 0.0f,
-          .z = root_position.z + (root_y_numerator / 4.0)
-      };
-      Vector3 bottom_left_pos = {
-          .x = root_position.x - (root_x_numerator_left / 4.0),
-          .y = 0.0f,
-          .z = root_position.z + (root_y_numerator / 4.0)
-      };
-      Vector3 top_left_pos = {
-          .x = root_position.x - (root_x_numerator_left / 4.0),
-          .y = 0.0f,
-          .z = root_position.z - (root_y_numerator / 4.0)
-      };
-      Vector3 top_right_pos = {
-          .x = root_position.x + (root_x_numerator_right / 4.0),
-          .y = 0.0f,
-          .z = root_position.z - (root_y_numerator / 4.0)
-      };
-
-      Vector2 bottom_right_size = {.x=root_dimensions.x / 2.0, .y=root_dimensions.y / 2.0};
-      Vector2 bottom_left_size = {.x=root_dimensions.x / 2.0, .y=root_dimensions.y / 2.0};
-      Vector2 top_left_size = {.x=root_dimensions.x / 2.0, .y=root_dimensions.y / 2.0};
-      Vector2 top_right_size = {.x=root_dimensions.x / 2.0, .y=root_dimensions.y / 2.0};
-
-      //DrawCube(top_left_pos, top_left_size.x, 0.1f, top_left_size.y, next_color(i));
-      //DrawCube(top_right_pos, top_right_size.x, 0.1f, top_right_size.y, next_color(i+10));
-      //DrawCube(bottom_left_pos, bottom_left_size.x, 0.1f, bottom_left_size.y, next_color(i+20));
-      //DrawCube(bottom_right_pos, bottom_right_size.x, 0.1f, bottom_right_size.y, next_color(i+30));
-
-      assert(q_push((struct QItem){.position=top_left_pos, .dimensions=top_left_size}, queue, q_size) != -1);
-      assert(q_push((struct QItem){.position=top_right_pos, .dimensions=top_right_size}, queue, q_size) != -1);
-      assert(q_push((struct QItem){.position=bottom_right_pos, .dimensions=bottom_right_size}, queue, q_size) != -1);
-      assert(q_push((struct QItem){.position=bottom_left_pos, .dimensions=bottom_left_size}, queue, q_size) != -1);
-
-      /*
-      printf("===============\n");
-      printf("root_pos = "); print_vec3(root_position);
-      printf("bottom_right_pos = "); print_vec3(bottom_right_pos);
-      printf("top_right_pos = "); print_vec3(top_right_pos);
-      printf("bottom_left_pos = "); print_vec3(bottom_left_pos);
-      printf("top_left_pos = "); print_vec3(top_left_pos);
-      printf("===============\n");
-      */
-    }
-  }
-
-  q_count = 0;
-  q_tail = 0;
-  q_head = 0;
+    animations->shown_squares[key] = square;
 
-}
+    // Back on the board after a reset, it just appears
+    if (shown == SQUARE_NONE) {
+      tween_stop(tweens, key);
+      continue;
+    }
 
-static Vector3
-calculate_position(int col, int row, int size) {
-  // Given a column and row, and a tile size
-  // calculate a board position
-  assert (size != 0);
-  Vector3 position = { (size*row) - (size/2.0),
-                       0.0f,
-                       (size*col) - (size/2.0)}; // 4 = half the grid from center
-  assert (fpclassify(position.x) == FP_NORMAL || fpclassify(position.x) == FP_ZERO);
-  assert (fpclassify(position.y) == FP_NORMAL || fpclassify(position.y) == FP_ZERO);
-  assert (fpclassify(position.z) == FP_NORMAL || fpclassify(position.z) == FP_ZERO);
-
-  return position;
+    // Carry on from wherever it's drawn now, a piece can move again before its last move is done
+    int row = tween_of(tweens, key);
+    Vector3 from = row >= 0 ? tween_position(tweens, row) : square_positions[shown];
+    if (square == SQUARE_NONE) {
+      tween_fade_out(tweens, key, from, TWEEN_FADE_SECONDS, elapsed);
+    }
+    else {
+      tween_move(tweens, key, from, square_positions[square], TWEEN_MOVE_SECONDS, TWEEN_SMOOTH, elapsed);
+    }
+  }
+  animations->tick = snapshot->tick;
 }
 
-static struct ChessPieces
-set_pieces(struct ChessPieces pieces,
-           struct Cells cells,
-           struct Players players,
-           int size,
-           unsigned int side,
-           int player_id) {
-  int cell_id = 0;
-  int start;
-  int end;
-
-  if (side == BOTTOM_SIDE) {
-    start = 0;
-    end = N_PIECES;
+static void
+draw_piece(const struct Snapshot *snapshot,
+           const struct Tweens *tweens,
+           int key,
+           struct ChessTypes chess_types,
+           Vector3 offset) {
+  // Pieces that are moving or fading out are drawn where their tween is
+  Square square = snapshot->squares[key];
+  int row = tween_of(tweens, key);
+  if (square == SQUARE_NONE && row < 0) {
+    return;
   }
 
-  else {
-    start = N_CELLS - (N_PIECES);
-    end = N_CELLS;
+  Vector3 grid_pos = row >= 0 ? tween_position(tweens, row) : square_positions[square];
+  Color color = snapshot->colors[key];
+  if (row >= 0) {
+    color = Fade(color, tweens->fade[row]);
   }
 
-  int x_half = (N_ROWS / 2.0) - 1;
-  int y_half = (N_COLS / 2.0);
+  int model = piece_tables.models[snapshot->types[key]];
+  DrawModel(chess_types.models[model], Vector3Add(grid_pos, offset), chess_types.scaling_factors[model], color);
+}
+
+static void
+draw_board_tile(const struct Snapshot *snapshot,
+                const struct Tweens *tweens,
+                int board,
+                struct ChessTypes chess_types,
+                Vector3 offset) {
+  DrawPlane(offset, (Vector2){N_ROWS * PIECE_SIZE, N_COLS * PIECE_SIZE}, Fade(LIGHTGRAY, 0.5f));
+
+  int first = board * snapshot->pieces_per_board;
+  for (int i = 0; i < snapshot->pieces_per_board; i++) {
+    draw_piece(snapshot, tweens, first + i, chess_types, offset);
+  }
+}
 
-  for (float i = -x_half; i <= y_half; i++) {
-    for (float j = -x_half; j <= y_half; j++) {
-      Vector3 position = calculate_position(i, j, size);
-      // there are always 16 pieces per player
-      if (cell_id >= start && cell_id < end) {
-        pieces.grid_positions[cell_id % N_PIECES] = position;
-        pieces.chess_positions[cell_id % N_PIECES] = (Vector2){i, j};
-        pieces.is_dead[cell_id % N_PIECES] = 0;
-        pieces.piece_cell_indices[cell_id % N_PIECES] = cell_id; // points to the cell that piece is on
+// Render thread only, the threat overlay as one quad a square in one mesh. Only the colours
+// of squares whose threats changed get rewritten, then uploaded in one range.
+#define THREAT_OVERLAY_HEIGHT 0.15f // over the move highlights
 
-        cells.occupied_states[N_CELLS - cell_id - 1] = 1;
-        cells.cell_player_states[N_CELLS - cell_id - 1] = player_id;
-        cells.cell_piece_indices[N_CELLS - cell_id - 1] = cell_id % N_PIECES; // ends up pointing back to the piece occupied by that cell
-        players.select_to_move_pieces[player_id] = cell_id % N_PIECES;
+struct ThreatMesh {
+  Mesh mesh;
+  Material material;
+  struct Threats shown;
+};
 
-        assert(pieces.grid_positions[cells.cell_piece_indices[N_CELLS - cell_id - 1]].y == position.y);
-      }
-      cell_id++;
+static void
+threat_color(const struct Threats *threats, int square, unsigned char *rgba) {
+  // Each attacking side's colour mixed together, hanging pieces stand out in red
+  Color threat_colors[MAX_PLAYERS] = {SKYBLUE, ORANGE, LIME, PURPLE};
+  Color color = BLANK;
+  int attackers = 0;
+  int r = 0;
+  int g = 0;
+  int b = 0;
+  for (int player = 0; player < MAX_PLAYERS; player++) {
+    if (threats->attacked_by[square] & (1 << player)) {
+      r += threat_colors[player].r;
+      g += threat_colors[player].g;
+      b += threat_colors[player].b;
+      attackers++;
     }
   }
-  assert (cell_id < (N_ROWS*N_COLS) + 1);
-  return pieces;
+  if (attackers > 0) {
+    color = (Color){r / attackers, g / attackers, b / attackers, 90};
+  }
+  if (threats->hanging & SQUARE_BIT(square)) {
+    color = Fade(RED, 0.6f);
+  }
+  for (int vertex = 0; vertex < 4; vertex++) {
+    rgba[(vertex * 4) + 0] = color.r;
+    rgba[(vertex * 4) + 1] = color.g;
+    rgba[(vertex * 4) + 2] = color.b;
+    rgba[(vertex * 4) + 3] = color.a;
+  }
 }
 
-static int
-should_skip_cell(int x,
-                 int y,
-                 int player_sign,
-                 int active_player,
-                 struct Cells cells) {
-  // Filter out moves off the end of the board
-  int position = y + (x * N_COLS);
-  if (x < 0 || y < 0 || x >= N_ROWS || y >= N_COLS) {
-    return BOARD_EDGE;
+static void
+threat_mesh_init(struct ThreatMesh *overlay, const struct Threats *threats) {
+  // raylib frees mesh arrays itself when it unloads them, so they come from MemAlloc
+  Mesh mesh = {0};
+  mesh.vertexCount = N_CELLS * 4;
+  mesh.triangleCount = N_CELLS * 2;
+  mesh.vertices = MemAlloc(mesh.vertexCount * 3 * sizeof (float));
+  mesh.colors = MemAlloc(mesh.vertexCount * 4);
+  mesh.indices = MemAlloc(mesh.triangleCount * 3 * sizeof (unsigned short));
+
+  float half = PIECE_SIZE / 2;
+  for (int square = 0; square < N_CELLS; square++) {
+    Vector3 center = square_positions[square];
+    float corners[4][2] = {{-half, -half}, {-half, half}, {half, half}, {half, -half}};
+    for (int corner = 0; corner < 4; corner++) {
+      float *vertex = &mesh.vertices[((square * 4) + corner) * 3];
+      vertex[0] = center.x + corners[corner][0];
+      vertex[1] = THREAT_OVERLAY_HEIGHT;
+      vertex[2] = center.z + corners[corner][1];
+    }
+    unsigned short first = (unsigned short)(square * 4);
+    unsigned short quad[6] = {first, first + 1, first + 2, first, first + 2, first + 3};
+    memcpy(&mesh.indices[square * 6], quad, sizeof quad);
+    threat_color(threats, square, &mesh.colors[square * 16]);
   }
 
-  // If it's occupied but not by us then we can move to it (and take the piece on it in chess)
+  UploadMesh(&mesh, true);
+  overlay->mesh = mesh;
+  overlay->material = LoadMaterialDefault();
+  overlay->shown = *threats;
+}
 
-  if (cells.cell_player_states[position] == active_player) {
-    return OWN_PIECE;
+static void
+threat_mesh_update(struct ThreatMesh *overlay, const struct Threats *threats) {
+  SquareSet hanging_changed = overlay->shown.hanging ^ threats->hanging;
+  int first = N_CELLS;
+  int last = -1;
+  for (int square = 0; square < N_CELLS; square++) {
+    if (overlay->shown.attacked_by[square] == threats->attacked_by[square] && !(hanging_changed & SQUARE_BIT(square))) {
+      continue;
+    }
+    threat_color(threats, square, &overlay->mesh.colors[square * 16]);
+    first = square < first ? square : first;
+    last = square;
   }
+  overlay->shown = *threats;
 
-  if (cells.cell_player_states[position] != active_player && cells.occupied_states[position] != 0) {
-    return OTHER_PIECE;
+  if (last >= 0) {
+    int offset = first * 16;
+    UpdateMeshBuffer(overlay->mesh, 3, &overlay->mesh.colors[offset], ((last - first) + 1) * 16, offset);
   }
-
-  return NO_COLLISION;
 }
 
-static int
-handle_moving_piece(int piece_size,
-                    int active_cell_to_move_to,
-                    int active_piece_to_move,
-                    int active_player,
-                    int player_sign,
-                    struct ChessPieces active_pieces,
-                    struct Players active_players,
-                    Vector2 active_chess_pos,
-                    struct ChessTypes chess_types,
-                    struct Cells cells) {
+// What the simulation ticks work on, only the simulation thread touches it
+// apart from the three fields the render thread writes for the next tick
+struct PlayState {
+  struct BoardPool *pool;
+  struct Game *game; // the focused board
+  struct Input *input;
+  struct Arena *tick_arena;
+  struct BoardPoolStats board_stats;
+  struct Threats threats; // the focused board's, brought up to date before every publish
+  int active_player;
+  uint64_t tick;
+  float frame_time; // of the last frame, replays keep it. Set by the render thread.
+  uint32_t controls; // input_poll_controls from the render thread
+  int computer; // the seat the computer plays, -1 when people play them all
+  uint32_t computer_move; // from the render thread, Move | ply << 16 of the position it's for, 0 for none
+
+  // Three struct Snapshot, handed from the simulation to the render thread
+  struct TripleBuffer snapshots;
+};
 
-  if (active_pieces.is_dead[active_piece_to_move] == 1) {
-    return 0;
+static void
+play_tick(void *ctx) {
+  // One fixed step of everything: input, the focused board and every so often the other boards
+  struct PlayState *play = ctx;
+  struct Game *game = play->game;
+  struct Input *input = play->input;
+  struct Players active_players = game->players;
+  int active_player = play->active_player;
+
+  // A lockstep replay can be a frame ahead of the render thread noticing it's over
+  if (input_finished(input)) {
+    return;
   }
 
-  int active_piece_type = active_pieces.chess_type[active_piece_to_move];
-  int active_piece_aps = active_pieces.action_points_per_turn[active_piece_to_move];
-
-  assert(active_piece_aps > 0);
+  float frame_time;
+  __atomic_load(&play->frame_time, &frame_time, __ATOMIC_RELAXED);
+  input_begin_tick(input, __atomic_load_n(&play->controls, __ATOMIC_RELAXED), frame_time);
 
-  Vector2 *offsets = chess_types.offsets[active_piece_type];
-  int offsetNum = chess_types.offset_sizes[active_piece_type];
-  Vector2 move_chess_pos;
-
-  int move_to_count = 0;
+  play->tick++;
+  if (play->pool->count > 1 && play->tick % BOARD_UPDATE_TICKS == 0) {
+    play->board_stats = board_pool_update(play->pool);
+  }
 
-  for (int offsetIndex = 0; offsetIndex < offsetNum; offsetIndex++) {
-    Vector2 offset = offsets[offsetIndex];
-    offset.x = offset.x * player_sign;
-    offset.y = offset.y * player_sign;
+  // The computer's move, as long as it's still for the position on the board
+  uint32_t computer_move = __atomic_exchange_n(&play->computer_move, 0, __ATOMIC_ACQ_REL);
+  if (computer_move != 0 &&
+      (computer_move >> 16) == ((uint32_t)game->ply & 0xFFFF) &&
+      game->active_player == play->computer &&
+      !game_over(game)) {
+    Move move = (Move)computer_move;
+    game_move_piece(game, game->cells.cell_piece_indices[MOVE_FROM(move)], MOVE_TO(move));
+    game_next_player(game);
+  }
 
-    // Used to refer to the active chess position in x/y coordinates
-    int origin_x = convert_coord(active_chess_pos.x, N_ROWS);
-    int origin_y = convert_coord(active_chess_pos.y, N_COLS);
+  // Clocks run in game time, a tick at a time
+  game_clock_tick(game, 1000000 / SIM_TICK_RATE);
+
+  // Which way left/right cycles through moves, follows the way the player faces
+  // we will want to orient the camera depending on the player as well
+  Vector2 forward = active_players.forwards[active_player];
+  int player_sign = (int)(forward.x + forward.y);
+
+  // Get the IDs of the cell to move and the possible cell to move to
+  int active_player_state = active_players.player_states[active_player];
+  int active_piece_to_move = active_players.select_to_move_pieces[active_player];
+  int active_cell_to_move_to = active_players.select_to_move_to_cells[active_player];
+
+  // These are set by the controls to say which cell to move to
+  // the names refer to moving in the x or y direction basically
+  int move_count = active_players.select_counts[active_player];
+
+  int col_move_to_forward = calculate_row_move_forward(active_cell_to_move_to, player_sign, move_count, 1);
+  int col_move_to_back = calculate_row_move_backward(active_cell_to_move_to, player_sign, move_count, 1);
+
+  PROFILE_BEGIN(PHASE_NEXT_PIECE);
+  int next_piece_to_move_forward = find_next_piece(active_piece_to_move, active_player, 1, active_players);
+  int next_piece_to_move_backward = find_next_piece(active_piece_to_move, active_player, -1, active_players);
+  PROFILE_END(PHASE_NEXT_PIECE);
+
+  // A frame can run many ticks, give the scratch back every time
+  size_t scratch_mark = arena_mark(play->tick_arena);
+  Square *move_squares = ARENA_ALLOC_ARRAY(play->tick_arena, Square, N_CELLS);
+  PROFILE_BEGIN(PHASE_MOVES);
+  int move_to_count = handle_moving_piece(active_cell_to_move_to,
+                                          active_piece_to_move,
+                                          active_player,
+                                          game,
+                                          active_players,
+                                          move_squares);
+  PROFILE_END(PHASE_MOVES);
+  arena_rewind(play->tick_arena, scratch_mark);
+
+  PROFILE_BEGIN(PHASE_INPUT);
+  // Handle cell movement for different states here
+  switch (active_player_state) {
+    case PIECE_MOVE:
+
+      // Needed to know how to iterate through possible moves
+      active_players.select_counts[active_player] = move_to_count;
+
+      if (input_take(input, INPUT_LEFT)) {
+        // FIXME only select live ones?
+        active_players.select_to_move_to_cells[active_player] = col_move_to_back;
+      }
 
-    int scaled_x = convert_coord(active_chess_pos.x, N_ROWS);
-    int scaled_y = convert_coord(active_chess_pos.y, N_COLS);
+      if (input_take(input, INPUT_RIGHT)) {
+        active_players.select_to_move_to_cells[active_player] = col_move_to_forward;
+      }
 
-    int collision_state = NO_COLLISION;
+      break;
+    case PIECE_SELECTION:
 
-    int found_other = 0;
-    int used_aps = 0;
+      active_players.select_to_move_to_cells[active_player] = 0;
+      active_players.select_counts[active_player] = active_players.live_piece_counts[active_player];
 
-    while ((scaled_x >= 0 && scaled_x < N_ROWS) && (scaled_y >= 0 && scaled_y < N_COLS)) {
-      if (found_other == 1) {
-        break;
+      if (input_take(input, INPUT_LEFT)) {
+        active_players.select_to_move_pieces[active_player] = next_piece_to_move_backward;
       }
 
-      if (used_aps > active_piece_aps) {
-        break;
+      if (input_take(input, INPUT_RIGHT)) {
+        active_players.select_to_move_pieces[active_player] = next_piece_to_move_forward;
       }
 
-      int converted_x = convert_coord(scaled_x, N_ROWS);
-      int converted_y = convert_coord(scaled_y, N_COLS);
-      Vector3 scaled_pos = calculate_position(converted_x, converted_y, piece_size);
-
-      scaled_x = scaled_x + offset.x;
-      scaled_y = scaled_y + offset.y;
+      break;
+  }
 
-      used_aps++;
+  // Against the computer the turn passes by itself
+  if (input_take(input, INPUT_SWITCH_PLAYERS) && play->computer < 0) {
+    printf("Switching players\n");
+    game->active_player = active_player;
+    play->active_player = game_next_player(game);
+    PROFILE_END(PHASE_INPUT);
+    return;
+  }
 
-      if ((collision_state = should_skip_cell(
-                         convert_coord(converted_x, N_ROWS),
-                         convert_coord(converted_y, N_COLS),
-                         player_sign,
-                         active_player,
-                         cells))) {
+  // Nobody moves once the game is decided, switching players still works to look around
+  if (game_over(game)) {
+    PROFILE_END(PHASE_INPUT);
+    return;
+  }
 
-        // Check if it's the origin piece first
+  // Handle switching modes here
+  if (input_take(input, INPUT_TRIGGER)) {
+    if (active_player_state == PIECE_MOVE) {
+      active_player_state = active_players.player_states[active_player] = PIECE_SELECTION;
+    }
+    else if (move_count > 0) {
+      active_player_state = active_players.player_states[active_player] = PIECE_MOVE;
+    }
+  }
 
-        if (((scaled_x - offset.x) == origin_x && (scaled_y - offset.y) == origin_y)) {
-         continue;
-        }
-        // Make sure to check if it's our own piece but only after checking if it's the origin
-        else if (collision_state == OWN_PIECE) {
-          break;
-        }
-        else if (collision_state == OTHER_PIECE) {
-          found_other = 1;
-        }
-        else {
-          break;
-        }
+  // Handle moving a piece to a new cell here
+  if (input_take(input, INPUT_SELECT)) {
+    int our_turn = play->computer < 0 || game->active_player == active_player;
+    if (active_player_state == PIECE_MOVE && move_count > 0 && our_turn) {
+      Square square_to = active_players.select_to_move_to_squares[active_player];
+      game_move_piece(game, active_piece_to_move, square_to);
+      if (play->computer >= 0) {
+        game_next_player(game);
       }
 
-      // have to select the *previous* one
-      move_chess_pos.x = convert_coord(scaled_x - offset.x, N_ROWS);
-      move_chess_pos.y = convert_coord(scaled_y - offset.y, N_COLS);
+      // and reset the mode back to piece selection
+      active_player_state = active_players.player_states[active_player] = PIECE_SELECTION;
 
-      if (move_to_count == active_cell_to_move_to) {
-        DrawCube(scaled_pos, 5, 0.1f, 5, BLUE);
-        active_players.select_to_move_to_chess_positions[active_player] = move_chess_pos;
-      }
-      else {
-        DrawCube(scaled_pos, 5, 0.1f, 5, GREEN);
-      }
+    }
+  }
+  PROFILE_END(PHASE_INPUT);
+}
 
-      move_to_count++;
+static void
+run_tick(void *ctx) {
+  PROFILE_SCOPE(PHASE_TICK) {
+    play_tick(ctx);
+  }
+}
 
+// Where the piece can capture and come out behind once the other side takes back. Only two
+// player games fit in a struct Position, the rest never get any.
+static SquareSet
+losing_captures(const struct Game *game, int piece) {
+  if (game->num_players != 2) {
+    return 0;
+  }
+  struct Position pos;
+  position_from_game(&pos, &game->pieces, game->num_pieces, game->pieces.owners[piece]);
+
+  Move captures[POSITION_MAX_MOVES];
+  int count = position_generate_captures(&pos, captures);
+  Square from = game->pieces.squares[piece];
+  SquareSet losing = 0;
+  for (int i = 0; i < count; i++) {
+    Move move = captures[i];
+    if (MOVE_FROM(move) == from && (MOVE_FLAGS(move) & MOVE_CAPTURE) && position_see_losing(&pos, move)) {
+      losing |= SQUARE_BIT(MOVE_TO(move));
     }
   }
+  return losing;
+}
 
-  return move_to_count;
+static void
+publish_snapshot(void *ctx, const struct Simulation *sim, double tick_time) {
+  // Runs on the simulation thread after its ticks, copies out what the next frames draw
+  struct PlayState *play = ctx;
+  struct Game *game = play->game;
+  struct Players active_players = game->players;
+  struct Snapshot *snapshot = triple_buffer_back(&play->snapshots);
+  PROFILE_BEGIN(PHASE_PUBLISH);
+
+  snapshot->tick = play->tick;
+  snapshot->tick_time = tick_time;
+  snapshot->sim_mode = sim->mode;
+  snapshot->ticks_per_publish = sim->ticks_last_frame;
+  snapshot->finished = input_finished(play->input);
+  snapshot->board_stats = play->board_stats;
+
+  int active_player = play->active_player;
+  int active_piece_to_move = active_players.select_to_move_pieces[active_player];
+  snapshot->active_move = active_players.select_to_move_to_cells[active_player];
+  snapshot->selected_square = SQUARE_NONE;
+  snapshot->move_count = 0;
+  snapshot->losing_moves = 0;
+  if (game->pieces.is_dead[active_piece_to_move] == 0) {
+    snapshot->selected_square = game->pieces.squares[active_piece_to_move];
+    snapshot->move_count = game_piece_moves(game, active_piece_to_move, snapshot->move_squares);
+    snapshot->losing_moves = losing_captures(game, active_piece_to_move);
+  }
+  // Players here hand the turn over themselves, so the game's status can be for somebody else
+  snapshot->status = game_over(game) ? game->status : game_player_status(game, active_player);
+  threats_update(&play->threats, game->attacks, game);
+  snapshot->threats = play->threats;
+
+  snapshot->ply = game->ply;
+  snapshot->has_position = game->num_players == 2;
+  if (snapshot->has_position) {
+    position_from_game(&snapshot->position, &game->pieces, game->num_pieces, game->active_player);
+  }
+  snapshot->game_over = game_over(game);
+  snapshot->computer_to_move = play->computer >= 0 && game->active_player == play->computer && !snapshot->game_over;
+  snapshot->clock = game->clock;
+  snapshot->clock_player = game->active_player;
+
+  for (int board = 0; board < play->pool->count; board++) {
+    size_t first = (size_t)board * snapshot->pieces_per_board;
+    copy_pieces(play->pool->games[board],
+                &snapshot->squares[first],
+                &snapshot->types[first],
+                &snapshot->colors[first]);
+  }
+
+  PROFILE_END(PHASE_PUBLISH);
+  triple_buffer_publish(&play->snapshots);
 }
 
-static int
-clamp(int d, int min, int max) {
-  const int t = d < min ? min : d;
-  return t > max ? max : t;
+// The computer's side of the focused board. It searches on the render thread a slice after
+// every frame is drawn, so thinking never holds a frame up and doesn't need a thread.
+//
+// Once it has moved it ponders through the other side's turn: it searches the position after
+// the reply it expects with the same limits as a move of its own. If that reply is played
+// (a ponderhit) the search just carries on from where it got to, or answers straight away if
+// it already finished. Any other reply throws the search away, but the table and move
+// history it filled stay, which moves the next search's node count a percent or so either way.
+//
+// On a clock the time manager decides when it's done thinking, starting from when the
+// position comes up. Time spent pondering comes free, so pondering only stops for a miss.
+enum ComputerState {
+  COMPUTER_IDLE,
+  COMPUTER_THINKING, // on a position it has to move in
+  COMPUTER_PONDERING // on one it expects to have to move in
+};
+
+struct Computer {
+  struct Search search;
+  struct Tt tt;
+  struct TimeManager time;
+  int seat;
+  int state;
+  int ply; // of the position it was last asked to move in, -1 before the first
+  uint64_t ponder_hash; // the position it's pondering on
+  int ponder_hits;
+  int ponder_misses;
+  double asked_at; // when the position it's thinking on came up, for the latency
+  int frames; // it has thought for on this move
+  double slice_us; // the last slice took
+};
+
+// What its own moves are searched with, starting the time manager when there's a clock
+static struct SearchLimits
+computer_limits(struct Computer *computer, const struct Snapshot *snapshot) {
+  if (!snapshot->clock.running) {
+    return (struct SearchLimits){.depth = COMPUTER_DEPTH, .nodes = COMPUTER_NODES};
+  }
+  struct TimeControl control = {
+    .remaining_us = snapshot->clock.remaining_us[computer->seat],
+    .increment_us = snapshot->clock.increment_us,
+    .moves_to_go = game_clock_moves_to_go(&snapshot->clock, computer->seat)
+  };
+  time_manager_start(&computer->time, &control, COMPUTER_MOVE_OVERHEAD_US);
+  return (struct SearchLimits){.depth = SEARCH_MAX_PLY - 1, .time = &computer->time};
 }
 
+static void
+computer_ponder(struct Computer *computer, const struct Snapshot *snapshot) {
+  struct Search *search = &computer->search;
+  Move reply = search_ponder_move(search);
+  if (search->best_move == MOVE_NONE || reply == MOVE_NONE) {
+    computer->state = COMPUTER_IDLE;
+    return;
+  }
 
-static int
-calculate_row_move_forward(int active_cell_to_move_to, int player_sign, int move_count, int n_rows) {
-  if (move_count <= 0) {
-    return 0;
+  struct Position after;
+  struct Position expected;
+  position_copy_make(&after, &search->pos, search->best_move);
+  position_copy_make(&expected, &after, reply);
+  struct SearchLimits limits = {.depth = COMPUTER_DEPTH, .nodes = COMPUTER_NODES};
+  if (snapshot->clock.running) {
+    limits = (struct SearchLimits){.depth = SEARCH_MAX_PLY - 1};
   }
-  return clamp(active_cell_to_move_to + (player_sign * n_rows) % move_count, 0, move_count - 1);
+  search_set_position(search, &expected);
+  search_start(search, &limits);
+  computer->ponder_hash = expected.hash;
+  computer->state = COMPUTER_PONDERING;
 }
 
-static int
-calculate_row_move_backward(int active_cell_to_move_to, int player_sign, int move_count, int n_rows) {
-  if (move_count <= 0) {
-    return 0;
+static void
+computer_think(struct Computer *computer, struct PlayState *play, const struct Snapshot *snapshot) {
+  struct Search *search = &computer->search;
+  // Nothing to think about once it's the other side's turn after all, or the game's over,
+  // a stalemate included, since a ponder search would go on for a position that can't come up
+  if ((!snapshot->computer_to_move && computer->state == COMPUTER_THINKING) || snapshot->game_over) {
+    search_stop(search);
+    computer->state = COMPUTER_IDLE;
+  }
+
+  if (snapshot->computer_to_move && snapshot->ply != computer->ply) {
+    computer->ply = snapshot->ply;
+    computer->asked_at = sim_now();
+    computer->frames = 0;
+    struct SearchLimits limits = computer_limits(computer, snapshot);
+    if (computer->state == COMPUTER_PONDERING && snapshot->position.hash == computer->ponder_hash) {
+      computer->ponder_hits++;
+      search_set_time(search, limits.time);
+    }
+    else {
+      computer->ponder_misses += computer->state == COMPUTER_PONDERING;
+      search_stop(search);
+      search_set_position(search, &snapshot->position);
+      search_start(search, &limits);
+    }
+    computer->state = COMPUTER_THINKING;
+  }
+
+  if (computer->state == COMPUTER_IDLE) {
+    return;
+  }
+  // Pondering can finish long before the reply comes, then there's nothing to do until it does
+  if (search->running) {
+    double start = sim_now();
+    search_slice(search, COMPUTER_SLICE_US);
+    computer->slice_us = (sim_now() - start) * 1e6;
+    computer->frames++;
+  }
+
+  if (computer->state == COMPUTER_THINKING && !search->running) {
+    printf("computer: depth %d score %d, %llu nodes, answered in %.1fms over %d frames (%d ponderhits, %d misses)\n",
+           search->depth,
+           search->score,
+           (unsigned long long)search->nodes,
+           (sim_now() - computer->asked_at) * 1000.0,
+           computer->frames,
+           computer->ponder_hits,
+           computer->ponder_misses);
+    uint32_t move = (uint32_t)search->best_move | (((uint32_t)computer->ply & 0xFFFF) << 16);
+    __atomic_store_n(&play->computer_move, move, __ATOMIC_RELEASE);
+    computer_ponder(computer, snapshot);
   }
-  return clamp(active_cell_to_move_to - (player_sign * n_rows) % move_count, 0, move_count - 1);
 }
 
-static int
-find_next_piece(int active_piece_to_move,
-                int active_player,
-                int direction,
-                struct Cells cells,
-                struct ChessPieces pieces) {
-  // Cycles through all your active pieces
-  // TODO: use a quadtree to do this as well for the mouse
-  assert(active_piece_to_move < 16);
-
-  if (direction == 1) {
-    for (int i = active_piece_to_move; i < N_PIECES; i++) {
-      if (pieces.is_dead[i+1] != 1 && (i+1 < N_PIECES)) {
-        return clamp(i+1, 0, N_PIECES-1);
-      }
+// An arrow for the first move of each of the engine's best lines, the best one widest
+static void
+draw_analysis_arrows(const struct AnalysisReport *report) {
+  Color line_colors[SEARCH_MAX_LINES] = {DARKGREEN, DARKBLUE, PURPLE, GRAY};
+  for (int i = report->line_count - 1; i >= 0; i--) {
+    const struct AnalysisLine *line = &report->lines[i];
+    if (line->length == 0) {
+      continue;
     }
+    Vector3 from = square_positions[MOVE_FROM(line->moves[0])];
+    Vector3 to = square_positions[MOVE_TO(line->moves[0])];
+    from.y = ANALYSIS_ARROW_HEIGHT;
+    to.y = ANALYSIS_ARROW_HEIGHT;
+    Vector3 head = Vector3Subtract(to, Vector3Scale(Vector3Normalize(Vector3Subtract(to, from)), PIECE_SIZE / 3));
+    float width = 0.5f - (0.1f * i);
+    Color color = Fade(line_colors[i], 0.8f);
+    DrawCylinderEx(from, head, width, width, 8, color);
+    DrawCylinderEx(head, to, width * 3, 0.0f, 8, color);
   }
-  else if (direction == -1) {
-    for (int i = active_piece_to_move; i > 0; i--) {
-      if (pieces.is_dead[i-1] != 1 && (i-1 >= 0)) {
-        return clamp(i-1, 0, N_PIECES-1);
-      }
+}
+
+static void
+draw_focused_board(const struct Snapshot *snapshot,
+                   const struct Tweens *tweens,
+                   int board,
+                   struct ChessTypes chess_types) {
+  // Get the position of the currently selected cell and highlight it red
+  if (snapshot->selected_square != SQUARE_NONE) {
+    Vector3 highlight_pos = square_positions[snapshot->selected_square];
+    highlight_pos.y = 0; // Setting the height of it
+    DrawCube(highlight_pos, 5, 0.1f, 5, RED);
+  }
+  else {
+    // TODO
+    // We have selected a dead piece, reset to the first live piece
+  }
+
+  for (int i = 0; i < snapshot->move_count; i++) {
+    Square square = snapshot->move_squares[i];
+    Color highlight_color = GREEN;
+    if (i == snapshot->active_move) {
+      highlight_color = BLUE;
+    }
+    else if (snapshot->losing_moves & SQUARE_BIT(square)) {
+      highlight_color = MAROON;
     }
+    DrawCube(square_positions[square], 5, 0.1f, 5, highlight_color);
+  }
+
+  int first = board * snapshot->pieces_per_board;
+  for (int i = 0; i < snapshot->pieces_per_board; i++) {
+    draw_piece(snapshot, tweens, first + i, chess_types, Vector3Zero());
+  }
+}
+
+static void
+usage(const char *program) {
+  printf("usage: %s [--boards N] [--players 2-%d] [--threads N] [--pieces FILE] [--level FILE.lvl] [--log FILE] [--record FILE | --replay FILE] [--fast-forward] [--computer SEAT] [--clock [MOVES/]SECONDS[+INCREMENT]]\n", program, MAX_PLAYERS);
+}
+
+// Like 300+2, or 40/5400 for 40 moves in 90 minutes then the same again. Seconds can have
+// fractions, 0 moves is all of them.
+static int
+parse_clock(const char *text, int *moves, double *seconds, double *increment) {
+  *moves = 0;
+  *increment = 0.0;
+  const char *slash = strchr(text, '/');
+  if (slash != NULL) {
+    *moves = atoi(text);
+    text = slash + 1;
+  }
+  char *end;
+  *seconds = strtod(text, &end);
+  if (*end == '+') {
+    *increment = strtod(end + 1, &end);
+  }
+  return (*end == '\0' && *seconds > 0.0 && *moves >= 0 && *increment >= 0.0) ? 0 : -1;
+}
+
+// Every player's time along the bottom, the one that's running in black
+static void
+draw_clocks(const struct Snapshot *snapshot, int num_players) {
+  const struct GameClock *clock = &snapshot->clock;
+  int y = GetScreenHeight() - 30;
+  for (int player = 0; player < num_players; player++) {
+    int64_t tenths = clock->remaining_us[player] / 100000;
+    Color color = player == clock->flagged ? RED : (player == snapshot->clock_player ? BLACK : GRAY);
+    DrawText(TextFormat("%d  %d:%02d.%d",
+                        player,
+                        (int)(tenths / 600),
+                        (int)((tenths / 10) % 60),
+                        (int)(tenths % 10)),
+             20 + (110 * player), y, 20, color);
   }
-  return active_piece_to_move; // If we didn't find anything return the original cell, can't return 0 because it could be invalid!
 }
 
 int
-main(void)
+main(int argc, char **argv)
 {
+    int num_boards = 1;
+    int num_players = NUM_PLAYERS;
+    int num_threads = 0; // one per cpu
+    const char *pieces_path = "resources/pieces/chess.txt";
+    const char *level_path = NULL; // baked by `make levels`
+    const char *log_path = NULL; // every game played gets appended to it
+    int input_mode = INPUT_LIVE;
+    const char *input_path = NULL; // session to record or replay, replay with the same flags it was recorded with
+    int fast_forward = 0; // F toggles it while running
+    int computer_seat = -1; // the computer plays it, two player games only
+    int clock_moves = 0; // per time control, 0 is the whole game
+    double clock_seconds = 0.0; // 0 plays without a clock
+    double clock_increment = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "--boards") == 0 && i + 1 < argc) {
+        num_boards = atoi(argv[++i]);
+      }
+      else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+        num_players = atoi(argv[++i]);
+      }
+      else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+        num_threads = atoi(argv[++i]);
+      }
+      else if (strcmp(argv[i], "--pieces") == 0 && i + 1 < argc) {
+        pieces_path = argv[++i];
+      }
+      else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+        level_path = argv[++i];
+      }
+      else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+        log_path = argv[++i];
+      }
+      else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+        input_mode = INPUT_RECORD;
+        input_path = argv[++i];
+      }
+      else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+        input_mode = INPUT_REPLAY;
+        input_path = argv[++i];
+      }
+      else if (strcmp(argv[i], "--fast-forward") == 0) {
+        fast_forward = 1;
+      }
+      else if (strcmp(argv[i], "--computer") == 0 && i + 1 < argc) {
+        computer_seat = atoi(argv[++i]);
+      }
+      else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+        if (parse_clock(argv[++i], &clock_moves, &clock_seconds, &clock_increment) != 0) {
+          usage(argv[0]);
+          return 2;
+        }
+      }
+      else {
+        usage(argv[0]);
+        return 2;
+      }
+    }
+
+    if (num_boards < 1 || num_players < 2 || num_players > MAX_PLAYERS) {
+      usage(argv[0]);
+      return 2;
+    }
+
+    // How every piece type moves, compiled into lookup tables before any game exists
+    if (piece_rules_load(pieces_path) != 0) {
+      return 1;
+    }
+
+    struct Input input;
+    if (input_open(&input, input_mode, input_path) != 0) {
+      return 1;
+    }
 
-    int q_size = next_pow2(next_pow2(N_CELLS*2+1) + 1); // add 1 for the root node
-    // Quad-Tree stuff
-    Vector2 quad_sizes_buf[q_size];
-    Vector3 quad_positions_buf[q_size];
-    int quad_piece_indices_buf[q_size];
-    int top_left_quad_children[q_size];
-    int top_right_quad_children[q_size];
-    int bottom_left_quad_children[q_size];
-    int bottom_right_quad_children[q_size];
+    // Every board shares the one mapping, the level decides how many players there are
+    struct Level level = {0};
+    if (level_path != NULL) {
+      if (level_map(&level, level_path) != 0) {
+        return 1;
+      }
+      num_players = level.num_players;
+    }
 
-    struct QItem queue[q_size];
+    // The computer's moves come whenever it's done thinking, a replay couldn't play them back
+    if (computer_seat >= 0 && (num_players != 2 || computer_seat > 1 || input_mode != INPUT_LIVE)) {
+      printf("--computer plays seat 0 or 1 of a two player game, and not while recording or replaying\n");
+      return 2;
+    }
+    // Fast forward runs the clocks faster than the computer's thinking
+    int computer_on_clock = computer_seat >= 0 && clock_seconds > 0.0;
+    if (computer_on_clock && fast_forward) {
+      printf("--fast-forward can't be used with the computer on a clock\n");
+      return 2;
+    }
 
     const int screenWidth = 800;
     const int screenHeight = 450;
@@ -521,282 +957,198 @@ main(void)
 
     load_assets();
 
-    SetTargetFPS(60);
+    // Replays are for timing frames, so let them run as fast as they can
+    SetTargetFPS(input_mode == INPUT_REPLAY ? 0 : TARGET_FPS);
 
     // Piece type stuff
     struct ChessTypes chess_types = {
       .textures = &piece_textures[0],
       .models = &piece_models[0],
       .scaling_factors = &piece_scaling_factors[0],
-      .offset_sizes = &offset_sizes[0],
-      .offsets = &offsets[0],
     };
 
-    memset(&white_piece_cell_indices[0], -1, (sizeof white_piece_cell_indices));
-    // Gameplay piece stuff
-    struct ChessPieces white_pieces = {
-      .grid_positions = &white_grid_positions[0],
-      .chess_positions = &white_chess_positions[0],
-      .is_dead = &white_pieces_dead[0],
-      .chess_type = &white_starting_pieces[0],
-      .colors = &white_colors[0], // later on, a player could have differently colored pieces
-      .action_points_per_turn = &white_starting_aps[0],
-      .piece_cell_indices = &white_piece_cell_indices[0]
-    };
-
-    memset(&black_piece_cell_indices[0], -1, (sizeof black_piece_cell_indices));
-    struct ChessPieces black_pieces = {
-      .grid_positions = &black_grid_positions[0],
-      .chess_positions = &black_chess_positions[0],
-      .is_dead = &black_pieces_dead[0],
-      .chess_type = &black_starting_pieces[0],
-      .colors = &black_colors[0], // later on, a player could have differently colored pieces
-      .action_points_per_turn = &black_starting_aps[0],
-      .piece_cell_indices = &black_piece_cell_indices[0]
-    };
+    build_square_positions(&square_positions[0], PIECE_SIZE);
 
-    // TODO, load these from data, set the size when it loads the players in a level
-    // this is kind of like a "pivot" table I think, it helps map from player to their piece sets
-    struct ChessPieces pieces[2] = {white_pieces, black_pieces};
-    int piece_indices[2] = {0, 1}; // indices mapping to different sets of pieces
-    int num_players = (sizeof pieces) / (sizeof (struct ChessPieces));
-
-    // Player type stuff
-
-    int score[2] = {0, 0};
-    // TODO allocate these from an arena for variable number of players (and bots / NPCs later)
-    PlayerType active_players_buf[2] = {WHITE_PLAYER, BLACK_PLAYER};
-
-    // Tracks the state a player is currently in
-    PlayerState player_states_buf[2] = {PIECE_SELECTION, PIECE_SELECTION};
-    int select_to_move_pieces_buf[2] = {0, 0};
-    int live_piece_counts_buf[2] = {N_PIECES, N_PIECES}; // start out being able to select any piece
-    int select_to_move_to_cells_buf[2] = {-1, -1};
-    Vector2 select_to_move_to_chess_positions_buf[2] = {{0},{0}};
-
-    struct Players active_players = {
-      .score = &score[0],
-      .select_to_move_pieces = &select_to_move_pieces_buf[0],
-      .select_to_move_to_cells = &select_to_move_to_cells_buf[0],
-      .select_to_move_to_chess_positions = &select_to_move_to_chess_positions_buf[0],
-      .live_piece_counts = &live_piece_counts_buf[0],
-      .player_type = &active_players_buf[0],
-      .piece_indices = &piece_indices[0],
-      .player_states = &player_states_buf[0]
-    };
+    // Every board's game comes out of the pool, scratch that only lives for a tick out of tick_arena
+    struct BoardPool board_pool;
+    if (board_pool_init(&board_pool, num_boards, num_players, level_path != NULL ? &level : NULL, num_threads) != 0) {
+      printf("could not set up %d boards\n", num_boards);
+      return 1;
+    }
+    struct Arena tick_arena;
+    arena_init(&tick_arena, &tick_memory[0], sizeof tick_memory);
 
-    // Cell stuff
-    memset(&cell_player_states[0], -1, (sizeof cell_player_states));
-    struct Cells cells = {
-      .occupied_states = &occupied_states[0],
-      .cell_player_states = &cell_player_states[0],
-      .cell_piece_indices = &cell_piece_indices[0]
-    };
+    struct GameLogWriter game_log;
+    if (log_path != NULL) {
+      if (game_log_writer_open(&game_log, log_path) != 0 || board_pool_attach_log(&board_pool, &game_log) != 0) {
+        return 1;
+      }
+    }
 
-    set_pieces(white_pieces, cells, active_players, PIECE_SIZE, TOP_SIDE, WHITE_PLAYER);
-    set_pieces(black_pieces, cells, active_players, PIECE_SIZE, BOTTOM_SIDE, BLACK_PLAYER);
+    // Board 0 is the one we play on
+    struct Game *game = board_pool.games[board_pool.focused];
+    printf("%d boards on %d threads, %zu bytes per game\n",
+           num_boards,
+           board_pool.threads.num_threads,
+           game->memory_used);
+    if (clock_seconds > 0.0) {
+      game_clock_set(game, (int64_t)(clock_seconds * 1e6), (int64_t)(clock_increment * 1e6), clock_moves);
+    }
 
-    int active_player = BLACK_PLAYER;
+    int tiles_per_row = (int)ceilf(sqrtf((float)num_boards));
+
+    static struct PlayState play;
+    play.pool = &board_pool;
+    play.game = game;
+    play.input = &input;
+    play.tick_arena = &tick_arena;
+    play.active_player = game->active_player;
+    play.computer = computer_seat;
+    if (computer_seat >= 0) {
+      play.active_player = (computer_seat + 1) % num_players;
+    }
 
-    // This is specific to chess moves because they are inverted for either side
-    // In some other cell based game, this could be based on a direction variable instead
-    // we will want to orient the camera depending on the player as well
-    int player_sign = active_player == BLACK_PLAYER ? -1 : 1;
+    // Only set up when it's playing, the search and its table are the biggest things around
+    static struct Computer computer;
+    computer.state = COMPUTER_IDLE;
+    computer.seat = computer_seat;
+    computer.ply = -1;
+    if (computer_seat >= 0) {
+      struct Arena tt_arena;
+      void *tt_memory = malloc(COMPUTER_TT_BYTES);
+      arena_init(&tt_arena, tt_memory, tt_memory != NULL ? COMPUTER_TT_BYTES : 0);
+      if (tt_init(&computer.tt, &tt_arena, COMPUTER_TT_BYTES) != 0) {
+        printf("out of memory for the computer's table\n");
+        return 1;
+      }
+      search_init(&computer.search, &computer.tt, NULL);
+    }
 
-    float time_since_move = 0;
+    // Set up the first time L is pressed, the table stays for the whole session after that
+    static struct Search analysis_search;
+    static struct Tt analysis_tt;
+    static struct Analysis analysis;
+    int analysis_ready = 0;
+    int show_analysis = 0;
+
+    static struct Snapshot snapshots[3];
+    for (int i = 0; i < 3; i++) {
+      if (snapshot_init(&snapshots[i], num_boards, game->num_pieces) != 0) {
+        printf("out of memory for %d boards\n", num_boards);
+        return 1;
+      }
+    }
+    triple_buffer_init(&play.snapshots, &snapshots[0], &snapshots[1], &snapshots[2]);
+
+    // The game runs on its own thread from here on, this one polls input and draws snapshots.
+    // Replays step exactly one tick a frame so their frame times line up from run to run.
+    int sim_mode = input_mode == INPUT_REPLAY ? SIM_LOCKSTEP : (fast_forward ? SIM_FAST_FORWARD : SIM_REALTIME);
+    struct SimThread sim_thread;
+    if (sim_thread_start(&sim_thread, sim_mode, TARGET_FPS, run_tick, publish_snapshot, &play) != 0) {
+      return 1;
+    }
 
-    struct Quads qtree = {
-      .quad_sizes = &quad_sizes_buf[0],
-      .quad_positions = &quad_positions_buf[0],
-      .piece_indices = &quad_piece_indices_buf[0],
-      .top_left = &top_left_quad_children[0],
-      .top_right = &top_right_quad_children[0],
-      .bottom_left = &bottom_left_quad_children[0],
-      .bottom_right = &bottom_right_quad_children[0]
+#ifdef PROFILER
+    int show_profiler = 1;
+#endif
+
+    // Piece animations run on this thread off the snapshots, one tween slot for every piece
+    const struct Snapshot *snapshot = triple_buffer_read(&play.snapshots);
+    int num_keys = num_boards * game->num_pieces;
+    void *tween_memory = malloc(TWEENS_ARENA_SIZE(num_keys));
+    struct Animations animations = {
+      .shown_squares = malloc(num_keys * sizeof (Square)),
+      .tick = snapshot->tick
     };
+    struct Arena tween_arena;
+    arena_init(&tween_arena, tween_memory, tween_memory != NULL ? TWEENS_ARENA_SIZE(num_keys) : 0);
+    animations.tweens = tweens_create(&tween_arena, num_keys);
+    if (animations.tweens == NULL || animations.shown_squares == NULL) {
+      printf("out of memory for %d boards\n", num_boards);
+      return 1;
+    }
+    memcpy(animations.shown_squares, snapshot->squares, num_keys * sizeof (Square));
 
-    initialize_qtree(qtree, queue, q_size);
-
-    while (!WindowShouldClose()) {
-      player_sign = active_player == BLACK_PLAYER ? -1 : 1; // FIXME doesn't work for more than 2 players
-      rlTPCameraUpdate(&orbitCam);
-
-      BeginDrawing();
-
-          ClearBackground(RAYWHITE);
+    // T shows what each side attacks on the focused board and which pieces are hanging
+    struct ThreatMesh threat_overlay;
+    threat_mesh_init(&threat_overlay, &snapshot->threats);
+    int show_threats = 0;
 
-          rlTPCameraBeginMode3D(&orbitCam);
+    while (!WindowShouldClose() && !snapshot->finished) {
+      PROFILE_BEGIN(PHASE_FRAME);
+      PROFILE_SCOPE(PHASE_CAMERA) {
+        rlTPCameraUpdate(&orbitCam);
+      }
 
-              Vector2 mousePos = GetMousePosition();
-              float targetWorldZ = 0.0f;
-              Vector3 worldPos = rlTPCameraGetScreenToWorld(&orbitCam, mousePos, targetWorldZ);
+      if (fast_forward_control() && sim_mode != SIM_LOCKSTEP && !computer_on_clock) {
+        sim_mode = sim_mode == SIM_FAST_FORWARD ? SIM_REALTIME : SIM_FAST_FORWARD;
+        sim_thread_set_mode(&sim_thread, sim_mode);
+      }
 
-              //print_vec3(worldPos);
+      if (threat_overlay_control()) {
+        show_threats = !show_threats;
+      }
 
-              struct ChessPieces active_pieces = pieces[active_players.piece_indices[active_player]];
+      if (analysis_control() && snapshot->has_position) {
+        if (!analysis_ready) {
+          struct Arena tt_arena;
+          void *tt_memory = malloc(ANALYSIS_TT_BYTES);
+          arena_init(&tt_arena, tt_memory, tt_memory != NULL ? ANALYSIS_TT_BYTES : 0);
+          analysis_ready = tt_init(&analysis_tt, &tt_arena, ANALYSIS_TT_BYTES) == 0;
+          search_init(&analysis_search, &analysis_tt, NULL);
+        }
+        show_analysis = analysis_ready && !show_analysis;
+        if (show_analysis && analysis_start(&analysis, &analysis_search, ANALYSIS_LINES) != 0) {
+          show_analysis = 0;
+        }
+        else if (analysis_ready) {
+          analysis_stop(&analysis);
+        }
+      }
 
-              // Get the IDs of the cell to move and the possible cell to move to
-              int active_player_state = active_players.player_states[active_player];
-              int active_piece_to_move = active_players.select_to_move_pieces[active_player];
-              int active_cell_to_move_to = active_players.select_to_move_to_cells[active_player];
-              Vector2 active_chess_pos = active_pieces.chess_positions[active_piece_to_move];
+      float frame_time = GetFrameTime();
+      __atomic_store(&play.frame_time, &frame_time, __ATOMIC_RELAXED);
+      __atomic_store_n(&play.controls, input_poll_controls(), __ATOMIC_RELAXED);
+      sim_thread_frame(&sim_thread, frame_time);
+
+      snapshot = triple_buffer_read(&play.snapshots);
+      const struct AnalysisReport *report = NULL;
+      if (show_analysis) {
+        analysis_set_position(&analysis, &snapshot->position);
+        report = analysis_read(&analysis);
+        // Lines for the position before a move would point at pieces that have gone
+        report = report->hash == snapshot->position.hash ? report : NULL;
+      }
+      PROFILE_SCOPE(PHASE_ANIMATE) {
+        // Tweens start from when the tick really happened, not when this frame noticed it
+        if (snapshot->tick != animations.tick) {
+          animate_snapshot(&animations, snapshot, sim_alpha(snapshot->tick_time, sim_now()) * (float)SIM_TIMESTEP);
+        }
+        tweens_update(animations.tweens, frame_time);
+      }
 
-              // Get the position of the currently selected cell and highlight it red
-              if (active_pieces.is_dead[active_piece_to_move] == 0) {
-                Vector3 highlight_pos = active_pieces.grid_positions[active_piece_to_move];
-                highlight_pos.y = 0; // Setting the height of it
-                DrawCube(highlight_pos, 5, 0.1f, 5, RED);
-              }
-              else {
-                // TODO
-                // We have selected a dead piece, reset to the first live piece
-              }
+      BeginDrawing();
 
-              // These are set by the controls to say which cell to move to
-              // the names refer to moving in the x or y direction basically
-              int move_count = active_players.live_piece_counts[active_player];
-
-              int col_move_to_forward = calculate_row_move_forward(active_cell_to_move_to, player_sign, move_count, 1);
-              int col_move_to_back = calculate_row_move_backward(active_cell_to_move_to, player_sign, move_count, 1);
-
-              int next_piece_to_move_forward = find_next_piece(active_piece_to_move, active_player, 1, cells, active_pieces);
-              int next_piece_to_move_backward = find_next_piece(active_piece_to_move, active_player, -1, cells, active_pieces);
-
-              int move_to_count = 0;
-              move_to_count = handle_moving_piece(PIECE_SIZE,
-                                                  active_cell_to_move_to,
-                                                  active_piece_to_move,
-                                                  active_player,
-                                                  player_sign,
-                                                  active_pieces,
-                                                  active_players,
-                                                  active_chess_pos,
-                                                  chess_types,
-                                                  cells);
-
-              // Handle cell movement for different states here
-              switch (active_player_state) {
-                case PIECE_MOVE:
-
-                  // Needed to know how to iterate through possible moves
-                  active_players.live_piece_counts[active_player] = move_to_count;
-
-                  if (left_x_left_control() && time_since_move >= 0.2f) {
-                    // FIXME only select live ones?
-                    active_players.select_to_move_to_cells[active_player] = col_move_to_back;
-                    time_since_move = 0.0f;
-                  }
-
-                  if (left_x_right_control() && time_since_move >= 0.2f) {
-                    active_players.select_to_move_to_cells[active_player] = col_move_to_forward;
-                    time_since_move = 0.0f;
-                  }
-
-                  break;
-                case PIECE_SELECTION:
-
-                  active_players.select_to_move_to_cells[active_player] = 0;
-                  active_players.live_piece_counts[active_player] = N_PIECES;
-
-                  if (left_x_left_control() && time_since_move >= 0.2f) {
-                    active_players.select_to_move_pieces[active_player] = next_piece_to_move_backward;
-                    time_since_move = 0.0f;
-                  }
-
-                  if (left_x_right_control() && time_since_move >= 0.2f) {
-                    active_players.select_to_move_pieces[active_player] = next_piece_to_move_forward;
-                    time_since_move = 0.0f;
-                  }
-
-                  break;
-              }
+          ClearBackground(RAYWHITE);
 
-              if (switch_players_control() && time_since_move >= 0.2f) {
-                printf("Switching players\n");
-                active_player = (active_player + 1) % NUM_PLAYERS;
-                time_since_move = 0.0f;
-                continue;
-              }
+          rlTPCameraBeginMode3D(&orbitCam);
 
-              // Handle switching modes here
-              if (trigger_control() && time_since_move >= 0.2f) {
-                if (active_player_state == PIECE_MOVE) {
-                  active_player_state = active_players.player_states[active_player] = PIECE_SELECTION;
-                }
-                else if (move_count > 0) {
-                  active_player_state = active_players.player_states[active_player] = PIECE_MOVE;
-                }
-                time_since_move = 0.0f;
+              PROFILE_BEGIN(PHASE_DRAW_PIECES);
+              draw_focused_board(snapshot, animations.tweens, board_pool.focused, chess_types);
+              if (show_threats) {
+                threat_mesh_update(&threat_overlay, &snapshot->threats);
+                DrawMesh(threat_overlay.mesh, threat_overlay.material, MatrixIdentity());
               }
-
-              // Handle moving a piece to a new cell here
-              if (select_control() && time_since_move >= 0.2f) {
-                if (active_player_state == PIECE_MOVE && move_count > 0) {
-                  Vector2 chessPosMoveTo = active_players.select_to_move_to_chess_positions[active_player];
-                  Vector2 chessPosMoveFrom = active_pieces.chess_positions[active_piece_to_move];
-
-                  int x_to = convert_coord(chessPosMoveTo.x, N_ROWS);
-                  int y_to = convert_coord(chessPosMoveTo.y, N_COLS);
-
-                  int x_from = convert_coord(chessPosMoveFrom.x, N_ROWS);
-                  int y_from = convert_coord(chessPosMoveFrom.y, N_COLS);
-
-                  if (cells.occupied_states[y_to + (x_to * N_COLS)] == 1) {
-                    int kill_cell_piece_index = cells.cell_piece_indices[y_to + (x_to * N_COLS)];
-                    int kill_cell_player_id = cells.cell_player_states[y_to + (x_to * N_COLS)];
-                    // Now get the player associated and set that piece to be dead
-                    pieces[active_players.piece_indices[kill_cell_player_id]].is_dead[kill_cell_piece_index] = 1;
-                    active_players.live_piece_counts[kill_cell_player_id]--; // reduce number of live pieces for enemy
-                  }
-
-                  // Moving around all the state tracking stuff
-                  // This tracks whether a cell is occupied or not
-                  cells.occupied_states[y_to + (x_to * N_COLS)] = 1;
-                  cells.occupied_states[y_from + (x_from * N_COLS)] = 0;
-
-                  // This tracks which piece is currently occupying a cell
-                  cells.cell_piece_indices[y_to + (x_to * N_COLS)] = cells.cell_piece_indices[y_from + (x_from * N_COLS)];
-                  cells.cell_piece_indices[y_from + (x_from * N_COLS)] = 0;
-
-                  // This tracks which player is currently occupying a cell
-                  cells.cell_player_states[y_to + (x_to * N_COLS)] = active_player;
-                  cells.cell_player_states[y_from + (x_from * N_COLS)] = -1;
-
-                  // Set the x,y coordinates first of the piece we want to move
-                  active_pieces.chess_positions[active_piece_to_move].x = chessPosMoveTo.x;
-                  active_pieces.chess_positions[active_piece_to_move].y = chessPosMoveTo.y;
-
-                  // Then update with the calculated grid position
-                  active_pieces.grid_positions[active_piece_to_move] = calculate_position(chessPosMoveTo.x, chessPosMoveTo.y, PIECE_SIZE);
-
-                  // and reset the mode back to piece selection
-                  active_player_state = active_players.player_states[active_player] = PIECE_SELECTION;
-
-                }
-                time_since_move = 0.0f;
+              if (report != NULL) {
+                draw_analysis_arrows(report);
               }
 
-              time_since_move += GetFrameTime();
-
-              for (int player_index = 0; player_index < num_players; player_index++) {
-                struct ChessPieces player_pieces = pieces[player_index];
-                for (int i = 0; i < N_PIECES; i++) {
-                  int is_dead = player_pieces.is_dead[i];
-
-                  if (is_dead) {
-                    continue;
-                  }
-
-                  Vector3 grid_pos = player_pieces.grid_positions[i];
-                  Color piece_color = player_pieces.colors[i];
-
-                  int piece_type = player_pieces.chess_type[i];
-                  Model model = chess_types.models[piece_type];
-                  float scaling_factor = chess_types.scaling_factors[piece_type];
-
-                  DrawModel(model, grid_pos, scaling_factor, piece_color);
+              for (int board = 0; board < snapshot->num_boards; board++) {
+                if (board != board_pool.focused) {
+                  draw_board_tile(snapshot, animations.tweens, board, chess_types, board_tile_offset(board, tiles_per_row));
                 }
               }
+              PROFILE_END(PHASE_DRAW_PIECES);
 
               DrawGrid(MAX(N_ROWS, N_COLS), 5.0f);
           rlTPCameraEndMode3D();
@@ -806,9 +1158,123 @@ main(void)
 
           DrawText("Chess!", 20, 20, 5, BLACK);
 
+          if (num_boards > 1) {
+            DrawText(TextFormat("%d boards  update avg %.1fus  max %.1fus (board %d)  wall %.1fus",
+                                num_boards,
+                                snapshot->board_stats.avg_ns / 1000.0,
+                                snapshot->board_stats.max_ns / 1000.0,
+                                snapshot->board_stats.max_board,
+                                snapshot->board_stats.wall_ns / 1000.0),
+                     70, 20, 10, DARKGRAY);
+          }
+
+          if (snapshot->sim_mode == SIM_FAST_FORWARD) {
+            DrawText(TextFormat("fast forward  %d ticks/frame", snapshot->ticks_per_publish), 70, 34, 10, MAROON);
+          }
+
+          if (snapshot->status == GAME_CHECK) {
+            DrawText("Check", 20, 62, 20, RED);
+          }
+          else if (snapshot->status == GAME_CHECKMATE) {
+            DrawText("Checkmate", 20, 62, 20, RED);
+          }
+          else if (snapshot->status == GAME_STALEMATE) {
+            DrawText("Stalemate", 20, 62, 20, DARKGRAY);
+          }
+          else if (snapshot->status == GAME_FLAGGED) {
+            DrawText(TextFormat("Player %d lost on time", snapshot->clock.flagged), 20, 62, 20, RED);
+          }
+
+          if (snapshot->clock.running) {
+            draw_clocks(snapshot, num_players);
+          }
+
+          if (report != NULL) {
+            DrawText(TextFormat("analysis  depth %d  %llu nodes", report->depth, (unsigned long long)report->nodes),
+                     20, 100, 10, DARKGRAY);
+            for (int i = 0; i < report->line_count; i++) {
+              const struct AnalysisLine *line = &report->lines[i];
+              char text[ANALYSIS_LINE_MOVES * 6 + 1] = "";
+              for (int move = 0; move < line->length; move++) {
+                position_move_text(line->moves[move], &text[move * 6]);
+                text[(move * 6) + 4] = ' ';
+                text[(move * 6) + 5] = '\0';
+              }
+              // Scores are for the side to move, mates in moves rather than plies
+              if (search_is_mate_score(line->score)) {
+                int moves = (SEARCH_MATE - abs(line->score) + 1) / 2;
+                DrawText(TextFormat("%s#%d  %s", line->score > 0 ? "" : "-", moves, text), 20, 114 + (14 * i), 10, DARKGRAY);
+              }
+              else {
+                DrawText(TextFormat("%+.2f  %s", line->score / 100.0, text), 20, 114 + (14 * i), 10, DARKGRAY);
+              }
+            }
+          }
+
+          if (computer.search.running) {
+            DrawText(TextFormat("%s  depth %d  %llu nodes  +%llu in %.0fus",
+                                computer.state == COMPUTER_PONDERING ? "pondering" : "thinking",
+                                computer.search.depth,
+                                (unsigned long long)computer.search.nodes,
+                                (unsigned long long)computer.search.slice_nodes,
+                                computer.slice_us),
+                     20, 86, 10, DARKGRAY);
+          }
+
+#ifdef PROFILER
+          if (profiler_overlay_control()) {
+            show_profiler = !show_profiler;
+          }
+
+          if (profiler_export_control()) {
+            printf("Exported %d profile samples\n", profiler_export_csv("profile.csv"));
+            profiler_export_trace("profile.json");
+          }
+
+          if (show_profiler) {
+            profiler_draw_overlay(GetScreenWidth() - 270, 6);
+          }
+#endif
+
+      PROFILE_BEGIN(PHASE_PRESENT);
       EndDrawing();
+      PROFILE_END(PHASE_PRESENT);
+
+      // What's left of the frame's time after drawing goes to the computer, and to analysis
+      // when there's no thread to run it
+      if (computer_seat >= 0 || show_analysis) {
+        PROFILE_SCOPE(PHASE_THINK) {
+          if (computer_seat >= 0) {
+            computer_think(&computer, &play, snapshot);
+          }
+          if (show_analysis) {
+            analysis_frame(&analysis, COMPUTER_SLICE_US);
+          }
+        }
+      }
+      PROFILE_END(PHASE_FRAME);
     }
 
+    // Nothing touches the games once the simulation thread has stopped
+    sim_thread_stop(&sim_thread);
+    if (show_analysis) {
+      analysis_stop(&analysis);
+    }
+    board_pool_destroy(&board_pool);
+    if (log_path != NULL && game_log_writer_close(&game_log) != 0) {
+      printf("some games could not be written to %s\n", log_path);
+    }
+    if (input_close(&input) != 0) {
+      printf("could not save the input recording to %s\n", input_path);
+    }
+    level_unmap(&level);
+    for (int i = 0; i < 3; i++) {
+      snapshot_free(&snapshots[i]);
+    }
+    free(animations.shown_squares);
+    free(tween_memory);
+    UnloadMesh(threat_overlay.mesh);
+    UnloadMaterial(threat_overlay.material);
     CloseWindow();
 
     return 0;
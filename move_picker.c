@@ -0,0 +1,259 @@
+#include "stdint.h"
+#include "stdlib.h"
+#include "string.h"
+#include "chess.h"
+#include "piece_defs.h"
+#include "eval.h"
+#include "position.h"
+#include "see.h"
+#include "move_picker.h"
+
+void
+move_history_clear(struct MoveHistory *history) {
+  memset(history, 0, sizeof *history);
+}
+
+static inline void
+history_add(int16_t *entry, int bonus) {
+  // Scores that are already big move less, which keeps them within MOVE_HISTORY_MAX
+  // and lets the latest searches count for more than old ones
+  *entry = (int16_t)(*entry + bonus - ((*entry * abs(bonus)) / MOVE_HISTORY_MAX));
+}
+
+void
+move_history_update(struct MoveHistory *history,
+                    const struct Position *pos,
+                    Move previous,
+                    Move best,
+                    const Move *quiets_tried,
+                    int quiet_count,
+                    int depth) {
+  int side = pos->side_to_move;
+  int bonus = MIN(32 * depth * depth, 2048);
+
+  history_add(&history->butterfly[side][MOVE_FROM(best)][MOVE_TO(best)], bonus);
+  for (int i = 0; i < quiet_count; i++) {
+    if (quiets_tried[i] != best) {
+      history_add(&history->butterfly[side][MOVE_FROM(quiets_tried[i])][MOVE_TO(quiets_tried[i])], -bonus);
+    }
+  }
+
+  if (previous != MOVE_NONE) {
+    int to = MOVE_TO(previous);
+    history->counters[position_piece_type(pos, pos->board[to] - 1)][to] = best;
+  }
+}
+
+void
+move_picker_init(struct MovePicker *picker,
+                 const struct Position *pos,
+                 const struct MoveHistory *history,
+                 Move tt_move,
+                 const Move *killers,
+                 Move counter,
+                 int ordering) {
+  picker->pos = pos;
+  picker->history = history;
+  picker->ordering = ordering;
+  picker->captures_only = 0;
+  picker->index = 0;
+  picker->count = 0;
+  picker->bad_index = 0;
+  picker->bad_count = 0;
+  picker->tt_move = MOVE_NONE;
+  picker->killers[0] = MOVE_NONE;
+  picker->killers[1] = MOVE_NONE;
+  picker->counter = MOVE_NONE;
+
+  if (ordering == MOVE_ORDER_NONE) {
+    picker->stage = PICK_GENERATE_ALL;
+    return;
+  }
+
+  // The table's move could be from another position with the same bucket bits, or even the
+  // same hash, so it has to be checked. Killers and the counter are checked when they come up.
+  if (position_move_is_pseudo_legal(pos, tt_move)) {
+    picker->tt_move = tt_move;
+  }
+  if (ordering >= MOVE_ORDER_KILLERS) {
+    picker->killers[0] = killers[0];
+    picker->killers[1] = killers[1];
+    picker->counter = counter;
+  }
+  picker->stage = PICK_TT_MOVE;
+}
+
+void
+move_picker_init_captures(struct MovePicker *picker, const struct Position *pos, int ordering) {
+  picker->pos = pos;
+  picker->history = NULL;
+  picker->tt_move = MOVE_NONE;
+  picker->ordering = ordering;
+  picker->captures_only = 1;
+  picker->index = 0;
+  picker->count = 0;
+  picker->stage = PICK_GENERATE_CAPTURES;
+}
+
+static void
+score_captures(struct MovePicker *picker) {
+  // Victim first and then the cheapest piece taking it, a promotion adds what it turns into
+  const struct Position *pos = picker->pos;
+  for (int i = 0; i < picker->count; i++) {
+    Move move = picker->moves[i];
+    int mover_type = position_piece_type(pos, pos->board[MOVE_FROM(move)] - 1);
+    int victim = pos->board[MOVE_TO(move)];
+    int score = 0;
+    if (victim != 0) {
+      score += eval_piece_material(position_piece_type(pos, victim - 1));
+    }
+    if (MOVE_FLAGS(move) & MOVE_PROMOTE) {
+      score += eval_piece_material(piece_tables.promotes_to[mover_type]);
+    }
+    picker->scores[i] = (score * 8) - piece_tables.models[mover_type];
+  }
+}
+
+static void
+score_quiets(struct MovePicker *picker) {
+  const int16_t (*butterfly)[N_CELLS] = picker->history->butterfly[picker->pos->side_to_move];
+  for (int i = 0; i < picker->count; i++) {
+    Move move = picker->moves[i];
+    picker->scores[i] = butterfly[MOVE_FROM(move)][MOVE_TO(move)];
+  }
+}
+
+// Selection sort one move at a time, the rest are only ever sorted if nothing cuts off
+static inline Move
+pick_best(struct MovePicker *picker) {
+  int best = picker->index;
+  for (int i = best + 1; i < picker->count; i++) {
+    if (picker->scores[i] > picker->scores[best]) {
+      best = i;
+    }
+  }
+
+  Move move = picker->moves[best];
+  int score = picker->scores[best];
+  picker->moves[best] = picker->moves[picker->index];
+  picker->scores[best] = picker->scores[picker->index];
+  picker->moves[picker->index] = move;
+  picker->scores[picker->index] = score;
+  picker->index++;
+  return move;
+}
+
+static inline int
+special_quiet(const struct MovePicker *picker, Move move) {
+  // Killers and the counter only ever come out of their own stages
+  return move_is_quiet(move) && picker->tt_move != move && position_move_is_pseudo_legal(picker->pos, move);
+}
+
+Move
+move_picker_next(struct MovePicker *picker) {
+  for (;;) {
+    switch (picker->stage) {
+      case PICK_TT_MOVE:
+        picker->stage = PICK_GENERATE_CAPTURES;
+        if (picker->tt_move != MOVE_NONE) {
+          return picker->tt_move;
+        }
+        break;
+
+      case PICK_GENERATE_CAPTURES:
+        picker->count = position_generate_captures(picker->pos, picker->moves);
+        picker->index = 0;
+        if (picker->ordering >= MOVE_ORDER_MVV_LVA) {
+          score_captures(picker);
+        }
+        picker->stage = PICK_CAPTURES;
+        break;
+
+      case PICK_CAPTURES:
+        while (picker->index < picker->count) {
+          Move move = picker->ordering >= MOVE_ORDER_MVV_LVA ? pick_best(picker) : picker->moves[picker->index++];
+          if (move == picker->tt_move) {
+            continue;
+          }
+          if (picker->ordering >= MOVE_ORDER_SEE && position_see_losing(picker->pos, move)) {
+            if (!picker->captures_only) {
+              picker->bad_captures[picker->bad_count++] = move;
+            }
+            continue;
+          }
+          return move;
+        }
+        picker->stage = picker->captures_only ? PICK_DONE : PICK_KILLER_1;
+        break;
+
+      case PICK_KILLER_1:
+        picker->stage = PICK_KILLER_2;
+        if (picker->killers[0] != MOVE_NONE && special_quiet(picker, picker->killers[0])) {
+          return picker->killers[0];
+        }
+        break;
+
+      case PICK_KILLER_2:
+        picker->stage = PICK_COUNTER;
+        if (picker->killers[1] != MOVE_NONE && picker->killers[1] != picker->killers[0] &&
+            special_quiet(picker, picker->killers[1])) {
+          return picker->killers[1];
+        }
+        break;
+
+      case PICK_COUNTER:
+        picker->stage = PICK_GENERATE_QUIETS;
+        if (picker->counter != MOVE_NONE && picker->counter != picker->killers[0] &&
+            picker->counter != picker->killers[1] && special_quiet(picker, picker->counter)) {
+          return picker->counter;
+        }
+        break;
+
+      case PICK_GENERATE_QUIETS:
+        picker->count = position_generate_quiets(picker->pos, picker->moves);
+        picker->index = 0;
+        if (picker->ordering >= MOVE_ORDER_HISTORY) {
+          score_quiets(picker);
+        }
+        picker->stage = PICK_QUIETS;
+        break;
+
+      case PICK_QUIETS:
+        // A killer or counter that wasn't playable can't be generated either, so skipping
+        // anything equal to them only ever skips what already came out
+        while (picker->index < picker->count) {
+          Move move = picker->ordering >= MOVE_ORDER_HISTORY ? pick_best(picker) : picker->moves[picker->index++];
+          if (move != picker->tt_move && move != picker->killers[0] &&
+              move != picker->killers[1] && move != picker->counter) {
+            return move;
+          }
+        }
+        picker->stage = PICK_BAD_CAPTURES;
+        break;
+
+      case PICK_BAD_CAPTURES:
+        // Still in MVV-LVA order from when they were put off
+        if (picker->bad_index < picker->bad_count) {
+          return picker->bad_captures[picker->bad_index++];
+        }
+        picker->stage = PICK_DONE;
+        break;
+
+      case PICK_GENERATE_ALL:
+        picker->count = position_generate_moves(picker->pos, picker->moves);
+        picker->index = 0;
+        picker->stage = PICK_ALL;
+        break;
+
+      case PICK_ALL:
+        if (picker->index < picker->count) {
+          return picker->moves[picker->index++];
+        }
+        picker->stage = PICK_DONE;
+        break;
+
+      default:
+        return MOVE_NONE;
+    }
+  }
+}
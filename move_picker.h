@@ -0,0 +1,112 @@
+#ifndef MOVE_PICKER_H
+#define MOVE_PICKER_H
+
+#include "stdint.h"
+#include "chess.h"
+#include "piece_defs.h"
+#include "position.h"
+
+// Hands search one move at a time, best guess first, and only generates what it gets to.
+// The stages go: the transposition table's move, captures by most valuable victim and least
+// valuable attacker (MVV-LVA), the two killers of the ply and the counter to the move that
+// was just played, every other quiet move by butterfly history and last the captures static
+// exchange evaluation (see.h) says lose material. A cutoff in an early stage means the quiet
+// moves are never generated at all. Quiescence search only wants the captures that don't
+// lose, and gets nothing else.
+//
+// ordering switches heuristics off from the top down so the bench can show what each one
+// saves, search always runs with MOVE_ORDER_HISTORY.
+
+#define MOVE_HISTORY_MAX 16384 // history scores stay within +-this
+
+enum MoveOrdering {
+  MOVE_ORDER_NONE, // generation order
+  MOVE_ORDER_TT, // the transposition table's move first
+  MOVE_ORDER_MVV_LVA, // then captures, best first
+  MOVE_ORDER_SEE, // with the losing ones put off until after the quiets
+  MOVE_ORDER_KILLERS, // then killers and the counter move
+  MOVE_ORDER_HISTORY // and quiets sorted by history
+};
+
+enum MovePickStage {
+  PICK_TT_MOVE,
+  PICK_GENERATE_CAPTURES,
+  PICK_CAPTURES,
+  PICK_KILLER_1,
+  PICK_KILLER_2,
+  PICK_COUNTER,
+  PICK_GENERATE_QUIETS,
+  PICK_QUIETS,
+  PICK_BAD_CAPTURES,
+  PICK_GENERATE_ALL, // MOVE_ORDER_NONE, everything as it comes
+  PICK_ALL,
+  PICK_DONE
+};
+
+// What search has learned about quiet moves, kept from one search to the next
+struct MoveHistory {
+  int16_t butterfly[NUM_PLAYERS][N_CELLS][N_CELLS]; // by side, from and to
+  Move counters[MAX_PIECE_TYPES][N_CELLS]; // the reply that refuted a piece arriving on a square
+};
+
+struct MovePicker {
+  const struct Position *pos;
+  const struct MoveHistory *history;
+  Move tt_move;
+  Move killers[2];
+  Move counter;
+  int ordering;
+  int captures_only; // quiescence, losing captures are dropped rather than put off
+  int stage;
+  int index;
+  int count;
+  int bad_index;
+  int bad_count;
+  Move moves[POSITION_MAX_MOVES];
+  int scores[POSITION_MAX_MOVES];
+  Move bad_captures[POSITION_MAX_MOVES];
+};
+
+void move_history_clear(struct MoveHistory *history);
+
+// The counter to previous, the move that got to pos, MOVE_NONE at the root
+static inline Move
+move_history_counter(const struct MoveHistory *history, const struct Position *pos, Move previous) {
+  if (previous == MOVE_NONE) {
+    return MOVE_NONE;
+  }
+  int to = MOVE_TO(previous);
+  return history->counters[position_piece_type(pos, pos->board[to] - 1)][to];
+}
+
+// best caused a cutoff at depth, the quiet moves tried before it get the same amount taken off
+void move_history_update(struct MoveHistory *history,
+                         const struct Position *pos,
+                         Move previous,
+                         Move best,
+                         const Move *quiets_tried,
+                         int quiet_count,
+                         int depth);
+
+static inline int
+move_is_quiet(Move move) {
+  return (MOVE_FLAGS(move) & (MOVE_CAPTURE | MOVE_PROMOTE)) == 0;
+}
+
+// killers is the ply's two, any of the moves can be MOVE_NONE or not playable here
+void move_picker_init(struct MovePicker *picker,
+                      const struct Position *pos,
+                      const struct MoveHistory *history,
+                      Move tt_move,
+                      const Move *killers,
+                      Move counter,
+                      int ordering);
+
+// Captures and promotions that don't lose material, best first
+void move_picker_init_captures(struct MovePicker *picker, const struct Position *pos, int ordering);
+
+// MOVE_NONE once there's nothing left, every pseudo legal move comes out exactly once
+// (or every capture that doesn't lose, for move_picker_init_captures)
+Move move_picker_next(struct MovePicker *picker);
+
+#endif
@@ -0,0 +1,232 @@
+#include "stdint.h"
+#include "assert.h"
+#include "chess.h"
+#include "board.h"
+#include "piece_defs.h"
+#include "position.h"
+
+// Move generation for standard chess with every piece type written out at compile time.
+// The generic path in position.c walks the compiled target lists, which is what fairy
+// pieces need, this one has the offsets as constants: leapers are unrolled, sliders
+// work out how far they can go once per direction, and pawns have their own code per side.
+// It's only used when the loaded piece definitions are standard chess.
+
+// Rules this file implements, in the same form as resources/pieces/chess.txt
+struct ChessRule {
+  int8_t x;
+  int8_t y;
+  uint8_t flags;
+};
+
+static const struct ChessRule pawn_rules[] = {{1, 0, PIECE_MOVE_ONLY}, {1, -1, PIECE_CAPTURE_ONLY}, {1, 1, PIECE_CAPTURE_ONLY}};
+static const struct ChessRule knight_rules[] = {{1, -2, 0}, {-1, -2, 0}, {2, -1, 0}, {-2, -1, 0}, {2, 1, 0}, {-2, 1, 0}, {1, 2, 0}, {-1, 2, 0}};
+static const struct ChessRule bishop_rules[] = {{1, -1, 0}, {-1, -1, 0}, {1, 1, 0}, {-1, 1, 0}};
+static const struct ChessRule rook_rules[] = {{1, 0, 0}, {-1, 0, 0}, {0, -1, 0}, {0, 1, 0}};
+static const struct ChessRule royal_rules[] = {{0, -1, 0}, {-1, -1, 0}, {1, -1, 0}, {-1, 0, 0}, {1, 0, 0}, {-1, 1, 0}, {1, 1, 0}, {0, 1, 0}};
+
+static const struct ChessRule *chess_rules[6] = {pawn_rules, knight_rules, bishop_rules, rook_rules, royal_rules, royal_rules};
+static const int chess_rule_counts[6] = {3, 8, 4, 4, 8, 8};
+static const int chess_rule_sliding[6] = {0, 0, 1, 1, 1, 0};
+
+static int
+has_rule(const struct PieceDefs *defs, int type, struct ChessRule rule, int sliding) {
+  for (int i = 0; i < defs->offset_counts[type]; i++) {
+    int range = defs->offset_ranges[type][i];
+    // Anything that reaches across the board is the same as sliding to the edge
+    int slides = range == PIECE_RANGE_MAX || range >= MAX(N_ROWS, N_COLS) - 1;
+    if (defs->offset_x[type][i] == rule.x &&
+        defs->offset_y[type][i] == rule.y &&
+        defs->offset_flags[type][i] == rule.flags &&
+        (sliding ? slides : range == 1)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int
+piece_defs_is_standard_chess(const struct PieceDefs *defs) {
+  // Any type past the six would get no moves at all from the switch in generate_chess
+  if (defs->count != 6) {
+    return 0;
+  }
+
+  for (int type = PAWN; type <= KING; type++) {
+    if (defs->offset_counts[type] != chess_rule_counts[type]) {
+      return 0;
+    }
+    for (int i = 0; i < chess_rule_counts[type]; i++) {
+      if (!has_rule(defs, type, chess_rules[type][i], chess_rule_sliding[type])) {
+        return 0;
+      }
+    }
+    if (defs->promotes_to[type] != (type == PAWN ? QUEEN : -1)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// kinds is POSITION_GEN_* and a constant wherever these get inlined, so the moves a caller
+// didn't ask for compile away rather than being tested for
+static inline int
+add_target(const struct Position *pos, int side, int from, int to, Move *moves, int count, int kinds) {
+  int occupant = pos->board[to];
+  if (occupant == 0) {
+    if (kinds & POSITION_GEN_QUIETS) {
+      moves[count++] = MAKE_MOVE(from, to, 0);
+    }
+  }
+  else if ((kinds & POSITION_GEN_CAPTURES) && piece_owner(occupant - 1) != side) {
+    moves[count++] = MAKE_MOVE(from, to, MOVE_CAPTURE);
+  }
+  return count;
+}
+
+// One leaper offset, the bounds check is on constants so most of it folds away
+#define LEAP(dx, dy) \
+  if ((unsigned)(x + (dx)) < N_ROWS && (unsigned)(y + (dy)) < N_COLS) { \
+    count = add_target(pos, side, from, from + ((dx) * N_COLS) + (dy), moves, count, kinds); \
+  }
+
+// One slider direction, how many squares there are to the edge is worked out up front
+// so the loop only has to look at what's on each square
+#define SLIDE(dx, dy) { \
+    int steps_x = (dx) > 0 ? (N_ROWS - 1 - x) : ((dx) < 0 ? x : N_ROWS); \
+    int steps_y = (dy) > 0 ? (N_COLS - 1 - y) : ((dy) < 0 ? y : N_COLS); \
+    int to = from; \
+    for (int steps = MIN(steps_x, steps_y); steps > 0; steps--) { \
+      to += ((dx) * N_COLS) + (dy); \
+      int occupant = pos->board[to]; \
+      if (occupant == 0) { \
+        if (kinds & POSITION_GEN_QUIETS) { \
+          moves[count++] = MAKE_MOVE(from, to, 0); \
+        } \
+        continue; \
+      } \
+      if ((kinds & POSITION_GEN_CAPTURES) && piece_owner(occupant - 1) != side) { \
+        moves[count++] = MAKE_MOVE(from, to, MOVE_CAPTURE); \
+      } \
+      break; \
+    } \
+  }
+
+#define DEFINE_GENERATOR(name, body) \
+  static inline int \
+  name(const struct Position *pos, int side, int from, Move *moves, int count, int kinds) { \
+    int x = square_row(from); \
+    int y = square_col(from); \
+    (void)x; \
+    (void)y; \
+    body \
+    return count; \
+  }
+
+DEFINE_GENERATOR(generate_knight,
+  LEAP(1, -2) LEAP(-1, -2) LEAP(2, -1) LEAP(-2, -1)
+  LEAP(2, 1) LEAP(-2, 1) LEAP(1, 2) LEAP(-1, 2))
+
+DEFINE_GENERATOR(generate_king,
+  LEAP(0, -1) LEAP(-1, -1) LEAP(1, -1) LEAP(-1, 0)
+  LEAP(1, 0) LEAP(-1, 1) LEAP(1, 1) LEAP(0, 1))
+
+DEFINE_GENERATOR(generate_bishop,
+  SLIDE(1, -1) SLIDE(-1, -1) SLIDE(1, 1) SLIDE(-1, 1))
+
+DEFINE_GENERATOR(generate_rook,
+  SLIDE(1, 0) SLIDE(-1, 0) SLIDE(0, -1) SLIDE(0, 1))
+
+DEFINE_GENERATOR(generate_queen,
+  SLIDE(0, -1) SLIDE(-1, -1) SLIDE(1, -1) SLIDE(-1, 0)
+  SLIDE(1, 0) SLIDE(-1, 1) SLIDE(1, 1) SLIDE(0, 1))
+
+// Pawns push one square if it's empty and capture one square diagonally forward,
+// either way arriving on the last row promotes. dx is forward for the side. A push that
+// promotes goes with the captures.
+#define DEFINE_PAWN_GENERATOR(name, dx) \
+  static inline int \
+  name(const struct Position *pos, int side, int from, Move *moves, int count, int kinds) { \
+    int x = square_row(from) + (dx); \
+    int y = square_col(from); \
+    if ((unsigned)x >= N_ROWS) { \
+      return count; \
+    } \
+    int promote = x == ((dx) > 0 ? N_ROWS - 1 : 0) ? MOVE_PROMOTE : 0; \
+    int ahead = from + ((dx) * N_COLS); \
+    if (pos->board[ahead] == 0 && (kinds & (promote ? POSITION_GEN_CAPTURES : POSITION_GEN_QUIETS))) { \
+      moves[count++] = MAKE_MOVE(from, ahead, promote); \
+    } \
+    if (!(kinds & POSITION_GEN_CAPTURES)) { \
+      return count; \
+    } \
+    if (y > 0) { \
+      int occupant = pos->board[ahead - 1]; \
+      if (occupant != 0 && piece_owner(occupant - 1) != side) { \
+        moves[count++] = MAKE_MOVE(from, ahead - 1, promote | MOVE_CAPTURE); \
+      } \
+    } \
+    if (y < N_COLS - 1) { \
+      int occupant = pos->board[ahead + 1]; \
+      if (occupant != 0 && piece_owner(occupant - 1) != side) { \
+        moves[count++] = MAKE_MOVE(from, ahead + 1, promote | MOVE_CAPTURE); \
+      } \
+    } \
+    return count; \
+  }
+
+DEFINE_PAWN_GENERATOR(generate_white_pawn, 1)
+DEFINE_PAWN_GENERATOR(generate_black_pawn, -1)
+
+static inline int
+generate_chess(const struct Position *pos, Move *moves, int kinds) {
+  int count = 0;
+  int side = pos->side_to_move;
+  int first = side * N_PIECES;
+
+  for (int piece_id = first; piece_id < first + N_PIECES; piece_id++) {
+    int from = pos->piece_squares[piece_id];
+    if (from == POSITION_SQUARE_NONE) {
+      continue;
+    }
+
+    switch (position_piece_type(pos, piece_id)) {
+      case PAWN:
+        count = side == WHITE_PLAYER ? generate_white_pawn(pos, side, from, moves, count, kinds)
+                                     : generate_black_pawn(pos, side, from, moves, count, kinds);
+        break;
+      case KNIGHT:
+        count = generate_knight(pos, side, from, moves, count, kinds);
+        break;
+      case BISHOP:
+        count = generate_bishop(pos, side, from, moves, count, kinds);
+        break;
+      case ROOK:
+        count = generate_rook(pos, side, from, moves, count, kinds);
+        break;
+      case QUEEN:
+        count = generate_queen(pos, side, from, moves, count, kinds);
+        break;
+      case KING:
+        count = generate_king(pos, side, from, moves, count, kinds);
+        break;
+    }
+  }
+
+  assert(count <= POSITION_MAX_MOVES);
+  return count;
+}
+
+int
+position_generate_moves_chess(const struct Position *pos, Move *moves) {
+  return generate_chess(pos, moves, POSITION_GEN_ALL);
+}
+
+int
+position_generate_captures_chess(const struct Position *pos, Move *moves) {
+  return generate_chess(pos, moves, POSITION_GEN_CAPTURES);
+}
+
+int
+position_generate_quiets_chess(const struct Position *pos, Move *moves) {
+  return generate_chess(pos, moves, POSITION_GEN_QUIETS);
+}
@@ -0,0 +1,440 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+#include "chess.h"
+#include "board.h"
+#include "piece_defs.h"
+#include "position.h"
+#include "nnue.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NNUE_X86 1
+#include "immintrin.h"
+#endif
+
+// Accumulator columns are added 16 at a time, whatever vector width the target has
+typedef int16_t NnueLanes __attribute__((vector_size(32)));
+
+typedef void (*NnueClipFn)(const int16_t *input, uint8_t *output, int count);
+// weights are count_out rows of count_in, count_in a multiple of 32
+typedef void (*NnueDenseFn)(const uint8_t *input,
+                            int count_in,
+                            const int8_t *weights,
+                            const int32_t *biases,
+                            int32_t *output,
+                            int count_out);
+
+struct NnueKernels {
+  NnueClipFn clip;
+  NnueDenseFn dense;
+};
+
+const char *const nnue_kernel_names[NNUE_KERNEL_COUNT] = {"scalar", "sse4.1", "avx2"};
+
+static void
+clip_scalar(const int16_t *input, uint8_t *output, int count) {
+  for (int i = 0; i < count; i++) {
+    int value = input[i];
+    output[i] = (uint8_t)(value < 0 ? 0 : (value > NNUE_CLIP ? NNUE_CLIP : value));
+  }
+}
+
+static void
+dense_scalar(const uint8_t *input,
+             int count_in,
+             const int8_t *weights,
+             const int32_t *biases,
+             int32_t *output,
+             int count_out) {
+  for (int out = 0; out < count_out; out++) {
+    const int8_t *row = &weights[out * count_in];
+    int32_t sum = biases[out];
+    for (int i = 0; i < count_in; i++) {
+      sum += input[i] * row[i];
+    }
+    output[out] = sum;
+  }
+}
+
+#ifdef NNUE_X86
+// Packing to int8 saturates at 127, taking the max with zero finishes the clip
+__attribute__((target("sse4.1")))
+static void
+clip_sse41(const int16_t *input, uint8_t *output, int count) {
+  const __m128i zero = _mm_setzero_si128();
+  for (int i = 0; i < count; i += 16) {
+    __m128i low = _mm_load_si128((const __m128i *)&input[i]);
+    __m128i high = _mm_load_si128((const __m128i *)&input[i + 8]);
+    __m128i packed = _mm_max_epi8(_mm_packs_epi16(low, high), zero);
+    _mm_store_si128((__m128i *)&output[i], packed);
+  }
+}
+
+// maddubs multiplies the unsigned inputs by the signed weights and adds neighbouring pairs,
+// inputs are at most 127 so the pairs can't saturate, madd by ones widens them to int32
+__attribute__((target("sse4.1")))
+static void
+dense_sse41(const uint8_t *input,
+            int count_in,
+            const int8_t *weights,
+            const int32_t *biases,
+            int32_t *output,
+            int count_out) {
+  const __m128i ones = _mm_set1_epi16(1);
+  int out = 0;
+  for (; out + 4 <= count_out; out += 4) {
+    const int8_t *row = &weights[out * count_in];
+    __m128i sums[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+    for (int i = 0; i < count_in; i += 16) {
+      __m128i x = _mm_load_si128((const __m128i *)&input[i]);
+      for (int r = 0; r < 4; r++) {
+        __m128i w = _mm_load_si128((const __m128i *)&row[(r * count_in) + i]);
+        sums[r] = _mm_add_epi32(sums[r], _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+      }
+    }
+    __m128i four = _mm_hadd_epi32(_mm_hadd_epi32(sums[0], sums[1]), _mm_hadd_epi32(sums[2], sums[3]));
+    _mm_storeu_si128((__m128i *)&output[out], _mm_add_epi32(four, _mm_loadu_si128((const __m128i *)&biases[out])));
+  }
+
+  for (; out < count_out; out++) {
+    const int8_t *row = &weights[out * count_in];
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < count_in; i += 16) {
+      __m128i x = _mm_load_si128((const __m128i *)&input[i]);
+      __m128i w = _mm_load_si128((const __m128i *)&row[i]);
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    output[out] = biases[out] + _mm_cvtsi128_si32(sum);
+  }
+}
+
+__attribute__((target("avx2")))
+static void
+clip_avx2(const int16_t *input, uint8_t *output, int count) {
+  // packs works within 128 bit halves, the permute puts the quarters back in order
+  const __m256i zero = _mm256_setzero_si256();
+  for (int i = 0; i < count; i += 32) {
+    __m256i low = _mm256_load_si256((const __m256i *)&input[i]);
+    __m256i high = _mm256_load_si256((const __m256i *)&input[i + 16]);
+    __m256i packed = _mm256_max_epi8(_mm256_packs_epi16(low, high), zero);
+    _mm256_store_si256((__m256i *)&output[i], _mm256_permute4x64_epi64(packed, 0xD8));
+  }
+}
+
+__attribute__((target("avx2")))
+static void
+dense_avx2(const uint8_t *input,
+           int count_in,
+           const int8_t *weights,
+           const int32_t *biases,
+           int32_t *output,
+           int count_out) {
+  // Four rows at a time share the input loads and one horizontal add at the end
+  const __m256i ones = _mm256_set1_epi16(1);
+  int out = 0;
+  for (; out + 4 <= count_out; out += 4) {
+    const int8_t *row = &weights[out * count_in];
+    __m256i sums[4] = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+    for (int i = 0; i < count_in; i += 32) {
+      __m256i x = _mm256_load_si256((const __m256i *)&input[i]);
+      for (int r = 0; r < 4; r++) {
+        __m256i w = _mm256_load_si256((const __m256i *)&row[(r * count_in) + i]);
+        sums[r] = _mm256_add_epi32(sums[r], _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+      }
+    }
+    __m256i pairs = _mm256_hadd_epi32(_mm256_hadd_epi32(sums[0], sums[1]), _mm256_hadd_epi32(sums[2], sums[3]));
+    __m128i four = _mm_add_epi32(_mm256_castsi256_si128(pairs), _mm256_extracti128_si256(pairs, 1));
+    _mm_storeu_si128((__m128i *)&output[out], _mm_add_epi32(four, _mm_loadu_si128((const __m128i *)&biases[out])));
+  }
+
+  for (; out < count_out; out++) {
+    const int8_t *row = &weights[out * count_in];
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < count_in; i += 32) {
+      __m256i x = _mm256_load_si256((const __m256i *)&input[i]);
+      __m256i w = _mm256_load_si256((const __m256i *)&row[i]);
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    output[out] = biases[out] + _mm_cvtsi128_si32(half);
+  }
+}
+#endif
+
+static const struct NnueKernels kernels[NNUE_KERNEL_COUNT] = {
+  {clip_scalar, dense_scalar},
+#ifdef NNUE_X86
+  {clip_sse41, dense_sse41},
+  {clip_avx2, dense_avx2}
+#else
+  {clip_scalar, dense_scalar},
+  {clip_scalar, dense_scalar}
+#endif
+};
+
+// Scalar until somebody picks, nnue_load and nnue_init_random pick the best one
+static int active_kernel = NNUE_SCALAR;
+static int kernel_picked = 0;
+
+// Every square as each seat sees it, its back rank first like eval.c's tables
+static uint8_t relative_squares[NUM_PLAYERS][N_CELLS];
+
+static int
+kernel_supported(int kernel) {
+  if (kernel == NNUE_SCALAR) {
+    return 1;
+  }
+#ifdef NNUE_X86
+  __builtin_cpu_init();
+  if (kernel == NNUE_SSE41) {
+    return __builtin_cpu_supports("sse4.1");
+  }
+  if (kernel == NNUE_AVX2) {
+    return __builtin_cpu_supports("avx2");
+  }
+#endif
+  return 0;
+}
+
+int
+nnue_best_kernel(void) {
+  for (int kernel = NNUE_KERNEL_COUNT - 1; kernel > NNUE_SCALAR; kernel--) {
+    if (kernel_supported(kernel)) {
+      return kernel;
+    }
+  }
+  return NNUE_SCALAR;
+}
+
+int
+nnue_select_kernel(int kernel) {
+  if (kernel < 0 || kernel >= NNUE_KERNEL_COUNT || !kernel_supported(kernel)) {
+    return -1;
+  }
+  active_kernel = kernel;
+  kernel_picked = 1;
+  return 0;
+}
+
+int
+nnue_kernel(void) {
+  return active_kernel;
+}
+
+static void
+setup(void) {
+  // Runs whenever a network is loaded, before any search is using it
+  if (!kernel_picked) {
+    nnue_select_kernel(nnue_best_kernel());
+  }
+  for (int seat = 0; seat < NUM_PLAYERS; seat++) {
+    int forward_x = (int)player_forwards[seat].x;
+    int forward_y = (int)player_forwards[seat].y;
+    for (int square = 0; square < N_CELLS; square++) {
+      int row = square_row(square);
+      int col = square_col(square);
+      if (forward_x != 0) {
+        relative_squares[seat][square] = (uint8_t)(((forward_x > 0 ? row : N_ROWS - 1 - row) * N_COLS) + col);
+      }
+      else {
+        relative_squares[seat][square] = (uint8_t)(((forward_y > 0 ? col : N_COLS - 1 - col) * N_ROWS) + row);
+      }
+    }
+  }
+}
+
+int
+nnue_load(struct Nnue *net, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    printf("could not open network %s\n", path);
+    return -1;
+  }
+
+  struct NnueFileHeader header;
+  if (fread(&header, sizeof header, 1, file) != 1 || header.magic != NNUE_MAGIC || header.version != NNUE_VERSION) {
+    printf("%s is not a version %d network\n", path, NNUE_VERSION);
+    fclose(file);
+    return -1;
+  }
+  if (header.features != NNUE_FEATURES || header.hidden != NNUE_HIDDEN || header.layer1 != NNUE_LAYER1) {
+    printf("%s is %ux%ux%u, this build plays %dx%dx%d\n",
+           path,
+           header.features,
+           header.hidden,
+           header.layer1,
+           NNUE_FEATURES,
+           NNUE_HIDDEN,
+           NNUE_LAYER1);
+    fclose(file);
+    return -1;
+  }
+
+  int complete = fread(net->feature_weights, sizeof net->feature_weights, 1, file) == 1 &&
+                 fread(net->feature_biases, sizeof net->feature_biases, 1, file) == 1 &&
+                 fread(net->layer1_weights, sizeof net->layer1_weights, 1, file) == 1 &&
+                 fread(net->layer1_biases, sizeof net->layer1_biases, 1, file) == 1 &&
+                 fread(net->output_weights, sizeof net->output_weights, 1, file) == 1 &&
+                 fread(&net->output_bias, sizeof net->output_bias, 1, file) == 1;
+  fclose(file);
+  if (!complete) {
+    printf("%s is cut short\n", path);
+    return -1;
+  }
+  setup();
+  return 0;
+}
+
+int
+nnue_save(const struct Nnue *net, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    printf("could not write network %s\n", path);
+    return -1;
+  }
+
+  struct NnueFileHeader header = {NNUE_MAGIC, NNUE_VERSION, NNUE_FEATURES, NNUE_HIDDEN, NNUE_LAYER1, 0};
+  int complete = fwrite(&header, sizeof header, 1, file) == 1 &&
+                 fwrite(net->feature_weights, sizeof net->feature_weights, 1, file) == 1 &&
+                 fwrite(net->feature_biases, sizeof net->feature_biases, 1, file) == 1 &&
+                 fwrite(net->layer1_weights, sizeof net->layer1_weights, 1, file) == 1 &&
+                 fwrite(net->layer1_biases, sizeof net->layer1_biases, 1, file) == 1 &&
+                 fwrite(net->output_weights, sizeof net->output_weights, 1, file) == 1 &&
+                 fwrite(&net->output_bias, sizeof net->output_bias, 1, file) == 1;
+  if (fclose(file) != 0 || !complete) {
+    printf("could not write network %s\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+static int
+random_between(uint64_t *state, int low, int high) {
+  *state = (*state * 6364136223846793005ull) + 1442695040888963407ull;
+  return low + (int)((*state >> 33) % (uint64_t)(high - low + 1));
+}
+
+void
+nnue_init_random(struct Nnue *net, uint64_t seed) {
+  // Sized so a full board's accumulators land around the middle of the clip range
+  for (int feature = 0; feature < NNUE_FEATURES; feature++) {
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+      net->feature_weights[feature][i] = (int16_t)random_between(&seed, -8, 8);
+    }
+  }
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    net->feature_biases[i] = (int16_t)random_between(&seed, 0, 64);
+  }
+  for (int out = 0; out < NNUE_LAYER1; out++) {
+    for (int i = 0; i < NNUE_INPUTS; i++) {
+      net->layer1_weights[out][i] = (int8_t)random_between(&seed, -16, 16);
+    }
+    net->layer1_biases[out] = random_between(&seed, -1024, 1024);
+  }
+  for (int i = 0; i < NNUE_LAYER1; i++) {
+    net->output_weights[i] = (int8_t)random_between(&seed, -64, 64);
+  }
+  net->output_bias = 0;
+  setup();
+}
+
+static inline int
+feature_index(int seat, int owner, int type, int square) {
+  int side = owner == seat ? 0 : 1;
+  return (((side * NNUE_MODELS) + piece_tables.models[type]) * N_CELLS) + relative_squares[seat][square];
+}
+
+void
+nnue_refresh(const struct Nnue *net, const struct Position *pos, struct NnueAccumulator *acc) {
+  for (int seat = 0; seat < NUM_PLAYERS; seat++) {
+    int16_t *values = acc->values[seat];
+    memcpy(values, net->feature_biases, sizeof net->feature_biases);
+    for (int piece_id = 0; piece_id < POSITION_PIECES; piece_id++) {
+      int square = pos->piece_squares[piece_id];
+      if (square == POSITION_SQUARE_NONE) {
+        continue;
+      }
+      const int16_t *column = net->feature_weights[feature_index(seat, piece_owner(piece_id), position_piece_type(pos, piece_id), square)];
+      for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        *(NnueLanes *)&values[i] += *(const NnueLanes *)&column[i];
+      }
+    }
+  }
+}
+
+void
+nnue_stack_reset(struct NnueStack *stack, const struct Nnue *net, const struct Position *pos) {
+  stack->net = net;
+  stack->depth = 0;
+  nnue_refresh(net, pos, &stack->accumulators[0]);
+}
+
+void
+nnue_push_move(struct NnueStack *stack, const struct Position *pos, Move move) {
+  // The child is the parent with the mover's column moved and the captured piece's taken out
+  assert(stack->depth + 1 < NNUE_MAX_DEPTH);
+  const struct Nnue *net = stack->net;
+  const struct NnueAccumulator *parent = &stack->accumulators[stack->depth];
+  struct NnueAccumulator *child = &stack->accumulators[++stack->depth];
+
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  int mover = pos->board[from] - 1;
+  int captured = pos->board[to] - 1;
+  int seat = piece_owner(mover);
+  int type = position_piece_type(pos, mover);
+  int arrives_as = (MOVE_FLAGS(move) & MOVE_PROMOTE) ? piece_tables.promotes_to[type] : type;
+
+  for (int view = 0; view < NUM_PLAYERS; view++) {
+    const int16_t *added = net->feature_weights[feature_index(view, seat, arrives_as, to)];
+    const int16_t *removed = net->feature_weights[feature_index(view, seat, type, from)];
+    const int16_t *parent_values = parent->values[view];
+    int16_t *values = child->values[view];
+
+    if (captured >= 0) {
+      const int16_t *taken = net->feature_weights[feature_index(view, piece_owner(captured), position_piece_type(pos, captured), to)];
+      for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        *(NnueLanes *)&values[i] = *(const NnueLanes *)&parent_values[i] +
+                                   *(const NnueLanes *)&added[i] -
+                                   *(const NnueLanes *)&removed[i] -
+                                   *(const NnueLanes *)&taken[i];
+      }
+    }
+    else {
+      for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        *(NnueLanes *)&values[i] = *(const NnueLanes *)&parent_values[i] +
+                                   *(const NnueLanes *)&added[i] -
+                                   *(const NnueLanes *)&removed[i];
+      }
+    }
+  }
+}
+
+int
+nnue_evaluate(const struct Nnue *net, const struct NnueAccumulator *acc, int side_to_move) {
+  const struct NnueKernels *kernel = &kernels[active_kernel];
+  uint8_t inputs[NNUE_INPUTS] __attribute__((aligned(32)));
+  uint8_t hidden[NNUE_LAYER1] __attribute__((aligned(32)));
+  int32_t sums[NNUE_LAYER1];
+  int32_t output;
+
+  // The side to move's accumulator first, then the others in seat order after it
+  for (int i = 0; i < NUM_PLAYERS; i++) {
+    int seat = (side_to_move + i) % NUM_PLAYERS;
+    kernel->clip(acc->values[seat], &inputs[i * NNUE_HIDDEN], NNUE_HIDDEN);
+  }
+
+  kernel->dense(inputs, NNUE_INPUTS, &net->layer1_weights[0][0], net->layer1_biases, sums, NNUE_LAYER1);
+  for (int i = 0; i < NNUE_LAYER1; i++) {
+    int32_t value = sums[i] >> NNUE_LAYER1_SHIFT;
+    hidden[i] = (uint8_t)(value < 0 ? 0 : (value > NNUE_CLIP ? NNUE_CLIP : value));
+  }
+
+  kernel->dense(hidden, NNUE_LAYER1, net->output_weights, &net->output_bias, &output, 1);
+  return output / NNUE_OUTPUT_SCALE;
+}
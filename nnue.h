@@ -0,0 +1,110 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include "stdint.h"
+#include "chess.h"
+#include "position.h"
+
+// An efficiently updatable neural network evaluation, the alternative to eval.h's tables.
+//
+// Every piece on a square is an input feature, seen from each seat: whether it's theirs or
+// the other side's, its model (pawn to king) and the square turned around to face them.
+// The first layer sums a column of weights per feature into an accumulator per seat. A move
+// only takes two or three features away and puts one or two back, so search keeps a stack of
+// accumulators and each make pushes the parent's with those columns added and subtracted,
+// unmake pops it. The small dense layers on top run on every evaluation, as AVX2, SSE4.1 or
+// plain C kernels picked by what the cpu has.
+//
+// Everything is quantized: accumulators are int16, clipped to 0..127 they feed 8 bit inputs
+// into int8 weights, layers add up in int32. Weights are trained elsewhere and loaded from
+// a file laid out like struct NnueFileHeader and the arrays in struct Nnue, in that order.
+
+#define NNUE_MAGIC 0x4E4E4352u // "RCNN"
+#define NNUE_VERSION 1
+
+#define NNUE_MODELS 6
+#define NNUE_FEATURES (2 * NNUE_MODELS * N_CELLS) // ours and theirs
+#define NNUE_HIDDEN 128 // accumulator width per seat
+#define NNUE_INPUTS (NUM_PLAYERS * NNUE_HIDDEN) // side to move's accumulator first
+#define NNUE_LAYER1 32
+#define NNUE_CLIP 127
+#define NNUE_LAYER1_SHIFT 6 // layer 1 sums back down to 0..NNUE_CLIP
+#define NNUE_OUTPUT_SCALE 16 // output units per centipawn
+#define NNUE_MAX_DEPTH 128 // accumulators a stack holds
+
+// The kernels read 32 bytes at a time, the dense layers' inputs come in whole blocks
+#if (NNUE_INPUTS % 32) || (NNUE_LAYER1 % 32) || (NNUE_HIDDEN % 32)
+#error "NNUE layer widths have to be multiples of 32"
+#endif
+
+enum NnueKernel {
+  NNUE_SCALAR,
+  NNUE_SSE41,
+  NNUE_AVX2,
+  NNUE_KERNEL_COUNT
+};
+
+struct NnueFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t features;
+  uint32_t hidden;
+  uint32_t layer1;
+  uint32_t reserved;
+};
+
+struct Nnue {
+  int16_t feature_weights[NNUE_FEATURES][NNUE_HIDDEN] __attribute__((aligned(32)));
+  int16_t feature_biases[NNUE_HIDDEN] __attribute__((aligned(32)));
+  int8_t layer1_weights[NNUE_LAYER1][NNUE_INPUTS] __attribute__((aligned(32)));
+  int32_t layer1_biases[NNUE_LAYER1];
+  int8_t output_weights[NNUE_LAYER1] __attribute__((aligned(32)));
+  int32_t output_bias;
+};
+
+struct NnueAccumulator {
+  int16_t values[NUM_PLAYERS][NNUE_HIDDEN] __attribute__((aligned(32))); // by seat
+};
+
+struct NnueStack {
+  const struct Nnue *net;
+  int depth; // accumulators[depth] is the current position's
+  struct NnueAccumulator accumulators[NNUE_MAX_DEPTH];
+};
+
+extern const char *const nnue_kernel_names[NNUE_KERNEL_COUNT];
+
+// The fastest kernel the cpu has, picked on first use
+int nnue_best_kernel(void);
+// Returns -1 if the cpu can't run it
+int nnue_select_kernel(int kernel);
+int nnue_kernel(void);
+
+// Returns -1 after printing what was wrong with the file
+int nnue_load(struct Nnue *net, const char *path);
+int nnue_save(const struct Nnue *net, const char *path);
+// Small random weights, enough to exercise and time the network without a trained file
+void nnue_init_random(struct Nnue *net, uint64_t seed);
+
+// Both seats' accumulators from scratch
+void nnue_refresh(const struct Nnue *net, const struct Position *pos, struct NnueAccumulator *acc);
+
+// Starts a stack at a position, search's root
+void nnue_stack_reset(struct NnueStack *stack, const struct Nnue *net, const struct Position *pos);
+// Call before position_make_move with the position the move is played from
+void nnue_push_move(struct NnueStack *stack, const struct Position *pos, Move move);
+
+static inline void
+nnue_pop(struct NnueStack *stack) {
+  stack->depth--;
+}
+
+// Centipawns for the side to move
+int nnue_evaluate(const struct Nnue *net, const struct NnueAccumulator *acc, int side_to_move);
+
+static inline int
+nnue_stack_evaluate(const struct NnueStack *stack, const struct Position *pos) {
+  return nnue_evaluate(stack->net, &stack->accumulators[stack->depth], pos->side_to_move);
+}
+
+#endif
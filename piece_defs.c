@@ -0,0 +1,318 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "assert.h"
+#include "chess.h"
+#include "board.h"
+#include "arena.h"
+#include "piece_defs.h"
+
+#define PIECE_FILE_MAX_SIZE (64 * 1024)
+
+struct PieceTables piece_tables;
+
+static uint8_t rules_memory[PIECE_TABLES_ARENA_SIZE];
+
+static const char model_names[6][PIECE_NAME_SIZE] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+
+static int
+find_name(const char *names, int count, const char *name) {
+  // names is `count` PIECE_NAME_SIZE strings back to back
+  for (int i = 0; i < count; i++) {
+    if (strcmp(&names[i * PIECE_NAME_SIZE], name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static int
+parse_range(const char *word, uint8_t *range) {
+  if (strcmp(word, "max") == 0) {
+    *range = PIECE_RANGE_MAX;
+    return 0;
+  }
+  int value = atoi(word);
+  if (value <= 0 || value > 255) {
+    return -1;
+  }
+  *range = (uint8_t)value;
+  return 0;
+}
+
+int
+piece_defs_parse(struct PieceDefs *defs, const char *text, const char *source_name) {
+  memset(defs, 0, sizeof *defs);
+
+  // Promotions can name pieces further down the file, resolve them at the end
+  char promote_names[MAX_PIECE_TYPES][PIECE_NAME_SIZE] = {{0}};
+  uint8_t piece_range = 1;
+  int current = -1;
+  int line_number = 0;
+
+  while (*text != '\0') {
+    char line[256];
+    size_t length = strcspn(text, "\n");
+    line_number++;
+
+    if (length >= sizeof line) {
+      printf("%s:%d: line too long\n", source_name, line_number);
+      return -1;
+    }
+    memcpy(line, text, length);
+    line[length] = '\0';
+    text += length + (text[length] == '\n');
+
+    char word[4][PIECE_NAME_SIZE];
+    int words = sscanf(line, " %15s %15s %15s %15s", word[0], word[1], word[2], word[3]);
+    if (words <= 0 || word[0][0] == '#') {
+      continue;
+    }
+
+    if (strcmp(word[0], "piece") == 0) {
+      if (current != -1 || words < 3) {
+        printf("%s:%d: expected `piece <name> <model>` outside of a piece\n", source_name, line_number);
+        return -1;
+      }
+      if (defs->count == MAX_PIECE_TYPES) {
+        printf("%s:%d: more than %d piece types\n", source_name, line_number, MAX_PIECE_TYPES);
+        return -1;
+      }
+      current = defs->count++;
+      strcpy(defs->names[current], word[1]);
+      defs->models[current] = find_name(&model_names[0][0], 6, word[2]);
+      defs->promotes_to[current] = -1;
+      piece_range = 1;
+      if (defs->models[current] < 0) {
+        printf("%s:%d: unknown model %s\n", source_name, line_number, word[2]);
+        return -1;
+      }
+      continue;
+    }
+
+    if (current == -1) {
+      printf("%s:%d: %s outside of a piece\n", source_name, line_number, word[0]);
+      return -1;
+    }
+
+    // The piece range is the default for the offsets after it
+    if (strcmp(word[0], "range") == 0 && words == 2) {
+      if (parse_range(word[1], &piece_range) != 0) {
+        printf("%s:%d: bad range %s\n", source_name, line_number, word[1]);
+        return -1;
+      }
+    }
+    else if (strcmp(word[0], "offset") == 0 && words >= 3) {
+      int index = defs->offset_counts[current];
+      if (index == MAX_PIECE_OFFSETS) {
+        printf("%s:%d: more than %d offsets\n", source_name, line_number, MAX_PIECE_OFFSETS);
+        return -1;
+      }
+
+      // offset <x> <y> [move|capture] [range <n>], read the optional words off the line again
+      int x;
+      int y;
+      char extra[3][PIECE_NAME_SIZE];
+      int count = sscanf(line, " offset %d %d %15s %15s %15s", &x, &y, extra[0], extra[1], extra[2]);
+      if (count < 2 || (x == 0 && y == 0) || abs(x) >= MAX(N_ROWS, N_COLS) || abs(y) >= MAX(N_ROWS, N_COLS)) {
+        printf("%s:%d: bad offset\n", source_name, line_number);
+        return -1;
+      }
+
+      uint8_t flags = 0;
+      uint8_t range = piece_range;
+      for (int i = 0; i < count - 2; i++) {
+        if (strcmp(extra[i], "move") == 0) {
+          flags |= PIECE_MOVE_ONLY;
+        }
+        else if (strcmp(extra[i], "capture") == 0) {
+          flags |= PIECE_CAPTURE_ONLY;
+        }
+        else if (strcmp(extra[i], "range") == 0 && i + 1 < count - 2 && parse_range(extra[i + 1], &range) == 0) {
+          i++;
+        }
+        else {
+          printf("%s:%d: unexpected %s\n", source_name, line_number, extra[i]);
+          return -1;
+        }
+      }
+      if (flags == (PIECE_MOVE_ONLY | PIECE_CAPTURE_ONLY)) {
+        printf("%s:%d: an offset can't be both move and capture only\n", source_name, line_number);
+        return -1;
+      }
+
+      defs->offset_x[current][index] = (int8_t)x;
+      defs->offset_y[current][index] = (int8_t)y;
+      defs->offset_flags[current][index] = flags;
+      defs->offset_ranges[current][index] = range;
+      defs->offset_counts[current]++;
+    }
+    else if (strcmp(word[0], "promote") == 0 && words == 2) {
+      strcpy(promote_names[current], word[1]);
+    }
+    else if (strcmp(word[0], "end") == 0) {
+      if (defs->offset_counts[current] == 0) {
+        printf("%s:%d: %s has no offsets\n", source_name, line_number, defs->names[current]);
+        return -1;
+      }
+      current = -1;
+    }
+    else {
+      printf("%s:%d: unexpected %s\n", source_name, line_number, word[0]);
+      return -1;
+    }
+  }
+
+  if (current != -1) {
+    printf("%s: %s is missing its end\n", source_name, defs->names[current]);
+    return -1;
+  }
+
+  // The starting layout puts pawns, knights, ... kings on the board by slot
+  if (defs->count < 6) {
+    printf("%s: needs at least the six starting piece types\n", source_name);
+    return -1;
+  }
+
+  for (int type = 0; type < defs->count; type++) {
+    if (promote_names[type][0] == '\0') {
+      continue;
+    }
+    defs->promotes_to[type] = find_name(&defs->names[0][0], defs->count, promote_names[type]);
+    if (defs->promotes_to[type] < 0) {
+      printf("%s: %s promotes to unknown piece %s\n", source_name, defs->names[type], promote_names[type]);
+      return -1;
+    }
+  }
+
+  return defs->count;
+}
+
+int
+piece_defs_load(struct PieceDefs *defs, const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    printf("could not open piece definitions %s\n", path);
+    return -1;
+  }
+
+  static char text[PIECE_FILE_MAX_SIZE];
+  size_t size = fread(text, 1, sizeof text - 1, file);
+  int too_big = !feof(file);
+  fclose(file);
+
+  if (too_big) {
+    printf("%s is bigger than %d bytes\n", path, PIECE_FILE_MAX_SIZE);
+    return -1;
+  }
+  text[size] = '\0';
+  return piece_defs_parse(defs, text, path);
+}
+
+static int
+walk_offset(const struct PieceDefs *defs, int type, int offset_index, Vector2 forward, int square, struct PieceTarget *out) {
+  // Writes the squares along one offset in the order a piece reaches them, returns how many
+  Vector2 offset = rotate_offset((Vector2){defs->offset_x[type][offset_index], defs->offset_y[type][offset_index]}, forward);
+  int range = defs->offset_ranges[type][offset_index];
+  int x = square_row(square) + (int)offset.x;
+  int y = square_col(square) + (int)offset.y;
+  int count = 0;
+
+  while (x >= 0 && y >= 0 && x < N_ROWS && y < N_COLS && (range == PIECE_RANGE_MAX || count < range)) {
+    if (out != NULL) {
+      out[count] = (struct PieceTarget){.square = (uint8_t)square_of(x, y), .flags = defs->offset_flags[type][offset_index]};
+    }
+    count++;
+    x += (int)offset.x;
+    y += (int)offset.y;
+  }
+  return count;
+}
+
+int
+piece_tables_compile(struct PieceTables *tables, const struct PieceDefs *defs, struct Arena *arena) {
+  int entries = MAX_PLAYERS * defs->count * N_CELLS;
+
+  // Count first so the targets go into one block
+  int num_targets = 0;
+  for (int seat = 0; seat < MAX_PLAYERS; seat++) {
+    for (int type = 0; type < defs->count; type++) {
+      for (int square = 0; square < N_CELLS; square++) {
+        for (int i = 0; i < defs->offset_counts[type]; i++) {
+          num_targets += walk_offset(defs, type, i, player_forwards[seat], square, NULL);
+        }
+      }
+    }
+  }
+
+  size_t mark = arena_mark(arena);
+  tables->num_types = defs->count;
+  tables->num_targets = num_targets;
+  tables->starts = ARENA_ALLOC_ARRAY(arena, uint32_t, entries);
+  tables->counts = ARENA_ALLOC_ARRAY(arena, uint8_t, entries);
+  tables->targets = ARENA_ALLOC_ARRAY(arena, struct PieceTarget, num_targets);
+  tables->reach = ARENA_ALLOC_ZERO_ARRAY(arena, uint64_t, entries);
+  tables->promotion_squares = ARENA_ALLOC_ZERO_ARRAY(arena, uint8_t, MAX_PLAYERS * N_CELLS);
+
+  if (tables->starts == NULL || tables->counts == NULL || tables->targets == NULL || tables->reach == NULL || tables->promotion_squares == NULL) {
+    arena_rewind(arena, mark);
+    return -1;
+  }
+
+  int next = 0;
+  for (int seat = 0; seat < MAX_PLAYERS; seat++) {
+    for (int type = 0; type < defs->count; type++) {
+      for (int square = 0; square < N_CELLS; square++) {
+        int index = piece_table_index(tables, seat, type, square);
+        tables->starts[index] = (uint32_t)next;
+
+        for (int i = 0; i < defs->offset_counts[type]; i++) {
+          struct PieceTarget *ray = &tables->targets[next];
+          int length = walk_offset(defs, type, i, player_forwards[seat], square, ray);
+          for (int step = 0; step < length; step++) {
+            ray[step].skip = (uint8_t)(length - step);
+            if (!(ray[step].flags & PIECE_MOVE_ONLY)) {
+              tables->reach[index] |= 1ull << ray[step].square;
+            }
+          }
+          next += length;
+        }
+
+        assert(next - (int)tables->starts[index] <= UINT8_MAX);
+        tables->counts[index] = (uint8_t)(next - tables->starts[index]);
+      }
+    }
+
+    // The far row is the one a step forward would leave the board from
+    for (int square = 0; square < N_CELLS; square++) {
+      int x = square_row(square) + (int)player_forwards[seat].x;
+      int y = square_col(square) + (int)player_forwards[seat].y;
+      tables->promotion_squares[(seat * N_CELLS) + square] = (x < 0 || y < 0 || x >= N_ROWS || y >= N_COLS);
+    }
+  }
+  assert(next == num_targets);
+
+  tables->standard_chess = piece_defs_is_standard_chess(defs);
+  for (int type = 0; type < MAX_PIECE_TYPES; type++) {
+    tables->promotes_to[type] = type < defs->count ? (int8_t)defs->promotes_to[type] : -1;
+    tables->models[type] = type < defs->count ? (uint8_t)defs->models[type] : 0;
+  }
+  return 0;
+}
+
+int
+piece_rules_load(const char *path) {
+  static struct PieceDefs defs;
+  if (piece_defs_load(&defs, path) < 0) {
+    return -1;
+  }
+
+  struct Arena arena;
+  arena_init(&arena, &rules_memory[0], sizeof rules_memory);
+  if (piece_tables_compile(&piece_tables, &defs, &arena) != 0) {
+    printf("%s: compiled tables need more than %d bytes\n", path, PIECE_TABLES_ARENA_SIZE);
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,83 @@
+#ifndef PIECE_DEFS_H
+#define PIECE_DEFS_H
+
+#include "stdint.h"
+#include "chess.h"
+#include "arena.h"
+
+// Piece types come from a data file (resources/pieces/chess.txt) and get compiled
+// once at load time into a list of target squares for every seat, type and square.
+// Move generation just walks those lists, so a custom piece costs the same as a built in one.
+
+#define MAX_PIECE_TYPES 16 // struct Position packs piece types into 4 bits
+#define MAX_PIECE_OFFSETS 16
+#define PIECE_NAME_SIZE 16
+#define PIECE_RANGE_MAX 0 // keep going until the edge of the board
+#define PIECE_TABLES_ARENA_SIZE (512 * 1024)
+
+#if N_CELLS > 256
+#error "PieceTarget stores squares in a byte"
+#endif
+
+// Offset flags
+#define PIECE_MOVE_ONLY 1 // can't capture along this offset
+#define PIECE_CAPTURE_ONLY 2 // can only go there to capture
+
+// What the file describes, offsets are in the owner's frame (x forward, y across)
+struct PieceDefs {
+  int count;
+  char names[MAX_PIECE_TYPES][PIECE_NAME_SIZE];
+  int models[MAX_PIECE_TYPES]; // which of the six built in models draws it
+  int promotes_to[MAX_PIECE_TYPES]; // piece type, -1 if it doesn't promote
+  int offset_counts[MAX_PIECE_TYPES];
+  int8_t offset_x[MAX_PIECE_TYPES][MAX_PIECE_OFFSETS];
+  int8_t offset_y[MAX_PIECE_TYPES][MAX_PIECE_OFFSETS];
+  uint8_t offset_ranges[MAX_PIECE_TYPES][MAX_PIECE_OFFSETS]; // PIECE_RANGE_MAX for unbounded
+  uint8_t offset_flags[MAX_PIECE_TYPES][MAX_PIECE_OFFSETS];
+};
+
+// One square a piece can reach. The targets along one offset are stored in a row,
+// skip jumps from any of them to the start of the next offset once something is in the way.
+struct PieceTarget {
+  uint8_t square;
+  uint8_t flags;
+  uint8_t skip;
+};
+
+// Compiled lookup tables, indexed by piece_table_index(seat, type, square)
+struct PieceTables {
+  int num_types;
+  uint32_t *starts; // first target
+  uint8_t *counts; // number of targets
+  struct PieceTarget *targets;
+  int num_targets;
+  uint64_t *reach; // bit per square the capturing offsets cover on an empty board
+  uint8_t *promotion_squares; // N_CELLS per seat, 1 on the far row for that seat
+  int8_t promotes_to[MAX_PIECE_TYPES];
+  uint8_t models[MAX_PIECE_TYPES];
+  int standard_chess; // the definitions are plain chess, so the specialized generator can be used
+};
+
+// The rules every game and struct Position plays by, set up by piece_rules_load
+extern struct PieceTables piece_tables;
+
+static inline int
+piece_table_index(const struct PieceTables *tables, int seat, int type, int square) {
+  return (((seat * tables->num_types) + type) * N_CELLS) + square;
+}
+
+// Returns the number of piece types, or -1 after printing what was wrong with which line
+int piece_defs_parse(struct PieceDefs *defs, const char *text, const char *source_name);
+int piece_defs_load(struct PieceDefs *defs, const char *path);
+
+// True when there are exactly six types and they move like chess pieces (movegen_chess.c)
+int piece_defs_is_standard_chess(const struct PieceDefs *defs);
+
+// Returns -1 if the tables don't fit in the arena
+int piece_tables_compile(struct PieceTables *tables, const struct PieceDefs *defs, struct Arena *arena);
+
+// Loads and compiles a definition file into piece_tables. Do this before creating games,
+// and not while other threads are generating moves.
+int piece_rules_load(const char *path);
+
+#endif
@@ -0,0 +1,472 @@
+#include "stdint.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+#include "chess.h"
+#include "board.h"
+#include "arena.h"
+#include "game.h"
+#include "piece_defs.h"
+#include "eval.h"
+#include "position.h"
+
+static uint64_t zobrist_pieces[NUM_PLAYERS][MAX_PIECE_TYPES][N_CELLS];
+static uint64_t zobrist_side[NUM_PLAYERS];
+static int zobrist_ready = 0;
+
+static uint64_t
+splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+void
+position_init(void) {
+  if (zobrist_ready) {
+    return;
+  }
+
+  // Fixed seed so hashes are the same from run to run (and in saved games)
+  uint64_t seed = 0x5EED5EED5EED5EEDull;
+  for (int player = 0; player < NUM_PLAYERS; player++) {
+    for (int type = 0; type < MAX_PIECE_TYPES; type++) {
+      for (int square = 0; square < N_CELLS; square++) {
+        zobrist_pieces[player][type][square] = splitmix64(&seed);
+      }
+    }
+    zobrist_side[player] = splitmix64(&seed);
+  }
+  eval_init();
+  zobrist_ready = 1;
+}
+
+static inline uint64_t
+piece_key(const struct Position *pos, int piece_id, int square) {
+  return zobrist_pieces[piece_owner(piece_id)][position_piece_type(pos, piece_id)][square];
+}
+
+// The evaluation's share of make, summed up in registers and stored once at the end, board
+// stores are char stores so the compiler would otherwise reload the fields after each.
+// Unmake puts back the sums the undo saved.
+struct EvalSums {
+  int mg;
+  int eg;
+  int phase;
+};
+
+static inline void
+eval_add(struct EvalSums *sums, int seat, int type, int square, int sign) {
+  const struct EvalTerm *term = eval_term(seat, type, square);
+  sums->mg += sign * term->mg;
+  sums->eg += sign * term->eg;
+  sums->phase += sign * eval_phase_weight(type);
+}
+
+static inline void
+eval_store(struct Position *pos, const struct EvalSums *sums) {
+  pos->eval_mg = (int16_t)sums->mg;
+  pos->eval_eg = (int16_t)sums->eg;
+  pos->phase = (uint8_t)sums->phase;
+}
+
+void
+position_compute_eval(const struct Position *pos, int *mg, int *eg, int *phase) {
+  *mg = 0;
+  *eg = 0;
+  *phase = 0;
+  for (int piece_id = 0; piece_id < POSITION_PIECES; piece_id++) {
+    int square = pos->piece_squares[piece_id];
+    if (square != POSITION_SQUARE_NONE) {
+      int type = position_piece_type(pos, piece_id);
+      const struct EvalTerm *term = eval_term(piece_owner(piece_id), type, square);
+      *mg += term->mg;
+      *eg += term->eg;
+      *phase += eval_phase_weight(type);
+    }
+  }
+}
+
+uint64_t
+position_compute_hash(const struct Position *pos) {
+  uint64_t hash = zobrist_side[pos->side_to_move];
+  for (int piece_id = 0; piece_id < POSITION_PIECES; piece_id++) {
+    int square = pos->piece_squares[piece_id];
+    if (square != POSITION_SQUARE_NONE) {
+      hash ^= piece_key(pos, piece_id, square);
+    }
+  }
+  return hash;
+}
+
+// The hash and evaluation sums of a position whose pieces have just been put down
+static void
+finish_position(struct Position *pos) {
+  pos->hash = position_compute_hash(pos);
+
+  int mg, eg, phase;
+  position_compute_eval(pos, &mg, &eg, &phase);
+  pos->eval_mg = (int16_t)mg;
+  pos->eval_eg = (int16_t)eg;
+  pos->phase = (uint8_t)phase;
+}
+
+void
+position_from_game(struct Position *pos,
+                   const struct ChessPieces *pieces,
+                   int num_pieces,
+                   int side_to_move) {
+  assert(num_pieces <= POSITION_PIECES);
+  position_init();
+
+  memset(pos, 0, sizeof *pos);
+  memset(pos->piece_squares, POSITION_SQUARE_NONE, sizeof pos->piece_squares);
+
+  // Game piece ids are laid out player by player the same way, so they carry straight over
+  for (int piece_id = 0; piece_id < num_pieces; piece_id++) {
+    assert(pieces->owners[piece_id] == piece_owner(piece_id));
+    position_set_piece_type(pos, piece_id, pieces->chess_type[piece_id]);
+
+    if (pieces->is_dead[piece_id]) {
+      continue;
+    }
+
+    Square square = pieces->squares[piece_id];
+    pos->piece_squares[piece_id] = (uint8_t)square;
+    pos->board[square] = (uint8_t)(piece_id + 1);
+  }
+
+  pos->side_to_move = (uint8_t)side_to_move;
+  finish_position(pos);
+}
+
+int
+position_from_fen(struct Position *pos, const char *fen) {
+  if (!piece_tables.standard_chess || N_ROWS != 8 || N_COLS != 8) {
+    printf("FEN only describes the standard pieces on an 8x8 board\n");
+    return -1;
+  }
+  position_init();
+
+  memset(pos, 0, sizeof *pos);
+  memset(pos->piece_squares, POSITION_SQUARE_NONE, sizeof pos->piece_squares);
+
+  // Ranks come from the far side down, seat 0 plays up the rows from row 0. The board is
+  // drawn with the a file on the last column, that's where the usual start has it.
+  static const char letters[] = "pnbrqk";
+  int counts[NUM_PLAYERS] = {0, 0};
+  int row = N_ROWS - 1;
+  int file = 0;
+  const char *c = fen;
+  for (; *c != '\0' && *c != ' '; c++) {
+    if (*c == '/') {
+      row--;
+      file = 0;
+      continue;
+    }
+    if (*c >= '1' && *c <= '8') {
+      file += *c - '0';
+      continue;
+    }
+
+    int seat = (*c >= 'A' && *c <= 'Z') ? WHITE_PLAYER : BLACK_PLAYER;
+    const char *letter = strchr(letters, seat == WHITE_PLAYER ? *c - 'A' + 'a' : *c);
+    if (letter == NULL || *letter == '\0' || row < 0 || file >= N_COLS || counts[seat] == N_PIECES) {
+      printf("bad FEN board at '%c': %s\n", *c, fen);
+      return -1;
+    }
+
+    int piece_id = (seat * N_PIECES) + counts[seat]++;
+    int square = (row * N_COLS) + (N_COLS - 1 - file++);
+    position_set_piece_type(pos, piece_id, (int)(letter - letters));
+    pos->piece_squares[piece_id] = (uint8_t)square;
+    pos->board[square] = (uint8_t)(piece_id + 1);
+  }
+
+  while (*c == ' ') {
+    c++;
+  }
+  if (*c != 'w' && *c != 'b') {
+    printf("bad FEN side to move: %s\n", fen);
+    return -1;
+  }
+  pos->side_to_move = *c == 'w' ? WHITE_PLAYER : BLACK_PLAYER;
+  finish_position(pos);
+  return 0;
+}
+
+void
+position_move_text(Move move, char *text) {
+  int squares[2] = {MOVE_FROM(move), MOVE_TO(move)};
+  for (int i = 0; i < 2; i++) {
+    text[(i * 2) + 0] = (char)('a' + (N_COLS - 1 - (squares[i] % N_COLS)));
+    text[(i * 2) + 1] = (char)('1' + (squares[i] / N_COLS));
+  }
+  text[4] = '\0';
+}
+
+void
+position_set_start(struct Position *pos, int side_to_move) {
+  // Set a two player game up so this always matches what main() plays
+  uint8_t game_memory[GAME_ARENA_SIZE];
+  struct Arena arena;
+  arena_init(&arena, &game_memory[0], sizeof game_memory);
+
+  struct Game *game = game_create(&arena, NUM_PLAYERS);
+  position_from_game(pos, &game->pieces, game->num_pieces, side_to_move);
+}
+
+int
+position_generate_moves(const struct Position *pos, Move *moves) {
+  if (piece_tables.standard_chess) {
+    return position_generate_moves_chess(pos, moves);
+  }
+  return position_generate_moves_generic(pos, moves);
+}
+
+int
+position_generate_captures(const struct Position *pos, Move *moves) {
+  if (piece_tables.standard_chess) {
+    return position_generate_captures_chess(pos, moves);
+  }
+  return position_generate_captures_generic(pos, moves);
+}
+
+int
+position_generate_quiets(const struct Position *pos, Move *moves) {
+  if (piece_tables.standard_chess) {
+    return position_generate_quiets_chess(pos, moves);
+  }
+  return position_generate_quiets_generic(pos, moves);
+}
+
+static inline const struct PieceTarget *
+piece_targets(const struct Position *pos, int piece_id, int square, const struct PieceTarget **end) {
+  int index = piece_table_index(&piece_tables, piece_owner(piece_id), position_piece_type(pos, piece_id), square);
+  const struct PieceTarget *first = &piece_tables.targets[piece_tables.starts[index]];
+  *end = first + piece_tables.counts[index];
+  return first;
+}
+
+static inline int
+generate_generic(const struct Position *pos, Move *moves, int kinds) {
+  // Same rules as game_piece_moves: walk the precomputed targets of each piece,
+  // stop at our own pieces and stop after a capture
+  int count = 0;
+  int side = pos->side_to_move;
+  int first = side * N_PIECES;
+
+  for (int piece_id = first; piece_id < first + N_PIECES; piece_id++) {
+    int from = pos->piece_squares[piece_id];
+    if (from == POSITION_SQUARE_NONE) {
+      continue;
+    }
+
+    const struct PieceTarget *end;
+    const struct PieceTarget *target = piece_targets(pos, piece_id, from, &end);
+
+    // Moves onto the far row turn the piece into whatever it promotes to
+    int type = position_piece_type(pos, piece_id);
+    int promotes = piece_tables.promotes_to[type] >= 0;
+    const uint8_t *promotion_squares = &piece_tables.promotion_squares[side * N_CELLS];
+
+    while (target < end) {
+      int to = target->square;
+      int occupant = pos->board[to];
+      int flags = (promotes && promotion_squares[to]) ? MOVE_PROMOTE : 0;
+
+      if (occupant == 0) {
+        if (!(target->flags & PIECE_CAPTURE_ONLY) && (kinds & (flags ? POSITION_GEN_CAPTURES : POSITION_GEN_QUIETS))) {
+          moves[count++] = MAKE_MOVE(from, to, flags);
+        }
+        target++;
+        continue;
+      }
+
+      if ((kinds & POSITION_GEN_CAPTURES) && piece_owner(occupant - 1) != side && !(target->flags & PIECE_MOVE_ONLY)) {
+        moves[count++] = MAKE_MOVE(from, to, flags | MOVE_CAPTURE);
+      }
+      target += target->skip;
+    }
+  }
+
+  assert(count <= POSITION_MAX_MOVES);
+  return count;
+}
+
+int
+position_generate_moves_generic(const struct Position *pos, Move *moves) {
+  return generate_generic(pos, moves, POSITION_GEN_ALL);
+}
+
+int
+position_generate_captures_generic(const struct Position *pos, Move *moves) {
+  return generate_generic(pos, moves, POSITION_GEN_CAPTURES);
+}
+
+int
+position_generate_quiets_generic(const struct Position *pos, Move *moves) {
+  return generate_generic(pos, moves, POSITION_GEN_QUIETS);
+}
+
+int
+position_move_is_pseudo_legal(const struct Position *pos, Move move) {
+  // Walks the mover's targets the way the generic generator does until it gets to the
+  // destination, the flags it would have given the move have to match too
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  int mover = pos->board[from] - 1;
+  if (move == MOVE_NONE || mover < 0 || piece_owner(mover) != pos->side_to_move) {
+    return 0;
+  }
+
+  int side = pos->side_to_move;
+  int occupant = pos->board[to];
+  if (occupant != 0 && piece_owner(occupant - 1) == side) {
+    return 0;
+  }
+  int type = position_piece_type(pos, mover);
+  int promotes = piece_tables.promotes_to[type] >= 0 && piece_tables.promotion_squares[(side * N_CELLS) + to];
+  int flags = (promotes ? MOVE_PROMOTE : 0) | (occupant != 0 ? MOVE_CAPTURE : 0);
+  if (MOVE_FLAGS(move) != flags) {
+    return 0;
+  }
+
+  const struct PieceTarget *end;
+  const struct PieceTarget *target = piece_targets(pos, mover, from, &end);
+  while (target < end) {
+    if (target->square == to) {
+      int blocked = occupant == 0 ? (target->flags & PIECE_CAPTURE_ONLY) : (target->flags & PIECE_MOVE_ONLY);
+      if (!blocked) {
+        return 1;
+      }
+    }
+    target += pos->board[target->square] == 0 ? 1 : target->skip;
+  }
+  return 0;
+}
+
+int
+position_square_attacked(const struct Position *pos, int square, int by_seat) {
+  // Most pieces can't get to the square even on an empty board, only the rest walk their lines
+  int first = by_seat * N_PIECES;
+  for (int piece_id = first; piece_id < first + N_PIECES; piece_id++) {
+    int from = pos->piece_squares[piece_id];
+    if (from == POSITION_SQUARE_NONE) {
+      continue;
+    }
+    int index = piece_table_index(&piece_tables, by_seat, position_piece_type(pos, piece_id), from);
+    if (!(piece_tables.reach[index] & (1ull << square))) {
+      continue;
+    }
+
+    const struct PieceTarget *end;
+    const struct PieceTarget *target = piece_targets(pos, piece_id, from, &end);
+    while (target < end) {
+      if (target->square == square && !(target->flags & PIECE_MOVE_ONLY)) {
+        return 1;
+      }
+      target += pos->board[target->square] == 0 ? 1 : target->skip;
+    }
+  }
+  return 0;
+}
+
+int
+position_in_check(const struct Position *pos, int seat) {
+  int first = seat * N_PIECES;
+  for (int piece_id = first; piece_id < first + N_PIECES; piece_id++) {
+    int square = pos->piece_squares[piece_id];
+    if (square != POSITION_SQUARE_NONE && position_piece_type(pos, piece_id) == KING) {
+      return position_square_attacked(pos, square, (seat + 1) % NUM_PLAYERS);
+    }
+  }
+  return 0;
+}
+
+static inline void
+make_move(struct Position *pos, Move move, struct PositionUndo *undo) {
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  int mover = pos->board[from] - 1;
+  int captured = pos->board[to];
+
+  assert(mover >= 0);
+
+  uint64_t hash = pos->hash ^ zobrist_side[pos->side_to_move];
+  struct EvalSums sums = {pos->eval_mg, pos->eval_eg, pos->phase};
+  int seat = piece_owner(mover);
+  int mover_type = position_piece_type(pos, mover);
+
+  if (captured != 0) {
+    pos->piece_squares[captured - 1] = POSITION_SQUARE_NONE;
+    hash ^= piece_key(pos, captured - 1, to);
+    eval_add(&sums, piece_owner(captured - 1), position_piece_type(pos, captured - 1), to, -1);
+  }
+
+  if (undo != NULL) {
+    undo->captured = (uint8_t)captured;
+    undo->mover_type = (uint8_t)mover_type;
+    undo->phase = pos->phase;
+    undo->eval_mg = pos->eval_mg;
+    undo->eval_eg = pos->eval_eg;
+  }
+
+  pos->board[to] = (uint8_t)(mover + 1);
+  pos->board[from] = 0;
+  pos->piece_squares[mover] = (uint8_t)to;
+  hash ^= piece_key(pos, mover, from);
+  eval_add(&sums, seat, mover_type, from, -1);
+  if (MOVE_FLAGS(move) & MOVE_PROMOTE) {
+    mover_type = piece_tables.promotes_to[mover_type];
+    position_set_piece_type(pos, mover, mover_type);
+  }
+  hash ^= piece_key(pos, mover, to);
+  eval_add(&sums, seat, mover_type, to, 1);
+
+  pos->side_to_move = (uint8_t)((pos->side_to_move + 1) % NUM_PLAYERS);
+  pos->hash = hash ^ zobrist_side[pos->side_to_move];
+  pos->ply++;
+  eval_store(pos, &sums);
+}
+
+void
+position_make_move(struct Position *pos, Move move, struct PositionUndo *undo) {
+  make_move(pos, move, undo);
+}
+
+void
+position_unmake_move(struct Position *pos, Move move, const struct PositionUndo *undo) {
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  int mover = pos->board[to] - 1;
+  int captured = undo->captured;
+
+  uint64_t hash = pos->hash ^ zobrist_side[pos->side_to_move];
+  pos->side_to_move = (uint8_t)((pos->side_to_move + NUM_PLAYERS - 1) % NUM_PLAYERS);
+  pos->ply--;
+
+  pos->board[from] = (uint8_t)(mover + 1);
+  pos->board[to] = (uint8_t)captured;
+  pos->piece_squares[mover] = (uint8_t)from;
+  hash ^= piece_key(pos, mover, to);
+  position_set_piece_type(pos, mover, undo->mover_type);
+  hash ^= piece_key(pos, mover, from);
+
+  if (captured != 0) {
+    pos->piece_squares[captured - 1] = (uint8_t)to;
+    hash ^= piece_key(pos, captured - 1, to);
+  }
+
+  pos->hash = hash ^ zobrist_side[pos->side_to_move];
+  pos->eval_mg = undo->eval_mg;
+  pos->eval_eg = undo->eval_eg;
+  pos->phase = undo->phase;
+}
+
+void
+position_copy_make(struct Position *child, const struct Position *parent, Move move) {
+  *child = *parent;
+  make_move(child, move, NULL);
+}
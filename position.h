@@ -0,0 +1,141 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include "stdint.h"
+#include "chess.h"
+#include "eval.h"
+
+// Everything needed to carry on a game, packed into two cache lines with no pointers,
+// so search can either copy it per ply (copy-make) or mutate it in place (make/unmake).
+// Make and unmake keep the evaluation's sums up to date like the hash (eval.h).
+
+#define POSITION_PIECES (NUM_PLAYERS * N_PIECES)
+#define POSITION_SQUARE_NONE 0xFF
+#define POSITION_MAX_MOVES 256
+
+#if N_CELLS > 64
+#error "struct Position and Move pack squares into 6 bits, boards bigger than 8x8 use the Cells tables"
+#endif
+
+// Moves are 16 bits: from (6) | to (6) | flags (4)
+typedef uint16_t Move;
+
+#define MOVE_NONE ((Move)0)
+#define MOVE_CAPTURE 1
+#define MOVE_PROMOTE 2
+
+#define MAKE_MOVE(from, to, flags) ((Move)((from) | ((to) << 6) | ((flags) << 12)))
+#define MOVE_FROM(move) ((move) & 0x3F)
+#define MOVE_TO(move) (((move) >> 6) & 0x3F)
+#define MOVE_FLAGS(move) ((move) >> 12)
+
+struct Position {
+  uint64_t hash; // zobrist hash of pieces and side to move
+  uint8_t board[N_CELLS]; // piece id + 1 on each square, 0 when empty
+  uint8_t piece_squares[POSITION_PIECES]; // square of each piece id, POSITION_SQUARE_NONE once captured
+  uint8_t piece_types[POSITION_PIECES / 2]; // ChessPiece of each piece id, two per byte
+  uint8_t side_to_move;
+  uint8_t phase; // eval_phase_weight of every piece on the board
+  uint16_t ply;
+  int16_t eval_mg; // eval_term of every piece on the board, for seat 0
+  int16_t eval_eg;
+} __attribute__((aligned(64)));
+
+// C99 has no static_assert, this fails to compile if the struct outgrows two cache lines
+typedef char position_size_check[(sizeof (struct Position) <= 128) ? 1 : -1];
+
+// What make needs to hand back to unmake
+struct PositionUndo {
+  uint8_t captured; // piece id + 1 of the captured piece, 0 if nothing was taken
+  uint8_t mover_type; // what the moving piece was before it promoted
+  uint8_t phase; // the evaluation sums before the move
+  int16_t eval_mg;
+  int16_t eval_eg;
+};
+
+// Piece ids are laid out player by player, N_PIECES each
+static inline int
+piece_owner(int piece_id) {
+  return piece_id / N_PIECES;
+}
+
+static inline int
+position_piece_type(const struct Position *pos, int piece_id) {
+  uint8_t packed = pos->piece_types[piece_id >> 1];
+  return (piece_id & 1) ? (packed >> 4) : (packed & 0x0F);
+}
+
+static inline void
+position_set_piece_type(struct Position *pos, int piece_id, int type) {
+  uint8_t *packed = &pos->piece_types[piece_id >> 1];
+  if (piece_id & 1) {
+    *packed = (uint8_t)((*packed & 0x0F) | (type << 4));
+  }
+  else {
+    *packed = (uint8_t)((*packed & 0xF0) | type);
+  }
+}
+
+void position_init(void);
+
+// Builds a position from the piece table main() draws from, only two player games fit
+void position_from_game(struct Position *pos,
+                        const struct ChessPieces *pieces,
+                        int num_pieces,
+                        int side_to_move);
+void position_set_start(struct Position *pos, int side_to_move);
+// Only the board and side to move are read, there's no castling or en passant to set up.
+// Returns -1 after printing what was wrong with it
+int position_from_fen(struct Position *pos, const char *fen);
+// From and to squares the way FEN names them, "e2e4", text needs room for 5
+void position_move_text(Move move, char *text);
+
+uint64_t position_compute_hash(const struct Position *pos);
+
+// What make and unmake keep in eval_mg, eval_eg and phase, from scratch
+void position_compute_eval(const struct Position *pos, int *mg, int *eg, int *phase);
+
+// Centipawns for the side to move, from the sums make and unmake keep
+static inline int
+position_evaluate(const struct Position *pos) {
+  int score = eval_taper(pos->eval_mg, pos->eval_eg, pos->phase);
+  return pos->side_to_move == 0 ? score : -score;
+}
+
+// Which moves a generator keeps. Promotions go with the captures since they change the
+// material too, the quiet moves are the ones that leave it alone.
+#define POSITION_GEN_CAPTURES 1
+#define POSITION_GEN_QUIETS 2
+#define POSITION_GEN_ALL (POSITION_GEN_CAPTURES | POSITION_GEN_QUIETS)
+
+// Uses the specialized standard chess generator (movegen_chess.c) when that's what the
+// piece definitions describe and the generic table walk otherwise. Both give the same moves,
+// though not necessarily in the same order. Captures and quiets together are every move,
+// search generates them one after the other so a cutoff on a capture never pays for quiets.
+int position_generate_moves(const struct Position *pos, Move *moves);
+int position_generate_captures(const struct Position *pos, Move *moves);
+int position_generate_quiets(const struct Position *pos, Move *moves);
+int position_generate_moves_generic(const struct Position *pos, Move *moves);
+int position_generate_captures_generic(const struct Position *pos, Move *moves);
+int position_generate_quiets_generic(const struct Position *pos, Move *moves);
+int position_generate_moves_chess(const struct Position *pos, Move *moves);
+int position_generate_captures_chess(const struct Position *pos, Move *moves);
+int position_generate_quiets_chess(const struct Position *pos, Move *moves);
+
+// Whether the generator would give this move here, for moves that come from somewhere other
+// than this position (the transposition table, killers). Moves are only pseudo legal, they
+// can still leave the mover's own king attacked.
+int position_move_is_pseudo_legal(const struct Position *pos, Move move);
+
+// Whether any of seat's pieces could capture on square, and whether seat's king is attacked.
+// A seat without a king is never in check.
+int position_square_attacked(const struct Position *pos, int square, int by_seat);
+int position_in_check(const struct Position *pos, int seat);
+
+void position_make_move(struct Position *pos, Move move, struct PositionUndo *undo);
+void position_unmake_move(struct Position *pos, Move move, const struct PositionUndo *undo);
+
+// Copy-make, the parent is left untouched so there is nothing to undo
+void position_copy_make(struct Position *child, const struct Position *parent, Move move);
+
+#endif
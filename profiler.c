@@ -0,0 +1,233 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "time.h"
+#include "raylib.h"
+#include "profiler.h"
+
+#define MAX_PROFILE_THREADS 16
+#define PROFILE_RING_MASK (PROFILE_RING_SIZE - 1)
+#define PROFILE_SNAPSHOT_SIZE (PROFILE_RING_SIZE * MAX_PROFILE_THREADS)
+#define PROFILE_STATS_INTERVAL_NS 250000000ull
+
+static const char *PROFILE_PHASE_NAMES[NUM_PROFILE_PHASES] = {
+  "frame",
+  "camera",
+  "input",
+  "moves",
+  "next_piece",
+  "draw_pieces",
+  "present",
+  "tick",
+  "publish",
+  "animate",
+  "think"
+};
+
+// Single producer ring, only the owning thread writes samples and bumps head.
+// Readers copy the window behind head and then throw away anything the writer
+// lapped while they were copying, so nobody ever takes a lock.
+struct ProfileRing {
+  uint64_t head;
+  uint32_t thread_id;
+  struct ProfileSample samples[PROFILE_RING_SIZE];
+};
+
+// Rings are handed out from a fixed pool so recording never allocates
+static struct ProfileRing rings[MAX_PROFILE_THREADS];
+static uint32_t rings_claimed = 0;
+static __thread struct ProfileRing *thread_ring = NULL;
+
+static struct ProfileSample snapshot_buf[PROFILE_SNAPSHOT_SIZE];
+static uint64_t duration_buf[PROFILE_SNAPSHOT_SIZE];
+
+static struct ProfileStats overlay_stats;
+static uint64_t overlay_stats_time = 0;
+
+uint64_t
+profiler_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+const char *
+profiler_phase_name(ProfilePhase phase) {
+  if (phase < 0 || phase >= NUM_PROFILE_PHASES) {
+    return "unknown";
+  }
+  return PROFILE_PHASE_NAMES[phase];
+}
+
+static struct ProfileRing *
+claim_ring(void) {
+  uint32_t index = __atomic_fetch_add(&rings_claimed, 1, __ATOMIC_ACQ_REL);
+  if (index >= MAX_PROFILE_THREADS) {
+    return NULL; // Out of rings, this thread just doesn't get profiled
+  }
+  rings[index].thread_id = index;
+  return &rings[index];
+}
+
+void
+profiler_record(ProfilePhase phase, uint64_t start_ns, uint64_t end_ns) {
+  struct ProfileRing *ring = thread_ring;
+  if (ring == NULL) {
+    ring = thread_ring = claim_ring();
+    if (ring == NULL) {
+      return;
+    }
+  }
+
+  uint64_t head = ring->head;
+  struct ProfileSample *sample = &ring->samples[head & PROFILE_RING_MASK];
+  sample->start_ns = start_ns;
+  sample->end_ns = end_ns;
+  sample->phase = phase;
+  sample->thread_id = ring->thread_id;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+int
+profiler_snapshot(struct ProfileSample *out, int max_samples) {
+  int count = 0;
+  uint32_t num_rings = __atomic_load_n(&rings_claimed, __ATOMIC_ACQUIRE);
+  if (num_rings > MAX_PROFILE_THREADS) {
+    num_rings = MAX_PROFILE_THREADS;
+  }
+
+  for (uint32_t r = 0; r < num_rings; r++) {
+    struct ProfileRing *ring = &rings[r];
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t first = head > PROFILE_RING_SIZE ? head - PROFILE_RING_SIZE : 0;
+    int ring_start = count;
+
+    for (uint64_t i = first; i < head && count < max_samples; i++) {
+      out[count++] = ring->samples[i & PROFILE_RING_MASK];
+    }
+
+    // Anything the writer wrapped over while we copied is garbage now. That includes the slot
+    // at head_after, which it can be partway through filling before it publishes head_after + 1.
+    uint64_t head_after = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t valid_from = head_after >= PROFILE_RING_SIZE ? head_after - PROFILE_RING_SIZE + 1 : 0;
+    if (valid_from > first) {
+      int stale = (int)(valid_from - first);
+      int copied = count - ring_start;
+      if (stale >= copied) {
+        count = ring_start;
+      }
+      else {
+        for (int i = 0; i < copied - stale; i++) {
+          out[ring_start + i] = out[ring_start + stale + i];
+        }
+        count -= stale;
+      }
+    }
+  }
+  return count;
+}
+
+static int
+compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+void
+profiler_compute_stats(struct ProfileStats *stats) {
+  int num_samples = profiler_snapshot(snapshot_buf, PROFILE_SNAPSHOT_SIZE);
+
+  for (int phase = 0; phase < NUM_PROFILE_PHASES; phase++) {
+    int n = 0;
+    for (int i = 0; i < num_samples; i++) {
+      if (snapshot_buf[i].phase == (uint32_t)phase) {
+        duration_buf[n++] = snapshot_buf[i].end_ns - snapshot_buf[i].start_ns;
+      }
+    }
+
+    stats->counts[phase] = n;
+    if (n == 0) {
+      stats->p50_ns[phase] = 0;
+      stats->p99_ns[phase] = 0;
+      continue;
+    }
+
+    qsort(duration_buf, n, sizeof duration_buf[0], compare_u64);
+    stats->p50_ns[phase] = duration_buf[n / 2];
+    stats->p99_ns[phase] = duration_buf[(n * 99) / 100];
+  }
+}
+
+void
+profiler_draw_overlay(int x, int y) {
+  // Sorting every frame would eat the budget we are trying to measure,
+  // so the numbers only refresh a few times a second
+  uint64_t now = profiler_now();
+  if (now - overlay_stats_time >= PROFILE_STATS_INTERVAL_NS) {
+    profiler_compute_stats(&overlay_stats);
+    overlay_stats_time = now;
+  }
+
+  int line_height = 12;
+  DrawRectangle(x, y, 260, line_height * (NUM_PROFILE_PHASES + 1) + 8, Fade(BLACK, 0.6f));
+  DrawText("phase          p50 us   p99 us", x + 4, y + 4, 10, RAYWHITE);
+
+  for (int phase = 0; phase < NUM_PROFILE_PHASES; phase++) {
+    DrawText(TextFormat("%-12s %8.1f %8.1f",
+                        profiler_phase_name(phase),
+                        overlay_stats.p50_ns[phase] / 1000.0,
+                        overlay_stats.p99_ns[phase] / 1000.0),
+             x + 4, y + 4 + line_height * (phase + 1), 10, RAYWHITE);
+  }
+}
+
+int
+profiler_export_csv(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return -1;
+  }
+
+  int num_samples = profiler_snapshot(snapshot_buf, PROFILE_SNAPSHOT_SIZE);
+  fprintf(file, "thread,phase,start_ns,end_ns,duration_ns\n");
+  for (int i = 0; i < num_samples; i++) {
+    struct ProfileSample s = snapshot_buf[i];
+    fprintf(file, "%u,%s,%llu,%llu,%llu\n",
+            s.thread_id,
+            profiler_phase_name(s.phase),
+            (unsigned long long)s.start_ns,
+            (unsigned long long)s.end_ns,
+            (unsigned long long)(s.end_ns - s.start_ns));
+  }
+
+  fclose(file);
+  return num_samples;
+}
+
+int
+profiler_export_trace(const char *path) {
+  // Chrome trace-event format, load it in chrome://tracing or Perfetto
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return -1;
+  }
+
+  int num_samples = profiler_snapshot(snapshot_buf, PROFILE_SNAPSHOT_SIZE);
+  fprintf(file, "{\"traceEvents\":[\n");
+  for (int i = 0; i < num_samples; i++) {
+    struct ProfileSample s = snapshot_buf[i];
+    fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            profiler_phase_name(s.phase),
+            s.thread_id,
+            s.start_ns / 1000.0,
+            (s.end_ns - s.start_ns) / 1000.0,
+            i + 1 < num_samples ? "," : "");
+  }
+  fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+
+  fclose(file);
+  return num_samples;
+}
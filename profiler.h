@@ -0,0 +1,75 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "stdint.h"
+
+// Frame phases we time. Keep PROFILE_PHASE_NAMES in profiler.c in sync.
+typedef enum ProfilePhase {
+  PHASE_FRAME = 0,
+  PHASE_CAMERA = 1,
+  PHASE_INPUT = 2,
+  PHASE_MOVES = 3,
+  PHASE_NEXT_PIECE = 4,
+  PHASE_DRAW_PIECES = 5,
+  PHASE_PRESENT = 6,
+  PHASE_TICK = 7,
+  PHASE_PUBLISH = 8,
+  PHASE_ANIMATE = 9,
+  PHASE_THINK = 10,
+  NUM_PROFILE_PHASES
+} ProfilePhase;
+
+// Build with -DPROFILER (make profile) to turn the timers on.
+// Without it every macro expands to nothing so there is no cost at all.
+//
+// PROFILE_SCOPE wraps a block:
+//   PROFILE_SCOPE(PHASE_CAMERA) { rlTPCameraUpdate(&cam); }
+// don't `break` or `return` out of the block or the sample is dropped,
+// use PROFILE_BEGIN / PROFILE_END around code that does that.
+#ifdef PROFILER
+
+#define PROFILE_BEGIN(phase) uint64_t profile_start_##phase = profiler_now()
+#define PROFILE_END(phase) profiler_record((phase), profile_start_##phase, profiler_now())
+#define PROFILE_SCOPE(phase) \
+  for (uint64_t profile_scope_start = profiler_now(), profile_scope_once = 1; \
+       profile_scope_once; \
+       profile_scope_once = 0, profiler_record((phase), profile_scope_start, profiler_now()))
+
+#else
+
+#define PROFILE_BEGIN(phase)
+#define PROFILE_END(phase)
+#define PROFILE_SCOPE(phase)
+
+#endif
+
+// Samples kept per thread, older ones are overwritten
+#define PROFILE_RING_SIZE 8192
+
+struct ProfileSample {
+  uint64_t start_ns;
+  uint64_t end_ns;
+  uint32_t phase;
+  uint32_t thread_id;
+};
+
+struct ProfileStats {
+  uint64_t p50_ns[NUM_PROFILE_PHASES];
+  uint64_t p99_ns[NUM_PROFILE_PHASES];
+  int counts[NUM_PROFILE_PHASES];
+};
+
+uint64_t profiler_now(void);
+void profiler_record(ProfilePhase phase, uint64_t start_ns, uint64_t end_ns);
+
+// Copies out the most recent samples of every thread, returns how many were written
+int profiler_snapshot(struct ProfileSample *out, int max_samples);
+void profiler_compute_stats(struct ProfileStats *stats);
+
+void profiler_draw_overlay(int x, int y);
+int profiler_export_csv(const char *path);
+int profiler_export_trace(const char *path);
+
+const char *profiler_phase_name(ProfilePhase phase);
+
+#endif
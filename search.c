@@ -0,0 +1,620 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "stdint.h"
+#include "string.h"
+#include "time.h"
+#include "chess.h"
+#include "position.h"
+#include "tt.h"
+#include "nnue.h"
+#include "move_picker.h"
+#include "see.h"
+#include "time_manager.h"
+#include "search.h"
+
+void
+search_init(struct Search *search, struct Tt *tt, const struct Nnue *net) {
+  memset(search, 0, sizeof *search);
+  search->tt = tt;
+  search->net = net;
+  search->ordering = MOVE_ORDER_HISTORY;
+  search->quiescence = 1;
+  search->multi_pv = 1;
+  search->nnue.net = net;
+}
+
+void
+search_clear(struct Search *search) {
+  move_history_clear(&search->history);
+  if (search->tt != NULL) {
+    tt_clear(search->tt);
+  }
+}
+
+void
+search_set_position(struct Search *search, const struct Position *pos) {
+  search->pos = *pos;
+  if (search->net != NULL) {
+    nnue_stack_reset(&search->nnue, search->net, pos);
+  }
+}
+
+static inline int
+evaluate(const struct Search *search) {
+  if (search->net != NULL) {
+    return nnue_stack_evaluate(&search->nnue, &search->pos);
+  }
+  return position_evaluate(&search->pos);
+}
+
+static inline void
+make_move(struct Search *search, Move move, struct PositionUndo *undo) {
+  if (search->net != NULL) {
+    nnue_push_move(&search->nnue, &search->pos, move);
+  }
+  position_make_move(&search->pos, move, undo);
+}
+
+static inline void
+unmake_move(struct Search *search, Move move, const struct PositionUndo *undo) {
+  position_unmake_move(&search->pos, move, undo);
+  if (search->net != NULL) {
+    nnue_pop(&search->nnue);
+  }
+}
+
+// The table keeps mate scores as distances from the position that's stored, search's are
+// from the root, so they're shifted by the ply on the way in and out
+static inline int
+score_to_tt(int score, int ply) {
+  if (score >= SEARCH_MATE_BOUND) {
+    return score + ply;
+  }
+  if (score <= -SEARCH_MATE_BOUND) {
+    return score - ply;
+  }
+  return score;
+}
+
+static inline int
+score_from_tt(int score, int ply) {
+  if (score >= SEARCH_MATE_BOUND) {
+    return score - ply;
+  }
+  if (score <= -SEARCH_MATE_BOUND) {
+    return score + ply;
+  }
+  return score;
+}
+
+static inline int
+is_repetition(const struct Search *search, int ply) {
+  // Only the side to move's own earlier positions can be the same one
+  for (int earlier = ply - 2; earlier >= 0; earlier -= 2) {
+    if (search->hashes[earlier] == search->pos.hash) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static inline void
+update_line(struct Search *search, int ply, Move move) {
+  Move *line = search->lines[ply];
+  int child_length = search->line_lengths[ply + 1];
+  line[0] = move;
+  memcpy(&line[1], search->lines[ply + 1], child_length * sizeof (Move));
+  search->line_lengths[ply] = child_length + 1;
+}
+
+static inline void
+update_killers(struct Search *search, int ply, Move move) {
+  Move *killers = search->killers[ply];
+  if (killers[0] != move) {
+    killers[1] = killers[0];
+    killers[0] = move;
+  }
+}
+
+static inline int
+node_entered(struct Search *search, int ply) {
+  // Returns 1 when search has to stop
+  search->line_lengths[ply] = 0;
+  search->nodes++;
+  if (search->node_limit != 0 && search->nodes >= search->node_limit) {
+    search->stopped = 1;
+  }
+  return search->stopped;
+}
+
+static uint64_t
+now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+static inline void
+push_frame(struct Search *search, int state, int alpha, int beta, int depth, Move previous) {
+  struct SearchFrame *frame = &search->frames[search->height++];
+  frame->state = state;
+  frame->alpha = alpha;
+  frame->beta = beta;
+  frame->depth = depth;
+  frame->previous = previous;
+}
+
+// The top frame is done, its parent picks score up from returned
+static inline void
+leave(struct Search *search, int score) {
+  search->height--;
+  search->returned = score;
+}
+
+// Searches the frame's move as a child, the first one gets the whole window, the rest only
+// have to show they're no better and are searched again properly if they are
+static inline void
+search_child(struct Search *search, struct SearchFrame *frame, Move move) {
+  frame->move = move;
+  frame->state = NODE_SEARCHED;
+  frame->null_window = frame->legal_moves > 1;
+  int beta = frame->null_window ? frame->alpha + 1 : frame->beta;
+  push_frame(search, NODE_ENTER, -beta, -frame->alpha, frame->depth - 1, move);
+}
+
+static void
+node_enter(struct Search *search, struct SearchFrame *frame, int ply) {
+  struct Position *pos = &search->pos;
+  int pv_node = frame->beta - frame->alpha > 1;
+
+  // Checks are searched a ply deeper so the horizon doesn't land in the middle of one,
+  // otherwise quiescence takes over there and counts the node itself
+  frame->side = pos->side_to_move;
+  frame->in_check = position_in_check(pos, frame->side);
+  if (frame->depth <= 0 && !frame->in_check && search->quiescence) {
+    frame->state = QUIESCE_ENTER;
+    return;
+  }
+  if (node_entered(search, ply)) {
+    leave(search, 0);
+    return;
+  }
+
+  if (ply > 0 && is_repetition(search, ply)) {
+    leave(search, 0);
+    return;
+  }
+  search->hashes[ply] = pos->hash;
+  frame->depth += frame->in_check;
+  if (frame->depth <= 0 || ply >= SEARCH_MAX_PLY - 1) {
+    leave(search, evaluate(search));
+    return;
+  }
+
+  Move tt_move = MOVE_NONE;
+  const struct TtEntry *entry = search->tt != NULL ? tt_probe(search->tt, pos->hash) : NULL;
+  if (entry != NULL) {
+    tt_move = entry->move;
+    int score = score_from_tt(entry->score, ply);
+    int bound = tt_bound(entry);
+    if (!pv_node && entry->depth >= frame->depth &&
+        (bound == TT_BOUND_EXACT ||
+         (bound == TT_BOUND_LOWER && score >= frame->beta) ||
+         (bound == TT_BOUND_UPPER && score <= frame->alpha))) {
+      leave(search, score);
+      return;
+    }
+  }
+
+  move_picker_init(&frame->picker,
+                   pos,
+                   &search->history,
+                   tt_move,
+                   search->killers[ply],
+                   move_history_counter(&search->history, pos, frame->previous),
+                   search->ordering);
+  frame->quiet_count = 0;
+  frame->legal_moves = 0;
+  frame->best_score = -SEARCH_INFINITE;
+  frame->best_move = MOVE_NONE;
+  frame->bound = TT_BOUND_UPPER;
+  frame->state = NODE_NEXT_MOVE;
+}
+
+// The moves earlier lines of this iteration start with, only the root leaves them out
+static inline int
+in_earlier_line(const struct Search *search, Move move) {
+  for (int line = 0; line < search->line_index; line++) {
+    if (search->iteration_lines[line].moves[0] == move) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void
+node_finish(struct Search *search, struct SearchFrame *frame, int ply) {
+  if (frame->legal_moves == 0) {
+    leave(search, frame->in_check ? -SEARCH_MATE + ply : 0);
+    return;
+  }
+  // A root with moves left out doesn't have its real best move or score
+  if (search->tt != NULL && (ply > 0 || search->line_index == 0)) {
+    tt_store(search->tt,
+             search->pos.hash,
+             frame->best_move,
+             score_to_tt(frame->best_score, ply),
+             0,
+             frame->depth,
+             frame->bound);
+  }
+  leave(search, frame->best_score);
+}
+
+static void
+node_next_move(struct Search *search, struct SearchFrame *frame, int ply) {
+  Move move = move_picker_next(&frame->picker);
+  if (move == MOVE_NONE) {
+    node_finish(search, frame, ply);
+    return;
+  }
+  if (ply == 0 && in_earlier_line(search, move)) {
+    return;
+  }
+
+  make_move(search, move, &frame->undo);
+  if (position_in_check(&search->pos, frame->side)) {
+    unmake_move(search, move, &frame->undo);
+    return;
+  }
+  frame->legal_moves++;
+  search_child(search, frame, move);
+}
+
+static void
+node_searched(struct Search *search, struct SearchFrame *frame, int ply) {
+  Move move = frame->move;
+  int score = -search->returned;
+  if (frame->null_window && score > frame->alpha && score < frame->beta) {
+    frame->null_window = 0;
+    push_frame(search, NODE_ENTER, -frame->beta, -frame->alpha, frame->depth - 1, move);
+    return;
+  }
+  unmake_move(search, move, &frame->undo);
+  frame->state = NODE_NEXT_MOVE;
+
+  if (score > frame->best_score) {
+    frame->best_score = score;
+    frame->best_move = move;
+    if (score > frame->alpha) {
+      frame->alpha = score;
+      frame->bound = TT_BOUND_EXACT;
+      update_line(search, ply, move);
+    }
+  }
+  if (frame->alpha >= frame->beta) {
+    frame->bound = TT_BOUND_LOWER;
+    if (move_is_quiet(move)) {
+      update_killers(search, ply, move);
+      move_history_update(&search->history,
+                          &search->pos,
+                          frame->previous,
+                          move,
+                          frame->quiets_tried,
+                          frame->quiet_count,
+                          frame->depth);
+    }
+    node_finish(search, frame, ply);
+    return;
+  }
+  if (move_is_quiet(move)) {
+    frame->quiets_tried[frame->quiet_count++] = move;
+  }
+}
+
+// Only captures that don't lose material, unless the side to move is in check when every
+// evasion is tried. Otherwise the side to move can always stand pat on the static evaluation
+// rather than take, and captures that couldn't lift it to alpha even winning the piece
+// outright (delta pruning) aren't tried.
+static void
+quiesce_enter(struct Search *search, struct SearchFrame *frame, int ply) {
+  struct Position *pos = &search->pos;
+  if (node_entered(search, ply)) {
+    leave(search, 0);
+    return;
+  }
+  if (ply >= SEARCH_MAX_PLY - 1) {
+    leave(search, evaluate(search));
+    return;
+  }
+
+  frame->side = pos->side_to_move;
+  frame->in_check = position_in_check(pos, frame->side);
+  frame->best_score = -SEARCH_INFINITE;
+  frame->stand_pat = 0;
+  if (frame->in_check) {
+    static const Move no_killers[2] = {MOVE_NONE, MOVE_NONE};
+    move_picker_init(&frame->picker, pos, &search->history, MOVE_NONE, no_killers, MOVE_NONE, search->ordering);
+  }
+  else {
+    frame->stand_pat = evaluate(search);
+    if (frame->stand_pat >= frame->beta) {
+      leave(search, frame->stand_pat);
+      return;
+    }
+    frame->alpha = MAX(frame->alpha, frame->stand_pat);
+    frame->best_score = frame->stand_pat;
+    move_picker_init_captures(&frame->picker, pos, search->ordering);
+  }
+  frame->legal_moves = 0;
+  frame->state = QUIESCE_NEXT_MOVE;
+}
+
+static void
+quiesce_next_move(struct Search *search, struct SearchFrame *frame, int ply) {
+  struct Position *pos = &search->pos;
+  Move move = move_picker_next(&frame->picker);
+  if (move == MOVE_NONE) {
+    leave(search, frame->in_check && frame->legal_moves == 0 ? -SEARCH_MATE + ply : frame->best_score);
+    return;
+  }
+
+  if (!frame->in_check && !(MOVE_FLAGS(move) & MOVE_PROMOTE)) {
+    int victim = pos->board[MOVE_TO(move)] - 1;
+    if (frame->stand_pat + see_value(position_piece_type(pos, victim)) + SEARCH_DELTA_MARGIN < frame->alpha) {
+      return;
+    }
+  }
+
+  make_move(search, move, &frame->undo);
+  if (position_in_check(pos, frame->side)) {
+    unmake_move(search, move, &frame->undo);
+    return;
+  }
+  frame->legal_moves++;
+  frame->move = move;
+  frame->state = QUIESCE_SEARCHED;
+  push_frame(search, QUIESCE_ENTER, -frame->beta, -frame->alpha, 0, move);
+}
+
+static void
+quiesce_searched(struct Search *search, struct SearchFrame *frame, int ply) {
+  int score = -search->returned;
+  unmake_move(search, frame->move, &frame->undo);
+  frame->state = QUIESCE_NEXT_MOVE;
+
+  if (score > frame->best_score) {
+    frame->best_score = score;
+    if (score > frame->alpha) {
+      frame->alpha = score;
+      update_line(search, ply, frame->move);
+      if (frame->alpha >= frame->beta) {
+        leave(search, frame->best_score);
+      }
+    }
+  }
+}
+
+// Moves the top frame on by one state
+static inline void
+step(struct Search *search) {
+  int ply = search->height - 1;
+  struct SearchFrame *frame = &search->frames[ply];
+  switch (frame->state) {
+    case NODE_ENTER:
+      node_enter(search, frame, ply);
+      break;
+    case NODE_NEXT_MOVE:
+      node_next_move(search, frame, ply);
+      break;
+    case NODE_SEARCHED:
+      node_searched(search, frame, ply);
+      break;
+    case QUIESCE_ENTER:
+      quiesce_enter(search, frame, ply);
+      break;
+    case QUIESCE_NEXT_MOVE:
+      quiesce_next_move(search, frame, ply);
+      break;
+    case QUIESCE_SEARCHED:
+      quiesce_searched(search, frame, ply);
+      break;
+  }
+}
+
+// Takes back every move still made along the line, the position is the root again
+static void
+unwind(struct Search *search) {
+  while (search->height > 0) {
+    struct SearchFrame *frame = &search->frames[--search->height];
+    if (frame->state == NODE_SEARCHED || frame->state == QUIESCE_SEARCHED) {
+      unmake_move(search, frame->move, &frame->undo);
+    }
+  }
+}
+
+static void
+iteration_finished(struct Search *search) {
+  // Each line was searched without the ones before it, but that doesn't mean their
+  // scores came out in order
+  int count = search->line_index;
+  for (int i = 0; i < count; i++) {
+    struct SearchLine *line = &search->iteration_lines[i];
+    int slot = i;
+    while (slot > 0 && search->best_lines[slot - 1].score < line->score) {
+      search->best_lines[slot] = search->best_lines[slot - 1];
+      slot--;
+    }
+    search->best_lines[slot] = *line;
+  }
+  search->line_count = count;
+
+  const struct SearchLine *best = &search->best_lines[0];
+  search->depth = search->iteration;
+  search->score = best->score;
+  search->pv_length = best->length;
+  memcpy(search->pv, best->moves, best->length * sizeof (Move));
+  search->best_move = best->length > 0 ? best->moves[0] : MOVE_NONE;
+  if (search->report != NULL) {
+    search->report(search->report_ctx, search);
+  }
+
+  // On a clock, whether there's time for another iteration
+  if (search->time != NULL) {
+    time_manager_iteration(search->time, search->depth, search->best_move, search->score);
+    if (time_manager_out_of_time(search->time)) {
+      search->max_depth = search->iteration;
+    }
+  }
+}
+
+// The root just left its score in returned, that's one more of the iteration's lines
+static void
+root_finished(struct Search *search) {
+  struct SearchLine *line = &search->iteration_lines[search->line_index];
+  line->score = search->returned;
+  line->length = search->line_lengths[0];
+  memcpy(line->moves, search->lines[0], line->length * sizeof (Move));
+
+  // An empty line after the first means every move is in one already. The first can
+  // be empty too, when there's no move at all.
+  if (line->length > 0 || search->line_index == 0) {
+    search->line_index++;
+  }
+  if (line->length > 0 && search->line_index < search->multi_pv) {
+    push_frame(search, NODE_ENTER, -SEARCH_INFINITE, SEARCH_INFINITE, search->iteration, MOVE_NONE);
+    return;
+  }
+  iteration_finished(search);
+}
+
+static void
+finish(struct Search *search) {
+  unwind(search);
+  search->running = 0;
+
+  // Stopped before even the first iteration finished, whatever it had is better than nothing
+  if (search->best_move == MOVE_NONE && search->line_index > 0 && search->iteration_lines[0].length > 0) {
+    search->best_move = search->iteration_lines[0].moves[0];
+  }
+  else if (search->best_move == MOVE_NONE && search->line_lengths[0] > 0) {
+    search->best_move = search->lines[0][0];
+  }
+}
+
+void
+search_start(struct Search *search, const struct SearchLimits *limits) {
+  search->nodes = 0;
+  search->node_limit = limits->nodes;
+  search->time = limits->time;
+  search->stopped = 0;
+  search->depth = 0;
+  search->score = 0;
+  search->best_move = MOVE_NONE;
+  search->pv_length = 0;
+  search->line_count = 0;
+  search->line_lengths[0] = 0;
+  search->slice_nodes = 0;
+  search->clock_reads = 0;
+  memset(search->killers, 0, sizeof search->killers);
+  if (search->tt != NULL) {
+    tt_new_search(search->tt);
+  }
+
+  search->max_depth = MIN(limits->depth, SEARCH_MAX_PLY - 1);
+  search->iteration = 0;
+  search->height = 0;
+  search->running = 1;
+}
+
+int
+search_slice(struct Search *search, int64_t budget_us) {
+  uint64_t deadline = budget_us > 0 ? now_ns() + ((uint64_t)budget_us * 1000) : 0;
+  uint64_t start_nodes = search->nodes;
+  int steps = 0;
+
+  while (search->running) {
+    // An empty stack is between iterations
+    if (search->height == 0) {
+      if (search->iteration >= search->max_depth) {
+        finish(search);
+        break;
+      }
+      search->iteration++;
+      search->line_index = 0;
+      push_frame(search, NODE_ENTER, -SEARCH_INFINITE, SEARCH_INFINITE, search->iteration, MOVE_NONE);
+    }
+
+    step(search);
+    if (search->stopped) {
+      finish(search);
+      break;
+    }
+    if (search->height == 0) {
+      root_finished(search);
+    }
+    if (++steps == SEARCH_POLL_STEPS) {
+      steps = 0;
+      if (deadline == 0 && search->time == NULL) {
+        continue;
+      }
+      uint64_t now = now_ns();
+      search->clock_reads++;
+
+      // Past the hard limit the move gets played, as long as there's one to play
+      if (search->time != NULL && search->depth > 0 && now >= search->time->hard_deadline_ns) {
+        search->stopped = 1;
+        finish(search);
+        break;
+      }
+      if (deadline != 0 && now >= deadline) {
+        break;
+      }
+    }
+  }
+
+  search->slice_nodes = search->nodes - start_nodes;
+  return search->running;
+}
+
+void
+search_stop(struct Search *search) {
+  if (search->running) {
+    search->stopped = 1;
+    finish(search);
+  }
+}
+
+void
+search_set_time(struct Search *search, struct TimeManager *time) {
+  search->time = time;
+}
+
+Move
+search_run(struct Search *search, const struct SearchLimits *limits) {
+  search_start(search, limits);
+  while (search_slice(search, 0)) {
+  }
+  return search->best_move;
+}
+
+Move
+search_ponder_move(const struct Search *search) {
+  if (search->pv_length >= 2) {
+    return search->pv[1];
+  }
+  if (search->best_move == MOVE_NONE || search->tt == NULL) {
+    return MOVE_NONE;
+  }
+
+  // The line got cut short, by a table hit or a repetition, the table may still know
+  struct Position after;
+  position_copy_make(&after, &search->pos, search->best_move);
+  const struct TtEntry *entry = tt_probe(search->tt, after.hash);
+  if (entry == NULL || !position_move_is_pseudo_legal(&after, entry->move)) {
+    return MOVE_NONE;
+  }
+  struct Position reply;
+  position_copy_make(&reply, &after, entry->move);
+  return position_in_check(&reply, after.side_to_move) ? MOVE_NONE : entry->move;
+}
@@ -0,0 +1,162 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "stdint.h"
+#include "position.h"
+#include "tt.h"
+#include "nnue.h"
+#include "move_picker.h"
+
+// The engine: iterative deepening principal variation search over struct Position with
+// make/unmake, a transposition table and the staged move picker. Past the last ply a capture
+// only quiescence search carries on until the position is quiet, so the horizon doesn't fall
+// between a capture and its recapture. Positions are evaluated with eval.h's tables, or with
+// a network when one is given (nnue.h), then search keeps its accumulator stack alongside
+// the position.
+//
+// Moves only come out of the generators pseudo legal, one that leaves the mover's king
+// attacked is taken back as soon as it's been made and doesn't count.
+//
+// There's no recursion: every ply of the line being searched is a struct SearchFrame on an
+// explicit stack, with a state saying where in the node it got to. That way search can stop
+// anywhere and carry on later, search_slice runs it for a few hundred microseconds at a time
+// so a build without threads can think between frames.
+//
+// Given a time manager (time_manager.h) search plays on a clock: it only starts iterations
+// there's time for, and gives up partway through one at the hard limit once any has finished.
+
+#define SEARCH_MAX_PLY 64
+#define SEARCH_INFINITE 32000
+#define SEARCH_MATE 31000 // mated at the root, mated n plies later is SEARCH_MATE - n
+#define SEARCH_MATE_BOUND (SEARCH_MATE - SEARCH_MAX_PLY) // anything past this is a mate score
+
+#define SEARCH_DELTA_MARGIN 200 // quiescence skips captures that can't get back to alpha by this much
+#define SEARCH_POLL_STEPS 256 // a slice or a search on the clock looks at the time this often
+#define SEARCH_MAX_LINES 4 // best lines from the root search can be asked for at once
+
+struct Search;
+struct TimeManager;
+
+// Called after every iteration that finishes
+typedef void (*SearchReportFn)(void *ctx, const struct Search *search);
+
+struct SearchLimits {
+  int depth; // iterations to run, at most SEARCH_MAX_PLY - 1
+  uint64_t nodes; // stops partway once this many have been searched, 0 for no limit
+  struct TimeManager *time; // started for this move when playing on a clock, otherwise NULL
+};
+
+// One of the best lines from the root. With more than one asked for, each is searched with
+// the first moves of the ones before it left out.
+struct SearchLine {
+  int score;
+  int length;
+  Move moves[SEARCH_MAX_PLY];
+};
+
+// Where a frame is in its node, the *_SEARCHED states have a move made and a child above them
+enum SearchNodeState {
+  NODE_ENTER,
+  NODE_NEXT_MOVE,
+  NODE_SEARCHED,
+  QUIESCE_ENTER,
+  QUIESCE_NEXT_MOVE,
+  QUIESCE_SEARCHED
+};
+
+// One ply of the line being searched, everything a recursive search would keep in locals
+struct SearchFrame {
+  int state;
+  int alpha;
+  int beta;
+  int depth;
+  Move previous; // the move that got here
+  int side;
+  int in_check;
+  int stand_pat;
+  int legal_moves;
+  int best_score;
+  Move best_move;
+  int bound;
+  int null_window; // the child is a null window search that's redone if it beats alpha
+  Move move; // the one being searched
+  struct PositionUndo undo;
+  struct MovePicker picker;
+  int quiet_count;
+  Move quiets_tried[POSITION_MAX_MOVES];
+};
+
+struct Search {
+  struct Position pos; // the root, and whichever node search is at while it runs
+  struct Tt *tt; // NULL searches without one
+  const struct Nnue *net; // NULL evaluates with eval.h
+  struct NnueStack nnue;
+  struct MoveHistory history;
+  int ordering; // MoveOrdering, MOVE_ORDER_HISTORY unless it's being measured
+  int quiescence; // 0 stops at the horizon, only for measuring too
+  int multi_pv; // best lines to find, 1 to SEARCH_MAX_LINES. 1 unless analysing.
+  SearchReportFn report; // NULL when nobody's listening
+  void *report_ctx;
+
+  // Results of the last iteration that finished
+  int depth;
+  int score; // centipawns for the side to move at the root
+  Move best_move;
+  int pv_length;
+  Move pv[SEARCH_MAX_PLY];
+  int line_count; // up to multi_pv, fewer when there aren't that many moves
+  struct SearchLine best_lines[SEARCH_MAX_LINES]; // best first, the first is pv again
+  uint64_t nodes; // every node of the whole search, the unfinished iteration too
+
+  // While searching
+  int running; // search_start until the last iteration or a limit
+  int iteration; // the depth being searched
+  int line_index; // of the line being searched in this iteration
+  struct SearchLine iteration_lines[SEARCH_MAX_LINES]; // the ones this iteration has so far
+  int max_depth;
+  uint64_t node_limit;
+  struct TimeManager *time;
+  int stopped;
+  uint64_t slice_nodes; // searched by the last search_slice
+  uint64_t clock_reads; // since search_start, to keep an eye on what polling costs
+  int height; // frames on the stack, the top one is at ply height - 1
+  int returned; // the score the last frame to finish left for its parent
+  struct SearchFrame frames[SEARCH_MAX_PLY];
+  Move killers[SEARCH_MAX_PLY][2];
+  uint64_t hashes[SEARCH_MAX_PLY]; // along the current line, for repetitions
+  int line_lengths[SEARCH_MAX_PLY];
+  Move lines[SEARCH_MAX_PLY][SEARCH_MAX_PLY]; // best line found from each ply
+};
+
+// net's weights have to stay around while search uses them
+void search_init(struct Search *search, struct Tt *tt, const struct Nnue *net);
+// Forgets the history and the table, for a new game
+void search_clear(struct Search *search);
+void search_set_position(struct Search *search, const struct Position *pos);
+
+// Searches the position deeper and deeper until a limit is hit, returns the best move of
+// the last finished iteration (or the first move searched if none finished),
+// MOVE_NONE when the side to move has no legal moves
+Move search_run(struct Search *search, const struct SearchLimits *limits);
+
+// search_run a piece at a time: search_start sets it up, then every search_slice carries on
+// for about budget_us microseconds (0 for as long as it takes). The slice that finishes
+// returns 0 and best_move is the answer, every one before returns 1. search_stop gives up
+// straight away, keeping what the last finished iteration found.
+void search_start(struct Search *search, const struct SearchLimits *limits);
+int search_slice(struct Search *search, int64_t budget_us);
+void search_stop(struct Search *search);
+// Puts a running search on the clock, for when the move it was pondering gets played. The
+// time manager has to outlive the search.
+void search_set_time(struct Search *search, struct TimeManager *time);
+
+// The reply search expects to its best move, from the principal variation or failing that
+// the table. MOVE_NONE when it has no idea. Only once search has finished.
+Move search_ponder_move(const struct Search *search);
+
+static inline int
+search_is_mate_score(int score) {
+  return score >= SEARCH_MATE_BOUND || score <= -SEARCH_MATE_BOUND;
+}
+
+#endif
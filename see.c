@@ -0,0 +1,100 @@
+#include "stdint.h"
+#include "chess.h"
+#include "piece_defs.h"
+#include "position.h"
+#include "see.h"
+
+const int16_t see_values[EVAL_MODELS] = {100, 320, 330, 500, 900, 20000};
+
+// Whether the piece on from gets to square with only the pieces in occupied in the way
+static inline int
+reaches(const struct Position *pos, int piece_id, int from, int square, uint64_t occupied) {
+  int index = piece_table_index(&piece_tables, piece_owner(piece_id), position_piece_type(pos, piece_id), from);
+  const struct PieceTarget *target = &piece_tables.targets[piece_tables.starts[index]];
+  const struct PieceTarget *end = target + piece_tables.counts[index];
+  while (target < end) {
+    if (target->square == square) {
+      if (!(target->flags & PIECE_MOVE_ONLY)) {
+        return 1;
+      }
+    }
+    target += (occupied & (1ull << target->square)) ? target->skip : 1;
+  }
+  return 0;
+}
+
+int
+position_see(const struct Position *pos, Move move) {
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  int mover = pos->board[from] - 1;
+  int victim = pos->board[to] - 1;
+
+  // Everything that could ever get to the square, cheapest first. Only these get walked.
+  int candidates[POSITION_PIECES];
+  int candidate_values[POSITION_PIECES];
+  int count = 0;
+  uint64_t occupied = 0;
+  for (int piece_id = 0; piece_id < POSITION_PIECES; piece_id++) {
+    int square = pos->piece_squares[piece_id];
+    if (square == POSITION_SQUARE_NONE) {
+      continue;
+    }
+    occupied |= 1ull << square;
+
+    int type = position_piece_type(pos, piece_id);
+    int index = piece_table_index(&piece_tables, piece_owner(piece_id), type, square);
+    if (piece_id == mover || !(piece_tables.reach[index] & (1ull << to))) {
+      continue;
+    }
+    int value = see_value(type);
+    int slot = count++;
+    while (slot > 0 && candidate_values[slot - 1] > value) {
+      candidates[slot] = candidates[slot - 1];
+      candidate_values[slot] = candidate_values[slot - 1];
+      slot--;
+    }
+    candidates[slot] = piece_id;
+    candidate_values[slot] = value;
+  }
+
+  // gain[d] is what the side making capture d is up by if the exchange stops after it
+  int gain[POSITION_PIECES + 1];
+  int mover_type = position_piece_type(pos, mover);
+  int standing = see_value(mover_type); // what's on the square for the next capture to take
+  gain[0] = victim >= 0 ? see_value(position_piece_type(pos, victim)) : 0;
+  if (MOVE_FLAGS(move) & MOVE_PROMOTE) {
+    int promoted = piece_tables.promotes_to[mover_type];
+    gain[0] += see_value(promoted) - see_value(mover_type);
+    standing = see_value(promoted);
+  }
+  occupied &= ~(1ull << from);
+
+  int side = (piece_owner(mover) + 1) % NUM_PLAYERS;
+  int depth = 0;
+  for (;;) {
+    int attacker = -1;
+    for (int i = 0; i < count; i++) {
+      int piece_id = candidates[i];
+      int square = pos->piece_squares[piece_id];
+      if (piece_owner(piece_id) == side && (occupied & (1ull << square)) && reaches(pos, piece_id, square, to, occupied)) {
+        attacker = i;
+        break;
+      }
+    }
+    if (attacker < 0) {
+      break;
+    }
+    depth++;
+    gain[depth] = standing - gain[depth - 1];
+    standing = candidate_values[attacker];
+    occupied &= ~(1ull << pos->piece_squares[candidates[attacker]]);
+    side = (side + 1) % NUM_PLAYERS;
+  }
+
+  // Each side takes or stops, whichever is better for them, from the last capture back
+  for (; depth > 0; depth--) {
+    gain[depth - 1] = -MAX(-gain[depth - 1], gain[depth]);
+  }
+  return gain[0];
+}
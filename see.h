@@ -0,0 +1,39 @@
+#ifndef SEE_H
+#define SEE_H
+
+#include "stdint.h"
+#include "eval.h"
+#include "piece_defs.h"
+#include "position.h"
+
+// Static exchange evaluation: how much material the side making a move comes out ahead by
+// if both sides keep taking on its destination with their cheapest piece, each stopping as
+// soon as carrying on would cost them. Nothing is made, it only looks at which pieces' reach
+// masks cover the square and walks their lines over a bitboard of what's still standing, so
+// pieces lined up behind each other join in as the ones in front are used up.
+//
+// Pins and checks are ignored, it's a guess that's right nearly all the time and cheap.
+
+// Exchange values by model, a king only ever takes last
+extern const int16_t see_values[EVAL_MODELS];
+
+static inline int
+see_value(int type) {
+  return see_values[piece_tables.models[type]];
+}
+
+// Centipawns for the side to move, a quiet move scores what it loses by standing there
+int position_see(const struct Position *pos, Move move);
+
+// Whether the capture loses material, taking something worth at least the taker never does
+static inline int
+position_see_losing(const struct Position *pos, Move move) {
+  int victim = pos->board[MOVE_TO(move)];
+  int mover_type = position_piece_type(pos, pos->board[MOVE_FROM(move)] - 1);
+  if (victim != 0 && see_value(position_piece_type(pos, victim - 1)) >= see_value(mover_type)) {
+    return 0;
+  }
+  return position_see(pos, move) < 0;
+}
+
+#endif
@@ -0,0 +1,251 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "stdint.h"
+#include "stdio.h"
+#include "string.h"
+#include "time.h"
+#include "sim.h"
+
+double
+sim_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+void
+sim_init(struct Simulation *sim, int mode, int display_rate) {
+  *sim = (struct Simulation){
+    .mode = mode,
+    .frame_budget = 1.0 / (display_rate > 0 ? display_rate : SIM_TICK_RATE),
+    .alpha = 1.0f
+  };
+}
+
+int
+sim_advance(struct Simulation *sim, double frame_time, SimTickFn tick, void *ctx) {
+  int ticks = 0;
+
+  switch (sim->mode) {
+    case SIM_LOCKSTEP:
+      tick(ctx);
+      ticks = 1;
+      sim->alpha = 1.0f;
+      break;
+
+    case SIM_FAST_FORWARD: {
+      // Always at least one, then keep going until the frame's share of time is used up
+      double deadline = sim_now() + (sim->frame_budget * SIM_FAST_FORWARD_SHARE);
+      do {
+        tick(ctx);
+        ticks++;
+      } while (sim_now() < deadline);
+      sim->accumulator = 0.0;
+      sim->alpha = 1.0f;
+      break;
+    }
+
+    default:
+      if (frame_time > SIM_MAX_CATCH_UP_TICKS * SIM_TIMESTEP) {
+        frame_time = SIM_MAX_CATCH_UP_TICKS * SIM_TIMESTEP;
+      }
+      sim->accumulator += frame_time;
+      while (sim->accumulator >= SIM_TIMESTEP) {
+        tick(ctx);
+        ticks++;
+        sim->accumulator -= SIM_TIMESTEP;
+      }
+      sim->alpha = (float)(sim->accumulator / SIM_TIMESTEP);
+      break;
+  }
+
+  sim->ticks += ticks;
+  sim->ticks_last_frame = ticks;
+  return ticks;
+}
+
+float
+sim_alpha(double tick_time, double now) {
+  if (tick_time <= 0.0) {
+    return 1.0f;
+  }
+  double alpha = (now - tick_time) / SIM_TIMESTEP;
+  return alpha < 0.0 ? 0.0f : (alpha > 1.0 ? 1.0f : (float)alpha);
+}
+
+static void
+sim_thread_init(struct SimThread *thread,
+                int mode,
+                int display_rate,
+                SimTickFn tick,
+                SimPublishFn publish,
+                void *ctx) {
+  memset(thread, 0, sizeof *thread);
+  sim_init(&thread->sim, mode, display_rate);
+  thread->tick = tick;
+  thread->publish = publish;
+  thread->ctx = ctx;
+  thread->mode = mode;
+  thread->running = 1;
+
+  // So the render thread has something to draw before the first tick
+  publish(ctx, &thread->sim, 0.0);
+}
+
+#ifdef NO_THREADS
+
+int
+sim_thread_start(struct SimThread *thread,
+                 int mode,
+                 int display_rate,
+                 SimTickFn tick,
+                 SimPublishFn publish,
+                 void *ctx) {
+  sim_thread_init(thread, mode, display_rate, tick, publish, ctx);
+  return 0;
+}
+
+void
+sim_thread_stop(struct SimThread *thread) {
+  thread->running = 0;
+}
+
+void
+sim_thread_frame(struct SimThread *thread, double frame_time) {
+  struct Simulation *sim = &thread->sim;
+  sim->mode = thread->mode;
+  sim_advance(sim, frame_time, thread->tick, thread->ctx);
+
+  // The ticks ran just now, the clock is whatever is left in the accumulator past the last one
+  double tick_time = sim->mode == SIM_REALTIME ? sim_now() - sim->accumulator : 0.0;
+  thread->publish(thread->ctx, sim, tick_time);
+}
+
+void
+sim_thread_set_mode(struct SimThread *thread, int mode) {
+  thread->mode = mode;
+}
+
+#else
+
+static void
+sleep_until(double when) {
+  struct timespec ts;
+  ts.tv_sec = (time_t)when;
+  ts.tv_nsec = (long)((when - (double)ts.tv_sec) * 1e9);
+  // Waking early (a signal, or tv_nsec rounding up to a whole second) only means checking the clock again
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+// Waits for the render thread to start another frame, returns 0 when it's time to stop
+static int
+wait_for_frame(struct SimThread *thread) {
+  pthread_mutex_lock(&thread->lock);
+  while (thread->running && thread->frames <= thread->sim.ticks) {
+    pthread_cond_wait(&thread->frame_started, &thread->lock);
+  }
+  int running = thread->running;
+  pthread_mutex_unlock(&thread->lock);
+  return running;
+}
+
+static void *
+sim_thread_main(void *arg) {
+  struct SimThread *thread = arg;
+  struct Simulation *sim = &thread->sim;
+  double next_tick = sim_now(); // when the next real time tick is due
+  double last_publish = next_tick;
+
+  while (__atomic_load_n(&thread->running, __ATOMIC_ACQUIRE)) {
+    sim->mode = __atomic_load_n(&thread->mode, __ATOMIC_RELAXED);
+    double tick_time = 0.0;
+
+    if (sim->mode == SIM_LOCKSTEP) {
+      if (!wait_for_frame(thread)) {
+        break;
+      }
+    }
+    else if (sim->mode == SIM_REALTIME) {
+      double now = sim_now();
+      if (now < next_tick) {
+        sleep_until(next_tick);
+        continue; // the mode may have changed or we may be stopping
+      }
+      if (now - next_tick > SIM_MAX_CATCH_UP_TICKS * SIM_TIMESTEP) {
+        // After a long stall drop the backlog instead of spiralling, like sim_advance
+        next_tick = now - (SIM_MAX_CATCH_UP_TICKS * SIM_TIMESTEP);
+      }
+      tick_time = next_tick;
+      next_tick += SIM_TIMESTEP;
+    }
+
+    thread->tick(thread->ctx);
+    sim->ticks++;
+    sim->ticks_last_frame++;
+
+    // Fast forward ticks flat out but only publishes at display rate, nobody would see the rest
+    double now = sim_now();
+    if (sim->mode == SIM_FAST_FORWARD) {
+      next_tick = now; // so going back to real time doesn't try to catch up
+      if (now - last_publish < sim->frame_budget) {
+        continue;
+      }
+    }
+
+    thread->publish(thread->ctx, sim, tick_time);
+    sim->ticks_last_frame = 0;
+    last_publish = now;
+  }
+  return NULL;
+}
+
+int
+sim_thread_start(struct SimThread *thread,
+                 int mode,
+                 int display_rate,
+                 SimTickFn tick,
+                 SimPublishFn publish,
+                 void *ctx) {
+  sim_thread_init(thread, mode, display_rate, tick, publish, ctx);
+  pthread_mutex_init(&thread->lock, NULL);
+  pthread_cond_init(&thread->frame_started, NULL);
+  if (pthread_create(&thread->thread, NULL, sim_thread_main, thread) != 0) {
+    printf("could not start the simulation thread\n");
+    pthread_mutex_destroy(&thread->lock);
+    pthread_cond_destroy(&thread->frame_started);
+    return -1;
+  }
+  return 0;
+}
+
+void
+sim_thread_stop(struct SimThread *thread) {
+  pthread_mutex_lock(&thread->lock);
+  __atomic_store_n(&thread->running, 0, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&thread->frame_started);
+  pthread_mutex_unlock(&thread->lock);
+
+  pthread_join(thread->thread, NULL);
+  pthread_mutex_destroy(&thread->lock);
+  pthread_cond_destroy(&thread->frame_started);
+}
+
+void
+sim_thread_frame(struct SimThread *thread, double frame_time) {
+  // Real time and fast forward keep their own clock, only lockstep ticks wait on frames
+  (void)frame_time;
+  if (__atomic_load_n(&thread->mode, __ATOMIC_RELAXED) != SIM_LOCKSTEP) {
+    return;
+  }
+  pthread_mutex_lock(&thread->lock);
+  thread->frames++;
+  pthread_cond_signal(&thread->frame_started);
+  pthread_mutex_unlock(&thread->lock);
+}
+
+void
+sim_thread_set_mode(struct SimThread *thread, int mode) {
+  __atomic_store_n(&thread->mode, mode, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "stdint.h"
+
+#ifndef NO_THREADS
+#include "pthread.h"
+#endif
+
+// Fixed timestep driver. The game moves on in ticks of SIM_TIMESTEP whatever the frame rate,
+// a frame runs however many ticks its time covers and the renderer blends between the last
+// two with alpha. Nothing in here draws, main() passes in what one tick does.
+//
+// SimThread runs the ticks on a thread of their own so a slow tick never holds a frame up.
+// After its ticks it calls publish, which is where the caller hands the render thread a copy
+// of what to draw. Built with -DNO_THREADS the ticks run inside sim_thread_frame instead.
+
+#define SIM_TICK_RATE 60
+#define SIM_TIMESTEP (1.0 / SIM_TICK_RATE)
+#define SIM_MAX_CATCH_UP_TICKS 8 // after a long stall the rest is dropped instead of spiralling
+#define SIM_FAST_FORWARD_SHARE 0.75 // of a display frame spent ticking when fast forwarding
+
+enum SimMode {
+  SIM_REALTIME, // ticks follow the clock
+  SIM_FAST_FORWARD, // as many ticks as fit in the frame, rendering stays at display rate
+  SIM_LOCKSTEP // exactly one tick per frame, for replays
+};
+
+typedef void (*SimTickFn)(void *ctx);
+
+struct Simulation;
+
+// tick_time is the clock time (sim_now) the latest tick stands for, or 0 when ticks
+// don't follow the clock and there's nothing to blend
+typedef void (*SimPublishFn)(void *ctx, const struct Simulation *sim, double tick_time);
+
+struct Simulation {
+  int mode;
+  double accumulator; // clock time not yet ticked
+  double frame_budget; // seconds in one display frame
+  uint64_t ticks;
+  int ticks_last_frame; // on a SimThread, ticks since the last publish
+  float alpha; // how far between the previous tick and the latest the frame is
+};
+
+void sim_init(struct Simulation *sim, int mode, int display_rate);
+
+// Runs the ticks for a frame that took frame_time seconds, returns how many ran
+int sim_advance(struct Simulation *sim, double frame_time, SimTickFn tick, void *ctx);
+
+// Monotonic seconds, the clock tick_time is on
+double sim_now(void);
+
+// How far past tick_time the clock is, in ticks, clamped to [0, 1]
+float sim_alpha(double tick_time, double now);
+
+struct SimThread {
+  struct Simulation sim; // only the simulation thread touches it
+  SimTickFn tick;
+  SimPublishFn publish;
+  void *ctx;
+  int mode; // asked for by the render thread, picked up before the next tick
+  int running;
+  uint64_t frames; // frames the render thread has started, lockstep ticks wait for them
+#ifndef NO_THREADS
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t frame_started;
+#endif
+};
+
+// Starts ticking straight away, publish is called once before the first tick.
+// Returns -1 if the thread couldn't be started, then there's nothing to stop.
+int sim_thread_start(struct SimThread *thread,
+                      int mode,
+                      int display_rate,
+                      SimTickFn tick,
+                      SimPublishFn publish,
+                      void *ctx);
+// Waits for the tick in progress, nothing runs after it returns
+void sim_thread_stop(struct SimThread *thread);
+
+// From the render thread at the start of every frame
+void sim_thread_frame(struct SimThread *thread, double frame_time);
+void sim_thread_set_mode(struct SimThread *thread, int mode);
+
+#endif
@@ -0,0 +1,154 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "unistd.h"
+#include "thread_pool.h"
+
+#ifdef NO_THREADS
+
+void
+thread_pool_init(struct ThreadPool *pool, int num_threads) {
+  (void)num_threads;
+  pool->num_threads = 1;
+}
+
+void
+thread_pool_destroy(struct ThreadPool *pool) {
+  (void)pool;
+}
+
+void
+thread_pool_parallel_for(struct ThreadPool *pool, int count, ThreadPoolFn fn, void *ctx) {
+  (void)pool;
+  for (int i = 0; i < count; i++) {
+    fn(ctx, i);
+  }
+}
+
+#else
+
+static void
+run_items(struct ThreadPool *pool, ThreadPoolFn fn, void *ctx, int count) {
+  for (;;) {
+    int index = __atomic_fetch_add(&pool->next_index, 1, __ATOMIC_RELAXED);
+    if (index >= count) {
+      return;
+    }
+    fn(ctx, index);
+  }
+}
+
+static void *
+worker_main(void *arg) {
+  struct ThreadPool *pool = arg;
+  unsigned seen_generation = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->shutdown && pool->generation == seen_generation) {
+      pthread_cond_wait(&pool->work_ready, &pool->lock);
+    }
+    if (pool->shutdown) {
+      break;
+    }
+
+    seen_generation = pool->generation;
+    ThreadPoolFn fn = pool->fn;
+    void *ctx = pool->ctx;
+    int count = pool->count;
+    pool->busy_workers++;
+    pthread_mutex_unlock(&pool->lock);
+
+    run_items(pool, fn, ctx, count);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->busy_workers == 0) {
+      pthread_cond_signal(&pool->work_done);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+void
+thread_pool_init(struct ThreadPool *pool, int num_threads) {
+  if (num_threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = cpus > 0 ? (int)cpus : 1;
+  }
+  if (num_threads > THREAD_POOL_MAX_THREADS + 1) {
+    num_threads = THREAD_POOL_MAX_THREADS + 1;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_ready, NULL);
+  pthread_cond_init(&pool->work_done, NULL);
+  pool->fn = NULL;
+  pool->ctx = NULL;
+  pool->count = 0;
+  pool->next_index = 0;
+  pool->busy_workers = 0;
+  pool->generation = 0;
+  pool->shutdown = 0;
+
+  // The caller counts as one of the threads, if a worker fails to start we just run with fewer
+  pool->num_threads = 1;
+  for (int i = 0; i < num_threads - 1; i++) {
+    if (pthread_create(&pool->workers[i], NULL, worker_main, pool) != 0) {
+      break;
+    }
+    pool->num_threads++;
+  }
+}
+
+void
+thread_pool_destroy(struct ThreadPool *pool) {
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->work_ready);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (int i = 0; i < pool->num_threads - 1; i++) {
+    pthread_join(pool->workers[i], NULL);
+  }
+
+  pthread_cond_destroy(&pool->work_done);
+  pthread_cond_destroy(&pool->work_ready);
+  pthread_mutex_destroy(&pool->lock);
+  pool->num_threads = 1;
+}
+
+void
+thread_pool_parallel_for(struct ThreadPool *pool, int count, ThreadPoolFn fn, void *ctx) {
+  // Not worth waking anyone for a single item
+  if (pool->num_threads == 1 || count <= 1) {
+    for (int i = 0; i < count; i++) {
+      fn(ctx, i);
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  // A worker that woke up late for the previous loop may still hold its fn,
+  // let it see that loop is finished before next_index goes back to 0
+  while (pool->busy_workers > 0) {
+    pthread_cond_wait(&pool->work_done, &pool->lock);
+  }
+  pool->fn = fn;
+  pool->ctx = ctx;
+  pool->count = count;
+  __atomic_store_n(&pool->next_index, 0, __ATOMIC_RELAXED);
+  pool->generation++;
+  pthread_cond_broadcast(&pool->work_ready);
+  pthread_mutex_unlock(&pool->lock);
+
+  run_items(pool, fn, ctx, count);
+
+  // Every item has been claimed by now, wait for the workers still running theirs
+  pthread_mutex_lock(&pool->lock);
+  while (pool->busy_workers > 0) {
+    pthread_cond_wait(&pool->work_done, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// A fixed set of worker threads that split a loop between them.
+// Build with -DNO_THREADS (make THREADS=0) and every loop just runs on the caller.
+
+#define THREAD_POOL_MAX_THREADS 64
+
+// Called once for every index in [0, count), from any thread in the pool
+typedef void (*ThreadPoolFn)(void *ctx, int index);
+
+#ifndef NO_THREADS
+#include "pthread.h"
+#endif
+
+struct ThreadPool {
+  int num_threads; // workers plus the calling thread
+#ifndef NO_THREADS
+  pthread_t workers[THREAD_POOL_MAX_THREADS];
+  pthread_mutex_t lock;
+  pthread_cond_t work_ready;
+  pthread_cond_t work_done;
+
+  // The loop currently being run, guarded by lock apart from next_index
+  ThreadPoolFn fn;
+  void *ctx;
+  int count;
+  int next_index; // claimed with atomics so workers don't take the lock per item
+  int busy_workers;
+  unsigned generation; // bumped for every loop so workers know there is new work
+  int shutdown;
+#endif
+};
+
+// num_threads <= 0 picks one per online cpu
+void thread_pool_init(struct ThreadPool *pool, int num_threads);
+void thread_pool_destroy(struct ThreadPool *pool);
+
+// Runs fn(ctx, i) for every i in [0, count) and returns once they have all finished.
+// The calling thread takes items as well.
+void thread_pool_parallel_for(struct ThreadPool *pool, int count, ThreadPoolFn fn, void *ctx);
+
+#endif
@@ -0,0 +1,78 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "stdint.h"
+#include "time.h"
+#include "chess.h"
+#include "position.h"
+#include "time_manager.h"
+
+static uint64_t
+now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+void
+time_manager_start(struct TimeManager *tm, const struct TimeControl *control, int64_t overhead_us) {
+  tm->start_ns = now_ns();
+  int64_t available = MAX(control->remaining_us - overhead_us, 0);
+  int moves_to_go = control->moves_to_go > 0 ? MIN(control->moves_to_go, TIME_MOVES_TO_GO) : TIME_MOVES_TO_GO;
+
+  // An even share of what's left, plus most of the increment since it comes back after the
+  // move. Only the last move before a time control can use nearly everything.
+  int64_t optimum = (available / moves_to_go) + (control->increment_us * 3 / 4);
+  tm->hard_us = MIN(optimum * TIME_HARD_FACTOR, available * 3 / 4);
+  tm->optimum_us = MIN(optimum, tm->hard_us);
+  tm->soft_us = tm->optimum_us;
+  tm->hard_deadline_ns = tm->start_ns + ((uint64_t)tm->hard_us * 1000);
+
+  tm->depth = 0;
+  tm->best_move = MOVE_NONE;
+  tm->score = 0;
+  tm->best_changes = 0.0;
+  tm->previous_us = 0;
+  tm->iteration_us = 0;
+  tm->next_iteration_us = 0;
+}
+
+void
+time_manager_iteration(struct TimeManager *tm, int depth, Move best_move, int score) {
+  // How long this iteration took on top of the ones before, and from that the next
+  int64_t elapsed = time_manager_elapsed_us(tm);
+  int64_t iteration = MAX(elapsed - tm->previous_us, 1);
+  double growth = tm->iteration_us > 0 ? (double)iteration / tm->iteration_us : TIME_MIN_GROWTH;
+  growth = MIN(MAX(growth, TIME_MIN_GROWTH), TIME_MAX_GROWTH);
+  tm->iteration_us = iteration;
+  tm->next_iteration_us = (int64_t)(iteration * growth);
+  tm->previous_us = elapsed;
+
+  int drop = 0;
+  tm->best_changes /= 2.0;
+  if (tm->depth > 0) {
+    if (best_move != tm->best_move) {
+      tm->best_changes += 1.0;
+    }
+    drop = MIN(MAX(tm->score - score, 0), TIME_MAX_SCORE_DROP);
+  }
+  tm->depth = depth;
+  tm->best_move = best_move;
+  tm->score = score;
+
+  // A settled search gets 0.7 of the optimum, one changing its mind every iteration nearly
+  // twice it, and a score that's falling another half on top
+  double changes = 0.7 + (0.6 * MIN(tm->best_changes, 2.0));
+  double falling = 1.0 + ((double)drop / (2.0 * TIME_MAX_SCORE_DROP));
+  tm->soft_us = MIN((int64_t)((double)tm->optimum_us * changes * falling), tm->hard_us);
+}
+
+int
+time_manager_out_of_time(const struct TimeManager *tm) {
+  // An iteration that would most likely end past the soft limit isn't worth starting
+  return time_manager_elapsed_us(tm) + tm->next_iteration_us >= tm->soft_us;
+}
+
+int64_t
+time_manager_elapsed_us(const struct TimeManager *tm) {
+  return (int64_t)((now_ns() - tm->start_ns) / 1000);
+}
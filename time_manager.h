@@ -0,0 +1,53 @@
+#ifndef TIME_MANAGER_H
+#define TIME_MANAGER_H
+
+#include "stdint.h"
+#include "position.h"
+
+// How long the engine gets to think about a move when it's playing on a clock. From the time
+// left, the increment and the moves to the next time control it works out an optimum for the
+// move and a hard limit. Search doesn't start another iteration that would likely end past the
+// soft limit, which is the optimum scaled by how settled the search looks: a best move that keeps changing
+// or a score that's dropping gets more time, one that has held for a few iterations gets less.
+// The hard limit stops search partway through an iteration. It stays well inside what's on the
+// clock, so the move is played before the flag falls however short the time gets.
+
+#define TIME_MOVES_TO_GO 30 // assumed when the rest of the game is one time control
+#define TIME_HARD_FACTOR 4 // the hard limit is at most this many optimums
+#define TIME_MAX_SCORE_DROP 200 // centipawns, more than this doesn't get any more time
+#define TIME_MIN_GROWTH 1.5 // an iteration is guessed to take at least this many times the last
+#define TIME_MAX_GROWTH 8.0
+
+struct TimeControl {
+  int64_t remaining_us;
+  int64_t increment_us;
+  int moves_to_go; // to the next time control, 0 when there isn't one
+};
+
+struct TimeManager {
+  uint64_t start_ns;
+  int64_t optimum_us;
+  int64_t soft_us;
+  int64_t hard_us;
+  uint64_t hard_deadline_ns; // search polls this, so it's kept as a clock reading
+
+  // How the iterations so far have gone
+  int depth;
+  Move best_move;
+  int score;
+  double best_changes; // each change counts 1 and halves every iteration after
+  int64_t previous_us; // elapsed when the last iteration finished
+  int64_t iteration_us; // the last one took
+  int64_t next_iteration_us; // guessed from how much longer each took than the one before
+};
+
+// overhead_us is kept back for everything between search stopping and the clock stopping
+void time_manager_start(struct TimeManager *tm, const struct TimeControl *control, int64_t overhead_us);
+// After every iteration that finishes, with its best move and score
+void time_manager_iteration(struct TimeManager *tm, int depth, Move best_move, int score);
+// Whether there's no point starting another iteration
+int time_manager_out_of_time(const struct TimeManager *tm);
+
+int64_t time_manager_elapsed_us(const struct TimeManager *tm);
+
+#endif
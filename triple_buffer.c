@@ -0,0 +1,27 @@
+#include "triple_buffer.h"
+
+void
+triple_buffer_init(struct TripleBuffer *buffer, void *first, void *second, void *third) {
+  buffer->slots[0] = first;
+  buffer->slots[1] = second;
+  buffer->slots[2] = third;
+  buffer->back = 0;
+  buffer->middle = 1;
+  buffer->front = 2;
+}
+
+void
+triple_buffer_publish(struct TripleBuffer *buffer) {
+  // Release so the reader sees everything written to the slot before it sees the index
+  int old_middle = __atomic_exchange_n(&buffer->middle, buffer->back | TRIPLE_BUFFER_FRESH, __ATOMIC_ACQ_REL);
+  buffer->back = old_middle & ~TRIPLE_BUFFER_FRESH;
+}
+
+void *
+triple_buffer_read(struct TripleBuffer *buffer) {
+  if (__atomic_load_n(&buffer->middle, __ATOMIC_RELAXED) & TRIPLE_BUFFER_FRESH) {
+    int old_middle = __atomic_exchange_n(&buffer->middle, buffer->front, __ATOMIC_ACQ_REL);
+    buffer->front = old_middle & ~TRIPLE_BUFFER_FRESH;
+  }
+  return buffer->slots[buffer->front];
+}
@@ -0,0 +1,34 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+// Hands the latest of something from one writer thread to one reader thread without locks.
+// There are three slots: the writer fills the back one, the reader holds the front one,
+// and the middle one is the last thing published. Publishing swaps back and middle,
+// reading swaps middle and front if anything new came in, so neither side ever waits
+// and the reader always gets the newest complete slot. Anything published in between
+// two reads is just skipped.
+
+#define TRIPLE_BUFFER_FRESH 4 // set on the middle index when the reader hasn't taken it yet
+
+struct TripleBuffer {
+  void *slots[3];
+  int back; // only the writer touches it
+  int front; // only the reader touches it
+  int middle; // index | TRIPLE_BUFFER_FRESH, swapped with atomics
+};
+
+void triple_buffer_init(struct TripleBuffer *buffer, void *first, void *second, void *third);
+
+// The slot to fill, it belongs to the writer until triple_buffer_publish
+static inline void *
+triple_buffer_back(struct TripleBuffer *buffer) {
+  return buffer->slots[buffer->back];
+}
+
+void triple_buffer_publish(struct TripleBuffer *buffer);
+
+// The newest published slot, it stays valid until the reader calls this again.
+// Before anything is published it's the slot the reader started with.
+void *triple_buffer_read(struct TripleBuffer *buffer);
+
+#endif
@@ -0,0 +1,97 @@
+#include "stddef.h"
+#include "stdint.h"
+#include "string.h"
+#include "arena.h"
+#include "position.h"
+#include "tt.h"
+
+int
+tt_init(struct Tt *tt, struct Arena *arena, size_t bytes) {
+  size_t count = 1;
+  while (count * 2 * sizeof (struct TtBucket) <= bytes) {
+    count *= 2;
+  }
+  if (count * sizeof (struct TtBucket) > bytes) {
+    return -1;
+  }
+
+  tt->buckets = ARENA_ALLOC_ARRAY(arena, struct TtBucket, count);
+  if (tt->buckets == NULL) {
+    return -1;
+  }
+  tt->mask = count - 1;
+  tt_clear(tt);
+  return 0;
+}
+
+void
+tt_clear(struct Tt *tt) {
+  memset(tt->buckets, 0, (tt->mask + 1) * sizeof (struct TtBucket));
+  tt->generation = 0;
+}
+
+void
+tt_new_search(struct Tt *tt) {
+  tt->generation = (uint8_t)((tt->generation + 1) & 0x3F);
+}
+
+const struct TtEntry *
+tt_probe(const struct Tt *tt, uint64_t key) {
+  const struct TtBucket *bucket = tt_bucket(tt, key);
+  for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    if (bucket->entries[i].key == key) {
+      return &bucket->entries[i];
+    }
+  }
+  return NULL;
+}
+
+static inline int
+entry_age(const struct Tt *tt, const struct TtEntry *entry) {
+  return (tt->generation - (entry->bound >> 2)) & 0x3F;
+}
+
+void
+tt_store(struct Tt *tt, uint64_t key, Move move, int score, int eval, int depth, int bound) {
+  // The position's own slot if it has one, otherwise the slot worth least: shallow and old
+  struct TtBucket *bucket = tt_bucket(tt, key);
+  struct TtEntry *replace = &bucket->entries[0];
+  for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    struct TtEntry *entry = &bucket->entries[i];
+    if (entry->key == key || entry->key == 0) {
+      replace = entry;
+      break;
+    }
+    if (entry->depth - (8 * entry_age(tt, entry)) < replace->depth - (8 * entry_age(tt, replace))) {
+      replace = entry;
+    }
+  }
+
+  // A shallower result for the same position keeps the move it already had
+  if (replace->key == key && move == MOVE_NONE) {
+    move = replace->move;
+  }
+  if (replace->key == key && bound != TT_BOUND_EXACT && depth + 2 < replace->depth && entry_age(tt, replace) == 0) {
+    return;
+  }
+
+  replace->key = key;
+  replace->move = move;
+  replace->score = (int16_t)score;
+  replace->eval = (int16_t)eval;
+  replace->depth = (uint8_t)(depth < 0 ? 0 : depth);
+  replace->bound = (uint8_t)(bound | (tt->generation << 2));
+}
+
+int
+tt_hashfull(const struct Tt *tt) {
+  int used = 0;
+  size_t buckets = (tt->mask + 1) < 250 ? (tt->mask + 1) : 250;
+  for (size_t b = 0; b < buckets; b++) {
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+      const struct TtEntry *entry = &tt->buckets[b].entries[i];
+      used += entry->key != 0 && entry_age(tt, entry) == 0;
+    }
+  }
+  return (int)((used * 1000) / (buckets * TT_BUCKET_ENTRIES));
+}
@@ -0,0 +1,65 @@
+#ifndef TT_H
+#define TT_H
+
+#include "stddef.h"
+#include "stdint.h"
+#include "arena.h"
+#include "position.h"
+
+// Transposition table: what search found out about positions it has already been to, keyed
+// by struct Position's hash. Entries are 16 bytes in buckets of four, one cache line, and a
+// probe only ever reads its own bucket. Storing keeps whatever was searched deepest and
+// pushes out entries left over from earlier searches first.
+
+#define TT_BUCKET_ENTRIES 4
+
+enum TtBound {
+  TT_BOUND_NONE,
+  TT_BOUND_UPPER, // every move failed low, the score is at most this
+  TT_BOUND_LOWER, // a move failed high, the score is at least this
+  TT_BOUND_EXACT
+};
+
+struct TtEntry {
+  uint64_t key; // the whole hash, 0 for an empty slot
+  Move move; // best or refuting move, MOVE_NONE if there wasn't one
+  int16_t score; // mate scores are from this position, not the root (see search.c)
+  int16_t eval; // static evaluation
+  uint8_t depth;
+  uint8_t bound; // TtBound in the low two bits, the generation that stored it above them
+};
+
+struct TtBucket {
+  struct TtEntry entries[TT_BUCKET_ENTRIES];
+} __attribute__((aligned(64)));
+
+struct Tt {
+  struct TtBucket *buckets;
+  size_t mask; // bucket count - 1, it's a power of two
+  uint8_t generation; // bumped by every new search, kept in the top six bits of bound
+};
+
+// Takes the biggest power of two buckets that fits in bytes out of the arena,
+// returns -1 if not even one does
+int tt_init(struct Tt *tt, struct Arena *arena, size_t bytes);
+void tt_clear(struct Tt *tt);
+void tt_new_search(struct Tt *tt);
+
+static inline struct TtBucket *
+tt_bucket(const struct Tt *tt, uint64_t key) {
+  return &tt->buckets[key & tt->mask];
+}
+
+static inline int
+tt_bound(const struct TtEntry *entry) {
+  return entry->bound & 3;
+}
+
+// NULL when the position isn't in the table
+const struct TtEntry *tt_probe(const struct Tt *tt, uint64_t key);
+void tt_store(struct Tt *tt, uint64_t key, Move move, int score, int eval, int depth, int bound);
+
+// Per mille of the first thousand entries that are from the current search
+int tt_hashfull(const struct Tt *tt);
+
+#endif
@@ -0,0 +1,179 @@
+#include "stddef.h"
+#include "stdint.h"
+#include "string.h"
+#include "raylib.h"
+#include "arena.h"
+#include "tween.h"
+
+// GCC vector extensions (clang has them too). The repo builds at -O2 -std=c99 where
+// GCC won't vectorize the update loop by itself, so it's written a vector at a time.
+typedef float TweenFloats __attribute__((vector_size(TWEEN_LANES * sizeof (float))));
+typedef int32_t TweenMask __attribute__((vector_size(TWEEN_LANES * sizeof (int32_t))));
+
+// a, b, c of each easing's cubic, indexed by TweenEasing
+static const float easing_coefficients[TWEEN_EASING_COUNT][3] = {
+  {1.0f, 0.0f, 0.0f}, // t
+  {2.0f, -1.0f, 0.0f}, // t * (2 - t)
+  {0.0f, 3.0f, -2.0f} // t * t * (3 - 2t)
+};
+
+struct Tweens *
+tweens_create(struct Arena *arena, int num_keys) {
+  struct Tweens *tweens = ARENA_ALLOC_ZERO_ARRAY(arena, struct Tweens, 1);
+  if (tweens == NULL) {
+    return NULL;
+  }
+  tweens->num_keys = num_keys;
+  int rows = TWEEN_ROWS(num_keys);
+
+  // Cache line aligned and zeroed, the update runs over the padding rows too
+  float **floats[TWEEN_FLOATS] = {
+    &tweens->start_x, &tweens->start_y, &tweens->start_z,
+    &tweens->end_x, &tweens->end_y, &tweens->end_z,
+    &tweens->start_fade, &tweens->end_fade,
+    &tweens->ease_a, &tweens->ease_b, &tweens->ease_c,
+    &tweens->rate, &tweens->t,
+    &tweens->x, &tweens->y, &tweens->z, &tweens->fade
+  };
+  for (int i = 0; i < TWEEN_FLOATS; i++) {
+    *floats[i] = arena_alloc_zero(arena, rows * sizeof (float), 64);
+    if (*floats[i] == NULL) {
+      return NULL;
+    }
+  }
+
+  tweens->keys = arena_alloc(arena, rows * sizeof (int), 64);
+  tweens->slots = arena_alloc(arena, num_keys * sizeof (int), 64);
+  if (tweens->keys == NULL || tweens->slots == NULL) {
+    return NULL;
+  }
+
+  tweens_clear(tweens);
+  return tweens;
+}
+
+void
+tweens_clear(struct Tweens *tweens) {
+  tweens->count = 0;
+  for (int key = 0; key < tweens->num_keys; key++) {
+    tweens->slots[key] = -1;
+  }
+}
+
+static int
+start(struct Tweens *tweens, int key, Vector3 from, Vector3 to, float duration, int easing, float elapsed) {
+  int row = tweens->slots[key];
+  if (row < 0) {
+    row = tweens->count++;
+    tweens->slots[key] = row;
+    tweens->keys[row] = key;
+  }
+
+  tweens->start_x[row] = tweens->x[row] = from.x;
+  tweens->start_y[row] = tweens->y[row] = from.y;
+  tweens->start_z[row] = tweens->z[row] = from.z;
+  tweens->end_x[row] = to.x;
+  tweens->end_y[row] = to.y;
+  tweens->end_z[row] = to.z;
+  tweens->ease_a[row] = easing_coefficients[easing][0];
+  tweens->ease_b[row] = easing_coefficients[easing][1];
+  tweens->ease_c[row] = easing_coefficients[easing][2];
+  tweens->rate[row] = 1.0f / duration;
+  tweens->t[row] = elapsed > 0.0f ? elapsed / duration : 0.0f;
+  return row;
+}
+
+void
+tween_move(struct Tweens *tweens, int key, Vector3 start_position, Vector3 end, float duration, int easing, float elapsed) {
+  int row = start(tweens, key, start_position, end, duration, easing, elapsed);
+  tweens->start_fade[row] = tweens->end_fade[row] = tweens->fade[row] = 1.0f;
+}
+
+void
+tween_fade_out(struct Tweens *tweens, int key, Vector3 at, float duration, float elapsed) {
+  int row = start(tweens, key, at, at, duration, TWEEN_LINEAR, elapsed);
+  tweens->start_fade[row] = tweens->fade[row] = 1.0f;
+  tweens->end_fade[row] = 0.0f;
+}
+
+static void
+remove_row(struct Tweens *tweens, int row) {
+  int last = --tweens->count;
+  tweens->slots[tweens->keys[row]] = -1;
+  if (row == last) {
+    tweens->t[last] = tweens->rate[last] = 0.0f; // so the padding never looks finished
+    return;
+  }
+
+  float *floats[TWEEN_FLOATS] = {
+    tweens->start_x, tweens->start_y, tweens->start_z,
+    tweens->end_x, tweens->end_y, tweens->end_z,
+    tweens->start_fade, tweens->end_fade,
+    tweens->ease_a, tweens->ease_b, tweens->ease_c,
+    tweens->rate, tweens->t,
+    tweens->x, tweens->y, tweens->z, tweens->fade
+  };
+  for (int i = 0; i < TWEEN_FLOATS; i++) {
+    floats[i][row] = floats[i][last];
+  }
+  tweens->keys[row] = tweens->keys[last];
+  tweens->slots[tweens->keys[row]] = row;
+  tweens->t[last] = tweens->rate[last] = 0.0f;
+}
+
+void
+tween_stop(struct Tweens *tweens, int key) {
+  int row = tweens->slots[key];
+  if (row >= 0) {
+    remove_row(tweens, row);
+  }
+}
+
+void
+tweens_update(struct Tweens *tweens, float dt) {
+  // Rows past count hold finished or zeroed tweens, working on them is harmless and keeps
+  // every step a whole vector
+  const TweenFloats zeros = {0};
+  const TweenFloats ones = zeros + 1.0f;
+  const TweenFloats step = zeros + dt;
+  TweenMask finished = {0};
+
+  for (int i = 0; i < tweens->count; i += TWEEN_LANES) {
+    TweenFloats t = *(TweenFloats *)&tweens->t[i] + (step * *(const TweenFloats *)&tweens->rate[i]);
+    TweenMask running = t < ones;
+    finished |= ~running;
+    t = (TweenFloats)(((TweenMask)t & running) | ((TweenMask)ones & ~running));
+    *(TweenFloats *)&tweens->t[i] = t;
+
+    TweenFloats eased = t * (*(const TweenFloats *)&tweens->ease_a[i] +
+                             (t * (*(const TweenFloats *)&tweens->ease_b[i] +
+                                   (t * *(const TweenFloats *)&tweens->ease_c[i]))));
+
+    TweenFloats start_x = *(const TweenFloats *)&tweens->start_x[i];
+    TweenFloats start_y = *(const TweenFloats *)&tweens->start_y[i];
+    TweenFloats start_z = *(const TweenFloats *)&tweens->start_z[i];
+    TweenFloats start_fade = *(const TweenFloats *)&tweens->start_fade[i];
+    *(TweenFloats *)&tweens->x[i] = start_x + ((*(const TweenFloats *)&tweens->end_x[i] - start_x) * eased);
+    *(TweenFloats *)&tweens->y[i] = start_y + ((*(const TweenFloats *)&tweens->end_y[i] - start_y) * eased);
+    *(TweenFloats *)&tweens->z[i] = start_z + ((*(const TweenFloats *)&tweens->end_z[i] - start_z) * eased);
+    *(TweenFloats *)&tweens->fade[i] = start_fade + ((*(const TweenFloats *)&tweens->end_fade[i] - start_fade) * eased);
+  }
+
+  int any_finished = 0;
+  for (int lane = 0; lane < TWEEN_LANES; lane++) {
+    any_finished |= finished[lane];
+  }
+  if (!any_finished) {
+    return;
+  }
+
+  // Finished ones are already drawn at their end, the last row fills each gap
+  for (int i = 0; i < tweens->count;) {
+    if (tweens->t[i] >= 1.0f) {
+      remove_row(tweens, i);
+    }
+    else {
+      i++;
+    }
+  }
+}
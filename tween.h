@@ -0,0 +1,84 @@
+#ifndef TWEEN_H
+#define TWEEN_H
+
+#include "stddef.h"
+#include "stdint.h"
+#include "raylib.h"
+#include "arena.h"
+
+// Piece animations. Every running tween is one row across flat arrays, so a frame's update is
+// a single branch free loop that works on TWEEN_LANES rows at a time, and thousands of them
+// cost next to nothing. Each tween animates one key (a piece on a board) and a key has at most
+// one, starting another replaces it. Finished tweens are dropped at the end of the update,
+// after that the piece is drawn where the game says it is.
+
+#define TWEEN_MOVE_SECONDS 0.25f
+#define TWEEN_FADE_SECONDS 0.35f // captured pieces
+
+enum TweenEasing {
+  TWEEN_LINEAR,
+  TWEEN_EASE_OUT, // fast start, settles gently
+  TWEEN_SMOOTH, // eases in and out
+  TWEEN_EASING_COUNT
+};
+
+// Rows updated per step, the arrays are padded to a whole number of them
+#define TWEEN_LANES 4
+#define TWEEN_ROWS(num_keys) ((((num_keys) + TWEEN_LANES - 1) / TWEEN_LANES) * TWEEN_LANES)
+
+// Floats and ints per row, what TWEENS_ARENA_SIZE is made of
+#define TWEEN_FLOATS 17
+#define TWEEN_INTS 2
+
+// What tweens_create takes out of an arena, alignment padding included
+#define TWEENS_ARENA_SIZE(num_keys) (sizeof (struct Tweens) + \
+                                     ((size_t)TWEEN_ROWS(num_keys) * ((TWEEN_FLOATS * sizeof (float)) + (TWEEN_INTS * sizeof (int)))) + \
+                                     ((TWEEN_FLOATS + TWEEN_INTS) * 64))
+
+struct Tweens {
+  int count;
+  int num_keys; // also the capacity, every key can be animating at once
+
+  // Set when a tween starts. Easings are all cubics, eased = t * (a + t * (b + t * c)),
+  // so every tween runs the same arithmetic whatever its easing.
+  float *start_x, *start_y, *start_z;
+  float *end_x, *end_y, *end_z;
+  float *start_fade, *end_fade;
+  float *ease_a, *ease_b, *ease_c;
+  float *rate; // 1 / duration
+  float *t; // 0 to 1
+  int *keys;
+
+  // Where each tween has got to as of the last update
+  float *x, *y, *z;
+  float *fade; // 1 is opaque
+
+  int *slots; // per key, the row animating it or -1
+};
+
+struct Tweens *tweens_create(struct Arena *arena, int num_keys);
+void tweens_clear(struct Tweens *tweens);
+
+// Slides key from start to end. elapsed is how long ago the move really happened,
+// the tween starts that far along so it ends on time.
+void tween_move(struct Tweens *tweens, int key, Vector3 start, Vector3 end, float duration, int easing, float elapsed);
+// Leaves key where it is and fades it out
+void tween_fade_out(struct Tweens *tweens, int key, Vector3 at, float duration, float elapsed);
+
+// Drops key's tween, if it has one, so it's drawn where the game says straight away
+void tween_stop(struct Tweens *tweens, int key);
+
+void tweens_update(struct Tweens *tweens, float dt);
+
+// The row animating key, -1 if it isn't moving
+static inline int
+tween_of(const struct Tweens *tweens, int key) {
+  return tweens->slots[key];
+}
+
+static inline Vector3
+tween_position(const struct Tweens *tweens, int row) {
+  return (Vector3){tweens->x[row], tweens->y[row], tweens->z[row]};
+}
+
+#endif